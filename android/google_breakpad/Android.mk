@@ -79,6 +79,7 @@ LOCAL_SRC_FILES := \
     src/client/linux/microdump_writer/microdump_writer.cc \
     src/client/linux/minidump_writer/linux_dumper.cc \
     src/client/linux/minidump_writer/linux_ptrace_dumper.cc \
+    src/client/linux/minidump_writer/minidump_compressor.cc \
     src/client/linux/minidump_writer/minidump_writer.cc \
     src/client/minidump_file_writer.cc \
     src/common/convert_UTF.cc \
@@ -97,7 +98,7 @@ LOCAL_C_INCLUDES        := $(LOCAL_PATH)/src/common/android/include \
                            $(LSS_PATH)
 
 LOCAL_EXPORT_C_INCLUDES := $(LOCAL_C_INCLUDES)
-LOCAL_EXPORT_LDLIBS     := -llog
+LOCAL_EXPORT_LDLIBS     := -llog -lz
 
 include $(BUILD_STATIC_LIBRARY)
 
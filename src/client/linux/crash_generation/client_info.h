@@ -30,6 +30,9 @@
 #ifndef CLIENT_LINUX_CRASH_GENERATION_CLIENT_INFO_H_
 #define CLIENT_LINUX_CRASH_GENERATION_CLIENT_INFO_H_
 
+#include <stdint.h>
+#include <sys/types.h>
+
 namespace google_breakpad {
 
 class CrashGenerationServer;
@@ -38,14 +41,27 @@ class ClientInfo {
  public:
   ClientInfo(pid_t pid, CrashGenerationServer* crash_server)
     : crash_server_(crash_server),
-      pid_(pid) {}
+      pid_(pid),
+      queue_latency_us_(0),
+      dump_latency_us_(0) {}
 
   CrashGenerationServer* crash_server() const { return crash_server_; }
   pid_t pid() const { return pid_; }
 
+  // The time, in microseconds, that the client's dump request waited for
+  // a worker thread, and that its minidump took to write.
+  uint64_t queue_latency_us() const { return queue_latency_us_; }
+  uint64_t dump_latency_us() const { return dump_latency_us_; }
+  void set_latencies(uint64_t queue_latency_us, uint64_t dump_latency_us) {
+    queue_latency_us_ = queue_latency_us;
+    dump_latency_us_ = dump_latency_us;
+  }
+
  private:
   CrashGenerationServer* crash_server_;
   pid_t pid_;
+  uint64_t queue_latency_us_;
+  uint64_t dump_latency_us_;
 };
 
 }
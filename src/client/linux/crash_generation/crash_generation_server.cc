@@ -37,6 +37,7 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <vector>
@@ -51,6 +52,12 @@
 
 static const char kCommandQuit = 'x';
 
+static uint64_t NowMicroseconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
 namespace google_breakpad {
 
 CrashGenerationServer::CrashGenerationServer(
@@ -67,18 +74,29 @@ CrashGenerationServer::CrashGenerationServer(
     exit_callback_(exit_callback),
     exit_context_(exit_context),
     generate_dumps_(generate_dumps),
-    started_(false)
+    started_(false),
+    worker_count_(0),
+    max_queued_dumps_(16),
+    stopping_(false)
 {
   if (dump_path)
     dump_dir_ = *dump_path;
   else
     dump_dir_ = "/tmp";
+
+  pthread_mutex_init(&queue_lock_, NULL);
+  pthread_cond_init(&queue_not_empty_, NULL);
+  pthread_cond_init(&queue_not_full_, NULL);
 }
 
 CrashGenerationServer::~CrashGenerationServer()
 {
   if (started_)
     Stop();
+
+  pthread_cond_destroy(&queue_not_full_);
+  pthread_cond_destroy(&queue_not_empty_);
+  pthread_mutex_destroy(&queue_lock_);
 }
 
 bool
@@ -102,9 +120,22 @@ CrashGenerationServer::Start()
   control_pipe_in_ = control_pipe[0];
   control_pipe_out_ = control_pipe[1];
 
+  stopping_ = false;
+  for (int i = 0; i < worker_count_; ++i) {
+    pthread_t worker;
+    if (pthread_create(&worker, NULL,
+                       WorkerMain, reinterpret_cast<void*>(this))) {
+      StopWorkers();
+      return false;
+    }
+    workers_.push_back(worker);
+  }
+
   if (pthread_create(&thread_, NULL,
-                     ThreadMain, reinterpret_cast<void*>(this)))
+                     ThreadMain, reinterpret_cast<void*>(this))) {
+    StopWorkers();
     return false;
+  }
 
   started_ = true;
   return true;
@@ -123,6 +154,9 @@ CrashGenerationServer::Stop()
   void* dummy;
   pthread_join(thread_, &dummy);
 
+  // No more requests can be queued now.
+  StopWorkers();
+
   close(control_pipe_in_);
   close(control_pipe_out_);
 
@@ -260,28 +294,93 @@ CrashGenerationServer::ClientEvent(short revents)
     return true;
   }
 
-  string minidump_filename;
-  if (!MakeMinidumpFilename(minidump_filename))
-    return true;
+  DumpRequest request;
+  request.crashing_pid = crashing_pid;
+  request.signal_fd = signal_fd;
+  request.received_us = NowMicroseconds();
+  request.crash_context.assign(crash_context,
+                               crash_context + kCrashContextSize);
 
-  if (!google_breakpad::WriteMinidump(minidump_filename.c_str(),
-                                      crashing_pid, crash_context,
-                                      kCrashContextSize)) {
-    close(signal_fd);
+  if (workers_.empty()) {
+    DumpClient(request);
     return true;
   }
 
+  // Don't receive any more requests until there's room for this one.
+  // Clients that crash in the meantime block sending theirs.
+  pthread_mutex_lock(&queue_lock_);
+  while (!queue_.empty() && queue_.size() >= max_queued_dumps_)
+    pthread_cond_wait(&queue_not_full_, &queue_lock_);
+  queue_.push_back(request);
+  pthread_cond_signal(&queue_not_empty_);
+  pthread_mutex_unlock(&queue_lock_);
+
+  return true;
+}
+
+void
+CrashGenerationServer::DumpClient(const DumpRequest& request)
+{
+  const uint64_t start_us = NowMicroseconds();
+
+  string minidump_filename;
+  if (!MakeMinidumpFilename(minidump_filename) ||
+      !google_breakpad::WriteMinidump(minidump_filename.c_str(),
+                                      request.crashing_pid,
+                                      &request.crash_context[0],
+                                      request.crash_context.size())) {
+    close(request.signal_fd);
+    return;
+  }
+
   if (dump_callback_) {
-    ClientInfo info(crashing_pid, this);
+    ClientInfo info(request.crashing_pid, this);
+    info.set_latencies(start_us - request.received_us,
+                       NowMicroseconds() - start_us);
 
     dump_callback_(dump_context_, &info, &minidump_filename);
   }
 
   // Send the done signal to the process: it can exit now.
   // (Closing this will make the child's sys_read unblock and return 0.)
-  close(signal_fd);
+  close(request.signal_fd);
+}
 
-  return true;
+// The following methods execute on the worker threads
+
+void
+CrashGenerationServer::RunWorker()
+{
+  while (true) {
+    pthread_mutex_lock(&queue_lock_);
+    while (queue_.empty() && !stopping_)
+      pthread_cond_wait(&queue_not_empty_, &queue_lock_);
+    if (queue_.empty()) {
+      pthread_mutex_unlock(&queue_lock_);
+      return;
+    }
+    DumpRequest request = queue_.front();
+    queue_.pop_front();
+    pthread_cond_signal(&queue_not_full_);
+    pthread_mutex_unlock(&queue_lock_);
+
+    DumpClient(request);
+  }
+}
+
+void
+CrashGenerationServer::StopWorkers()
+{
+  pthread_mutex_lock(&queue_lock_);
+  stopping_ = true;
+  pthread_cond_broadcast(&queue_not_empty_);
+  pthread_mutex_unlock(&queue_lock_);
+
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    void* dummy;
+    pthread_join(workers_[i], &dummy);
+  }
+  workers_.clear();
 }
 
 bool
@@ -330,4 +429,12 @@ CrashGenerationServer::ThreadMain(void *arg)
   return NULL;
 }
 
+// static
+void*
+CrashGenerationServer::WorkerMain(void *arg)
+{
+  reinterpret_cast<CrashGenerationServer*>(arg)->RunWorker();
+  return NULL;
+}
+
 }  // namespace google_breakpad
@@ -31,8 +31,12 @@
 #define CLIENT_LINUX_CRASH_GENERATION_CRASH_GENERATION_SERVER_H_
 
 #include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
 
+#include <deque>
 #include <string>
+#include <vector>
 
 #include "common/using_std_string.h"
 
@@ -44,7 +48,14 @@ class CrashGenerationServer {
 public:
   // WARNING: callbacks may be invoked on a different thread
   // than that which creates the CrashGenerationServer.  They must
-  // be thread safe.
+  // be thread safe.  With more than one worker thread (see
+  // set_worker_count()), the dump callback may also run concurrently
+  // with itself, once for each client being dumped.
+  //
+  // The server traces the clients it dumps from its own threads. If this
+  // process is also the parent of a client, it must not wait for it while
+  // it is dumped: the kernel reports the stops of a tracee to any thread
+  // of the tracer's process that waits for it as its parent.
   typedef void (*OnClientDumpRequestCallback)(void* context,
                                               const ClientInfo* client_info,
                                               const string* file_path);
@@ -75,6 +86,18 @@ public:
 
   ~CrashGenerationServer();
 
+  // Write up to |count| dumps concurrently, each on a worker thread,
+  // rather than on the thread that receives dump requests. Must be called
+  // before Start(). With a |count| above one, the dump callback is not
+  // serialized: each worker invokes it as soon as its dump is written, so
+  // calls may overlap and must guard any state they share.
+  void set_worker_count(int count) { worker_count_ = count; }
+
+  // With worker threads, stop receiving dump requests while |max| of them
+  // are waiting for a worker, so that further crashing clients block
+  // instead of queueing without bound. Must be called before Start().
+  void set_max_queued_dumps(size_t max) { max_queued_dumps_ = max; }
+
   // Perform initialization steps needed to start listening to clients.
   //
   // Return true if initialization is successful; false otherwise.
@@ -104,9 +127,29 @@ private:
   // Return a unique filename at which a minidump can be written
   bool MakeMinidumpFilename(string& outFilename);
 
+  // A dump request received from a client, waiting for a worker thread.
+  struct DumpRequest {
+    pid_t crashing_pid;
+    int signal_fd;
+    uint64_t received_us;
+    std::vector<char> crash_context;
+  };
+
+  // Write the minidump for a request and let the client go.
+  void DumpClient(const DumpRequest& request);
+
+  // Run a worker thread, writing queued dumps until the server stops.
+  void RunWorker();
+
+  // Let the worker threads finish the queued dumps, and wait for them.
+  void StopWorkers();
+
   // Trampoline to |Run()|
   static void* ThreadMain(void* arg);
 
+  // Trampoline to |RunWorker()|
+  static void* WorkerMain(void* arg);
+
   int server_fd_;
 
   OnClientDumpRequestCallback dump_callback_;
@@ -125,6 +168,18 @@ private:
   int control_pipe_in_;
   int control_pipe_out_;
 
+  int worker_count_;
+  size_t max_queued_dumps_;
+  std::vector<pthread_t> workers_;
+
+  // Dump requests waiting for a worker, and the state shared with the
+  // workers, guarded by queue_lock_.
+  pthread_mutex_t queue_lock_;
+  pthread_cond_t queue_not_empty_;
+  pthread_cond_t queue_not_full_;
+  std::deque<DumpRequest> queue_;
+  bool stopping_;
+
   // disable these
   CrashGenerationServer(const CrashGenerationServer&);
   CrashGenerationServer& operator=(const CrashGenerationServer&);
@@ -0,0 +1,187 @@
+// Copyright (c) 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// crash_generation_server_unittest.cc: Unit tests for
+// google_breakpad::CrashGenerationServer.
+
+#include <pthread.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "breakpad_googletest_includes.h"
+#include "client/linux/crash_generation/client_info.h"
+#include "client/linux/crash_generation/crash_generation_client.h"
+#include "client/linux/crash_generation/crash_generation_server.h"
+#include "client/linux/handler/exception_handler.h"
+#include "common/linux/eintr_wrapper.h"
+#include "common/tests/auto_tempdir.h"
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/minidump.h"
+
+using namespace google_breakpad;
+
+namespace {
+
+struct DumpRecord {
+  pthread_mutex_t lock;
+  std::set<pid_t> pids;
+  std::set<string> paths;
+  uint64_t total_dump_latency_us;
+};
+
+void OnClientDumpRequest(void* context, const ClientInfo* client_info,
+                         const string* file_path) {
+  DumpRecord* record = reinterpret_cast<DumpRecord*>(context);
+  pthread_mutex_lock(&record->lock);
+  record->pids.insert(client_info->pid());
+  record->paths.insert(*file_path);
+  record->total_dump_latency_us += client_info->dump_latency_us();
+  pthread_mutex_unlock(&record->lock);
+}
+
+void* SleepForever(void*) {
+  for (;;)
+    pause();
+  return NULL;
+}
+
+// Fork |count| processes of |thread_count| threads that each ask the server
+// listening on the other end of |client_fd| for a dump of themselves.
+// Returns the number that were dumped successfully.
+//
+// As the server traces them from this process, waiting for them could take
+// the stops of their threads while they are dumped. So each reports its
+// dump over a pipe, and they are only waited for once all have done so.
+int RequestDumps(int client_fd, int count, int thread_count) {
+  int fds[2];
+  if (pipe(fds) == -1)
+    return -1;
+
+  std::vector<pid_t> children;
+  for (int i = 0; i < count; ++i) {
+    const pid_t child = fork();
+    if (child == 0) {
+      close(fds[0]);
+      for (int j = 1; j < thread_count; ++j) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, SleepForever, NULL) != 0)
+          _exit(1);
+      }
+      CrashGenerationClient* client =
+          CrashGenerationClient::TryCreate(client_fd);
+      ExceptionHandler::CrashContext context;
+      memset(&context, 0, sizeof(context));
+      getcontext(&context.context);
+      context.tid = syscall(__NR_gettid);
+      const char dumped =
+          client && client->RequestDump(&context, sizeof(context));
+      _exit(HANDLE_EINTR(write(fds[1], &dumped, 1)) == 1 ? 0 : 1);
+    }
+    if (child != -1)
+      children.push_back(child);
+  }
+  close(fds[1]);
+
+  int dumped = 0;
+  char result;
+  for (size_t i = 0; i < children.size() &&
+                     HANDLE_EINTR(read(fds[0], &result, 1)) == 1; ++i) {
+    dumped += result;
+  }
+  close(fds[0]);
+  for (size_t i = 0; i < children.size(); ++i)
+    HANDLE_EINTR(waitpid(children[i], NULL, 0));
+  return dumped;
+}
+
+void TestServer(int worker_count, size_t max_queued_dumps,
+                int thread_count) {
+  int server_fd, client_fd;
+  ASSERT_TRUE(CrashGenerationServer::CreateReportChannel(&server_fd,
+                                                         &client_fd));
+
+  AutoTempDir temp_dir;
+  const string dump_path = temp_dir.path();
+  DumpRecord record;
+  pthread_mutex_init(&record.lock, NULL);
+  record.total_dump_latency_us = 0;
+  {
+    CrashGenerationServer server(server_fd, OnClientDumpRequest, &record,
+                                 NULL, NULL, true, &dump_path);
+    server.set_worker_count(worker_count);
+    server.set_max_queued_dumps(max_queued_dumps);
+    ASSERT_TRUE(server.Start());
+
+    const int kClients = 6;
+    EXPECT_EQ(kClients, RequestDumps(client_fd, kClients, thread_count));
+    server.Stop();
+
+    EXPECT_EQ(static_cast<size_t>(kClients), record.pids.size());
+    EXPECT_EQ(static_cast<size_t>(kClients), record.paths.size());
+    for (std::set<string>::const_iterator path = record.paths.begin();
+         path != record.paths.end(); ++path) {
+      Minidump minidump(*path);
+      ASSERT_TRUE(minidump.Read()) << *path;
+      MinidumpThreadList* threads = minidump.GetThreadList();
+      ASSERT_TRUE(threads) << *path;
+      EXPECT_EQ(static_cast<unsigned>(thread_count), threads->thread_count());
+    }
+    EXPECT_LT(0U, record.total_dump_latency_us);
+  }
+  pthread_mutex_destroy(&record.lock);
+  close(server_fd);
+  close(client_fd);
+}
+
+}  // namespace
+
+TEST(CrashGenerationServerTest, DumpsOnServerThread) {
+  TestServer(0, 16, 1);
+}
+
+TEST(CrashGenerationServerTest, DumpsOnWorkerThreads) {
+  TestServer(3, 16, 1);
+}
+
+TEST(CrashGenerationServerTest, DumpsMultithreadedClientsOnWorkerThreads) {
+  // The workers suspend several processes' threads at once.
+  TestServer(3, 16, 8);
+}
+
+TEST(CrashGenerationServerTest, BoundedQueue) {
+  TestServer(2, 1, 4);
+}
@@ -58,6 +58,7 @@ struct MappingInfo {
   } system_mapping_info;
   size_t offset;  // offset into the backed file.
   bool exec;  // true if the mapping has the execute bit set.
+  bool writable;  // true if the mapping has the write bit set.
   char name[NAME_MAX];
 };
 
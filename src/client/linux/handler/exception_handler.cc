@@ -74,6 +74,7 @@
 #include <stdio.h>
 #include <sys/mman.h>
 #include <sys/prctl.h>
+#include <sys/socket.h>
 #include <sys/syscall.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -92,7 +93,9 @@
 #include "common/memory_allocator.h"
 #include "client/linux/log/log.h"
 #include "client/linux/microdump_writer/microdump_writer.h"
+#include "client/linux/minidump_writer/directory_reader.h"
 #include "client/linux/minidump_writer/linux_dumper.h"
+#include "client/linux/minidump_writer/minidump_compressor.h"
 #include "client/linux/minidump_writer/minidump_writer.h"
 #include "common/linux/eintr_wrapper.h"
 #include "third_party/lss/linux_syscall_support.h"
@@ -200,6 +203,26 @@ void InstallDefaultHandler(int sig) {
 #endif
 }
 
+// Closes every descriptor but the standard ones and |keep|, so that the dump
+// helper doesn't hold files, sockets or pipes of the process it dumps open.
+// Runs on the dump helper, before it serves any request.
+void CloseInheritedDescriptors(int keep) {
+  const int dir_fd = sys_open("/proc/self/fd", O_RDONLY | O_DIRECTORY, 0);
+  if (dir_fd < 0)
+    return;
+  DirectoryReader reader(dir_fd);
+  const char* name;
+  while (reader.GetNextEntry(&name)) {
+    int fd;
+    if (my_strtoui(&fd, name) && fd > STDERR_FILENO && fd != keep &&
+        fd != dir_fd) {
+      sys_close(fd);
+    }
+    reader.PopEntry();
+  }
+  sys_close(dir_fd);
+}
+
 // The global exception handler stack. This is needed because there may exist
 // multiple ExceptionHandler instances in a process. Each will have itself
 // registered in this stack.
@@ -257,6 +280,8 @@ ExceptionHandler::ExceptionHandler(const MinidumpDescriptor& descriptor,
 
 // Runs before crashing: normal context.
 ExceptionHandler::~ExceptionHandler() {
+  StopDumpHelper();
+
   pthread_mutex_lock(&g_handler_stack_mutex_);
   std::vector<ExceptionHandler*>::iterator handler =
       std::find(g_handler_stack_->begin(), g_handler_stack_->end(), this);
@@ -499,6 +524,13 @@ bool ExceptionHandler::GenerateDump(CrashContext *context) {
   if (IsOutOfProcess())
     return crash_generation_client_->RequestDump(context, sizeof(*context));
 
+  bool dumped = false;
+  if (RequestDumpFromHelper(context, false, &dumped, NULL)) {
+    if (callback_)
+      dumped = callback_(minidump_descriptor_, callback_context_, dumped);
+    return dumped;
+  }
+
   // Allocating too much stack isn't a problem, and better to err on the side
   // of caution than smash it into random locations.
   static const unsigned kChildStackSize = 16000;
@@ -605,6 +637,9 @@ bool ExceptionHandler::DoDump(pid_t crashing_process, const void* context,
   const uintptr_t principal_mapping_address =
       minidump_descriptor_.address_within_principal_mapping();
   const bool sanitize_stacks = minidump_descriptor_.sanitize_stacks();
+  const int stack_trim_slack = minidump_descriptor_.stack_trim_slack();
+  const size_t heap_capture_budget =
+      minidump_descriptor_.heap_capture_budget();
   if (minidump_descriptor_.IsMicrodumpOnConsole()) {
     return google_breakpad::WriteMicrodump(
         crashing_process,
@@ -617,27 +652,437 @@ bool ExceptionHandler::DoDump(pid_t crashing_process, const void* context,
         *minidump_descriptor_.microdump_extra_info());
   }
   if (minidump_descriptor_.IsFD()) {
-    return google_breakpad::WriteMinidump(minidump_descriptor_.fd(),
-                                          minidump_descriptor_.size_limit(),
-                                          crashing_process,
-                                          context,
-                                          context_size,
-                                          mapping_list_,
-                                          app_memory_list_,
-                                          may_skip_dump,
-                                          principal_mapping_address,
-                                          sanitize_stacks);
-  }
-  return google_breakpad::WriteMinidump(minidump_descriptor_.path(),
-                                        minidump_descriptor_.size_limit(),
-                                        crashing_process,
-                                        context,
-                                        context_size,
-                                        mapping_list_,
-                                        app_memory_list_,
-                                        may_skip_dump,
-                                        principal_mapping_address,
-                                        sanitize_stacks);
+    return DoDumpToFD(crashing_process, context, context_size,
+                      minidump_descriptor_.fd());
+  }
+  if (!google_breakpad::WriteMinidump(minidump_descriptor_.path(),
+                                      minidump_descriptor_.size_limit(),
+                                      crashing_process,
+                                      context,
+                                      context_size,
+                                      mapping_list_,
+                                      app_memory_list_,
+                                      may_skip_dump,
+                                      principal_mapping_address,
+                                      sanitize_stacks,
+                                      stack_trim_slack,
+                                      heap_capture_budget)) {
+    return false;
+  }
+  if (!minidump_descriptor_.compress())
+    return true;
+  const int fd = sys_open(minidump_descriptor_.path(), O_RDWR, 0);
+  if (fd < 0)
+    return false;
+  const bool compressed = google_breakpad::CompressMinidumpFile(fd);
+  sys_close(fd);
+  return compressed;
+}
+
+// What a dump request sends the dump helper after the crash context, along
+// with the descriptors of the file to write and of a socket for the rest of
+// the request and the replies. The helper's copy of this process's state
+// dates from when it started, so the request carries the dump options of
+// minidump_descriptor_, and is followed on that socket by one message for
+// each of the mappings and app memory regions to dump.
+struct ExceptionHandler::DumpHelperRequest {
+  bool snapshot;
+  off_t size_limit;
+  bool skip_dump_if_principal_mapping_not_referenced;
+  uintptr_t address_within_principal_mapping;
+  bool sanitize_stacks;
+  bool compress;
+  int stack_trim_slack;
+  size_t heap_capture_budget;
+  size_t mapping_count;
+  size_t app_memory_count;
+};
+
+// What the dump helper sends back for each request. A snapshot gets one
+// reply once the threads resume, and another once the minidump is written.
+struct ExceptionHandler::DumpHelperReply {
+  bool complete;
+  bool succeeded;
+  uint64_t pause_ns;
+};
+
+// This function runs in a compromised context: see the top of the file.
+// Runs on the dump helper, once the threads of a snapshot are resumed.
+// static
+void ExceptionHandler::SendSnapshotResumed(void* context, uint64_t pause_ns) {
+  DumpHelperReply reply;
+  my_memset(&reply, 0, sizeof(reply));
+  reply.succeeded = true;
+  reply.pause_ns = pause_ns;
+  ignore_result(HANDLE_EINTR(sys_write(*static_cast<int*>(context), &reply,
+                                       sizeof(reply))));
+}
+
+// This function runs in a compromised context: see the top of the file.
+// Runs on the cloned process or the dump helper.
+bool ExceptionHandler::DoDumpToFD(pid_t crashing_process, const void* context,
+                                  size_t context_size, int fd) {
+  const bool may_skip_dump =
+      minidump_descriptor_.skip_dump_if_principal_mapping_not_referenced();
+  const uintptr_t principal_mapping_address =
+      minidump_descriptor_.address_within_principal_mapping();
+  const bool sanitize_stacks = minidump_descriptor_.sanitize_stacks();
+  const int stack_trim_slack = minidump_descriptor_.stack_trim_slack();
+  const size_t heap_capture_budget =
+      minidump_descriptor_.heap_capture_budget();
+  if (!google_breakpad::WriteMinidump(fd,
+                                      minidump_descriptor_.size_limit(),
+                                      crashing_process,
+                                      context,
+                                      context_size,
+                                      mapping_list_,
+                                      app_memory_list_,
+                                      may_skip_dump,
+                                      principal_mapping_address,
+                                      sanitize_stacks,
+                                      stack_trim_slack,
+                                      heap_capture_budget)) {
+    return false;
+  }
+  return !minidump_descriptor_.compress() ||
+         google_breakpad::CompressMinidumpFile(fd);
+}
+
+// This function runs in a compromised context: see the top of the file.
+// Runs on the dump helper.
+bool ExceptionHandler::DoSnapshotToFD(pid_t process, const void* context,
+                                      size_t context_size, int fd,
+                                      int reply_fd) {
+  if (!google_breakpad::WriteMinidumpSnapshot(
+          fd, minidump_descriptor_.size_limit(), process, context,
+          context_size, mapping_list_, app_memory_list_,
+          minidump_descriptor_.skip_dump_if_principal_mapping_not_referenced(),
+          minidump_descriptor_.address_within_principal_mapping(),
+          minidump_descriptor_.sanitize_stacks(),
+          minidump_descriptor_.stack_trim_slack(),
+          minidump_descriptor_.heap_capture_budget(), SendSnapshotResumed,
+          &reply_fd)) {
+    return false;
+  }
+  return !minidump_descriptor_.compress() ||
+         google_breakpad::CompressMinidumpFile(fd);
+}
+
+// Runs before crashing: normal context.
+bool ExceptionHandler::StartDumpHelper() {
+  StopDumpHelper();
+  if (IsOutOfProcess())
+    return false;
+
+  // A SOCK_SEQPACKET socket keeps each crash context in one message, and
+  // carries the descriptors of the file to write and of the reply socket
+  // alongside it.
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == -1)
+    return false;
+
+  const pid_t owner = getpid();
+  const pid_t helper = fork();
+  if (helper == -1) {
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  }
+
+  if (helper == 0) {
+    // Don't outlive the process we dump, and leave crashes of the helper
+    // itself to the default handlers rather than to this handler.
+    sys_prctl(PR_SET_PDEATHSIG, SIGKILL, 0, 0, 0);
+    if (sys_getppid() != owner)
+      _exit(0);
+    for (int i = 0; i < kNumHandledSignals; ++i)
+      InstallDefaultHandler(kExceptionSignals[i]);
+    CloseInheritedDescriptors(fds[1]);
+    RunDumpHelper(fds[1], owner);
+    _exit(0);
+  }
+
+  close(fds[1]);
+  dump_helper_pid_ = helper;
+  dump_helper_fd_ = fds[0];
+  dump_helper_owner_ = owner;
+  dump_helper_died_ = false;
+  return true;
+}
+
+// Runs before crashing: normal context.
+bool ExceptionHandler::HasDumpHelper() {
+  // PR_SET_PDEATHSIG kills the helper when the thread that started it
+  // exits, even if the rest of the process carries on.
+  if (dump_helper_pid_ > 0 && getpid() == dump_helper_owner_ &&
+      HANDLE_EINTR(waitpid(dump_helper_pid_, NULL, WNOHANG)) != 0) {
+    // It has been reaped, so StopDumpHelper() mustn't kill or wait for it.
+    dump_helper_owner_ = -1;
+    StopDumpHelper();
+    dump_helper_died_ = true;
+  }
+  return dump_helper_pid_ > 0;
+}
+
+// Runs before crashing: normal context.
+void ExceptionHandler::StopDumpHelper() {
+  if (dump_helper_pid_ <= 0)
+    return;
+
+  // Let a snapshot's minidump be completed rather than cut short.
+  WaitForSnapshot();
+  close(dump_helper_fd_);
+  // Only the process that started the helper can reap it. Processes forked
+  // from that one just forget about it.
+  if (getpid() == dump_helper_owner_) {
+    kill(dump_helper_pid_, SIGKILL);
+    ignore_result(HANDLE_EINTR(waitpid(dump_helper_pid_, NULL, 0)));
+  }
+  dump_helper_pid_ = -1;
+  dump_helper_fd_ = -1;
+  dump_helper_owner_ = -1;
+}
+
+// This function may run in a compromised context: see the top of the file.
+// Sends the mappings and app memory to dump on the request socket |fd|.
+bool ExceptionHandler::SendDumpHelperState(int fd) {
+  for (MappingList::const_iterator iter = mapping_list_.begin();
+       iter != mapping_list_.end(); ++iter) {
+    if (HANDLE_EINTR(sys_write(fd, &*iter, sizeof(*iter))) !=
+        static_cast<ssize_t>(sizeof(*iter))) {
+      return false;
+    }
+  }
+  for (AppMemoryList::const_iterator iter = app_memory_list_.begin();
+       iter != app_memory_list_.end(); ++iter) {
+    if (HANDLE_EINTR(sys_write(fd, &*iter, sizeof(*iter))) !=
+        static_cast<ssize_t>(sizeof(*iter))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Runs on the dump helper, which has a heap of its own: this only replaces
+// the helper's copies of the options, mappings and app memory with those
+// of the request.
+bool ExceptionHandler::ReceiveDumpHelperState(
+    int fd, const DumpHelperRequest& request) {
+  minidump_descriptor_.set_size_limit(request.size_limit);
+  minidump_descriptor_.set_skip_dump_if_principal_mapping_not_referenced(
+      request.skip_dump_if_principal_mapping_not_referenced);
+  minidump_descriptor_.set_address_within_principal_mapping(
+      request.address_within_principal_mapping);
+  minidump_descriptor_.set_sanitize_stacks(request.sanitize_stacks);
+  minidump_descriptor_.set_compress(request.compress);
+  minidump_descriptor_.set_stack_trim_slack(request.stack_trim_slack);
+  minidump_descriptor_.set_heap_capture_budget(request.heap_capture_budget);
+
+  mapping_list_.clear();
+  for (size_t i = 0; i < request.mapping_count; ++i) {
+    MappingEntry mapping;
+    if (HANDLE_EINTR(sys_read(fd, &mapping, sizeof(mapping))) !=
+        static_cast<ssize_t>(sizeof(mapping))) {
+      return false;
+    }
+    mapping_list_.push_back(mapping);
+  }
+  app_memory_list_.clear();
+  for (size_t i = 0; i < request.app_memory_count; ++i) {
+    AppMemory app_memory;
+    if (HANDLE_EINTR(sys_read(fd, &app_memory, sizeof(app_memory))) !=
+        static_cast<ssize_t>(sizeof(app_memory))) {
+      return false;
+    }
+    app_memory_list_.push_back(app_memory);
+  }
+  return true;
+}
+
+// Runs on the dump helper.
+void ExceptionHandler::RunDumpHelper(int fd, pid_t crashing_process) {
+  static const unsigned kControlMsgSize = CMSG_SPACE(2 * sizeof(int));
+
+  for (;;) {
+    CrashContext context;
+    DumpHelperRequest request;
+    struct kernel_iovec iov[2];
+    iov[0].iov_base = &context;
+    iov[0].iov_len = sizeof(context);
+    iov[1].iov_base = &request;
+    iov[1].iov_len = sizeof(request);
+
+    struct kernel_msghdr msg;
+    my_memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    char cmsg[kControlMsgSize];
+    msg.msg_control = cmsg;
+    msg.msg_controllen = sizeof(cmsg);
+
+    // The crashing process closing its end is the signal to exit.
+    const ssize_t n = HANDLE_EINTR(sys_recvmsg(fd, &msg, 0));
+    if (n <= 0)
+      return;
+
+    int dump_fd = -1;
+    int reply_fd = -1;
+    struct cmsghdr* hdr = CMSG_FIRSTHDR(&msg);
+    if (hdr && hdr->cmsg_level == SOL_SOCKET &&
+        hdr->cmsg_type == SCM_RIGHTS &&
+        hdr->cmsg_len == CMSG_LEN(2 * sizeof(int))) {
+      const int* fds = reinterpret_cast<int*>(CMSG_DATA(hdr));
+      dump_fd = fds[0];
+      reply_fd = fds[1];
+    }
+
+    DumpHelperReply reply;
+    my_memset(&reply, 0, sizeof(reply));
+    reply.complete = true;
+    if (n == static_cast<ssize_t>(sizeof(context) + sizeof(request)) &&
+        dump_fd >= 0 && reply_fd >= 0 &&
+        ReceiveDumpHelperState(reply_fd, request)) {
+      reply.succeeded = request.snapshot ?
+          DoSnapshotToFD(crashing_process, &context, sizeof(context), dump_fd,
+                         reply_fd) :
+          DoDumpToFD(crashing_process, &context, sizeof(context), dump_fd);
+    }
+    if (dump_fd >= 0)
+      sys_close(dump_fd);
+    if (reply_fd >= 0) {
+      // The requester may be gone, which concerns no other request.
+      ignore_result(HANDLE_EINTR(sys_write(reply_fd, &reply, sizeof(reply))));
+      sys_close(reply_fd);
+    }
+  }
+}
+
+// This function may run in a compromised context: see the top of the file.
+// Returns false if there is no dump helper, or it could not be asked for a
+// dump. Otherwise sets |dumped| to whether the helper wrote the minidump,
+// or for a |snapshot|, whether it took the snapshot, and |pause_ns| if
+// non-NULL to the time the snapshot suspended the threads for.
+bool ExceptionHandler::RequestDumpFromHelper(CrashContext* context,
+                                             bool snapshot, bool* dumped,
+                                             uint64_t* pause_ns) {
+  if (dump_helper_pid_ <= 0 || sys_getpid() != dump_helper_owner_ ||
+      minidump_descriptor_.IsMicrodumpOnConsole()) {
+    return false;
+  }
+
+  // Each request gets a socket of its own for its state and replies, so
+  // that requests from several threads don't read each other's replies.
+  int reply_fds[2];
+  if (sys_socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, reply_fds) <
+      0) {
+    return false;
+  }
+
+  int dump_fd = minidump_descriptor_.fd();
+  if (!minidump_descriptor_.IsFD()) {
+    dump_fd = sys_open(minidump_descriptor_.path(),
+                       O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (dump_fd < 0) {
+      sys_close(reply_fds[0]);
+      sys_close(reply_fds[1]);
+      return false;
+    }
+  }
+
+  // The helper may not have been the last process allowed to ptrace us.
+  sys_prctl(PR_SET_PTRACER, dump_helper_pid_, 0, 0, 0);
+
+  DumpHelperRequest request;
+  my_memset(&request, 0, sizeof(request));
+  request.snapshot = snapshot;
+  request.size_limit = minidump_descriptor_.size_limit();
+  request.skip_dump_if_principal_mapping_not_referenced =
+      minidump_descriptor_.skip_dump_if_principal_mapping_not_referenced();
+  request.address_within_principal_mapping =
+      minidump_descriptor_.address_within_principal_mapping();
+  request.sanitize_stacks = minidump_descriptor_.sanitize_stacks();
+  request.compress = minidump_descriptor_.compress();
+  request.stack_trim_slack = minidump_descriptor_.stack_trim_slack();
+  request.heap_capture_budget = minidump_descriptor_.heap_capture_budget();
+  request.mapping_count = mapping_list_.size();
+  request.app_memory_count = app_memory_list_.size();
+
+  static const unsigned kControlMsgSize = CMSG_SPACE(2 * sizeof(int));
+
+  struct kernel_iovec iov[2];
+  iov[0].iov_base = context;
+  iov[0].iov_len = sizeof(*context);
+  iov[1].iov_base = &request;
+  iov[1].iov_len = sizeof(request);
+
+  struct kernel_msghdr msg;
+  my_memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+  char cmsg[kControlMsgSize];
+  my_memset(cmsg, 0, sizeof(cmsg));
+  msg.msg_control = cmsg;
+  msg.msg_controllen = sizeof(cmsg);
+
+  struct cmsghdr* hdr = CMSG_FIRSTHDR(&msg);
+  hdr->cmsg_level = SOL_SOCKET;
+  hdr->cmsg_type = SCM_RIGHTS;
+  hdr->cmsg_len = CMSG_LEN(2 * sizeof(int));
+  int* fds = reinterpret_cast<int*>(CMSG_DATA(hdr));
+  fds[0] = dump_fd;
+  fds[1] = reply_fds[1];
+
+  // MSG_NOSIGNAL, as a helper that has died must not raise SIGPIPE here.
+  // Each message on the socket is sent whole, so requests from several
+  // threads can share it.
+  const bool sent =
+      HANDLE_EINTR(sys_sendmsg(dump_helper_fd_, &msg, MSG_NOSIGNAL)) >= 0;
+  sys_close(reply_fds[1]);
+  if (!sent) {
+    sys_close(reply_fds[0]);
+    if (!minidump_descriptor_.IsFD()) {
+      sys_close(dump_fd);
+      sys_unlink(minidump_descriptor_.path());
+    }
+    return false;
+  }
+
+  // A snapshot is answered once its threads resume, and again once its
+  // minidump is written, which WaitForSnapshot() collects. If the state
+  // can't be sent, closing the socket makes the helper give up on the
+  // request.
+  DumpHelperReply reply;
+  const bool replied = SendDumpHelperState(reply_fds[0]) &&
+                       ReadDumpHelperReply(reply_fds[0], &reply);
+  if (!minidump_descriptor_.IsFD())
+    sys_close(dump_fd);
+  *dumped = replied && reply.succeeded;
+  if (snapshot && replied && !reply.complete)
+    snapshot_fd_ = reply_fds[0];
+  else
+    sys_close(reply_fds[0]);
+  if (pause_ns)
+    *pause_ns = replied ? reply.pause_ns : 0;
+  return true;
+}
+
+// This function may run in a compromised context: see the top of the file.
+// static
+bool ExceptionHandler::ReadDumpHelperReply(int fd, DumpHelperReply* reply) {
+  return HANDLE_EINTR(sys_read(fd, reply, sizeof(*reply))) ==
+         static_cast<ssize_t>(sizeof(*reply));
+}
+
+// Runs before crashing: normal context.
+bool ExceptionHandler::WaitForSnapshot() {
+  if (snapshot_fd_ < 0)
+    return false;
+  DumpHelperReply reply;
+  const bool written = ReadDumpHelperReply(snapshot_fd_, &reply) &&
+                       reply.complete && reply.succeeded;
+  close(snapshot_fd_);
+  snapshot_fd_ = -1;
+  return written;
 }
 
 // static
@@ -653,10 +1098,31 @@ bool ExceptionHandler::WriteMinidump(const string& dump_path,
 // a valid operation, ensure that this function is compiled with a
 // frame pointer using the following attribute. This attribute
 // is supported on GCC but not on clang.
+bool ExceptionHandler::WriteMinidump() {
+  return CaptureContextAndDump(false, NULL);
+}
+
+bool ExceptionHandler::WriteMinidumpSnapshot(uint64_t* pause_ns) {
+  // CaptureContextAndDump() replaces a helper that has died.
+  if (!dump_helper_died_ &&
+      (dump_helper_pid_ <= 0 || getpid() != dump_helper_owner_)) {
+    return false;
+  }
+  return CaptureContextAndDump(true, pause_ns);
+}
+
 #if defined(__i386__) && defined(__GNUC__) && !defined(__clang__)
 __attribute__((optimize("no-omit-frame-pointer")))
 #endif
-bool ExceptionHandler::WriteMinidump() {
+bool ExceptionHandler::CaptureContextAndDump(bool snapshot,
+                                             uint64_t* pause_ns) {
+  // Replace a dump helper that has died.
+  if (!HasDumpHelper() && dump_helper_died_)
+    StartDumpHelper();
+
+  // Don't reuse the descriptor while a snapshot may still be writing to it.
+  WaitForSnapshot();
+
   if (!IsOutOfProcess() && !minidump_descriptor_.IsFD() &&
       !minidump_descriptor_.IsMicrodumpOnConsole()) {
     // Update the path of the minidump so that this can be called multiple times
@@ -730,6 +1196,10 @@ bool ExceptionHandler::WriteMinidump() {
 #error "This code has not been ported to your platform yet."
 #endif
 
+  if (snapshot) {
+    bool taken = false;
+    return RequestDumpFromHelper(&context, true, &taken, pause_ns) && taken;
+  }
   return GenerateDump(&context);
 }
 
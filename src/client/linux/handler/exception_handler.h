@@ -163,6 +163,24 @@ class ExceptionHandler {
   // context as it uses the heap.
   bool WriteMinidump();
 
+  // Writes a minidump like WriteMinidump(), but suspends the process's
+  // threads only while their registers and stacks and the registered app
+  // memory are copied. The dump helper (see StartDumpHelper()) writes the
+  // rest of the minidump after they resume, while this returns. If
+  // |pause_ns| is non-NULL, it is set to the time in nanoseconds the
+  // threads were suspended for.
+  // The MinidumpCallback isn't called: WaitForSnapshot() tells whether the
+  // minidump was written, and other dumps wait for it first. Returns false
+  // if there is no dump helper or the snapshot couldn't be taken.
+  // Like WriteMinidump(), this is not supposed to be called from a
+  // compromised context.
+  bool WriteMinidumpSnapshot(uint64_t* pause_ns);
+
+  // Waits for the minidump of the last WriteMinidumpSnapshot() call to be
+  // written. Returns true if it was written successfully, and false if it
+  // wasn't or no snapshot is being written.
+  bool WaitForSnapshot();
+
   // Convenience form of WriteMinidump which does not require an
   // ExceptionHandler instance.
   static bool WriteMinidump(const string& dump_path,
@@ -205,6 +223,30 @@ class ExceptionHandler {
     return crash_generation_client_.get() != NULL;
   }
 
+  // Starts a helper process that writes minidumps of this process on request.
+  // Dumps are then generated by handing the crash context to the helper,
+  // instead of cloning a new process and waiting until it is allowed to
+  // ptrace this one. This must be called from a normal context, typically
+  // right after the handler is created, on a thread that outlives the
+  // handler: the helper is killed when the thread that started it exits.
+  // A crash after that is dumped as before, and the next WriteMinidump()
+  // or WriteMinidumpSnapshot() starts a new helper from its own thread.
+  //
+  // The helper is a forked copy of this process, which keeps only the
+  // standard descriptors and its end of the socket. Each request carries
+  // the dump options of the current descriptor, the mappings and the app
+  // memory, so later changes to them need no new helper. Requests from
+  // several threads, including a crash during WriteMinidump(), each get
+  // their own reply socket and are dumped one after another. Returns false
+  // if the helper could not be started, or if dumps are generated
+  // out-of-process, in which case dumps are generated as before. Microdumps
+  // are always generated as before.
+  bool StartDumpHelper();
+
+  // Returns whether a dump helper is running. Forgets a helper that has
+  // died. This must be called from a normal context.
+  bool HasDumpHelper();
+
   // Add information about a memory mapping. This can be used if
   // a custom library loader is used that maps things in a way
   // that the linux dumper can't handle by reading the maps file.
@@ -240,8 +282,25 @@ class ExceptionHandler {
 
   static void SignalHandler(int sig, siginfo_t* info, void* uc);
   static int ThreadEntry(void* arg);
+  static void SendSnapshotResumed(void* context, uint64_t pause_ns);
   bool DoDump(pid_t crashing_process, const void* context,
               size_t context_size);
+  bool DoDumpToFD(pid_t crashing_process, const void* context,
+                  size_t context_size, int fd);
+
+  bool DoSnapshotToFD(pid_t process, const void* context,
+                      size_t context_size, int fd, int reply_fd);
+
+  bool CaptureContextAndDump(bool snapshot, uint64_t* pause_ns);
+  bool RequestDumpFromHelper(CrashContext* context, bool snapshot,
+                             bool* dumped, uint64_t* pause_ns);
+  bool SendDumpHelperState(int fd);
+  struct DumpHelperRequest;
+  bool ReceiveDumpHelperState(int fd, const DumpHelperRequest& request);
+  struct DumpHelperReply;
+  static bool ReadDumpHelperReply(int fd, DumpHelperReply* reply);
+  void RunDumpHelper(int fd, pid_t crashing_process);
+  void StopDumpHelper();
 
   const FilterCallback filter_;
   const MinidumpCallback callback_;
@@ -264,6 +323,21 @@ class ExceptionHandler {
   // ptrace. This is used to store the file descriptors for the pipe
   int fdes[2] = {-1, -1};
 
+  // The process started by StartDumpHelper, our end of the socket used to
+  // send it dump requests, and the process it dumps. A process forked from
+  // that one inherits these, but must not ask the helper for dumps.
+  pid_t dump_helper_pid_ = -1;
+  int dump_helper_fd_ = -1;
+  pid_t dump_helper_owner_ = -1;
+
+  // Set when HasDumpHelper() finds the helper has died, until one is
+  // started again.
+  bool dump_helper_died_ = false;
+
+  // While the dump helper writes the minidump of a snapshot, the socket its
+  // last reply will come on.
+  int snapshot_fd_ = -1;
+
   // Callers can add extra info about mappings for cases where the
   // dumper code cannot extract enough information from /proc/<pid>/maps.
   MappingList mapping_list_;
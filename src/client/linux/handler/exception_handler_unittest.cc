@@ -207,7 +207,7 @@ static void DoNullPointerDereference() {
   *p_null = 1;
 }
 
-void ChildCrash(bool use_fd) {
+void ChildCrash(bool use_fd, bool use_dump_helper) {
   AutoTempDir temp_dir;
   int fds[2] = {0};
   int minidump_fd = -1;
@@ -232,6 +232,8 @@ void ChildCrash(bool use_fd) {
                                            NULL, DoneCallback, fd_param,
                                            true, -1));
       }
+      if (use_dump_helper && !handler->StartDumpHelper())
+        _exit(1);
       // Crash with the exception handler in scope.
       DoNullPointerDereference();
     }
@@ -251,11 +253,19 @@ void ChildCrash(bool use_fd) {
 }
 
 TEST(ExceptionHandlerTest, ChildCrashWithPath) {
-  ASSERT_NO_FATAL_FAILURE(ChildCrash(false));
+  ASSERT_NO_FATAL_FAILURE(ChildCrash(false, false));
 }
 
 TEST(ExceptionHandlerTest, ChildCrashWithFD) {
-  ASSERT_NO_FATAL_FAILURE(ChildCrash(true));
+  ASSERT_NO_FATAL_FAILURE(ChildCrash(true, false));
+}
+
+TEST(ExceptionHandlerTest, ChildCrashWithPathAndDumpHelper) {
+  ASSERT_NO_FATAL_FAILURE(ChildCrash(false, true));
+}
+
+TEST(ExceptionHandlerTest, ChildCrashWithFDAndDumpHelper) {
+  ASSERT_NO_FATAL_FAILURE(ChildCrash(true, true));
 }
 
 #if !defined(__ANDROID_API__) || __ANDROID_API__ >= __ANDROID_API_N__
@@ -1160,7 +1170,198 @@ TEST(ExceptionHandlerTest, GenerateMultipleDumpsWithPath) {
   ASSERT_STRNE(minidump_1_path.c_str(), minidump_2_path.c_str());
 }
 
+TEST(ExceptionHandlerTest, GenerateMultipleDumpsWithDumpHelper) {
+  const uint32_t kMemorySize = sysconf(_SC_PAGESIZE);
+  uint8_t* memory = new uint8_t[kMemorySize];
+  const uintptr_t kMemoryAddress = reinterpret_cast<uintptr_t>(memory);
+  for (uint32_t i = 0; i < kMemorySize; ++i) {
+    memory[i] = i % 255;
+  }
+
+  AutoTempDir temp_dir;
+  ExceptionHandler handler(MinidumpDescriptor(temp_dir.path()), NULL, NULL,
+                           NULL, false, -1);
+  ASSERT_TRUE(handler.StartDumpHelper());
+  ASSERT_TRUE(handler.HasDumpHelper());
+
+  // Memory registered after the helper started must still be dumped.
+  handler.RegisterAppMemory(memory, kMemorySize);
+  ASSERT_TRUE(handler.HasDumpHelper());
+
+  string previous_path;
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_TRUE(handler.WriteMinidump());
+    const string path(handler.minidump_descriptor().path());
+    ASSERT_NE(previous_path, path);
+    previous_path = path;
+
+    Minidump minidump(path);
+    ASSERT_TRUE(minidump.Read());
+    MinidumpMemoryList* dump_memory_list = minidump.GetMemoryList();
+    ASSERT_TRUE(dump_memory_list);
+    const MinidumpMemoryRegion* region =
+        dump_memory_list->GetMemoryRegionForAddress(kMemoryAddress);
+    ASSERT_TRUE(region);
+    EXPECT_EQ(0, memcmp(region->GetMemory(), memory, kMemorySize));
+    unlink(path.c_str());
+  }
+
+  // As must changes to the memory and the descriptor after that.
+  handler.UnregisterAppMemory(memory);
+  AutoTempDir other_temp_dir;
+  handler.set_minidump_descriptor(MinidumpDescriptor(other_temp_dir.path()));
+  ASSERT_TRUE(handler.HasDumpHelper());
+  ASSERT_TRUE(handler.WriteMinidump());
+  const string path(handler.minidump_descriptor().path());
+  ASSERT_EQ(0U, path.find(other_temp_dir.path()));
+  Minidump minidump(path);
+  ASSERT_TRUE(minidump.Read());
+  MinidumpMemoryList* dump_memory_list = minidump.GetMemoryList();
+  ASSERT_TRUE(dump_memory_list);
+  EXPECT_FALSE(dump_memory_list->GetMemoryRegionForAddress(kMemoryAddress));
+
+  delete[] memory;
+}
+
+void* StartDumpHelperOnThread(void* handler_arg) {
+  ExceptionHandler* handler = static_cast<ExceptionHandler*>(handler_arg);
+  // A dump through the helper makes sure it is set to die with this thread
+  // before the thread exits.
+  return reinterpret_cast<void*>(handler->StartDumpHelper() &&
+                                 handler->WriteMinidump());
+}
+
+TEST(ExceptionHandlerTest, DumpHelperReplacedAfterStartingThreadExits) {
+  AutoTempDir temp_dir;
+  ExceptionHandler handler(MinidumpDescriptor(temp_dir.path()), NULL, NULL,
+                           NULL, false, -1);
+  pthread_t thread;
+  ASSERT_EQ(0, pthread_create(&thread, NULL, StartDumpHelperOnThread,
+                              &handler));
+  void* started = NULL;
+  ASSERT_EQ(0, pthread_join(thread, &started));
+  ASSERT_TRUE(started);
+
+  // The helper dies with the thread that started it.
+  for (int i = 0; i < 500 && handler.HasDumpHelper(); ++i)
+    usleep(10000);
+  ASSERT_FALSE(handler.HasDumpHelper());
+
+  // A dump after that still succeeds, and starts a new helper.
+  ASSERT_TRUE(handler.WriteMinidump());
+  EXPECT_TRUE(handler.HasDumpHelper());
+  Minidump minidump(handler.minidump_descriptor().path());
+  EXPECT_TRUE(minidump.Read());
+}
+
+TEST(ExceptionHandlerTest, DumpHelperReplacedForSnapshot) {
+  AutoTempDir temp_dir;
+  ExceptionHandler handler(MinidumpDescriptor(temp_dir.path()), NULL, NULL,
+                           NULL, false, -1);
+  pthread_t thread;
+  ASSERT_EQ(0, pthread_create(&thread, NULL, StartDumpHelperOnThread,
+                              &handler));
+  void* started = NULL;
+  ASSERT_EQ(0, pthread_join(thread, &started));
+  ASSERT_TRUE(started);
+  for (int i = 0; i < 500 && handler.HasDumpHelper(); ++i)
+    usleep(10000);
+  ASSERT_FALSE(handler.HasDumpHelper());
+
+  ASSERT_TRUE(handler.WriteMinidumpSnapshot(NULL));
+  ASSERT_TRUE(handler.WaitForSnapshot());
+  EXPECT_TRUE(handler.HasDumpHelper());
+  Minidump minidump(handler.minidump_descriptor().path());
+  EXPECT_TRUE(minidump.Read());
+}
+
+TEST(ExceptionHandlerTest, DumpHelperClosesInheritedDescriptors) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  AutoTempDir temp_dir;
+  ExceptionHandler handler(MinidumpDescriptor(temp_dir.path()), NULL, NULL,
+                           NULL, false, -1);
+  ASSERT_TRUE(handler.StartDumpHelper());
+  ASSERT_TRUE(handler.WriteMinidump());
+
+  // With the helper's copy of the write end closed, closing ours ends the
+  // pipe.
+  close(fds[1]);
+  char c;
+  EXPECT_EQ(0, HANDLE_EINTR(read(fds[0], &c, 1)));
+  close(fds[0]);
+}
+
 // Test that an additional memory region can be added to the minidump.
+TEST(ExceptionHandlerTest, WriteMinidumpSnapshot) {
+  const uint32_t kMemorySize = sysconf(_SC_PAGESIZE);
+  uint8_t* memory = new uint8_t[kMemorySize];
+  const uintptr_t kMemoryAddress = reinterpret_cast<uintptr_t>(memory);
+  for (uint32_t i = 0; i < kMemorySize; ++i) {
+    memory[i] = i % 255;
+  }
+
+  AutoTempDir temp_dir;
+  ExceptionHandler handler(MinidumpDescriptor(temp_dir.path()), NULL, NULL,
+                           NULL, false, -1);
+  handler.RegisterAppMemory(memory, kMemorySize);
+
+  // Snapshots need the dump helper.
+  uint64_t pause_ns = 0;
+  ASSERT_FALSE(handler.WriteMinidumpSnapshot(&pause_ns));
+  ASSERT_TRUE(handler.StartDumpHelper());
+
+  ASSERT_TRUE(handler.WriteMinidumpSnapshot(&pause_ns));
+  EXPECT_GT(pause_ns, 0U);
+  const string path(handler.minidump_descriptor().path());
+  ASSERT_TRUE(handler.WaitForSnapshot());
+  EXPECT_FALSE(handler.WaitForSnapshot());
+
+  Minidump minidump(path);
+  ASSERT_TRUE(minidump.Read());
+  MinidumpThreadList* dump_thread_list = minidump.GetThreadList();
+  ASSERT_TRUE(dump_thread_list);
+  EXPECT_LT(0U, dump_thread_list->thread_count());
+  MinidumpMemoryList* dump_memory_list = minidump.GetMemoryList();
+  ASSERT_TRUE(dump_memory_list);
+  const MinidumpMemoryRegion* region =
+      dump_memory_list->GetMemoryRegionForAddress(kMemoryAddress);
+  ASSERT_TRUE(region);
+  EXPECT_EQ(0, memcmp(region->GetMemory(), memory, kMemorySize));
+
+  // A dump after a snapshot waits for it, and is written as usual.
+  ASSERT_TRUE(handler.WriteMinidumpSnapshot(NULL));
+  ASSERT_TRUE(handler.WriteMinidump());
+  EXPECT_FALSE(handler.WaitForSnapshot());
+
+  delete[] memory;
+}
+
+TEST(ExceptionHandlerTest, WriteMinidumpSnapshotSkipsUnreferencedMapping) {
+  // An address that no mapping holds.
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  void* unmapped = mmap(NULL, page_size, PROT_READ,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  ASSERT_NE(MAP_FAILED, unmapped);
+  munmap(unmapped, page_size);
+
+  AutoTempDir temp_dir;
+  MinidumpDescriptor descriptor(temp_dir.path());
+  descriptor.set_skip_dump_if_principal_mapping_not_referenced(true);
+  descriptor.set_address_within_principal_mapping(
+      reinterpret_cast<uintptr_t>(unmapped));
+  ExceptionHandler handler(descriptor, NULL, NULL, NULL, false, -1);
+  ASSERT_TRUE(handler.StartDumpHelper());
+  EXPECT_FALSE(handler.WriteMinidumpSnapshot(NULL));
+
+  // The thread asking for the snapshot runs code of this executable.
+  descriptor.set_address_within_principal_mapping(
+      reinterpret_cast<uintptr_t>(&StartDumpHelperOnThread));
+  handler.set_minidump_descriptor(descriptor);
+  ASSERT_TRUE(handler.WriteMinidumpSnapshot(NULL));
+  EXPECT_TRUE(handler.WaitForSnapshot());
+}
+
 TEST(ExceptionHandlerTest, AdditionalMemory) {
   const uint32_t kMemorySize = sysconf(_SC_PAGESIZE);
 
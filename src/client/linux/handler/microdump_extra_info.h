@@ -40,11 +40,17 @@ struct MicrodumpExtraInfo {
   const char* gpu_fingerprint;
   const char* process_type;
 
+  // If true, the stack and CPU state are emitted base64-encoded on "s" and
+  // "c" lines instead of hex-encoded on "S" and "C" lines. This shrinks
+  // them by a third; the processor accepts either form.
+  bool base64_payload;
+
   MicrodumpExtraInfo()
       : build_fingerprint(NULL),
         product_info(NULL),
         gpu_fingerprint(NULL),
-        process_type(NULL) {}
+        process_type(NULL),
+        base64_payload(false) {}
 };
 
 }
@@ -50,6 +50,9 @@ MinidumpDescriptor::MinidumpDescriptor(const MinidumpDescriptor& descriptor)
       skip_dump_if_principal_mapping_not_referenced_(
           descriptor.skip_dump_if_principal_mapping_not_referenced_),
       sanitize_stacks_(descriptor.sanitize_stacks_),
+      compress_(descriptor.compress_),
+      stack_trim_slack_(descriptor.stack_trim_slack_),
+      heap_capture_budget_(descriptor.heap_capture_budget_),
       microdump_extra_info_(descriptor.microdump_extra_info_) {
   // The copy constructor is not allowed to be called on a MinidumpDescriptor
   // with a valid path_, as getting its c_path_ would require the heap which
@@ -76,6 +79,9 @@ MinidumpDescriptor& MinidumpDescriptor::operator=(
   skip_dump_if_principal_mapping_not_referenced_ =
       descriptor.skip_dump_if_principal_mapping_not_referenced_;
   sanitize_stacks_ = descriptor.sanitize_stacks_;
+  compress_ = descriptor.compress_;
+  stack_trim_slack_ = descriptor.stack_trim_slack_;
+  heap_capture_budget_ = descriptor.heap_capture_budget_;
   microdump_extra_info_ = descriptor.microdump_extra_info_;
   return *this;
 }
@@ -55,7 +55,10 @@ class MinidumpDescriptor {
         fd_(-1),
         size_limit_(-1),
         address_within_principal_mapping_(0),
-        skip_dump_if_principal_mapping_not_referenced_(false) {}
+        skip_dump_if_principal_mapping_not_referenced_(false),
+        compress_(false),
+        stack_trim_slack_(-1),
+        heap_capture_budget_(0) {}
 
   explicit MinidumpDescriptor(const string& directory)
       : mode_(kWriteMinidumpToFile),
@@ -65,7 +68,10 @@ class MinidumpDescriptor {
         size_limit_(-1),
         address_within_principal_mapping_(0),
         skip_dump_if_principal_mapping_not_referenced_(false),
-        sanitize_stacks_(false) {
+        sanitize_stacks_(false),
+        compress_(false),
+        stack_trim_slack_(-1),
+        heap_capture_budget_(0) {
     assert(!directory.empty());
   }
 
@@ -76,7 +82,10 @@ class MinidumpDescriptor {
         size_limit_(-1),
         address_within_principal_mapping_(0),
         skip_dump_if_principal_mapping_not_referenced_(false),
-        sanitize_stacks_(false) {
+        sanitize_stacks_(false),
+        compress_(false),
+        stack_trim_slack_(-1),
+        heap_capture_budget_(0) {
     assert(fd != -1);
   }
 
@@ -86,7 +95,10 @@ class MinidumpDescriptor {
         size_limit_(-1),
         address_within_principal_mapping_(0),
         skip_dump_if_principal_mapping_not_referenced_(false),
-        sanitize_stacks_(false) {}
+        sanitize_stacks_(false),
+        compress_(false),
+        stack_trim_slack_(-1),
+        heap_capture_budget_(0) {}
 
   explicit MinidumpDescriptor(const MinidumpDescriptor& descriptor);
   MinidumpDescriptor& operator=(const MinidumpDescriptor& descriptor);
@@ -134,6 +146,19 @@ class MinidumpDescriptor {
     sanitize_stacks_ = sanitize_stacks;
   }
 
+  bool compress() const { return compress_; }
+  void set_compress(bool compress) { compress_ = compress; }
+
+  int stack_trim_slack() const { return stack_trim_slack_; }
+  void set_stack_trim_slack(int stack_trim_slack) {
+    stack_trim_slack_ = stack_trim_slack;
+  }
+
+  size_t heap_capture_budget() const { return heap_capture_budget_; }
+  void set_heap_capture_budget(size_t heap_capture_budget) {
+    heap_capture_budget_ = heap_capture_budget;
+  }
+
   MicrodumpExtraInfo* microdump_extra_info() {
     assert(IsMicrodumpOnConsole());
     return &microdump_extra_info_;
@@ -182,6 +207,25 @@ class MinidumpDescriptor {
   // register values, but elides strings and other program data.
   bool sanitize_stacks_;
 
+  // If set, the minidump is compressed with gzip once it has been written,
+  // which the processor handles transparently. When writing to a file
+  // descriptor, it must be open for reading as well as writing. A minidump
+  // that doesn't shrink, or any minidump if Breakpad was built without zlib,
+  // is left uncompressed.
+  bool compress_;
+
+  // If non-negative, each thread's stack is cut off this many bytes past
+  // its outermost frame instead of being captured to the end of the stack
+  // mapping (up to 32KB). The outermost frame is found heuristically, as
+  // the last word on the stack that points into executable code.
+  int stack_trim_slack_;
+
+  // If non-zero, up to this many bytes of heap are captured from around
+  // the addresses that thread registers and stacks point to in writable
+  // anonymous mappings, nearest the top of the crashing thread's stack
+  // first.
+  size_t heap_capture_budget_;
+
   // The extra microdump data (e.g. product name/version, build
   // fingerprint, gpu fingerprint) that should be appended to the dump
   // (microdump only). Microdumps don't have the ability of appending
@@ -62,6 +62,17 @@ using google_breakpad::UContextReader;
 
 const size_t kLineBufferSize = 2048;
 
+#if !defined(__ANDROID__)
+// Lines are written out to stderr in batches of up to this many bytes.
+// Logcat needs one write per line, so Android does not batch.
+const size_t kLogBatchSize = 16384;
+#endif
+
+// Stack memory is emitted in chunks of this many bytes per line. The base64
+// chunk is a multiple of 3 so that no line needs padding but the last.
+const size_t kHexStackChunkSize = 384;
+const size_t kBase64StackChunkSize = 1152;
+
 #if !defined(__LP64__)
 // The following are only used by DumpFreeSpace, so need to be compiled
 // in conditionally in the same way.
@@ -149,6 +160,11 @@ class MicrodumpWriter {
         sanitize_stack_(sanitize_stack),
         microdump_extra_info_(microdump_extra_info),
         log_line_(NULL),
+        log_line_len_(0),
+#if !defined(__ANDROID__)
+        log_batch_(NULL),
+        log_batch_len_(0),
+#endif
         stack_copy_(NULL),
         stack_len_(0),
         stack_lower_bound_(0),
@@ -156,6 +172,10 @@ class MicrodumpWriter {
     log_line_ = reinterpret_cast<char*>(Alloc(kLineBufferSize));
     if (log_line_)
       log_line_[0] = '\0';  // Clear out the log line buffer.
+#if !defined(__ANDROID__)
+    // Without a batch buffer lines are simply written out one at a time.
+    log_batch_ = reinterpret_cast<char*>(Alloc(kLogBatchSize));
+#endif
   }
 
   ~MicrodumpWriter() { dumper_->ThreadsResume(); }
@@ -174,6 +194,7 @@ class MicrodumpWriter {
     CaptureResult stack_capture_result = CaptureCrashingThreadStack(-1);
     if (stack_capture_result == CAPTURE_UNINTERESTING) {
       LogLine("Microdump skipped (uninteresting)");
+      FlushLog();
       return;
     }
 
@@ -191,24 +212,53 @@ class MicrodumpWriter {
     DumpCPUState();
     DumpMappings();
     LogLine("-----END BREAKPAD MICRODUMP-----");
+    FlushLog();
   }
 
  private:
   enum CaptureResult { CAPTURE_OK, CAPTURE_FAILED, CAPTURE_UNINTERESTING };
 
-  // Writes one line to the system log.
+  // Writes one line to the system log. Outside Android the line is staged
+  // in the batch buffer, which is written out once full or by FlushLog().
   void LogLine(const char* msg) {
 #if defined(__ANDROID__)
     logger::writeToCrashLog(msg);
 #else
-    logger::write(msg, my_strlen(msg));
+    const size_t length = my_strlen(msg);
+    if (log_batch_ && length < kLogBatchSize) {
+      if (log_batch_len_ + length + 1 > kLogBatchSize)
+        FlushLog();
+      memcpy(log_batch_ + log_batch_len_, msg, length);
+      log_batch_len_ += length;
+      log_batch_[log_batch_len_++] = '\n';
+      return;
+    }
+    FlushLog();
+    logger::write(msg, length);
     logger::write("\n", 1);
 #endif
   }
 
+  // Writes out any lines staged by LogLine().
+  void FlushLog() {
+#if !defined(__ANDROID__)
+    size_t done = 0;
+    while (done < log_batch_len_) {
+      int written = logger::write(log_batch_ + done, log_batch_len_ - done);
+      if (written <= 0)
+        break;
+      done += written;
+    }
+    log_batch_len_ = 0;
+#endif
+  }
+
   // Stages the given string in the current line buffer.
   void LogAppend(const char* str) {
-    my_strlcat(log_line_, str, kLineBufferSize);
+    log_line_len_ += my_strlcpy(log_line_ + log_line_len_, str,
+                                kLineBufferSize - log_line_len_);
+    if (log_line_len_ >= kLineBufferSize)
+      log_line_len_ = kLineBufferSize - 1;
   }
 
   // As above (required to take precedence over template specialization below).
@@ -231,15 +281,56 @@ class MicrodumpWriter {
 
   // Stages the buffer content hex-encoded in the current line buffer.
   void LogAppend(const void* buf, size_t length) {
+    static const char HEX[] = "0123456789ABCDEF";
+    const uint8_t* ptr = reinterpret_cast<const uint8_t*>(buf);
+    size_t room = (kLineBufferSize - 1 - log_line_len_) / 2;
+    if (length > room)
+      length = room;
+    char* out = log_line_ + log_line_len_;
+    for (size_t i = 0; i < length; ++i) {
+      *out++ = HEX[ptr[i] >> 4];
+      *out++ = HEX[ptr[i] & 0x0F];
+    }
+    *out = '\0';
+    log_line_len_ = out - log_line_;
+  }
+
+  // Stages the buffer content base64-encoded (RFC 4648, with padding) in
+  // the current line buffer.
+  void LogAppendBase64(const void* buf, size_t length) {
+    static const char kBase64[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
     const uint8_t* ptr = reinterpret_cast<const uint8_t*>(buf);
-    for (size_t i = 0; i < length; ++i, ++ptr)
-      LogAppend(*ptr);
+    size_t room = (kLineBufferSize - 1 - log_line_len_) / 4 * 3;
+    if (length > room)
+      length = room;
+    char* out = log_line_ + log_line_len_;
+    size_t i = 0;
+    for (; i + 3 <= length; i += 3) {
+      const uint32_t v = (ptr[i] << 16) | (ptr[i + 1] << 8) | ptr[i + 2];
+      *out++ = kBase64[(v >> 18) & 0x3F];
+      *out++ = kBase64[(v >> 12) & 0x3F];
+      *out++ = kBase64[(v >> 6) & 0x3F];
+      *out++ = kBase64[v & 0x3F];
+    }
+    if (i < length) {
+      uint32_t v = ptr[i] << 16;
+      if (i + 1 < length)
+        v |= ptr[i + 1] << 8;
+      *out++ = kBase64[(v >> 18) & 0x3F];
+      *out++ = kBase64[(v >> 12) & 0x3F];
+      *out++ = i + 1 < length ? kBase64[(v >> 6) & 0x3F] : '=';
+      *out++ = '=';
+    }
+    *out = '\0';
+    log_line_len_ = out - log_line_;
   }
 
   // Writes out the current line buffer on the system log.
   void LogCommitLine() {
     LogLine(log_line_);
     log_line_[0] = 0;
+    log_line_len_ = 0;
   }
 
   CaptureResult CaptureCrashingThreadStack(int max_stack_len) {
@@ -394,14 +485,19 @@ class MicrodumpWriter {
     LogAppend(stack_len_);
     LogCommitLine();
 
-    const size_t STACK_DUMP_CHUNK_SIZE = 384;
+    const bool base64 = microdump_extra_info_.base64_payload;
+    const size_t chunk_size =
+        base64 ? kBase64StackChunkSize : kHexStackChunkSize;
     for (size_t stack_off = 0; stack_off < stack_len_;
-         stack_off += STACK_DUMP_CHUNK_SIZE) {
-      LogAppend("S ");
+         stack_off += chunk_size) {
+      const size_t length = std::min(chunk_size, stack_len_ - stack_off);
+      LogAppend(base64 ? "s " : "S ");
       LogAppend(stack_lower_bound_ + stack_off);
       LogAppend(" ");
-      LogAppend(stack_copy_ + stack_off,
-                std::min(STACK_DUMP_CHUNK_SIZE, stack_len_ - stack_off));
+      if (base64)
+        LogAppendBase64(stack_copy_ + stack_off, length);
+      else
+        LogAppend(stack_copy_ + stack_off, length);
       LogCommitLine();
     }
   }
@@ -414,8 +510,13 @@ class MicrodumpWriter {
 #else
     UContextReader::FillCPUContext(&cpu, ucontext_);
 #endif
-    LogAppend("C ");
-    LogAppend(&cpu, sizeof(cpu));
+    if (microdump_extra_info_.base64_payload) {
+      LogAppend("c ");
+      LogAppendBase64(&cpu, sizeof(cpu));
+    } else {
+      LogAppend("C ");
+      LogAppend(&cpu, sizeof(cpu));
+    }
     LogCommitLine();
   }
 
@@ -615,6 +716,11 @@ class MicrodumpWriter {
   bool sanitize_stack_;
   const MicrodumpExtraInfo microdump_extra_info_;
   char* log_line_;
+  size_t log_line_len_;
+#if !defined(__ANDROID__)
+  char* log_batch_;
+  size_t log_batch_len_;
+#endif
 
   // The local copy of crashed process stack memory, beginning at
   // |stack_lower_bound_|.
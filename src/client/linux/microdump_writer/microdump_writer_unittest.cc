@@ -28,6 +28,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <ctype.h>
+#include <string.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -37,6 +38,7 @@
 #include <string>
 
 #include "breakpad_googletest_includes.h"
+#include "client/linux/dump_writer_common/raw_context_cpu.h"
 #include "client/linux/handler/exception_handler.h"
 #include "client/linux/handler/microdump_extra_info.h"
 #include "client/linux/microdump_writer/microdump_writer.h"
@@ -151,12 +153,41 @@ void CrashAndGetMicrodump(const MappingList& mappings,
   close(fds[1]);
 }
 
+// Decodes the base64 payload of an "s" or "c" line.
+string DecodeBase64(const string& data) {
+  static const char kBase64[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  string result;
+  uint32_t bits = 0;
+  int nbits = 0;
+  for (size_t i = 0; i < data.size() && data[i] != '='; ++i) {
+    const char* digit = strchr(kBase64, data[i]);
+    EXPECT_TRUE(digit != NULL && *digit != '\0');
+    if (digit == NULL || *digit == '\0')
+      break;
+    bits = (bits << 6) | (digit - kBase64);
+    nbits += 6;
+    if (nbits >= 8) {
+      nbits -= 8;
+      result.push_back(static_cast<char>(bits >> nbits));
+    }
+  }
+  return result;
+}
+
 void ExtractMicrodumpStackContents(const string& microdump_content,
                                    string* result) {
   std::istringstream iss(microdump_content);
   result->clear();
   for (string line; std::getline(iss, line);) {
-    if (line.find("S ") == 0) {
+    if (line.find("s ") == 0) {
+      std::istringstream stack_data(line);
+      std::string key;
+      std::string addr;
+      std::string data;
+      stack_data >> key >> addr >> data;
+      result->append(DecodeBase64(data));
+    } else if (line.find("S ") == 0) {
       std::istringstream stack_data(line);
       std::string key;
       std::string addr;
@@ -352,6 +383,35 @@ TEST(MicrodumpWriterTest, StringPresentIfNotSanitized) {
   ASSERT_TRUE(MicrodumpStackContains(buf, kIdentifiableString));
 }
 
+// Ensure that the stack and CPU state can be emitted base64-encoded.
+TEST(MicrodumpWriterTest, Base64Payload) {
+  MicrodumpExtraInfo microdump_extra_info(
+      MakeMicrodumpExtraInfo("foobar", "bazqux", NULL));
+  microdump_extra_info.base64_payload = true;
+
+  std::string buf;
+  MappingList no_mappings;
+
+  CrashAndGetMicrodump(no_mappings, microdump_extra_info, &buf);
+  ASSERT_TRUE(ContainsMicrodump(buf));
+  CheckMicrodumpContents(buf, microdump_extra_info);
+  ASSERT_TRUE(MicrodumpStackContains(buf, kIdentifiableString));
+
+  std::istringstream iss(buf);
+  bool did_find_cpu_state = false;
+  for (string line; std::getline(iss, line);) {
+    // Only the stack header is left on an "S" line.
+    ASSERT_NE(0U, line.find("C "));
+    if (line.find("S ") == 0)
+      ASSERT_EQ(0U, line.find("S 0 "));
+    if (line.find("c ") == 0) {
+      ASSERT_EQ(sizeof(RawContextCPU), DecodeBase64(line.substr(2)).size());
+      did_find_cpu_state = true;
+    }
+  }
+  ASSERT_TRUE(did_find_cpu_state);
+}
+
 // Ensure that output occurs if the interest region is set, and
 // does overlap something on the stack.
 TEST(MicrodumpWriterTest, OutputIfInteresting) {
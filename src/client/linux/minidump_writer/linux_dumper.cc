@@ -297,6 +297,17 @@ LinuxDumper::LinuxDumper(pid_t pid, const char* root_prefix)
 LinuxDumper::~LinuxDumper() {
 }
 
+bool LinuxDumper::CopyFromProcessBatch(pid_t child,
+                                       const CopyRequest* requests,
+                                       size_t count) {
+  bool success = true;
+  for (size_t i = 0; i < count; ++i) {
+    success &= CopyFromProcess(requests[i].dest, child, requests[i].src,
+                               requests[i].length);
+  }
+  return success;
+}
+
 bool LinuxDumper::Init() {
   return ReadAuxv() && EnumerateThreads() && EnumerateMappings();
 }
@@ -341,12 +352,17 @@ LinuxDumper::ElfFileIdentifierForMapping(const MappingInfo& mapping,
     return false;
   bool filename_modified = HandleDeletedFileInMapping(filename);
 
-  MemoryMappedFile mapped_file(filename, mapping.offset);
-  if (!mapped_file.data() || mapped_file.size() < SELFMAG)
-    return false;
+  // Most images carry their build ID in a loaded PT_NOTE segment, which is
+  // much cheaper to read than opening and mapping the file.
+  bool success = ElfFileIdentifierFromLoadedImage(mapping, identifier);
+  if (!success) {
+    MemoryMappedFile mapped_file(filename, mapping.offset);
+    if (!mapped_file.data() || mapped_file.size() < SELFMAG)
+      return false;
 
-  bool success =
-      FileID::ElfFileIdentifierFromMappedFile(mapped_file.data(), identifier);
+    success = FileID::ElfFileIdentifierFromMappedFile(mapped_file.data(),
+                                                      identifier);
+  }
   if (success && member && filename_modified) {
     mappings_[mapping_id]->name[my_strlen(mapping.name) -
                                 sizeof(kDeletedSuffix) + 1] = '\0';
@@ -355,6 +371,72 @@ LinuxDumper::ElfFileIdentifierForMapping(const MappingInfo& mapping,
   return success;
 }
 
+bool LinuxDumper::ElfFileIdentifierFromLoadedImage(
+    const MappingInfo& mapping,
+    wasteful_vector<uint8_t>& identifier) {
+  // Build IDs are a few dozen bytes; don't copy note segments that are
+  // implausibly large.
+  static const size_t kMaxNoteSegmentSize = 64 * 1024;
+
+  const uintptr_t start_addr = mapping.system_mapping_info.start_addr;
+  const uintptr_t end_addr = mapping.system_mapping_info.end_addr;
+  const size_t mapped_size = end_addr - start_addr;
+
+  ElfW(Ehdr) ehdr;
+  if (mapped_size < sizeof(ehdr) || !GetLoadedElfHeader(start_addr, &ehdr))
+    return false;
+  if (ehdr.e_phentsize != sizeof(ElfW(Phdr)) || ehdr.e_phnum == 0 ||
+      ehdr.e_phoff > mapped_size ||
+      ehdr.e_phnum > (mapped_size - ehdr.e_phoff) / sizeof(ElfW(Phdr))) {
+    return false;
+  }
+
+  const size_t phdrs_size = ehdr.e_phnum * sizeof(ElfW(Phdr));
+  ElfW(Phdr)* phdrs =
+      reinterpret_cast<ElfW(Phdr)*>(allocator_.Alloc(phdrs_size));
+  if (!phdrs ||
+      !CopyFromProcess(phdrs, pid_,
+                       reinterpret_cast<const void*>(start_addr +
+                                                     ehdr.e_phoff),
+                       phdrs_size)) {
+    return false;
+  }
+
+  // The mapping starts at file offset zero, which the first LOAD segment
+  // places at its vaddr less its offset past the load bias.
+  uintptr_t load_bias = 0;
+  bool found_load = false;
+  for (size_t i = 0; i < ehdr.e_phnum && !found_load; ++i) {
+    if (phdrs[i].p_type == PT_LOAD) {
+      load_bias = start_addr - (phdrs[i].p_vaddr - phdrs[i].p_offset);
+      found_load = true;
+    }
+  }
+  if (!found_load)
+    return false;
+
+  for (size_t i = 0; i < ehdr.e_phnum; ++i) {
+    if (phdrs[i].p_type != PT_NOTE)
+      continue;
+    const uintptr_t note_addr = load_bias + phdrs[i].p_vaddr;
+    const size_t note_size = phdrs[i].p_filesz;
+    if (note_size == 0 || note_size > kMaxNoteSegmentSize ||
+        note_addr < start_addr || note_addr >= end_addr ||
+        note_size > end_addr - note_addr) {
+      continue;
+    }
+    void* notes = allocator_.Alloc(note_size);
+    if (!notes ||
+        !CopyFromProcess(notes, pid_, reinterpret_cast<const void*>(note_addr),
+                         note_size)) {
+      continue;
+    }
+    if (FileID::ElfFileIdentifierFromNotes(notes, note_size, identifier))
+      return true;
+  }
+  return false;
+}
+
 void LinuxDumper::SetCrashInfoFromSigInfo(const siginfo_t& siginfo) {
   set_crash_address(reinterpret_cast<uintptr_t>(siginfo.si_addr));
   set_crash_signal(siginfo.si_signo);
@@ -571,6 +653,7 @@ bool LinuxDumper::EnumerateMappings() {
     if (*i1 == '-') {
       const char* i2 = my_read_hex_ptr(&end_addr, i1 + 1);
       if (*i2 == ' ') {
+        bool writable = (*(i2 + 2) == 'w');
         bool exec = (*(i2 + 3) == 'x');
         const char* i3 = my_read_hex_ptr(&offset, i2 + 6 /* skip ' rwxp ' */);
         if (*i3 == ' ') {
@@ -597,6 +680,7 @@ bool LinuxDumper::EnumerateMappings() {
               module->system_mapping_info.end_addr = end_addr;
               module->size = end_addr - module->start_addr;
               module->exec |= exec;
+              module->writable |= writable;
               line_reader->PopLine(line_len);
               continue;
             }
@@ -610,6 +694,7 @@ bool LinuxDumper::EnumerateMappings() {
           module->size = end_addr - start_addr;
           module->offset = offset;
           module->exec = exec;
+          module->writable = writable;
           if (name != NULL) {
             const unsigned l = my_strlen(name);
             if (l < sizeof(module->name))
@@ -646,8 +731,6 @@ bool LinuxDumper::EnumerateMappings() {
   return !mappings_.empty();
 }
 
-#if defined(__ANDROID__)
-
 bool LinuxDumper::GetLoadedElfHeader(uintptr_t start_addr, ElfW(Ehdr)* ehdr) {
   CopyFromProcess(ehdr, pid_,
                   reinterpret_cast<const void*>(start_addr),
@@ -655,6 +738,8 @@ bool LinuxDumper::GetLoadedElfHeader(uintptr_t start_addr, ElfW(Ehdr)* ehdr) {
   return my_memcmp(&ehdr->e_ident, ELFMAG, SELFMAG) == 0;
 }
 
+#if defined(__ANDROID__)
+
 void LinuxDumper::ParseLoadedElfProgramHeaders(ElfW(Ehdr)* ehdr,
                                                uintptr_t start_addr,
                                                uintptr_t* min_vaddr_ptr,
@@ -900,6 +985,37 @@ bool LinuxDumper::StackHasPointerToMapping(const uint8_t* stack_copy,
   return false;
 }
 
+size_t LinuxDumper::LiveStackLength(const uint8_t* stack_copy,
+                                    size_t stack_len,
+                                    uintptr_t sp_offset,
+                                    size_t slack) const {
+  const uintptr_t offset =
+      (sp_offset + sizeof(uintptr_t) - 1) & ~(sizeof(uintptr_t) - 1);
+  // Scan down from the end of the copy, so that the search stops at the
+  // outermost frame rather than examining every word of the stack.
+  // Most other words that look like pointers point into the stack
+  // itself, so test the last mapping hit before searching them all.
+  const MappingInfo* last_hit = NULL;
+  for (size_t end = stack_len & ~(sizeof(uintptr_t) - 1);
+       end >= offset + sizeof(uintptr_t);
+       end -= sizeof(uintptr_t)) {
+    uintptr_t addr;
+    my_memcpy(&addr, stack_copy + end - sizeof(uintptr_t), sizeof(addr));
+    const MappingInfo* mapping = NULL;
+    if (last_hit && addr >= last_hit->system_mapping_info.start_addr &&
+        addr < last_hit->system_mapping_info.end_addr) {
+      mapping = last_hit;
+    } else {
+      mapping = FindMappingNoBias(addr);
+    }
+    if (mapping && mapping->exec)
+      return slack < stack_len - end ? end + slack : stack_len;
+    if (mapping)
+      last_hit = mapping;
+  }
+  return stack_len;
+}
+
 // Find the mapping which the given memory address falls in.
 const MappingInfo* LinuxDumper::FindMapping(const void* address) const {
   const uintptr_t addr = (uintptr_t) address;
@@ -40,9 +40,7 @@
 
 #include <assert.h>
 #include <elf.h>
-#if defined(__ANDROID__)
 #include <link.h>
-#endif
 #include <linux/limits.h>
 #include <stdint.h>
 #include <sys/types.h>
@@ -152,6 +150,19 @@ class LinuxDumper {
                                 uintptr_t sp_offset,
                                 const MappingInfo& mapping);
 
+  // Return how much of |stack_copy| holds live frames: everything up to
+  // and including the outermost word, at or above the stack pointer, that
+  // could be a return address into an executable mapping, plus |slack|
+  // bytes for that frame's locals. Returns |stack_len| if there is no
+  // such word.
+  //   stack_copy: a copy of the stack, as for StackHasPointerToMapping.
+  //   stack_len: the length of the allocation pointed to by |stack_copy|.
+  //   sp_offset: the offset relative to stack_copy that reflects the
+  //              current value of the stack pointer.
+  //   slack: the number of bytes to keep beyond the outermost frame.
+  size_t LiveStackLength(const uint8_t* stack_copy, size_t stack_len,
+                         uintptr_t sp_offset, size_t slack) const;
+
   PageAllocator* allocator() { return &allocator_; }
 
   // Copy content of |length| bytes from a given process |child|,
@@ -159,6 +170,20 @@ class LinuxDumper {
   virtual bool CopyFromProcess(void* dest, pid_t child, const void* src,
                                size_t length) = 0;
 
+  // One of the copies made by CopyFromProcessBatch().
+  struct CopyRequest {
+    void* dest;
+    const void* src;
+    size_t length;
+  };
+
+  // Carry out the |count| copies in |requests| from process |child|.
+  // Dumpers that can read many ranges with one system call override this;
+  // the default calls CopyFromProcess() for each. Returns true if every
+  // copy succeeded.
+  virtual bool CopyFromProcessBatch(pid_t child, const CopyRequest* requests,
+                                    size_t count);
+
   // Builds a proc path for a certain pid for a node (/proc/<pid>/<node>).
   // |path| is a character array of at least NAME_MAX bytes to return the
   // result.|node| is the final node without any slashes. Returns true on
@@ -173,6 +198,14 @@ class LinuxDumper {
                                    unsigned int mapping_id,
                                    wasteful_vector<uint8_t>& identifier);
 
+  // Find the build ID note of the ELF image loaded at the start of |mapping|
+  // by reading its program headers and PT_NOTE segments from the process,
+  // without opening the mapped file. Return false if the image isn't there
+  // or has no build ID in memory; ElfFileIdentifierForMapping() then falls
+  // back to the file.
+  bool ElfFileIdentifierFromLoadedImage(const MappingInfo& mapping,
+                                        wasteful_vector<uint8_t>& identifier);
+
   void SetCrashInfoFromSigInfo(const siginfo_t& siginfo);
 
   uintptr_t crash_address() const { return crash_address_; }
@@ -232,6 +265,13 @@ class LinuxDumper {
   // Returns true if |path| is modified.
   bool HandleDeletedFileInMapping(char* path) const;
 
+  // Check that a given mapping at |start_addr| is for an ELF file. If it is,
+  // place the ELF header in |ehdr| and return true.
+  // The first LOAD segment in an ELF shared library has offset zero, so the
+  // ELF file header is at the start of this map entry, and in already mapped
+  // memory.
+  bool GetLoadedElfHeader(uintptr_t start_addr, ElfW(Ehdr)* ehdr);
+
    // ID of the crashed process.
   const pid_t pid_;
 
@@ -277,13 +317,6 @@ class LinuxDumper {
   // packed relocations, so that it properly represents the effective library
   // load bias. The following functions support this adjustment.
 
-  // Check that a given mapping at |start_addr| is for an ELF shared library.
-  // If it is, place the ELF header in |ehdr| and return true.
-  // The first LOAD segment in an ELF shared library has offset zero, so the
-  // ELF file header is at the start of this map entry, and in already mapped
-  // memory.
-  bool GetLoadedElfHeader(uintptr_t start_addr, ElfW(Ehdr)* ehdr);
-
   // For the ELF file mapped at |start_addr|, iterate ELF program headers to
   // find the min vaddr of all program header LOAD segments, the vaddr for
   // the DYNAMIC segment, and a count of DYNAMIC entries. Return values in
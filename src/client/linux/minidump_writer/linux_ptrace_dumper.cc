@@ -49,6 +49,8 @@
 #include <sys/ptrace.h>
 #include <sys/uio.h>
 #include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
 
 #if defined(__i386)
 #include <cpuid.h>
@@ -59,20 +61,19 @@
 #include "common/linux/linux_libc_support.h"
 #include "third_party/lss/linux_syscall_support.h"
 
-// Suspends a thread by attaching to it.
-static bool SuspendThread(pid_t pid) {
-  // This may fail if the thread has just died or debugged.
-  errno = 0;
-  if (sys_ptrace(PTRACE_ATTACH, pid, NULL, NULL) != 0 &&
-      errno != 0) {
-    return false;
-  }
-  while (sys_waitpid(pid, NULL, __WALL) < 0) {
-    if (errno != EINTR) {
-      sys_ptrace(PTRACE_DETACH, pid, NULL, NULL);
-      return false;
-    }
-  }
+#ifndef PTRACE_SEIZE
+#define PTRACE_SEIZE 0x4206
+#endif
+#ifndef PTRACE_INTERRUPT
+#define PTRACE_INTERRUPT 0x4207
+#endif
+#ifndef __WNOTHREAD
+#define __WNOTHREAD 0x20000000
+#endif
+
+// Checks that a thread we are tracing, which has stopped, is worth
+// dumping. If not, detaches from it and returns false.
+static bool CheckStoppedThread(pid_t pid) {
 #if defined(__i386) || defined(__x86_64)
   // On x86, the stack pointer is NULL or -1, when executing trusted code in
   // the seccomp sandbox. Not only does this cause difficulties down the line
@@ -96,16 +97,113 @@ static bool SuspendThread(pid_t pid) {
   return true;
 }
 
+// Waits for a thread we are tracing to stop, and checks that it is worth
+// dumping. If not, detaches from it and returns false.
+static bool WaitForThreadStop(pid_t pid) {
+  while (sys_waitpid(pid, NULL, __WALL) < 0) {
+    if (errno != EINTR) {
+      sys_ptrace(PTRACE_DETACH, pid, NULL, NULL);
+      return false;
+    }
+  }
+  return CheckStoppedThread(pid);
+}
+
+// Suspends a thread by attaching to it.
+static bool SuspendThread(pid_t pid) {
+  // This may fail if the thread has just died or debugged.
+  errno = 0;
+  if (sys_ptrace(PTRACE_ATTACH, pid, NULL, NULL) != 0 &&
+      errno != 0) {
+    return false;
+  }
+  return WaitForThreadStop(pid);
+}
+
+// Starts tracing a thread with PTRACE_SEIZE and asks it to stop, without
+// waiting for it to do so; ThreadsSuspend() collects the stops. Kernels
+// before Linux 3.4, which lack PTRACE_SEIZE, fail with ESRCH as though the
+// thread had gone, or on some architectures with EIO; the latter sets
+// |*unsupported| so that it isn't tried again.
+static bool InterruptThread(pid_t pid, bool* unsupported) {
+  if (sys_ptrace(PTRACE_SEIZE, pid, NULL, NULL) != 0) {
+    if (errno == EIO)
+      *unsupported = true;
+    return false;
+  }
+  if (sys_ptrace(PTRACE_INTERRUPT, pid, NULL, NULL) != 0) {
+    sys_ptrace(PTRACE_DETACH, pid, NULL, NULL);
+    return false;
+  }
+  return true;
+}
+
+// Returns the time in nanoseconds on the monotonic clock, or 0 if it
+// can't be read.
+static uint64_t MonotonicNanoseconds() {
+  struct kernel_timespec ts;
+  if (sys_clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+    return 0;
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
 // Resumes a thread by detaching from it.
 static bool ResumeThread(pid_t pid) {
   return sys_ptrace(PTRACE_DETACH, pid, NULL, NULL) >= 0;
 }
 
+// Reads the |count| ranges described by |remote| in process |pid| into
+// the buffers described by |local| with one process_vm_readv call.
+// Returns the number of bytes read, which stops short at the first page
+// that can't be read. Sets |*unavailable| and returns 0 if the kernel
+// doesn't support process_vm_readv or won't let us use it.
+static size_t ProcessVmReadv(pid_t pid, const struct kernel_iovec* local,
+                             const struct kernel_iovec* remote, size_t count,
+                             bool* unavailable) {
+  const ssize_t result = sys_process_vm_readv(pid, local, count, remote,
+                                              count, 0);
+  if (result < 0) {
+    if (errno == ENOSYS || errno == EPERM)
+      *unavailable = true;
+    return 0;
+  }
+  return result;
+}
+
+// Copies |length| bytes at |remote| in process |pid| to |local| a word
+// at a time with PTRACE_PEEKDATA, zeroing any words that can't be read.
+static void PeekFromProcess(uint8_t* local, pid_t pid, uint8_t* remote,
+                            size_t length) {
+  unsigned long tmp = 55;
+  size_t done = 0;
+  static const size_t word_size = sizeof(tmp);
+  while (done < length) {
+    const size_t l = (length - done > word_size) ? word_size : (length - done);
+    if (sys_ptrace(PTRACE_PEEKDATA, pid, remote + done, &tmp) == -1) {
+      tmp = 0;
+    }
+    my_memcpy(local + done, &tmp, l);
+    done += l;
+  }
+}
+
 namespace google_breakpad {
 
 LinuxPtraceDumper::LinuxPtraceDumper(pid_t pid)
     : LinuxDumper(pid),
-      threads_suspended_(false) {
+      threads_suspended_(false),
+      process_vm_readv_unavailable_(false),
+      mem_fd_(-1),
+      mem_fd_pid_(0),
+      process_tgid_(-1),
+      process_ppid_(-1),
+      suspend_start_ns_(0),
+      suspend_time_ns_(0),
+      freeze_time_ns_(0) {
+}
+
+LinuxPtraceDumper::~LinuxPtraceDumper() {
+  CloseMemFd();
 }
 
 bool LinuxPtraceDumper::BuildProcPath(char* path, pid_t pid,
@@ -132,23 +230,114 @@ bool LinuxPtraceDumper::BuildProcPath(char* path, pid_t pid,
 
 bool LinuxPtraceDumper::CopyFromProcess(void* dest, pid_t child,
                                         const void* src, size_t length) {
-  unsigned long tmp = 55;
-  size_t done = 0;
-  static const size_t word_size = sizeof(tmp);
   uint8_t* const local = (uint8_t*) dest;
-  uint8_t* const remote = (uint8_t*) src;
-
+  const uintptr_t remote = (uintptr_t) src;
+  const uintptr_t page_size = getpagesize();
+  size_t done = 0;
   while (done < length) {
-    const size_t l = (length - done > word_size) ? word_size : (length - done);
-    if (sys_ptrace(PTRACE_PEEKDATA, child, remote + done, &tmp) == -1) {
-      tmp = 0;
+    done += ReadProcessMemory(local + done, child, remote + done,
+                              length - done);
+    if (done == length)
+      break;
+    // Neither process_vm_readv nor /proc/<child>/mem could read the page
+    // at |remote + done|. Peek at the rest of that page a word at a time,
+    // as ptrace may manage what they couldn't.
+    const uintptr_t page_end = ((remote + done) | (page_size - 1)) + 1;
+    size_t chunk = page_end - (remote + done);
+    if (chunk > length - done)
+      chunk = length - done;
+    PeekFromProcess(local + done, child,
+                    reinterpret_cast<uint8_t*>(remote + done), chunk);
+    done += chunk;
+  }
+  return true;
+}
+
+bool LinuxPtraceDumper::CopyFromProcessBatch(pid_t child,
+                                             const CopyRequest* requests,
+                                             size_t count) {
+  struct kernel_iovec local[kMaxBatchCopies];
+  struct kernel_iovec remote[kMaxBatchCopies];
+  for (size_t first = 0; first < count; first += kMaxBatchCopies) {
+    const size_t batch = count - first < kMaxBatchCopies ?
+        count - first : kMaxBatchCopies;
+    for (size_t i = 0; i < batch; ++i) {
+      const CopyRequest& request = requests[first + i];
+      local[i].iov_base = request.dest;
+      local[i].iov_len = request.length;
+      remote[i].iov_base = const_cast<void*>(request.src);
+      remote[i].iov_len = request.length;
+    }
+    size_t copied = 0;
+    if (!process_vm_readv_unavailable_) {
+      copied = ProcessVmReadv(child, local, remote, batch,
+                              &process_vm_readv_unavailable_);
+    }
+    // Finish any requests process_vm_readv didn't, starting from where it
+    // stopped.
+    for (size_t i = 0; i < batch; ++i) {
+      const CopyRequest& request = requests[first + i];
+      if (copied >= request.length) {
+        copied -= request.length;
+        continue;
+      }
+      CopyFromProcess(static_cast<uint8_t*>(request.dest) + copied, child,
+                      static_cast<const uint8_t*>(request.src) + copied,
+                      request.length - copied);
+      copied = 0;
     }
-    my_memcpy(local + done, &tmp, l);
-    done += l;
   }
   return true;
 }
 
+size_t LinuxPtraceDumper::ReadProcessMemory(uint8_t* dest, pid_t child,
+                                            uintptr_t src, size_t length) {
+  size_t done = 0;
+  if (!process_vm_readv_unavailable_) {
+    struct kernel_iovec local;
+    struct kernel_iovec remote;
+    local.iov_base = dest;
+    local.iov_len = length;
+    remote.iov_base = reinterpret_cast<void*>(src);
+    remote.iov_len = length;
+    done = ProcessVmReadv(child, &local, &remote, 1,
+                          &process_vm_readv_unavailable_);
+  }
+  // /proc/<child>/mem can read pages the tracee has mapped without read
+  // permission, which process_vm_readv can't.
+  if (done < length) {
+    const int fd = GetMemFd(child);
+    while (fd >= 0 && done < length) {
+      const ssize_t r = sys_pread64(fd, dest + done, length - done,
+                                    src + done);
+      if (r <= 0)
+        break;
+      done += r;
+    }
+  }
+  return done;
+}
+
+int LinuxPtraceDumper::GetMemFd(pid_t child) {
+  if (mem_fd_pid_ == child)
+    return mem_fd_;
+  CloseMemFd();
+  mem_fd_pid_ = child;
+  char mem_path[NAME_MAX];
+  if (BuildProcPath(mem_path, child, "mem"))
+    mem_fd_ = sys_open(mem_path, O_RDONLY, 0);
+  if (mem_fd_ < 0)
+    mem_fd_ = -1;
+  return mem_fd_;
+}
+
+void LinuxPtraceDumper::CloseMemFd() {
+  if (mem_fd_ >= 0)
+    sys_close(mem_fd_);
+  mem_fd_ = -1;
+  mem_fd_pid_ = 0;
+}
+
 bool LinuxPtraceDumper::ReadRegisterSet(ThreadInfo* info, pid_t tid)
 {
 #ifdef PTRACE_GETREGSET
@@ -193,19 +382,15 @@ bool LinuxPtraceDumper::ReadRegisters(ThreadInfo* info, pid_t tid) {
 #endif
 }
 
-// Read thread info from /proc/$pid/status.
-// Fill out the |tgid|, |ppid| and |pid| members of |info|. If unavailable,
-// these members are set to -1. Returns true iff all three members are
-// available.
-bool LinuxPtraceDumper::GetThreadInfoByIndex(size_t index, ThreadInfo* info) {
-  if (index >= threads_.size())
-    return false;
-
-  pid_t tid = threads_[index];
+// Read the |tgid| and |ppid| of the process's threads from
+// /proc/$pid/status; these are the same for every thread, so are read
+// once. Returns true iff both are available.
+bool LinuxPtraceDumper::ReadProcessStatus() {
+  if (process_tgid_ != -1 && process_ppid_ != -1)
+    return true;
 
-  assert(info != NULL);
   char status_path[NAME_MAX];
-  if (!BuildProcPath(status_path, tid, "status"))
+  if (!BuildProcPath(status_path, pid_, "status"))
     return false;
 
   const int fd = sys_open(status_path, O_RDONLY, 0);
@@ -216,21 +401,36 @@ bool LinuxPtraceDumper::GetThreadInfoByIndex(size_t index, ThreadInfo* info) {
   const char* line;
   unsigned line_len;
 
-  info->ppid = info->tgid = -1;
+  process_ppid_ = process_tgid_ = -1;
 
   while (line_reader->GetNextLine(&line, &line_len)) {
     if (my_strncmp("Tgid:\t", line, 6) == 0) {
-      my_strtoui(&info->tgid, line + 6);
+      my_strtoui(&process_tgid_, line + 6);
     } else if (my_strncmp("PPid:\t", line, 6) == 0) {
-      my_strtoui(&info->ppid, line + 6);
+      my_strtoui(&process_ppid_, line + 6);
     }
 
     line_reader->PopLine(line_len);
   }
   sys_close(fd);
 
-  if (info->ppid == -1 || info->tgid == -1)
+  return process_ppid_ != -1 && process_tgid_ != -1;
+}
+
+// Fill out the |tgid|, |ppid| and |pid| members of |info|, and read the
+// thread's registers. Returns true iff all are available.
+bool LinuxPtraceDumper::GetThreadInfoByIndex(size_t index, ThreadInfo* info) {
+  if (index >= threads_.size())
+    return false;
+
+  pid_t tid = threads_[index];
+
+  assert(info != NULL);
+  info->ppid = info->tgid = -1;
+  if (!ReadProcessStatus())
     return false;
+  info->tgid = process_tgid_;
+  info->ppid = process_ppid_;
 
   if (!ReadRegisterSet(info, tid)) {
     if (!ReadRegisters(info, tid)) {
@@ -313,30 +513,125 @@ bool LinuxPtraceDumper::IsPostMortem() const {
 bool LinuxPtraceDumper::ThreadsSuspend() {
   if (threads_suspended_)
     return true;
+  suspend_start_ns_ = MonotonicNanoseconds();
+  freeze_time_ns_ = 0;
+
+  // Ask every thread to stop before waiting for any of them, so that they
+  // all stop at once rather than one after another. Threads that can't be
+  // seized (on kernels before 3.4, any of them) are attached to and waited
+  // for one at a time instead.
+  enum ThreadState { kAttach, kPending, kStopped, kGone };
+  ThreadState* const states = reinterpret_cast<ThreadState*>(
+      allocator_.Alloc(threads_.size() * sizeof(ThreadState)));
+  bool seize_unsupported = false;
+  size_t pending = 0;
   for (size_t i = 0; i < threads_.size(); ++i) {
-    if (!SuspendThread(threads_[i])) {
-      // If the thread either disappeared before we could attach to it, or if
-      // it was part of the seccomp sandbox's trusted code, it is OK to
-      // silently drop it from the minidump.
-      if (i < threads_.size() - 1) {
-        my_memmove(&threads_[i], &threads_[i + 1],
-                   (threads_.size() - i - 1) * sizeof(threads_[i]));
+    states[i] = !seize_unsupported &&
+        InterruptThread(threads_[i], &seize_unsupported) ? kPending : kAttach;
+    if (states[i] == kPending)
+      ++pending;
+  }
+
+  // Collect the stops in whatever order they come. Waiting for each
+  // thread in turn can hang: the group leader's exit, for one, isn't
+  // reported until every other thread has gone, and they are stopped. A
+  // thread that exits instead of stopping is dropped. __WNOTHREAD limits
+  // the waits to this thread's tracees and children, so that threads
+  // suspending other processes at the same time don't take each other's
+  // stops. Any other pid is a child of this thread, whose status is lost;
+  // the threads that dump have none.
+  while (pending > 0) {
+    // When only a group leader is left, poll it, so as to notice if it
+    // has exited.
+    size_t leader = threads_.size();
+    if (pending == 1) {
+      for (size_t i = 0; i < threads_.size(); ++i) {
+        if (states[i] == kPending && threads_[i] == pid_)
+          leader = i;
       }
-      threads_.resize(threads_.size() - 1);
-      --i;
     }
+    int status;
+    const pid_t waited = leader < threads_.size() ?
+        sys_waitpid(pid_, &status, __WALL | __WNOTHREAD | WNOHANG) :
+        sys_waitpid(-1, &status, __WALL | __WNOTHREAD);
+    if (waited == 0) {
+      if (IsZombie(pid_)) {
+        states[leader] = kGone;
+        --pending;
+      } else {
+        sys_sched_yield();
+      }
+      continue;
+    }
+    if (waited < 0) {
+      if (errno == EINTR)
+        continue;
+      // Nothing left to wait for: the pending threads have gone.
+      for (size_t i = 0; i < threads_.size(); ++i) {
+        if (states[i] == kPending)
+          states[i] = kGone;
+      }
+      break;
+    }
+    for (size_t i = 0; i < threads_.size(); ++i) {
+      if (threads_[i] != waited)
+        continue;
+      const bool exited = WIFEXITED(status) || WIFSIGNALED(status);
+      if (states[i] == kPending) {
+        --pending;
+        states[i] = !exited && CheckStoppedThread(waited) ? kStopped : kGone;
+      } else if (states[i] == kStopped && exited) {
+        states[i] = kGone;
+      }
+      break;
+    }
+  }
+
+  size_t kept = 0;
+  for (size_t i = 0; i < threads_.size(); ++i) {
+    const bool suspended = states[i] == kAttach ?
+        SuspendThread(threads_[i]) : states[i] == kStopped;
+    // If the thread either disappeared before we could attach to it, or if
+    // it was part of the seccomp sandbox's trusted code, it is OK to
+    // silently drop it from the minidump.
+    if (suspended)
+      threads_[kept++] = threads_[i];
   }
+  threads_.resize(kept);
   threads_suspended_ = true;
+  suspend_time_ns_ = MonotonicNanoseconds() - suspend_start_ns_;
   return threads_.size() > 0;
 }
 
+bool LinuxPtraceDumper::IsZombie(pid_t pid) const {
+  char path[NAME_MAX];
+  if (!BuildProcPath(path, pid, "stat"))
+    return false;
+  const int fd = sys_open(path, O_RDONLY, 0);
+  if (fd < 0)
+    return true;
+  char buf[512];
+  const ssize_t n = sys_read(fd, buf, sizeof(buf) - 1);
+  sys_close(fd);
+  if (n <= 0)
+    return true;
+  buf[n] = '\0';
+  // The state follows the command name, which is in parentheses and may
+  // itself contain them.
+  const char* const paren = my_strrchr(buf, ')');
+  return paren && (paren[1] == ' ') && (paren[2] == 'Z' || paren[2] == 'X');
+}
+
 bool LinuxPtraceDumper::ThreadsResume() {
   if (!threads_suspended_)
     return false;
+  // Reads through /proc/<pid>/mem fail once we've detached.
+  CloseMemFd();
   bool good = true;
   for (size_t i = 0; i < threads_.size(); ++i)
     good &= ResumeThread(threads_[i]);
   threads_suspended_ = false;
+  freeze_time_ns_ = MonotonicNanoseconds() - suspend_start_ns_;
   return good;
 }
 
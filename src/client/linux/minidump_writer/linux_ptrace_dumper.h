@@ -52,13 +52,24 @@ class LinuxPtraceDumper : public LinuxDumper {
   // success.
   virtual bool BuildProcPath(char* path, pid_t pid, const char* node) const;
 
+  virtual ~LinuxPtraceDumper();
+
   // Implements LinuxDumper::CopyFromProcess().
   // Copies content of |length| bytes from a given process |child|,
-  // starting from |src|, into |dest|. This method uses ptrace to extract
-  // the content from the target process. Always returns true.
+  // starting from |src|, into |dest|. This method reads the target
+  // process with process_vm_readv() or /proc/<child>/mem where it can,
+  // and with ptrace elsewhere; bytes that can't be read are zeroed.
+  // Always returns true.
   virtual bool CopyFromProcess(void* dest, pid_t child, const void* src,
                                size_t length);
 
+  // Implements LinuxDumper::CopyFromProcessBatch().
+  // Reads up to kMaxBatchCopies requests with each process_vm_readv()
+  // call, falling back to CopyFromProcess() for whatever that leaves
+  // unread. Always returns true.
+  virtual bool CopyFromProcessBatch(pid_t child, const CopyRequest* requests,
+                                    size_t count);
+
   // Implements LinuxDumper::GetThreadInfoByIndex().
   // Reads information about the |index|-th thread of |threads_|.
   // Returns true on success. One must have called |ThreadsSuspend| first.
@@ -71,12 +82,20 @@ class LinuxPtraceDumper : public LinuxDumper {
 
   // Implements LinuxDumper::ThreadsSuspend().
   // Suspends all threads in the given process. Returns true on success.
+  // Where the kernel supports PTRACE_SEIZE, every thread is asked to stop
+  // before waiting for any of them to, so large processes stop quickly.
   virtual bool ThreadsSuspend();
 
   // Implements LinuxDumper::ThreadsResume().
   // Resumes all threads in the given process. Returns true on success.
   virtual bool ThreadsResume();
 
+  // The time in nanoseconds the last ThreadsSuspend() call took to stop
+  // the process's threads, and the time from its start until the
+  // following ThreadsResume() let them run again; 0 until known.
+  uint64_t suspend_time_ns() const { return suspend_time_ns_; }
+  uint64_t freeze_time_ns() const { return freeze_time_ns_; }
+
  protected:
   // Implements LinuxDumper::EnumerateThreads().
   // Enumerates all threads of the given process into |threads_|.
@@ -94,6 +113,53 @@ class LinuxPtraceDumper : public LinuxDumper {
   // Read the tracee's registers on kernel with PTRACE_GETREGS support.
   // Returns true on success.
   bool ReadRegisters(ThreadInfo* info, pid_t tid);
+
+  // Returns true if |pid| has exited but not been reaped, or can no
+  // longer be found.
+  bool IsZombie(pid_t pid) const;
+
+  // Read the thread group and parent process IDs shared by all the
+  // process's threads into |process_tgid_| and |process_ppid_|, if that
+  // hasn't been done already. Returns true on success.
+  bool ReadProcessStatus();
+
+  // Read up to |length| bytes at |src| in |child| into |dest|, first with
+  // process_vm_readv() and then from /proc/<child>/mem. Returns the number
+  // of bytes read, which is less than |length| if some page can't be read
+  // by either.
+  size_t ReadProcessMemory(uint8_t* dest, pid_t child, uintptr_t src,
+                           size_t length);
+
+  // Return a descriptor for /proc/<child>/mem, or -1 if it can't be opened.
+  // The descriptor is kept open until a different thread is asked for or
+  // the threads are resumed.
+  int GetMemFd(pid_t child);
+
+  // Close the descriptor GetMemFd() returned, if any.
+  void CloseMemFd();
+
+  // The most requests CopyFromProcessBatch() passes to one system call.
+  static const size_t kMaxBatchCopies = 64;
+
+  // Set once process_vm_readv() fails with ENOSYS or EPERM, so that it
+  // isn't tried again.
+  bool process_vm_readv_unavailable_;
+
+  // The descriptor GetMemFd() last opened, and the thread it was opened
+  // for; mem_fd_ is -1 if the open failed, and mem_fd_pid_ is 0 if none
+  // has been attempted.
+  int mem_fd_;
+  pid_t mem_fd_pid_;
+
+  // The values ReadProcessStatus() read, or -1.
+  pid_t process_tgid_;
+  pid_t process_ppid_;
+
+  // When the last ThreadsSuspend() call started, on the monotonic clock,
+  // and the values suspend_time_ns() and freeze_time_ns() return.
+  uint64_t suspend_start_ns_;
+  uint64_t suspend_time_ns_;
+  uint64_t freeze_time_ns_;
 };
 
 }  // namespace google_breakpad
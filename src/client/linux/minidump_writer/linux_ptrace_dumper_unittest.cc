@@ -37,9 +37,11 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <poll.h>
+#include <pthread.h>
 #include <unistd.h>
 #include <signal.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/prctl.h>
@@ -47,6 +49,7 @@
 #include <sys/types.h>
 
 #include <string>
+#include <vector>
 
 #include "breakpad_googletest_includes.h"
 #include "client/linux/minidump_writer/linux_ptrace_dumper.h"
@@ -67,7 +70,7 @@ using namespace google_breakpad;
 namespace {
 
 pid_t SetupChildProcess(int number_of_threads) {
-  char kNumberOfThreadsArgument[2];
+  char kNumberOfThreadsArgument[8];
   sprintf(kNumberOfThreadsArgument, "%d", number_of_threads);
 
   int fds[2];
@@ -422,6 +425,37 @@ TEST_F(LinuxPtraceDumperChildTest, FileIDsMatch) {
   EXPECT_EQ(identifier_string1, identifier_string2);
 }
 
+TEST_F(LinuxPtraceDumperChildTest, LoadedImageFileIDsMatch) {
+  // Every build ID read from a loaded image must match the one read from
+  // its file, and our binary at least should have one.
+  char exe_name[PATH_MAX];
+  ASSERT_TRUE(SafeReadLink("/proc/self/exe", exe_name));
+
+  LinuxPtraceDumper dumper(getppid());
+  ASSERT_TRUE(dumper.Init());
+  ASSERT_TRUE(dumper.ThreadsSuspend());
+  const wasteful_vector<MappingInfo*> mappings = dumper.mappings();
+  bool found_exe = false;
+  for (unsigned i = 0; i < mappings.size(); ++i) {
+    const MappingInfo* mapping = mappings[i];
+    if (mapping->name[0] != '/')
+      continue;
+    id_vector identifier1(make_vector());
+    if (!dumper.ElfFileIdentifierFromLoadedImage(*mapping, identifier1))
+      continue;
+    id_vector identifier2(make_vector());
+    FileID fileid(mapping->name);
+    EXPECT_TRUE(fileid.ElfFileIdentifier(identifier2));
+    EXPECT_EQ(FileID::ConvertIdentifierToString(identifier2),
+              FileID::ConvertIdentifierToString(identifier1))
+        << mapping->name;
+    if (!strcmp(mapping->name, exe_name))
+      found_exe = true;
+  }
+  EXPECT_TRUE(dumper.ThreadsResume());
+  EXPECT_TRUE(found_exe);
+}
+
 /* Get back to normal behavior of TEST*() macros wrt TestBody. */
 #undef TestBody
 
@@ -578,3 +612,224 @@ TEST_F(LinuxPtraceDumperTest, SanitizeStackCopy) {
   ASSERT_TRUE(WIFSIGNALED(status));
   ASSERT_EQ(SIGKILL, WTERMSIG(status));
 }
+
+TEST_F(LinuxPtraceDumperTest, LiveStackLength) {
+  static const size_t kNumberOfThreadsInHelperProgram = 1;
+
+  pid_t child_pid = SetupChildProcess(kNumberOfThreadsInHelperProgram);
+  ASSERT_NE(child_pid, -1);
+
+  LinuxPtraceDumper dumper(child_pid);
+  ASSERT_TRUE(dumper.Init());
+  EXPECT_TRUE(dumper.ThreadsSuspend());
+
+  ThreadInfo thread_info;
+  EXPECT_TRUE(dumper.GetThreadInfoByIndex(0, &thread_info));
+  const uintptr_t code = thread_info.GetInstructionPointer();
+  const uintptr_t word = sizeof(uintptr_t);
+
+  uintptr_t simulated_stack[16];
+  const uint8_t* stack = reinterpret_cast<uint8_t*>(simulated_stack);
+
+  // With no return addresses, nothing is trimmed.
+  memset(simulated_stack, 0, sizeof(simulated_stack));
+  simulated_stack[3] = thread_info.stack_pointer;
+  EXPECT_EQ(sizeof(simulated_stack),
+            dumper.LiveStackLength(stack, sizeof(simulated_stack), 0, 0));
+
+  // The outermost return address ends the live stack, and pointers into
+  // the stack beyond it don't extend it.
+  simulated_stack[2] = code;
+  simulated_stack[5] = code;
+  simulated_stack[9] = thread_info.stack_pointer;
+  EXPECT_EQ(6 * word,
+            dumper.LiveStackLength(stack, sizeof(simulated_stack), 0, 0));
+  EXPECT_EQ(6 * word + 16,
+            dumper.LiveStackLength(stack, sizeof(simulated_stack), 0, 16));
+  EXPECT_EQ(sizeof(simulated_stack),
+            dumper.LiveStackLength(stack, sizeof(simulated_stack), 0, 4096));
+
+  // Words below the stack pointer are ignored.
+  EXPECT_EQ(sizeof(simulated_stack),
+            dumper.LiveStackLength(stack, sizeof(simulated_stack), 6 * word,
+                                   0));
+  EXPECT_EQ(6 * word,
+            dumper.LiveStackLength(stack, sizeof(simulated_stack), 5 * word,
+                                   0));
+
+  EXPECT_TRUE(dumper.ThreadsResume());
+  kill(child_pid, SIGKILL);
+
+  // Reap child.
+  int status;
+  ASSERT_NE(-1, HANDLE_EINTR(waitpid(child_pid, &status, 0)));
+  ASSERT_TRUE(WIFSIGNALED(status));
+  ASSERT_EQ(SIGKILL, WTERMSIG(status));
+}
+
+TEST(LinuxPtraceDumperTest, CopyFromProcess) {
+  // The child maps four pages of a known pattern, makes the second
+  // unreadable, and unmaps the fourth.
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t kPages = 4;
+  int fds[2];
+  ASSERT_NE(-1, pipe(fds));
+  pid_t child_pid = fork();
+  if (child_pid == 0) {
+    close(fds[0]);
+    uint8_t* memory = reinterpret_cast<uint8_t*>(
+        mmap(NULL, kPages * page_size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (memory == MAP_FAILED)
+      _exit(1);
+    for (size_t i = 0; i < kPages * page_size; ++i)
+      memory[i] = static_cast<uint8_t>(i * 7 + i / page_size);
+    mprotect(memory + page_size, page_size, PROT_NONE);
+    munmap(memory + 3 * page_size, page_size);
+    IGNORE_RET(write(fds[1], &memory, sizeof(memory)));
+    close(fds[1]);
+    while (true)
+      pause();
+  }
+  close(fds[1]);
+  ASSERT_NE(-1, child_pid);
+  uint8_t* remote;
+  ASSERT_EQ(static_cast<ssize_t>(sizeof(remote)),
+            HANDLE_EINTR(read(fds[0], &remote, sizeof(remote))));
+  close(fds[0]);
+
+  LinuxPtraceDumper dumper(child_pid);
+  ASSERT_TRUE(dumper.Init());
+  EXPECT_TRUE(dumper.ThreadsSuspend());
+
+  // Readable and unreadable pages both come back intact; the unmapped
+  // one comes back zeroed.
+  std::vector<uint8_t> copy(kPages * page_size, 0xff);
+  EXPECT_TRUE(dumper.CopyFromProcess(&copy[0], child_pid, remote,
+                                     copy.size()));
+  for (size_t i = 0; i < 3 * page_size; ++i)
+    ASSERT_EQ(static_cast<uint8_t>(i * 7 + i / page_size), copy[i]) << i;
+  for (size_t i = 3 * page_size; i < copy.size(); ++i)
+    ASSERT_EQ(0, copy[i]) << i;
+
+  // Batched copies that straddle those pages do the same.
+  uint8_t first[50], second[20], third[16];
+  memset(first, 0xff, sizeof(first));
+  memset(second, 0xff, sizeof(second));
+  memset(third, 0xff, sizeof(third));
+  LinuxDumper::CopyRequest requests[3] = {
+    { first, remote + 100, sizeof(first) },
+    { second, remote + page_size - 10, sizeof(second) },
+    { third, remote + 3 * page_size - 8, sizeof(third) },
+  };
+  EXPECT_TRUE(dumper.CopyFromProcessBatch(child_pid, requests, 3));
+  EXPECT_EQ(0, memcmp(first, &copy[100], sizeof(first)));
+  EXPECT_EQ(0, memcmp(second, &copy[page_size - 10], sizeof(second)));
+  EXPECT_EQ(0, memcmp(third, &copy[3 * page_size - 8], sizeof(third)));
+
+  EXPECT_TRUE(dumper.ThreadsResume());
+  kill(child_pid, SIGKILL);
+
+  // Reap child.
+  int status;
+  ASSERT_NE(-1, HANDLE_EINTR(waitpid(child_pid, &status, 0)));
+  ASSERT_TRUE(WIFSIGNALED(status));
+  ASSERT_EQ(SIGKILL, WTERMSIG(status));
+}
+
+TEST(LinuxPtraceDumperTest, ThreadsSuspendStopsAllThreads) {
+  static const size_t kNumberOfThreadsInHelperProgram = 20;
+
+  pid_t child_pid = SetupChildProcess(kNumberOfThreadsInHelperProgram);
+  ASSERT_NE(child_pid, -1);
+
+  LinuxPtraceDumper dumper(child_pid);
+  ASSERT_TRUE(dumper.Init());
+  EXPECT_EQ(0U, dumper.suspend_time_ns());
+  EXPECT_TRUE(dumper.ThreadsSuspend());
+#if !defined(THREAD_SANITIZER)
+  EXPECT_EQ(kNumberOfThreadsInHelperProgram, dumper.threads().size());
+#endif
+  EXPECT_LT(0U, dumper.suspend_time_ns());
+
+  // Every thread is in a tracing stop.
+  for (size_t i = 0; i < dumper.threads().size(); ++i) {
+    char stat_path[NAME_MAX];
+    ASSERT_TRUE(dumper.BuildProcPath(stat_path, dumper.threads()[i], "stat"));
+    FILE* stat_file = fopen(stat_path, "r");
+    ASSERT_TRUE(stat_file != NULL);
+    char state = 0;
+    EXPECT_EQ(1, fscanf(stat_file, "%*d %*s %c", &state));
+    fclose(stat_file);
+    EXPECT_EQ('t', state);
+
+    ThreadInfo info;
+    EXPECT_TRUE(dumper.GetThreadInfoByIndex(i, &info));
+    EXPECT_EQ(child_pid, info.tgid);
+    EXPECT_EQ(getpid(), info.ppid);
+  }
+
+  EXPECT_TRUE(dumper.ThreadsResume());
+  EXPECT_LE(dumper.suspend_time_ns(), dumper.freeze_time_ns());
+  kill(child_pid, SIGKILL);
+
+  // Reap child.
+  int status;
+  ASSERT_NE(-1, HANDLE_EINTR(waitpid(child_pid, &status, 0)));
+  ASSERT_TRUE(WIFSIGNALED(status));
+  ASSERT_EQ(SIGKILL, WTERMSIG(status));
+}
+
+namespace {
+
+// Suspends and resumes the threads of the process |arg| points to a few
+// times, counting the rounds in which they were all stopped.
+void* SuspendRepeatedly(void* arg) {
+  pid_t* const pid = static_cast<pid_t*>(arg);
+  for (int round = 0; round < 20; ++round) {
+    LinuxPtraceDumper dumper(*pid);
+    if (!dumper.Init() || !dumper.ThreadsSuspend())
+      return NULL;
+    for (size_t i = 0; i < dumper.threads().size(); ++i) {
+      ThreadInfo info;
+      if (!dumper.GetThreadInfoByIndex(i, &info) || info.tgid != *pid)
+        return NULL;
+    }
+    if (!dumper.ThreadsResume())
+      return NULL;
+  }
+  return arg;
+}
+
+}  // namespace
+
+TEST(LinuxPtraceDumperTest, ThreadsSuspendFromConcurrentThreads) {
+  // Each thread must collect the stops of the threads it suspends, and not
+  // those of the other's.
+  static const size_t kNumberOfThreadsInHelperProgram = 10;
+
+  pid_t child_pids[2];
+  for (int i = 0; i < 2; ++i) {
+    child_pids[i] = SetupChildProcess(kNumberOfThreadsInHelperProgram);
+    ASSERT_NE(child_pids[i], -1);
+  }
+
+  pthread_t threads[2];
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(0, pthread_create(&threads[i], NULL, SuspendRepeatedly,
+                                &child_pids[i]));
+  }
+  for (int i = 0; i < 2; ++i) {
+    void* result = NULL;
+    ASSERT_EQ(0, pthread_join(threads[i], &result));
+    EXPECT_EQ(&child_pids[i], result);
+  }
+
+  for (int i = 0; i < 2; ++i) {
+    kill(child_pids[i], SIGKILL);
+    int status;
+    ASSERT_NE(-1, HANDLE_EINTR(waitpid(child_pids[i], &status, 0)));
+    ASSERT_TRUE(WIFSIGNALED(status));
+    ASSERT_EQ(SIGKILL, WTERMSIG(status));
+  }
+}
@@ -0,0 +1,220 @@
+// Copyright (c) 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// minidump_compressor.cc: Compress a finished minidump file in place.
+//
+// See minidump_compressor.h for documentation.
+//
+// This runs in a compromised context: see the top of minidump_writer.cc.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "client/linux/minidump_writer/minidump_compressor.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+#include "common/basictypes.h"
+#include "common/linux/linux_libc_support.h"
+#include "common/memory_allocator.h"
+#include "third_party/lss/linux_syscall_support.h"
+
+namespace google_breakpad {
+
+#ifdef HAVE_LIBZ
+
+namespace {
+
+// The size of the buffers the minidump is read into and compressed into.
+const size_t kChunkSize = 64 * 1024;
+
+// deflate needs (1 << (kWindowBits + 2)) + (1 << (kMemLevel + 9)) bytes, 256KB
+// with these settings, plus a few kilobytes for its state.
+const int kWindowBits = 15;
+const int kMemLevel = 8;
+const size_t kArenaSize = 288 * 1024;
+
+// The pages zlib's allocations are carved from. Nothing is freed until the
+// PageAllocator that provided them is destroyed.
+struct Arena {
+  uint8_t* base;
+  size_t size;
+  size_t used;
+};
+
+voidpf ArenaAlloc(voidpf opaque, uInt items, uInt size) {
+  Arena* arena = static_cast<Arena*>(opaque);
+  const size_t bytes = (static_cast<size_t>(items) * size + 15) & ~15;
+  if (bytes > arena->size - arena->used)
+    return Z_NULL;
+  voidpf result = arena->base + arena->used;
+  arena->used += bytes;
+  return result;
+}
+
+void ArenaFree(voidpf opaque, voidpf address) {
+}
+
+bool ReadFully(int fd, uint8_t* buffer, size_t length, off_t offset) {
+  while (length) {
+    const ssize_t r = sys_pread64(fd, buffer, length, offset);
+    if (r <= 0)
+      return false;
+    buffer += r;
+    length -= r;
+    offset += r;
+  }
+  return true;
+}
+
+bool WriteFully(int fd, const uint8_t* buffer, size_t length, off_t offset) {
+  while (length) {
+    const ssize_t r = sys_pwrite64(fd, buffer, length, offset);
+    if (r <= 0)
+      return false;
+    buffer += r;
+    length -= r;
+    offset += r;
+  }
+  return true;
+}
+
+// Copies |length| bytes at |from| in |fd| to |to|, which must not overlap
+// them, through |buffer|.
+bool CopyWithin(int fd, uint8_t* buffer, off_t from, off_t to, off_t length) {
+  while (length > 0) {
+    size_t chunk = kChunkSize;
+    if (static_cast<off_t>(chunk) > length)
+      chunk = length;
+    if (!ReadFully(fd, buffer, chunk, from) ||
+        !WriteFully(fd, buffer, chunk, to)) {
+      return false;
+    }
+    from += chunk;
+    to += chunk;
+    length -= chunk;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool CompressMinidumpFile(int fd) {
+  const off_t file_size = sys_lseek(fd, 0, SEEK_END);
+  if (file_size <= 0)
+    return true;
+
+  PageAllocator allocator;
+  uint8_t* const in = reinterpret_cast<uint8_t*>(allocator.Alloc(kChunkSize));
+  uint8_t* const out = reinterpret_cast<uint8_t*>(allocator.Alloc(kChunkSize));
+  Arena arena = {
+    reinterpret_cast<uint8_t*>(allocator.Alloc(kArenaSize)), kArenaSize, 0
+  };
+  if (!in || !out || !arena.base)
+    return true;
+
+  z_stream stream;
+  my_memset(&stream, 0, sizeof(stream));
+  stream.zalloc = ArenaAlloc;
+  stream.zfree = ArenaFree;
+  stream.opaque = &arena;
+  // The crashed process stays frozen until this is done, so favour speed.
+  // Adding 16 to the window bits asks for a gzip header and trailer.
+  if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, kWindowBits + 16,
+                   kMemLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return true;
+  }
+
+  // Write the compressed copy after the original, so that the original is
+  // untouched until the copy is known to be complete and smaller.
+  off_t read_offset = 0;
+  off_t write_offset = file_size;
+  bool compressed = false;
+  for (;;) {
+    if (stream.avail_in == 0 && read_offset < file_size) {
+      size_t length = kChunkSize;
+      if (static_cast<off_t>(length) > file_size - read_offset)
+        length = file_size - read_offset;
+      if (!ReadFully(fd, in, length, read_offset))
+        break;
+      read_offset += length;
+      stream.next_in = in;
+      stream.avail_in = length;
+    }
+
+    stream.next_out = out;
+    stream.avail_out = kChunkSize;
+    const int result = deflate(&stream, read_offset == file_size ?
+                                        Z_FINISH : Z_NO_FLUSH);
+    if (result == Z_STREAM_ERROR)
+      break;
+    const size_t out_used = kChunkSize - stream.avail_out;
+    // There's no point going on once the copy is no smaller.
+    if (static_cast<off_t>(out_used) >= 2 * file_size - write_offset ||
+        !WriteFully(fd, out, out_used, write_offset)) {
+      break;
+    }
+    write_offset += out_used;
+    if (result == Z_STREAM_END) {
+      compressed = true;
+      break;
+    }
+  }
+  deflateEnd(&stream);
+
+  if (!compressed) {
+    // Even if this fails, the original is intact; the processor ignores
+    // anything after the streams its directory lists.
+    ignore_result(ftruncate(fd, file_size));
+    return true;
+  }
+
+  // Move the copy into place. Only an I/O error while doing so can leave
+  // the file holding neither the original nor the copy.
+  const off_t compressed_size = write_offset - file_size;
+  return CopyWithin(fd, in, file_size, 0, compressed_size) &&
+         ftruncate(fd, compressed_size) == 0;
+}
+
+#else  // HAVE_LIBZ
+
+bool CompressMinidumpFile(int fd) {
+  return true;
+}
+
+#endif  // HAVE_LIBZ
+
+}  // namespace google_breakpad
@@ -0,0 +1,58 @@
+// Copyright (c) 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// minidump_compressor.h: Compress a finished minidump file in place, from a
+// compromised context.
+
+#ifndef CLIENT_LINUX_MINIDUMP_WRITER_MINIDUMP_COMPRESSOR_H_
+#define CLIENT_LINUX_MINIDUMP_WRITER_MINIDUMP_COMPRESSOR_H_
+
+namespace google_breakpad {
+
+// Replaces the minidump in the file |fd|, which must be open for both reading
+// and writing, with a gzip-compressed copy, which the processor's Minidump
+// class reads transparently. Like the minidump writer, this neither mallocs
+// nor uses libc functions which may: the compressor works in a fixed set of
+// pages taken when it starts.
+//
+// A minidump is written out of order, with its header and directory filled in
+// last, so it can't be compressed as it's written. Instead, the compressed
+// copy is written after the original, then moved to the start of the file,
+// which is truncated to its new length. The file needs room for both at once.
+//
+// Returns false only if an I/O error while moving the compressed copy into
+// place left the file holding neither it nor the original. Otherwise the file
+// holds the minidump: compressed if that succeeded and made it smaller, and
+// as it was written if not, including always when Breakpad was built without
+// zlib.
+bool CompressMinidumpFile(int fd);
+
+}  // namespace google_breakpad
+
+#endif  // CLIENT_LINUX_MINIDUMP_WRITER_MINIDUMP_COMPRESSOR_H_
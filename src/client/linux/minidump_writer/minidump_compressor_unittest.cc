@@ -0,0 +1,175 @@
+// Copyright (c) 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// minidump_compressor_unittest.cc: Unit tests for CompressMinidumpFile.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "breakpad_googletest_includes.h"
+#include "client/linux/minidump_writer/minidump_compressor.h"
+#include "common/tests/auto_tempdir.h"
+#include "common/tests/file_utils.h"
+#include "common/using_std_string.h"
+
+using namespace google_breakpad;
+
+namespace {
+
+// Return |size| bytes of data that is compressible if |compressible| is true,
+// and pseudo-random otherwise.
+string MakeData(size_t size, bool compressible) {
+  string data(size, '\0');
+  uint32_t state = 12345;
+  for (size_t i = 0; i < size; ++i) {
+    state = state * 1103515245 + 12345;
+    data[i] = compressible ? "minidump"[(i / 64) % 8] : (state >> 16) & 0xff;
+  }
+  return data;
+}
+
+// Read the contents of |path| into |contents|.
+bool ReadContents(const string& path, string* contents) {
+  std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+  contents->assign(std::istreambuf_iterator<char>(file),
+                   std::istreambuf_iterator<char>());
+  return file.good() || file.eof();
+}
+
+// Write |data| to |path|, try to compress it, and check that the file is
+// left holding |data| as it was.
+void CompressAndCheckUnchanged(const string& path, const string& data,
+                               int flags) {
+  ASSERT_TRUE(WriteFile(path.c_str(), data.data(), data.size()));
+  int fd = open(path.c_str(), flags);
+  ASSERT_NE(-1, fd);
+  EXPECT_TRUE(CompressMinidumpFile(fd));
+  close(fd);
+
+  string contents;
+  ASSERT_TRUE(ReadContents(path, &contents));
+  EXPECT_TRUE(contents == data);
+}
+
+#ifdef HAVE_LIBZ
+
+// Inflate the gzip data in |compressed| into |contents|.
+bool Gunzip(const string& compressed, string* contents) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, 15 + 16) != Z_OK)
+    return false;
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+  stream.avail_in = compressed.size();
+  char buffer[4096];
+  int result;
+  do {
+    stream.next_out = reinterpret_cast<Bytef*>(buffer);
+    stream.avail_out = sizeof(buffer);
+    result = inflate(&stream, Z_NO_FLUSH);
+    contents->append(buffer, sizeof(buffer) - stream.avail_out);
+  } while (result == Z_OK);
+  inflateEnd(&stream);
+  return result == Z_STREAM_END && stream.avail_in == 0;
+}
+
+// Write |data| to |path|, compress it, and check that the file then holds
+// a gzip copy of it, no larger than |max_size|.
+void CompressAndCheck(const string& path, const string& data,
+                      size_t max_size) {
+  ASSERT_TRUE(WriteFile(path.c_str(), data.data(), data.size()));
+  int fd = open(path.c_str(), O_RDWR);
+  ASSERT_NE(-1, fd);
+  EXPECT_TRUE(CompressMinidumpFile(fd));
+  close(fd);
+
+  string compressed, contents;
+  ASSERT_TRUE(ReadContents(path, &compressed));
+  EXPECT_LE(compressed.size(), max_size);
+  ASSERT_TRUE(Gunzip(compressed, &contents));
+  EXPECT_TRUE(contents == data);
+}
+
+#endif  // HAVE_LIBZ
+
+}  // namespace
+
+#ifdef HAVE_LIBZ
+
+TEST(MinidumpCompressorTest, Compressible) {
+  AutoTempDir temp_dir;
+  const string data = MakeData(1024 * 1024 + 17, true);
+  CompressAndCheck(temp_dir.path() + "/minidump.dmp", data, data.size() / 10);
+}
+
+TEST(MinidumpCompressorTest, Incompressible) {
+  // The compressed copy would be larger than the original, so the original
+  // is kept.
+  AutoTempDir temp_dir;
+  CompressAndCheckUnchanged(temp_dir.path() + "/minidump.dmp",
+                            MakeData(300 * 1024, false), O_RDWR);
+}
+
+TEST(MinidumpCompressorTest, Mixed) {
+  AutoTempDir temp_dir;
+  const string data = MakeData(200 * 1024, false) +
+                      MakeData(500 * 1024, true) +
+                      MakeData(100 * 1024, false);
+  CompressAndCheck(temp_dir.path() + "/minidump.dmp", data, data.size());
+}
+
+TEST(MinidumpCompressorTest, WriteOnly) {
+  // The original can't be read, so it's kept.
+  AutoTempDir temp_dir;
+  CompressAndCheckUnchanged(temp_dir.path() + "/minidump.dmp",
+                            MakeData(10000, true), O_WRONLY);
+}
+
+#else  // HAVE_LIBZ
+
+TEST(MinidumpCompressorTest, WithoutZlib) {
+  AutoTempDir temp_dir;
+  CompressAndCheckUnchanged(temp_dir.path() + "/minidump.dmp",
+                            MakeData(10000, true), O_RDWR);
+}
+
+#endif  // HAVE_LIBZ
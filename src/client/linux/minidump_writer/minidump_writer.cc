@@ -124,6 +124,23 @@ class MinidumpWriter {
   // (exclude the stack data).
   static const unsigned kLimitMinidumpFudgeFactor = 64 * 1024;
 
+  // How much heap to capture before and after each address found by
+  // CaptureReferencedHeap(), in bytes. More is taken after, as pointers
+  // usually point to the start of an object.
+  static const unsigned kHeapWindowBefore = 64;
+  static const unsigned kHeapWindowAfter = 192;
+
+  // A copy of a region of the process's memory, to be written to the
+  // dump by WriteMemoryListStream.
+  struct CapturedMemory {
+    uintptr_t start;
+    size_t size;
+    const uint8_t* data;
+    size_t sequence;  // The order in which regions were captured.
+    int thread_index;  // The thread whose stack this is, or -1.
+    MDRVA rva;  // Where the region is written, once that is known.
+  };
+
   MinidumpWriter(const char* minidump_path,
                  int minidump_fd,
                  const ExceptionHandler::CrashContext* context,
@@ -132,6 +149,8 @@ class MinidumpWriter {
                  bool skip_stacks_if_mapping_unreferenced,
                  uintptr_t principal_mapping_address,
                  bool sanitize_stacks,
+                 int stack_trim_slack,
+                 size_t heap_capture_budget,
                  LinuxDumper* dumper)
       : fd_(minidump_fd),
         path_(minidump_path),
@@ -142,13 +161,20 @@ class MinidumpWriter {
         dumper_(dumper),
         minidump_size_limit_(-1),
         memory_blocks_(dumper_->allocator()),
+        captured_memory_(dumper_->allocator()),
+        heap_roots_(dumper_->allocator()),
+        thread_list_rva_(0),
         mapping_list_(mappings),
         app_memory_list_(appmem),
         skip_stacks_if_mapping_unreferenced_(
             skip_stacks_if_mapping_unreferenced),
         principal_mapping_address_(principal_mapping_address),
         principal_mapping_(nullptr),
-    sanitize_stacks_(sanitize_stacks) {
+    sanitize_stacks_(sanitize_stacks),
+    stack_trim_slack_(stack_trim_slack),
+    heap_capture_budget_(heap_capture_budget),
+    resumed_callback_(NULL),
+    resumed_context_(NULL) {
     // Assert there should be either a valid fd or a valid path, not both.
     assert(fd_ != -1 || minidump_path);
     assert(fd_ == -1 || !minidump_path);
@@ -223,9 +249,9 @@ class MinidumpWriter {
 
     TypedMDRVA<MDRawDirectory> dir(&minidump_writer_);
     {
-      // Ensure the header gets flushed, as that happens in the destructor.
-      // If a crash occurs somewhere below, at least the header will be
-      // intact.
+      // Ensure the header gets flushed, as that happens in the destructor,
+      // and then written out of the writer's buffer. If a crash occurs
+      // somewhere below, at least the header will be intact.
       TypedMDRVA<MDRawHeader> header(&minidump_writer_);
       if (!header.Allocate())
         return false;
@@ -241,6 +267,8 @@ class MinidumpWriter {
       header.get()->stream_count = kNumWriters;
       header.get()->stream_directory_rva = dir.position();
     }
+    if (!minidump_writer_.Flush())
+      return false;
 
     unsigned dir_index = 0;
     MDRawDirectory dirent;
@@ -249,13 +277,23 @@ class MinidumpWriter {
       return false;
     dir.CopyIndex(dir_index++, &dirent);
 
-    if (!WriteMappings(&dirent))
+    if (!WriteAppMemory())
       return false;
-    dir.CopyIndex(dir_index++, &dirent);
 
-    if (!WriteAppMemory())
+    if (!CaptureReferencedHeap())
       return false;
 
+    // The registers and memory that change as the threads run have all
+    // been copied by now.
+    if (resumed_callback_) {
+      dumper_->ThreadsResume();
+      resumed_callback_(resumed_context_);
+    }
+
+    if (!WriteMappings(&dirent))
+      return false;
+    dir.CopyIndex(dir_index++, &dirent);
+
     if (!WriteMemoryListStream(&dirent))
       return false;
     dir.CopyIndex(dir_index++, &dirent);
@@ -312,11 +350,28 @@ class MinidumpWriter {
     // above.
 
     dumper_->ThreadsResume();
-    return true;
+    return minidump_writer_.Flush();
+  }
+
+  // Record a copy of the process's memory at |start| to be written to the
+  // dump. If |thread_index| is non-negative, the memory is the stack of
+  // that thread in the thread list, whose descriptor is filled in when the
+  // memory is written.
+  void CaptureMemory(uintptr_t start, size_t size, const uint8_t* data,
+                     int thread_index) {
+    CapturedMemory region;
+    region.start = start;
+    region.size = size;
+    region.data = data;
+    region.sequence = captured_memory_.size();
+    region.thread_index = thread_index;
+    region.rva = 0;
+    captured_memory_.push_back(region);
   }
 
-  bool FillThreadStack(MDRawThread* thread, uintptr_t stack_pointer,
-                       uintptr_t pc, int max_stack_len, uint8_t** stack_copy) {
+  bool FillThreadStack(MDRawThread* thread, int thread_index,
+                       uintptr_t stack_pointer, uintptr_t pc,
+                       int max_stack_len, uint8_t** stack_copy) {
     *stack_copy = NULL;
     const void* stack;
     size_t stack_len;
@@ -358,18 +413,21 @@ class MinidumpWriter {
         }
       }
 
+      if (stack_trim_slack_ >= 0) {
+        stack_len = dumper_->LiveStackLength(*stack_copy, stack_len,
+                                             stack_pointer_offset,
+                                             stack_trim_slack_);
+      }
+
       if (sanitize_stacks_) {
         dumper_->SanitizeStackCopy(*stack_copy, stack_len, stack_pointer,
                                    stack_pointer_offset);
       }
 
-      UntypedMDRVA memory(&minidump_writer_);
-      if (!memory.Allocate(stack_len))
-        return false;
-      memory.Copy(*stack_copy, stack_len);
       thread->stack.start_of_memory_range = reinterpret_cast<uintptr_t>(stack);
-      thread->stack.memory = memory.location();
-      memory_blocks_.push_back(thread->stack);
+      thread->stack.memory.data_size = stack_len;
+      CaptureMemory(thread->stack.start_of_memory_range, stack_len,
+                    *stack_copy, thread_index);
     }
     return true;
   }
@@ -384,6 +442,7 @@ class MinidumpWriter {
 
     dirent->stream_type = MD_THREAD_LIST_STREAM;
     dirent->location = list.location();
+    thread_list_rva_ = list.position();
 
     *list.get() = num_threads;
 
@@ -416,7 +475,7 @@ class MinidumpWriter {
           !dumper_->IsPostMortem()) {
         uint8_t* stack_copy;
         const uintptr_t stack_ptr = UContextReader::GetStackPointer(ucontext_);
-        if (!FillThreadStack(&thread, stack_ptr,
+        if (!FillThreadStack(&thread, i, stack_ptr,
                              UContextReader::GetInstructionPointer(ucontext_),
                              -1, &stack_copy))
           return false;
@@ -449,9 +508,6 @@ class MinidumpWriter {
         }
 
         if (ip_is_mapped) {
-          UntypedMDRVA ip_memory(&minidump_writer_);
-          if (!ip_memory.Allocate(ip_memory_d.memory.data_size))
-            return false;
           uint8_t* memory_copy =
               reinterpret_cast<uint8_t*>(Alloc(ip_memory_d.memory.data_size));
           dumper_->CopyFromProcess(
@@ -459,9 +515,8 @@ class MinidumpWriter {
               thread.thread_id,
               reinterpret_cast<void*>(ip_memory_d.start_of_memory_range),
               ip_memory_d.memory.data_size);
-          ip_memory.Copy(memory_copy, ip_memory_d.memory.data_size);
-          ip_memory_d.memory = ip_memory.location();
-          memory_blocks_.push_back(ip_memory_d);
+          CaptureMemory(ip_memory_d.start_of_memory_range,
+                        ip_memory_d.memory.data_size, memory_copy, -1);
         }
 
         TypedMDRVA<RawContextCPU> cpu(&minidump_writer_);
@@ -473,6 +528,7 @@ class MinidumpWriter {
 #else
         UContextReader::FillCPUContext(cpu.get(), ucontext_);
 #endif
+        NoteHeapRoots(*cpu.get(), true);
         thread.thread_context = cpu.location();
         crashing_thread_context_ = cpu.location();
       } else {
@@ -484,7 +540,7 @@ class MinidumpWriter {
         int max_stack_len = -1;  // default to no maximum for this thread
         if (minidump_size_limit_ >= 0 && i >= kLimitBaseThreadCount)
           max_stack_len = extra_thread_stack_len;
-        if (!FillThreadStack(&thread, info.stack_pointer,
+        if (!FillThreadStack(&thread, i, info.stack_pointer,
                              info.GetInstructionPointer(), max_stack_len,
                              &stack_copy))
           return false;
@@ -494,6 +550,7 @@ class MinidumpWriter {
           return false;
         my_memset(cpu.get(), 0, sizeof(RawContextCPU));
         info.FillCPUContext(cpu.get());
+        NoteHeapRoots(*cpu.get(), dumper_->threads()[i] == GetCrashThread());
         thread.thread_context = cpu.location();
         if (dumper_->threads()[i] == GetCrashThread()) {
           crashing_thread_context_ = cpu.location();
@@ -512,25 +569,211 @@ class MinidumpWriter {
     return true;
   }
 
+  // Record the words of a thread's register context, so that
+  // CaptureReferencedHeap() can capture the heap they point to.
+  void NoteHeapRoots(const RawContextCPU& cpu, bool crashing) {
+    if (!heap_capture_budget_ || sanitize_stacks_)
+      return;
+
+    const uintptr_t* words = reinterpret_cast<const uintptr_t*>(&cpu);
+    for (size_t i = 0; i < sizeof(cpu) / sizeof(uintptr_t); ++i) {
+      HeapRoot root;
+      root.address = words[i];
+      root.crashing = crashing;
+      heap_roots_.push_back(root);
+    }
+  }
+
+  // Capture up to |heap_capture_budget_| bytes of the heap, in windows
+  // around the addresses in writable anonymous mappings that the threads'
+  // registers and captured stacks hold. The crashing thread's registers
+  // come first, then its stack from the top, then the other threads'.
+  // This is skipped when stacks are sanitized, as heap memory can't be.
+  bool CaptureReferencedHeap() {
+    if (!heap_capture_budget_ || sanitize_stacks_)
+      return true;
+
+    // The mappings heap pointers can point into, in address order, as
+    // /proc/<pid>/maps lists them.
+    wasteful_vector<const MappingInfo*> heap_mappings(dumper_->allocator());
+    for (size_t i = 0; i < dumper_->mappings().size(); ++i) {
+      const MappingInfo* mapping = dumper_->mappings()[i];
+      if (mapping->writable && !mapping->exec && mapping->name[0] == '\0' &&
+          (heap_mappings.empty() ||
+           heap_mappings.back()->start_addr < mapping->start_addr)) {
+        heap_mappings.push_back(mapping);
+      }
+    }
+    if (heap_mappings.empty())
+      return true;
+
+    // The captured stacks, in address order, with any that overlap merged.
+    wasteful_vector<CapturedMemory> stacks(dumper_->allocator());
+    for (size_t i = 0; i < captured_memory_.size(); ++i) {
+      if (captured_memory_[i].thread_index >= 0)
+        stacks.push_back(captured_memory_[i]);
+    }
+    std::sort(stacks.begin(), stacks.end(), CapturedMemoryStartsBefore);
+    size_t stack_count = 0;
+    for (size_t i = 0; i < stacks.size(); ++i) {
+      if (stack_count > 0 &&
+          stacks[i].start - stacks[stack_count - 1].start <=
+              stacks[stack_count - 1].size) {
+        CapturedMemory& previous = stacks[stack_count - 1];
+        previous.size = std::max(previous.size,
+                                 stacks[i].start + stacks[i].size -
+                                     previous.start);
+      } else {
+        stacks[stack_count++] = stacks[i];
+      }
+    }
+    stacks.resize(stack_count);
+
+    wasteful_vector<LinuxDumper::CopyRequest> windows(dumper_->allocator());
+    size_t budget = heap_capture_budget_;
+    const size_t captured_count = captured_memory_.size();
+    for (int pass = 0; pass < 2 && budget; ++pass) {
+      const bool crashing = pass == 0;
+      for (size_t i = 0; i < heap_roots_.size() && budget; ++i) {
+        if (heap_roots_[i].crashing == crashing) {
+          AddHeapWindow(heap_roots_[i].address, heap_mappings, stacks,
+                        &windows, &budget);
+        }
+      }
+      for (size_t i = 0; i < captured_count && budget; ++i) {
+        const CapturedMemory& stack = captured_memory_[i];
+        if (stack.thread_index < 0 ||
+            (static_cast<pid_t>(dumper_->threads()[stack.thread_index]) ==
+             GetCrashThread()) != crashing) {
+          continue;
+        }
+        const uintptr_t* words =
+            reinterpret_cast<const uintptr_t*>(stack.data);
+        for (size_t j = 0; j < stack.size / sizeof(uintptr_t) && budget; ++j)
+          AddHeapWindow(words[j], heap_mappings, stacks, &windows, &budget);
+      }
+    }
+    if (windows.empty())
+      return true;
+
+    for (size_t i = 0; i < windows.size(); ++i) {
+      windows[i].dest = dumper_->allocator()->Alloc(windows[i].length);
+      if (!windows[i].dest)
+        return false;
+    }
+    dumper_->CopyFromProcessBatch(GetCrashThread(), &windows[0],
+                                  windows.size());
+    for (size_t i = 0; i < windows.size(); ++i) {
+      CaptureMemory(reinterpret_cast<uintptr_t>(windows[i].src),
+                    windows[i].length,
+                    static_cast<const uint8_t*>(windows[i].dest), -1);
+    }
+    return true;
+  }
+
+  // If |address| is in one of |heap_mappings|, and neither in one of
+  // |stacks| nor in one of |windows| already, add a window around it to
+  // |windows|, which are kept in address order, taking its size from
+  // |budget|. A window the budget can't stretch to |address| is left out.
+  // |stacks| must be in address order, and not overlap.
+  void AddHeapWindow(uintptr_t address,
+                     const wasteful_vector<const MappingInfo*>& heap_mappings,
+                     const wasteful_vector<CapturedMemory>& stacks,
+                     wasteful_vector<LinuxDumper::CopyRequest>* windows,
+                     size_t* budget) {
+    // Find the last mapping that starts at or before |address|.
+    size_t low = 0;
+    size_t high = heap_mappings.size();
+    while (low < high) {
+      const size_t middle = low + (high - low) / 2;
+      if (heap_mappings[middle]->start_addr <= address)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+    if (low == 0)
+      return;
+    const MappingInfo* mapping = heap_mappings[low - 1];
+    if (address - mapping->start_addr >= mapping->size)
+      return;
+
+    // Likewise the last stack.
+    low = 0;
+    high = stacks.size();
+    while (low < high) {
+      const size_t middle = low + (high - low) / 2;
+      if (stacks[middle].start <= address)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+    if (low > 0 && address - stacks[low - 1].start < stacks[low - 1].size)
+      return;
+
+    // And the last window. No window holds another: each holds its own
+    // address, none is added around an address another holds, and only the
+    // last added can run out of budget. So only that one can hold |address|.
+    low = 0;
+    high = windows->size();
+    while (low < high) {
+      const size_t middle = low + (high - low) / 2;
+      if (reinterpret_cast<uintptr_t>((*windows)[middle].src) <= address)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+    if (low > 0) {
+      const LinuxDumper::CopyRequest& previous = (*windows)[low - 1];
+      if (address - reinterpret_cast<uintptr_t>(previous.src) <
+          previous.length) {
+        return;
+      }
+    }
+
+    uintptr_t start = address & ~static_cast<uintptr_t>(sizeof(uintptr_t) - 1);
+    start = start - mapping->start_addr > kHeapWindowBefore ?
+        start - kHeapWindowBefore : mapping->start_addr;
+    const uintptr_t mapping_end = mapping->start_addr + mapping->size;
+    const uintptr_t end = mapping_end - address > kHeapWindowAfter ?
+        address + kHeapWindowAfter : mapping_end;
+    const size_t length = std::min(static_cast<size_t>(end - start), *budget);
+    if (address - start >= length)
+      return;
+
+    LinuxDumper::CopyRequest window;
+    window.dest = NULL;
+    window.src = reinterpret_cast<const void*>(start);
+    window.length = length;
+    windows->insert(windows->begin() + low, window);
+    *budget -= length;
+  }
+
   // Write application-provided memory regions.
   bool WriteAppMemory() {
+    if (app_memory_list_.empty())
+      return true;
+
+    // Copy all the regions at once, so that dumpers that can read many
+    // ranges per system call do.
+    wasteful_vector<LinuxDumper::CopyRequest> copies(dumper_->allocator(),
+                                                     app_memory_list_.size());
     for (AppMemoryList::const_iterator iter = app_memory_list_.begin();
          iter != app_memory_list_.end();
          ++iter) {
-      uint8_t* data_copy =
-        reinterpret_cast<uint8_t*>(dumper_->allocator()->Alloc(iter->length));
-      dumper_->CopyFromProcess(data_copy, GetCrashThread(), iter->ptr,
-                               iter->length);
+      LinuxDumper::CopyRequest copy;
+      copy.dest = dumper_->allocator()->Alloc(iter->length);
+      copy.src = iter->ptr;
+      copy.length = iter->length;
+      copies.push_back(copy);
+    }
+    dumper_->CopyFromProcessBatch(GetCrashThread(), &copies[0], copies.size());
 
-      UntypedMDRVA memory(&minidump_writer_);
-      if (!memory.Allocate(iter->length)) {
-        return false;
-      }
-      memory.Copy(data_copy, iter->length);
-      MDMemoryDescriptor desc;
-      desc.start_of_memory_range = reinterpret_cast<uintptr_t>(iter->ptr);
-      desc.memory = memory.location();
-      memory_blocks_.push_back(desc);
+    size_t i = 0;
+    for (AppMemoryList::const_iterator iter = app_memory_list_.begin();
+         iter != app_memory_list_.end();
+         ++iter, ++i) {
+      CaptureMemory(reinterpret_cast<uintptr_t>(iter->ptr), iter->length,
+                    static_cast<const uint8_t*>(copies[i].dest), -1);
     }
 
     return true;
@@ -673,7 +916,57 @@ class MinidumpWriter {
     return true;
   }
 
+  // Write the captured memory, merging overlapping and adjacent regions
+  // so that each byte is written once, and list the merged regions.
   bool WriteMemoryListStream(MDRawDirectory* dirent) {
+    // Allocate space for each run of overlapping or adjacent regions.
+    std::sort(captured_memory_.begin(), captured_memory_.end(),
+              CapturedMemoryStartsBefore);
+    for (size_t i = 0; i < captured_memory_.size(); ) {
+      const uintptr_t start = captured_memory_[i].start;
+      uintptr_t end = start + captured_memory_[i].size;
+      size_t next = i + 1;
+      while (next < captured_memory_.size() &&
+             captured_memory_[next].start <= end) {
+        end = std::max(end, captured_memory_[next].start +
+                            captured_memory_[next].size);
+        ++next;
+      }
+      UntypedMDRVA memory(&minidump_writer_);
+      if (!memory.Allocate(end - start))
+        return false;
+      for (; i < next; ++i) {
+        captured_memory_[i].rva =
+            memory.position() + (captured_memory_[i].start - start);
+      }
+      MDMemoryDescriptor desc;
+      desc.start_of_memory_range = start;
+      desc.memory = memory.location();
+      memory_blocks_.push_back(desc);
+    }
+
+    // Where regions overlap, the one captured first (a sanitized stack,
+    // say) wins, so write them in the reverse of the order they were
+    // captured in.
+    std::sort(captured_memory_.begin(), captured_memory_.end(),
+              CapturedMemoryCapturedAfter);
+    for (size_t i = 0; i < captured_memory_.size(); ++i) {
+      const CapturedMemory& region = captured_memory_[i];
+      if (!minidump_writer_.Copy(region.rva, region.data, region.size))
+        return false;
+      if (region.thread_index < 0)
+        continue;
+      MDMemoryDescriptor stack;
+      stack.start_of_memory_range = region.start;
+      stack.memory.data_size = region.size;
+      stack.memory.rva = region.rva;
+      const MDRVA stack_rva = thread_list_rva_ + sizeof(uint32_t) +
+          region.thread_index * sizeof(MDRawThread) +
+          offsetof(MDRawThread, stack);
+      if (!minidump_writer_.Copy(stack_rva, &stack, sizeof(stack)))
+        return false;
+    }
+
     TypedMDRVA<uint32_t> list(&minidump_writer_);
     if (memory_blocks_.size()) {
       if (!list.AllocateObjectAndArray(memory_blocks_.size(),
@@ -882,6 +1175,14 @@ class MinidumpWriter {
 
   void set_minidump_size_limit(off_t limit) { minidump_size_limit_ = limit; }
 
+  // If |callback| is non-NULL, resume the threads as soon as their state
+  // and the app memory have been copied, and call |callback| with
+  // |context|, rather than leave them suspended until the dump is written.
+  void set_resumed_callback(void (*callback)(void*), void* context) {
+    resumed_callback_ = callback;
+    resumed_context_ = context;
+  }
+
  private:
   void* Alloc(unsigned bytes) {
     return dumper_->allocator()->Alloc(bytes);
@@ -1340,10 +1641,32 @@ class MinidumpWriter {
   MinidumpFileWriter minidump_writer_;
   off_t minidump_size_limit_;
   MDLocationDescriptor crashing_thread_context_;
-  // Blocks of memory written to the dump. These are all currently
-  // written while writing the thread list stream, but saved here
-  // so a memory list stream can be written afterwards.
+  static bool CapturedMemoryStartsBefore(const CapturedMemory& a,
+                                         const CapturedMemory& b) {
+    return a.start < b.start;
+  }
+
+  static bool CapturedMemoryCapturedAfter(const CapturedMemory& a,
+                                          const CapturedMemory& b) {
+    return a.sequence > b.sequence;
+  }
+
+  // The merged blocks of memory written to the dump, listed in the
+  // memory list stream.
   wasteful_vector<MDMemoryDescriptor> memory_blocks_;
+  // Memory captured while writing the thread list stream and
+  // application memory, written out by WriteMemoryListStream.
+  wasteful_vector<CapturedMemory> captured_memory_;
+  // A word of a thread's registers, which may point into the heap.
+  struct HeapRoot {
+    uintptr_t address;
+    bool crashing;  // Whether the thread is the crashing one.
+  };
+  // The register words noted by NoteHeapRoots().
+  wasteful_vector<HeapRoot> heap_roots_;
+  // The position of the thread list, whose stack descriptors are filled
+  // in by WriteMemoryListStream.
+  MDRVA thread_list_rva_;
   // Additional information about some mappings provided by the caller.
   const MappingList& mapping_list_;
   // Additional memory regions to be included in the dump,
@@ -1356,6 +1679,14 @@ class MinidumpWriter {
   const MappingInfo* principal_mapping_;
   // If true, apply stack sanitization to stored stack data.
   bool sanitize_stacks_;
+  // If non-negative, trim each stored stack to its live extent plus
+  // this many bytes. See LinuxDumper::LiveStackLength.
+  int stack_trim_slack_;
+  // If non-zero, the most heap CaptureReferencedHeap() captures, in bytes.
+  size_t heap_capture_budget_;
+  // Set by set_resumed_callback().
+  void (*resumed_callback_)(void*);
+  void* resumed_context_;
 };
 
 
@@ -1368,7 +1699,9 @@ bool WriteMinidumpImpl(const char* minidump_path,
                        const AppMemoryList& appmem,
                        bool skip_stacks_if_mapping_unreferenced,
                        uintptr_t principal_mapping_address,
-                       bool sanitize_stacks) {
+                       bool sanitize_stacks,
+                       int stack_trim_slack,
+                       size_t heap_capture_budget) {
   LinuxPtraceDumper dumper(crashing_process);
   const ExceptionHandler::CrashContext* context = NULL;
   if (blob) {
@@ -1380,7 +1713,8 @@ bool WriteMinidumpImpl(const char* minidump_path,
   }
   MinidumpWriter writer(minidump_path, minidump_fd, context, mappings,
                         appmem, skip_stacks_if_mapping_unreferenced,
-                        principal_mapping_address, sanitize_stacks, &dumper);
+                        principal_mapping_address, sanitize_stacks,
+                        stack_trim_slack, heap_capture_budget, &dumper);
   // Set desired limit for file size of minidump (-1 means no limit).
   writer.set_minidump_size_limit(minidump_size_limit);
   if (!writer.Init())
@@ -1388,6 +1722,20 @@ bool WriteMinidumpImpl(const char* minidump_path,
   return writer.Dump();
 }
 
+// Passes the time a snapshot's threads were suspended for on to the
+// caller of WriteMinidumpSnapshot().
+struct SnapshotResume {
+  LinuxPtraceDumper* dumper;
+  google_breakpad::SnapshotResumedCallback callback;
+  void* context;
+};
+
+void OnSnapshotResumed(void* context) {
+  const SnapshotResume* resume = static_cast<SnapshotResume*>(context);
+  if (resume->callback)
+    resume->callback(resume->context, resume->dumper->freeze_time_ns());
+}
+
 }  // namespace
 
 namespace google_breakpad {
@@ -1396,26 +1744,34 @@ bool WriteMinidump(const char* minidump_path, pid_t crashing_process,
                    const void* blob, size_t blob_size,
                    bool skip_stacks_if_mapping_unreferenced,
                    uintptr_t principal_mapping_address,
-                   bool sanitize_stacks) {
+                   bool sanitize_stacks,
+                   int stack_trim_slack,
+                   size_t heap_capture_budget) {
   return WriteMinidumpImpl(minidump_path, -1, -1,
                            crashing_process, blob, blob_size,
                            MappingList(), AppMemoryList(),
                            skip_stacks_if_mapping_unreferenced,
                            principal_mapping_address,
-                           sanitize_stacks);
+                           sanitize_stacks,
+                           stack_trim_slack,
+                           heap_capture_budget);
 }
 
 bool WriteMinidump(int minidump_fd, pid_t crashing_process,
                    const void* blob, size_t blob_size,
                    bool skip_stacks_if_mapping_unreferenced,
                    uintptr_t principal_mapping_address,
-                   bool sanitize_stacks) {
+                   bool sanitize_stacks,
+                   int stack_trim_slack,
+                   size_t heap_capture_budget) {
   return WriteMinidumpImpl(NULL, minidump_fd, -1,
                            crashing_process, blob, blob_size,
                            MappingList(), AppMemoryList(),
                            skip_stacks_if_mapping_unreferenced,
                            principal_mapping_address,
-                           sanitize_stacks);
+                           sanitize_stacks,
+                           stack_trim_slack,
+                           heap_capture_budget);
 }
 
 bool WriteMinidump(const char* minidump_path, pid_t process,
@@ -1427,7 +1783,7 @@ bool WriteMinidump(const char* minidump_path, pid_t process,
   MappingList mapping_list;
   AppMemoryList app_memory_list;
   MinidumpWriter writer(minidump_path, -1, NULL, mapping_list,
-                        app_memory_list, false, 0, false, &dumper);
+                        app_memory_list, false, 0, false, -1, 0, &dumper);
   if (!writer.Init())
     return false;
   return writer.Dump();
@@ -1439,13 +1795,17 @@ bool WriteMinidump(const char* minidump_path, pid_t crashing_process,
                    const AppMemoryList& appmem,
                    bool skip_stacks_if_mapping_unreferenced,
                    uintptr_t principal_mapping_address,
-                   bool sanitize_stacks) {
+                   bool sanitize_stacks,
+                   int stack_trim_slack,
+                   size_t heap_capture_budget) {
   return WriteMinidumpImpl(minidump_path, -1, -1, crashing_process,
                            blob, blob_size,
                            mappings, appmem,
                            skip_stacks_if_mapping_unreferenced,
                            principal_mapping_address,
-                           sanitize_stacks);
+                           sanitize_stacks,
+                           stack_trim_slack,
+                           heap_capture_budget);
 }
 
 bool WriteMinidump(int minidump_fd, pid_t crashing_process,
@@ -1454,13 +1814,17 @@ bool WriteMinidump(int minidump_fd, pid_t crashing_process,
                    const AppMemoryList& appmem,
                    bool skip_stacks_if_mapping_unreferenced,
                    uintptr_t principal_mapping_address,
-                   bool sanitize_stacks) {
+                   bool sanitize_stacks,
+                   int stack_trim_slack,
+                   size_t heap_capture_budget) {
   return WriteMinidumpImpl(NULL, minidump_fd, -1, crashing_process,
                            blob, blob_size,
                            mappings, appmem,
                            skip_stacks_if_mapping_unreferenced,
                            principal_mapping_address,
-                           sanitize_stacks);
+                           sanitize_stacks,
+                           stack_trim_slack,
+                           heap_capture_budget);
 }
 
 bool WriteMinidump(const char* minidump_path, off_t minidump_size_limit,
@@ -1470,13 +1834,17 @@ bool WriteMinidump(const char* minidump_path, off_t minidump_size_limit,
                    const AppMemoryList& appmem,
                    bool skip_stacks_if_mapping_unreferenced,
                    uintptr_t principal_mapping_address,
-                   bool sanitize_stacks) {
+                   bool sanitize_stacks,
+                   int stack_trim_slack,
+                   size_t heap_capture_budget) {
   return WriteMinidumpImpl(minidump_path, -1, minidump_size_limit,
                            crashing_process, blob, blob_size,
                            mappings, appmem,
                            skip_stacks_if_mapping_unreferenced,
                            principal_mapping_address,
-                           sanitize_stacks);
+                           sanitize_stacks,
+                           stack_trim_slack,
+                           heap_capture_budget);
 }
 
 bool WriteMinidump(int minidump_fd, off_t minidump_size_limit,
@@ -1486,13 +1854,48 @@ bool WriteMinidump(int minidump_fd, off_t minidump_size_limit,
                    const AppMemoryList& appmem,
                    bool skip_stacks_if_mapping_unreferenced,
                    uintptr_t principal_mapping_address,
-                   bool sanitize_stacks) {
+                   bool sanitize_stacks,
+                   int stack_trim_slack,
+                   size_t heap_capture_budget) {
   return WriteMinidumpImpl(NULL, minidump_fd, minidump_size_limit,
                            crashing_process, blob, blob_size,
                            mappings, appmem,
                            skip_stacks_if_mapping_unreferenced,
                            principal_mapping_address,
-                           sanitize_stacks);
+                           sanitize_stacks,
+                           stack_trim_slack,
+                           heap_capture_budget);
+}
+
+bool WriteMinidumpSnapshot(int minidump_fd, off_t minidump_size_limit,
+                           pid_t process,
+                           const void* blob, size_t blob_size,
+                           const MappingList& mappings,
+                           const AppMemoryList& appmem,
+                           bool skip_stacks_if_mapping_unreferenced,
+                           uintptr_t principal_mapping_address,
+                           bool sanitize_stacks,
+                           int stack_trim_slack,
+                           size_t heap_capture_budget,
+                           SnapshotResumedCallback resumed,
+                           void* resumed_context) {
+  if (!blob || blob_size != sizeof(ExceptionHandler::CrashContext))
+    return false;
+  const ExceptionHandler::CrashContext* context =
+      reinterpret_cast<const ExceptionHandler::CrashContext*>(blob);
+  LinuxPtraceDumper dumper(process);
+  dumper.SetCrashInfoFromSigInfo(context->siginfo);
+  dumper.set_crash_thread(context->tid);
+  MinidumpWriter writer(NULL, minidump_fd, context, mappings, appmem,
+                        skip_stacks_if_mapping_unreferenced,
+                        principal_mapping_address, sanitize_stacks,
+                        stack_trim_slack, heap_capture_budget, &dumper);
+  writer.set_minidump_size_limit(minidump_size_limit);
+  SnapshotResume resume = { &dumper, resumed, resumed_context };
+  writer.set_resumed_callback(OnSnapshotResumed, &resume);
+  if (!writer.Init())
+    return false;
+  return writer.Dump();
 }
 
 bool WriteMinidump(const char* filename,
@@ -1500,7 +1903,7 @@ bool WriteMinidump(const char* filename,
                    const AppMemoryList& appmem,
                    LinuxDumper* dumper) {
   MinidumpWriter writer(filename, -1, NULL, mappings, appmem,
-                        false, 0, false, dumper);
+                        false, 0, false, -1, 0, dumper);
   if (!writer.Init())
     return false;
   return writer.Dump();
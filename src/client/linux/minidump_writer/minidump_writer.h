@@ -82,13 +82,17 @@ bool WriteMinidump(const char* minidump_path, pid_t crashing_process,
                    const void* blob, size_t blob_size,
                    bool skip_stacks_if_mapping_unreferenced = false,
                    uintptr_t principal_mapping_address = 0,
-                   bool sanitize_stacks = false);
+                   bool sanitize_stacks = false,
+                   int stack_trim_slack = -1,
+                   size_t heap_capture_budget = 0);
 // Same as above but takes an open file descriptor instead of a path.
 bool WriteMinidump(int minidump_fd, pid_t crashing_process,
                    const void* blob, size_t blob_size,
                    bool skip_stacks_if_mapping_unreferenced = false,
                    uintptr_t principal_mapping_address = 0,
-                   bool sanitize_stacks = false);
+                   bool sanitize_stacks = false,
+                   int stack_trim_slack = -1,
+                   size_t heap_capture_budget = 0);
 
 // Alternate form of WriteMinidump() that works with processes that
 // are not expected to have crashed.  If |process_blamed_thread| is
@@ -106,14 +110,18 @@ bool WriteMinidump(const char* minidump_path, pid_t crashing_process,
                    const AppMemoryList& appdata,
                    bool skip_stacks_if_mapping_unreferenced = false,
                    uintptr_t principal_mapping_address = 0,
-                   bool sanitize_stacks = false);
+                   bool sanitize_stacks = false,
+                   int stack_trim_slack = -1,
+                   size_t heap_capture_budget = 0);
 bool WriteMinidump(int minidump_fd, pid_t crashing_process,
                    const void* blob, size_t blob_size,
                    const MappingList& mappings,
                    const AppMemoryList& appdata,
                    bool skip_stacks_if_mapping_unreferenced = false,
                    uintptr_t principal_mapping_address = 0,
-                   bool sanitize_stacks = false);
+                   bool sanitize_stacks = false,
+                   int stack_trim_slack = -1,
+                   size_t heap_capture_budget = 0);
 
 // These overloads also allow passing a file size limit for the minidump.
 bool WriteMinidump(const char* minidump_path, off_t minidump_size_limit,
@@ -123,7 +131,9 @@ bool WriteMinidump(const char* minidump_path, off_t minidump_size_limit,
                    const AppMemoryList& appdata,
                    bool skip_stacks_if_mapping_unreferenced = false,
                    uintptr_t principal_mapping_address = 0,
-                   bool sanitize_stacks = false);
+                   bool sanitize_stacks = false,
+                   int stack_trim_slack = -1,
+                   size_t heap_capture_budget = 0);
 bool WriteMinidump(int minidump_fd, off_t minidump_size_limit,
                    pid_t crashing_process,
                    const void* blob, size_t blob_size,
@@ -131,13 +141,40 @@ bool WriteMinidump(int minidump_fd, off_t minidump_size_limit,
                    const AppMemoryList& appdata,
                    bool skip_stacks_if_mapping_unreferenced = false,
                    uintptr_t principal_mapping_address = 0,
-                   bool sanitize_stacks = false);
+                   bool sanitize_stacks = false,
+                   int stack_trim_slack = -1,
+                   size_t heap_capture_budget = 0);
 
 bool WriteMinidump(const char* filename,
                    const MappingList& mappings,
                    const AppMemoryList& appdata,
                    LinuxDumper* dumper);
 
+// Called by WriteMinidumpSnapshot() with |context| once the threads of the
+// process being dumped run again, with the time in nanoseconds they were
+// suspended for.
+typedef void (*SnapshotResumedCallback)(void* context, uint64_t pause_ns);
+
+// Writes a minidump of |process|, which need not have crashed, suspending
+// its threads only while their registers and stacks, the memory around the
+// instruction pointer of |blob| and the |appdata| regions are copied. The
+// threads are then resumed, |resumed| is called if non-NULL, and the rest of
+// the minidump is written while they run. Otherwise the same as the
+// WriteMinidump() overloads above, with |blob| describing the thread that
+// asked for the snapshot.
+bool WriteMinidumpSnapshot(int minidump_fd, off_t minidump_size_limit,
+                           pid_t process,
+                           const void* blob, size_t blob_size,
+                           const MappingList& mappings,
+                           const AppMemoryList& appdata,
+                           bool skip_stacks_if_mapping_unreferenced,
+                           uintptr_t principal_mapping_address,
+                           bool sanitize_stacks,
+                           int stack_trim_slack,
+                           size_t heap_capture_budget,
+                           SnapshotResumedCallback resumed,
+                           void* resumed_context);
+
 }  // namespace google_breakpad
 
 #endif  // CLIENT_LINUX_MINIDUMP_WRITER_MINIDUMP_WRITER_H_
@@ -676,6 +676,175 @@ TEST(MinidumpWriterTest, AdditionalMemory) {
   IGNORE_EINTR(waitpid(child, nullptr, 0));
 }
 
+// Test that overlapping and adjacent memory regions are written once, as
+// a single region.
+TEST(MinidumpWriterTest, OverlappingMemoryIsMerged) {
+  int fds[2];
+  ASSERT_NE(-1, pipe(fds));
+
+  const uint32_t kMemorySize = sysconf(_SC_PAGESIZE);
+  uint8_t* memory = new uint8_t[kMemorySize];
+  const uintptr_t kMemoryAddress = reinterpret_cast<uintptr_t>(memory);
+  for (uint32_t i = 0; i < kMemorySize; ++i) {
+    memory[i] = i % 255;
+  }
+
+  const pid_t child = fork();
+  if (child == 0) {
+    close(fds[1]);
+    char b;
+    HANDLE_EINTR(read(fds[0], &b, sizeof(b)));
+    close(fds[0]);
+    syscall(__NR_exit_group);
+  }
+  close(fds[0]);
+
+  ExceptionHandler::CrashContext context;
+  ASSERT_EQ(0, getcontext(&context.context));
+  context.tid = child;
+
+  AutoTempDir temp_dir;
+  string templ = temp_dir.path() + kMDWriterUnitTestFileName;
+  unlink(templ.c_str());
+
+  // The second half, the first half overlapping its start, a region
+  // within both, and the last bytes again.
+  MappingList mappings;
+  AppMemoryList memory_list;
+  const size_t kRegions[][2] = {
+    { kMemorySize / 2, kMemorySize / 2 },
+    { 0, kMemorySize / 2 + 16 },
+    { kMemorySize / 4, kMemorySize / 2 },
+    { kMemorySize - 8, 8 },
+  };
+  for (size_t i = 0; i < sizeof(kRegions) / sizeof(kRegions[0]); ++i) {
+    AppMemory app_memory;
+    app_memory.ptr = memory + kRegions[i][0];
+    app_memory.length = kRegions[i][1];
+    memory_list.push_back(app_memory);
+  }
+  ASSERT_TRUE(WriteMinidump(templ.c_str(), child, &context, sizeof(context),
+                            mappings, memory_list));
+
+  Minidump minidump(templ);
+  ASSERT_TRUE(minidump.Read());
+
+  MinidumpMemoryList* dump_memory_list = minidump.GetMemoryList();
+  ASSERT_TRUE(dump_memory_list);
+  const MinidumpMemoryRegion* region =
+    dump_memory_list->GetMemoryRegionForAddress(kMemoryAddress);
+  ASSERT_TRUE(region);
+  EXPECT_EQ(kMemoryAddress, region->GetBase());
+  EXPECT_EQ(kMemorySize, region->GetSize());
+  EXPECT_EQ(0, memcmp(region->GetMemory(), memory, kMemorySize));
+
+  // No other region covers any of the memory.
+  for (unsigned i = 0; i < dump_memory_list->region_count(); ++i) {
+    const MinidumpMemoryRegion* other =
+        dump_memory_list->GetMemoryRegionAtIndex(i);
+    if (other == region)
+      continue;
+    EXPECT_TRUE(other->GetBase() + other->GetSize() <= kMemoryAddress ||
+                other->GetBase() >= kMemoryAddress + kMemorySize);
+  }
+
+  // The thread stacks lie within the listed regions.
+  MinidumpThreadList* thread_list = minidump.GetThreadList();
+  ASSERT_TRUE(thread_list);
+  for (unsigned i = 0; i < thread_list->thread_count(); ++i) {
+    MinidumpMemoryRegion* stack =
+        thread_list->GetThreadAtIndex(i)->GetMemory();
+    if (!stack || !stack->GetSize())
+      continue;
+    const MinidumpMemoryRegion* listed =
+        dump_memory_list->GetMemoryRegionForAddress(stack->GetBase());
+    ASSERT_TRUE(listed);
+    ASSERT_LE(stack->GetBase() + stack->GetSize(),
+              listed->GetBase() + listed->GetSize());
+    EXPECT_EQ(0, memcmp(stack->GetMemory(),
+                        listed->GetMemory() +
+                            (stack->GetBase() - listed->GetBase()),
+                        stack->GetSize()));
+  }
+
+  delete[] memory;
+  close(fds[1]);
+  IGNORE_EINTR(waitpid(child, nullptr, 0));
+}
+
+// Test that heap memory referenced from the stack is captured when a heap
+// capture budget is given, and not otherwise.
+TEST(MinidumpWriterTest, ReferencedHeapIsCaptured) {
+  int fds[2];
+  ASSERT_NE(-1, pipe(fds));
+
+  const size_t kObjectSize = 1024;
+  uint8_t* object = new uint8_t[kObjectSize];
+  for (size_t i = 0; i < kObjectSize; ++i) {
+    object[i] = i % 251;
+  }
+  // Keep a pointer to the object on this frame's stack, which is captured.
+  uint8_t* volatile object_pointer = object;
+  const uintptr_t kObjectAddress = reinterpret_cast<uintptr_t>(object_pointer);
+
+  const pid_t child = fork();
+  if (child == 0) {
+    close(fds[1]);
+    char b;
+    HANDLE_EINTR(read(fds[0], &b, sizeof(b)));
+    close(fds[0]);
+    syscall(__NR_exit_group);
+  }
+  close(fds[0]);
+
+  ExceptionHandler::CrashContext context;
+  ASSERT_EQ(0, getcontext(&context.context));
+  context.tid = child;
+
+  AutoTempDir temp_dir;
+  // A budget smaller than the part of a window before its address captures
+  // nothing, rather than memory that stops short of the address.
+  const int kBudgets[] = {0, 32, 64 * 1024};
+  unsigned uncaptured_region_count = 0;
+  for (size_t i = 0; i < sizeof(kBudgets) / sizeof(kBudgets[0]); ++i) {
+    const int budget = kBudgets[i];
+    string templ = temp_dir.path() + kMDWriterUnitTestFileName;
+    unlink(templ.c_str());
+    MappingList mappings;
+    AppMemoryList memory_list;
+    ASSERT_TRUE(WriteMinidump(templ.c_str(), -1, child, &context,
+                              sizeof(context), mappings, memory_list, false,
+                              0, false, -1, budget));
+
+    Minidump minidump(templ);
+    ASSERT_TRUE(minidump.Read());
+    MinidumpMemoryList* dump_memory_list = minidump.GetMemoryList();
+    ASSERT_TRUE(dump_memory_list);
+    const MinidumpMemoryRegion* region =
+        dump_memory_list->GetMemoryRegionForAddress(kObjectAddress);
+    if (!budget) {
+      EXPECT_FALSE(region);
+      uncaptured_region_count = dump_memory_list->region_count();
+      continue;
+    }
+    if (budget == 32) {
+      EXPECT_EQ(uncaptured_region_count, dump_memory_list->region_count());
+      continue;
+    }
+
+    // The window around the object's address extends past its start.
+    ASSERT_TRUE(region);
+    ASSERT_LE(kObjectAddress + 128, region->GetBase() + region->GetSize());
+    EXPECT_EQ(0, memcmp(region->GetMemory() +
+                            (kObjectAddress - region->GetBase()),
+                        object, 128));
+  }
+
+  delete[] object;
+  close(fds[1]);
+  IGNORE_EINTR(waitpid(child, nullptr, 0));
+}
+
 // Test that an invalid thread stack pointer still results in a minidump.
 TEST(MinidumpWriterTest, InvalidStackPointer) {
   int fds[2];
@@ -93,12 +93,25 @@ MinidumpFileWriter::MinidumpFileWriter()
     : file_(-1),
       close_file_when_destroyed_(true),
       position_(0),
-      size_(0) {
+      size_(0),
+      buffer_(NULL),
+      buffer_position_(0),
+      buffer_used_(0),
+      written_end_(0) {
 }
 
 MinidumpFileWriter::~MinidumpFileWriter() {
-  if (close_file_when_destroyed_)
+  if (close_file_when_destroyed_) {
     Close();
+  } else if (file_ != -1 && Flush()) {
+    // Leave the caller's descriptor positioned after the dump, as it would
+    // be had the dump been written sequentially.
+#if defined(__linux__) && __linux__
+    sys_lseek(file_, written_end_, SEEK_SET);
+#else
+    lseek(file_, written_end_, SEEK_SET);
+#endif
+  }
 }
 
 bool MinidumpFileWriter::Open(const char *path) {
@@ -125,6 +138,8 @@ bool MinidumpFileWriter::Close() {
   bool result = true;
 
   if (file_ != -1) {
+    if (!Flush())
+      return false;
 #if defined(__ANDROID__)
     if (!NeedsFTruncateWorkAround() && ftruncate(file_, position_)) {
        return false;
@@ -316,21 +331,82 @@ bool MinidumpFileWriter::Copy(MDRVA position, const void *src, ssize_t size) {
   if (static_cast<size_t>(size + position) > size_)
     return false;
 
-  // Seek and write the data
-#if defined(__linux__) && __linux__
-  if (sys_lseek(file_, position, SEEK_SET) == static_cast<off_t>(position)) {
-    if (sys_write(file_, src, size) == size) {
-      return true;
+  const size_t end = position + size;
+  if (buffer_used_) {
+    const size_t buffer_end = buffer_position_ + buffer_used_;
+
+    // Data that lies wholly before the buffered data, such as a header
+    // filled in after its contents, can go straight to the file.
+    if (end <= buffer_position_) {
+      if (end > written_end_)
+        written_end_ = end;
+      return WriteAt(position, src, size);
     }
-  }
-#else
-  if (lseek(file_, position, SEEK_SET) == static_cast<off_t>(position)) {
-    if (write(file_, src, size) == size) {
+
+    // Add the data to the buffer if it starts within or right after the
+    // buffered data, or past it in space nothing has been written to yet,
+    // such as the padding Allocate() leaves between allocations.
+    if (position >= buffer_position_ &&
+        end - buffer_position_ <= kBufferSize &&
+        (position <= buffer_end || buffer_end == written_end_)) {
+      if (position > buffer_end)
+        memset(buffer_ + buffer_used_, 0, position - buffer_end);
+      memcpy(buffer_ + (position - buffer_position_), src, size);
+      if (end > buffer_end)
+        buffer_used_ = end - buffer_position_;
+      if (end > written_end_)
+        written_end_ = end;
       return true;
     }
+
+    if (!Flush())
+      return false;
   }
+
+  if (end > written_end_)
+    written_end_ = end;
+
+  if (!buffer_)
+    buffer_ = reinterpret_cast<uint8_t *>(allocator_.Alloc(kBufferSize));
+  if (!buffer_ || static_cast<size_t>(size) >= kBufferSize)
+    return WriteAt(position, src, size);
+
+  buffer_position_ = position;
+  buffer_used_ = size;
+  memcpy(buffer_, src, size);
+  return true;
+}
+
+bool MinidumpFileWriter::Flush() {
+  if (!buffer_used_)
+    return true;
+
+  // Empty the buffer even on failure, so that later writes aren't held up
+  // behind data that can't be written.
+  const size_t used = buffer_used_;
+  buffer_used_ = 0;
+  return WriteAt(buffer_position_, buffer_, used);
+}
+
+bool MinidumpFileWriter::WriteAt(MDRVA position, const void *src,
+                                 size_t size) {
+  assert(file_ != -1);
+
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(src);
+  off_t offset = position;
+  while (size) {
+#if defined(__linux__) && __linux__
+    ssize_t written = sys_pwrite64(file_, data, size, offset);
+#else
+    ssize_t written = pwrite(file_, data, size, offset);
 #endif
-  return false;
+    if (written <= 0)
+      return false;
+    data += written;
+    offset += written;
+    size -= written;
+  }
+  return true;
 }
 
 bool UntypedMDRVA::Allocate(size_t size) {
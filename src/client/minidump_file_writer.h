@@ -36,6 +36,7 @@
 
 #include <string>
 
+#include "common/memory_allocator.h"
 #include "google_breakpad/common/minidump_format.h"
 
 namespace google_breakpad {
@@ -47,6 +48,9 @@ template<typename MDType> class TypedMDRVA;
 // strings using the definitions in minidump_format.h.  Since this class is
 // expected to be used in a situation where the current process may be
 // damaged, it will not allocate heap memory.
+// Writes are collected in a buffer taken from a PageAllocator, so that
+// adjacent ones reach the file in a single pwrite(); the buffer is written
+// out by Flush() and Close(), and when the instance is destroyed.
 // Sample usage:
 // MinidumpFileWriter writer;
 // writer.Open("/tmp/minidump.dmp");
@@ -91,6 +95,10 @@ public:
   // Return true on success, or false on failure.
   bool Close();
 
+  // Write any buffered data to the file.
+  // Return true on success, or false on failure.
+  bool Flush();
+
   // Copy the contents of |str| to a MDString and write it to the file.
   // |str| is expected to be either UTF-16 or UTF-32 depending on the size
   // of wchar_t.
@@ -124,6 +132,14 @@ public:
   // unable to allocate the bytes.
   MDRVA Allocate(size_t size);
 
+  // Write |size| bytes from |src| to the file at |position|, bypassing the
+  // buffer.
+  // Return true on success, or false on failure
+  bool WriteAt(MDRVA position, const void *src, size_t size);
+
+  // The size of |buffer_|.
+  static const size_t kBufferSize = 64 * 1024;
+
   // The file descriptor for the output file.
   int file_;
 
@@ -136,6 +152,19 @@ public:
   // Current allocated size
   size_t size_;
 
+  // Provides |buffer_|, which is allocated on the first Copy().
+  PageAllocator allocator_;
+
+  // Data waiting to be written: |buffer_used_| bytes destined for
+  // |buffer_position_| in the file.
+  uint8_t *buffer_;
+  MDRVA buffer_position_;
+  size_t buffer_used_;
+
+  // The end of the furthest data written to the file or buffered so far.
+  // Allocated space past it still holds the zeros that ftruncate() left.
+  size_t written_end_;
+
   // Copy |length| characters from |str| to |mdstring|.  These are distinct
   // because the underlying MDString is a UTF-16 based string.  The wchar_t
   // variant may need to create a MDString that has more characters than the
@@ -38,6 +38,9 @@
  */
 
 #include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "minidump_file_writer-inl.h"
@@ -166,11 +169,77 @@ static bool CompareFile(const char *path) {
   return true;
 }
 
+// Copy |size| bytes of |value| to |position| through |mdrva|, and to the
+// same offset in |expected|.
+static bool CopyPattern(google_breakpad::UntypedMDRVA *mdrva, MDRVA position,
+                        unsigned char value, size_t size,
+                        unsigned char *expected) {
+  unsigned char *data = reinterpret_cast<unsigned char *>(malloc(size));
+  ASSERT_TRUE(data);
+  memset(data, value, size);
+  memset(expected + position, value, size);
+  bool result = mdrva->Copy(position, data, size);
+  free(data);
+  return result;
+}
+
+// Write blocks out of order, over one another, and larger than the
+// writer's buffer, to a file provided with SetFile(), and check that the
+// file holds what was written last once the writer is destroyed.
+static bool WriteAndCompareBufferedFile(const char *path) {
+  const size_t kLargeSize = 100 * 1024;
+  const size_t kFileSize = 8 + 16 + kLargeSize + 16;
+  unsigned char *expected =
+      reinterpret_cast<unsigned char *>(calloc(kFileSize, 1));
+  ASSERT_TRUE(expected);
+
+  int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+  ASSERT_NE(fd, -1);
+  {
+    MinidumpFileWriter writer;
+    writer.SetFile(fd);
+
+    google_breakpad::UntypedMDRVA header(&writer);
+    google_breakpad::UntypedMDRVA odd(&writer);
+    google_breakpad::UntypedMDRVA large(&writer);
+    google_breakpad::UntypedMDRVA trailer(&writer);
+    ASSERT_TRUE(header.Allocate(8));
+    ASSERT_TRUE(odd.Allocate(13));
+    ASSERT_TRUE(large.Allocate(kLargeSize));
+    ASSERT_TRUE(trailer.Allocate(16));
+    ASSERT_EQ(writer.position(), kFileSize);
+
+    ASSERT_TRUE(CopyPattern(&odd, odd.position(), 0x11, 13, expected));
+    ASSERT_TRUE(CopyPattern(&header, header.position(), 0x22, 8, expected));
+    ASSERT_TRUE(CopyPattern(&large, large.position(), 0x33, kLargeSize,
+                            expected));
+    ASSERT_TRUE(CopyPattern(&trailer, trailer.position() + 4, 0x44, 12,
+                            expected));
+    ASSERT_TRUE(CopyPattern(&trailer, trailer.position(), 0x55, 8,
+                            expected));
+    ASSERT_TRUE(CopyPattern(&odd, odd.position() + 4, 0x66, 4, expected));
+    ASSERT_TRUE(CopyPattern(&large, large.position() + 10, 0x77, 100,
+                            expected));
+  }
+
+  unsigned char *actual = reinterpret_cast<unsigned char *>(malloc(kFileSize));
+  ASSERT_TRUE(actual);
+  ASSERT_EQ(pread(fd, actual, kFileSize, 0),
+            static_cast<ssize_t>(kFileSize));
+  ASSERT_EQ(memcmp(actual, expected, kFileSize), 0);
+  close(fd);
+  free(actual);
+  free(expected);
+  return true;
+}
+
 static bool RunTests() {
   const char *path = "/tmp/minidump_file_writer_unittest.dmp";
   ASSERT_TRUE(WriteFile(path));
   ASSERT_TRUE(CompareFile(path));
   unlink(path);
+  ASSERT_TRUE(WriteAndCompareBufferedFile(path));
+  unlink(path);
   return true;
 }
 
@@ -296,6 +296,9 @@ class DIEDispatcher: public Dwarf2Handler {
                             uint8_t offset_size, uint64_t cu_length,
                             uint8_t dwarf_version);
   bool StartDIE(uint64_t offset, enum DwarfTag tag);
+  // A DIE we decline to visit has no handler, so neither do any of its
+  // descendants: let the reader skip the whole subtree.
+  bool SkipChildrenOfSkippedDIEs() { return true; }
   void ProcessAttributeUnsigned(uint64_t offset,
                                 enum DwarfAttribute attr,
                                 enum DwarfForm form,
@@ -59,13 +59,12 @@ CompilationUnit::CompilationUnit(const string& path,
                                  ByteReader* reader, Dwarf2Handler* handler)
     : path_(path), offset_from_section_start_(offset), reader_(reader),
       sections_(sections), handler_(handler), abbrevs_(),
-      string_buffer_(NULL), string_buffer_length_(0),
+      abbrev_cache_(NULL), string_buffer_(NULL), string_buffer_length_(0),
       str_offsets_buffer_(NULL), str_offsets_buffer_length_(0),
       addr_buffer_(NULL), addr_buffer_length_(0),
       is_split_dwarf_(false), dwo_id_(0), dwo_name_(),
       skeleton_dwo_id_(0), ranges_base_(0), addr_base_(0),
-      have_checked_for_dwp_(false), dwp_path_(),
-      dwp_byte_reader_(), dwp_reader_() {}
+      dwp_cache_(NULL) {}
 
 // Initialize a compilation unit from a .dwo or .dwp file.
 // In this case, we need the .debug_addr section from the
@@ -95,6 +94,60 @@ void CompilationUnit::SetSplitDwarf(const uint8_t* addr_buffer,
 // zero for the form.  The entire abbreviation section is terminated
 // by a zero for the code.
 
+// Add an attribute NAME with FORM, about to be appended to ABBREV's
+// attribute list, to ABBREV's plan for skipping DIEs.
+static void AddToSkipPlan(CompilationUnit::Abbrev* abbrev,
+                          enum DwarfAttribute name, enum DwarfForm form) {
+  switch (form) {
+    case DW_FORM_ref1:
+    case DW_FORM_ref2:
+    case DW_FORM_ref4:
+    case DW_FORM_ref8:
+    case DW_FORM_ref_udata:
+      if (name == DW_AT_sibling)
+        abbrev->sibling_index = static_cast<int>(abbrev->attributes.size());
+      break;
+    default:
+      break;
+  }
+
+  switch (form) {
+    case DW_FORM_flag_present:
+      break;
+    case DW_FORM_data1:
+    case DW_FORM_flag:
+    case DW_FORM_ref1:
+      abbrev->fixed_bytes += 1;
+      break;
+    case DW_FORM_data2:
+    case DW_FORM_ref2:
+      abbrev->fixed_bytes += 2;
+      break;
+    case DW_FORM_data4:
+    case DW_FORM_ref4:
+      abbrev->fixed_bytes += 4;
+      break;
+    case DW_FORM_data8:
+    case DW_FORM_ref8:
+    case DW_FORM_ref_sig8:
+      abbrev->fixed_bytes += 8;
+      break;
+    case DW_FORM_addr:
+      abbrev->address_forms++;
+      break;
+    case DW_FORM_strp:
+    case DW_FORM_sec_offset:
+      abbrev->offset_forms++;
+      break;
+    case DW_FORM_ref_addr:
+      abbrev->ref_addr_forms++;
+      break;
+    default:
+      abbrev->fixed_size = false;
+      break;
+  }
+}
+
 void CompilationUnit::ReadAbbrevs() {
   if (abbrevs_)
     return;
@@ -107,15 +160,22 @@ void CompilationUnit::ReadAbbrevs() {
     iter = sections_.find("__debug_abbrev");
   assert(iter != sections_.end());
 
-  abbrevs_ = new std::vector<Abbrev>;
-  abbrevs_->resize(1);
-
   // The only way to check whether we are reading over the end of the
   // buffer would be to first compute the size of the leb128 data by
   // reading it, then go back and read it again.
   const uint8_t *abbrev_start = iter->second.first +
                                       header_.abbrev_offset;
   const uint8_t *abbrevptr = abbrev_start;
+
+  // If another compilation unit has already parsed this table, share it.
+  if (abbrev_cache_) {
+    abbrevs_ = abbrev_cache_->Find(abbrev_start);
+    if (abbrevs_)
+      return;
+  }
+
+  std::shared_ptr<AbbrevTable> abbrevs(new AbbrevTable);
+  abbrevs->resize(1);
 #ifndef NDEBUG
   const uint64_t abbrev_length = iter->second.second - header_.abbrev_offset;
 #endif
@@ -141,6 +201,13 @@ void CompilationUnit::ReadAbbrevs() {
 
     assert(abbrevptr < abbrev_start + abbrev_length);
 
+    abbrev.fixed_size = true;
+    abbrev.fixed_bytes = 0;
+    abbrev.address_forms = 0;
+    abbrev.offset_forms = 0;
+    abbrev.ref_addr_forms = 0;
+    abbrev.sibling_index = -1;
+
     while (1) {
       const uint64_t nametemp = reader_->ReadUnsignedLEB128(abbrevptr, &len);
       abbrevptr += len;
@@ -154,16 +221,48 @@ void CompilationUnit::ReadAbbrevs() {
       const enum DwarfAttribute name =
         static_cast<enum DwarfAttribute>(nametemp);
       const enum DwarfForm form = static_cast<enum DwarfForm>(formtemp);
+      AddToSkipPlan(&abbrev, name, form);
       abbrev.attributes.push_back(std::make_pair(name, form));
     }
-    assert(abbrev.number == abbrevs_->size());
-    abbrevs_->push_back(abbrev);
+    assert(abbrev.number == abbrevs->size());
+    abbrevs->push_back(abbrev);
+  }
+
+  abbrevs_ = abbrevs;
+  if (abbrev_cache_)
+    abbrev_cache_->Add(abbrev_start, abbrevs_);
+}
+
+std::shared_ptr<const CompilationUnit::AbbrevTable> AbbrevCache::Find(
+    const uint8_t* start) {
+  TableMap::const_iterator it = tables_.find(start);
+  if (it == tables_.end()) {
+    misses_++;
+    return std::shared_ptr<const CompilationUnit::AbbrevTable>();
   }
+  hits_++;
+  return it->second;
+}
+
+void AbbrevCache::Add(
+    const uint8_t* start,
+    std::shared_ptr<const CompilationUnit::AbbrevTable> table) {
+  tables_[start] = table;
 }
 
 // Skips a single DIE's attributes.
 const uint8_t *CompilationUnit::SkipDIE(const uint8_t* start,
                                         const Abbrev& abbrev) {
+  if (abbrev.fixed_size) {
+    // DWARF2 and 3/4 differ on whether ref_addr is address size or
+    // offset size.
+    const uint64_t ref_addr_size = header_.version == 2 ?
+        reader_->AddressSize() : reader_->OffsetSize();
+    return start + abbrev.fixed_bytes
+        + abbrev.address_forms * reader_->AddressSize()
+        + abbrev.offset_forms * reader_->OffsetSize()
+        + abbrev.ref_addr_forms * ref_addr_size;
+  }
   for (AttributeList::const_iterator i = abbrev.attributes.begin();
        i != abbrev.attributes.end();
        i++)  {
@@ -172,6 +271,88 @@ const uint8_t *CompilationUnit::SkipDIE(const uint8_t* start,
   return start;
 }
 
+const uint8_t *CompilationUnit::FindSibling(const uint8_t *start,
+                                            const Abbrev& abbrev,
+                                            const uint8_t *end) {
+  if (abbrev.sibling_index < 0)
+    return NULL;
+
+  AttributeList::const_iterator attr = abbrev.attributes.begin();
+  for (int i = 0; i < abbrev.sibling_index; i++, attr++) {
+    start = SkipAttribute(start, attr->second);
+    if (!start)
+      return NULL;
+  }
+
+  uint64_t offset;
+  size_t len;
+  switch (attr->second) {
+    case DW_FORM_ref1:
+      offset = reader_->ReadOneByte(start);
+      break;
+    case DW_FORM_ref2:
+      offset = reader_->ReadTwoBytes(start);
+      break;
+    case DW_FORM_ref4:
+      offset = reader_->ReadFourBytes(start);
+      break;
+    case DW_FORM_ref8:
+      offset = reader_->ReadEightBytes(start);
+      break;
+    case DW_FORM_ref_udata:
+      offset = reader_->ReadUnsignedLEB128(start, &len);
+      break;
+    default:
+      return NULL;
+  }
+
+  // The reference is relative to the start of the compilation unit. A
+  // sibling that doesn't lie after this DIE is bogus; walk the subtree.
+  if (offset > static_cast<uint64_t>(end - buffer_) ||
+      buffer_ + offset <= start)
+    return NULL;
+  return buffer_ + offset;
+}
+
+// Skips a DIE and all its descendants. Subtrees whose root has a
+// DW_AT_sibling attribute are skipped in a single step; everything else
+// is walked without looking at attribute values, which SkipDIE can
+// usually pass over without decoding a single form.
+const uint8_t *CompilationUnit::SkipDIETree(const uint8_t *start,
+                                            const Abbrev& abbrev,
+                                            const uint8_t *end) {
+  const uint8_t *sibling = FindSibling(start, abbrev, end);
+  if (sibling)
+    return sibling;
+
+  const uint8_t *ptr = SkipDIE(start, abbrev);
+  int depth = 1;
+  while (depth > 0) {
+    if (!ptr || ptr >= end)
+      return end;
+
+    size_t len;
+    const uint64_t abbrev_num = reader_->ReadUnsignedLEB128(ptr, &len);
+    ptr += len;
+    if (abbrev_num == 0) {
+      depth--;
+      continue;
+    }
+
+    const Abbrev& child = abbrevs_->at(static_cast<size_t>(abbrev_num));
+    if (child.has_children) {
+      sibling = FindSibling(ptr, child, end);
+      if (sibling) {
+        ptr = sibling;
+        continue;
+      }
+      depth++;
+    }
+    ptr = SkipDIE(ptr, child);
+  }
+  return ptr;
+}
+
 // Skips a single attribute form's data.
 const uint8_t *CompilationUnit::SkipAttribute(const uint8_t *start,
                                               enum DwarfForm form) {
@@ -562,9 +743,11 @@ void CompilationUnit::ProcessDIEs() {
   else
     lengthstart += 4;
 
+  const uint8_t *end = lengthstart + header_.length;
+  const bool skip_children = handler_->SkipChildrenOfSkippedDIEs();
   std::stack<uint64_t> die_stack;
   
-  while (dieptr < (lengthstart + header_.length)) {
+  while (dieptr < end) {
     // We give the user the absolute offset from the beginning of
     // debug_info, since they need it to deal with ref_addr forms.
     uint64_t absolute_offset = (dieptr - buffer_) + offset_from_section_start_;
@@ -588,6 +771,13 @@ void CompilationUnit::ProcessDIEs() {
     const Abbrev& abbrev = abbrevs_->at(static_cast<size_t>(abbrev_num));
     const enum DwarfTag tag = abbrev.tag;
     if (!handler_->StartDIE(absolute_offset, tag)) {
+      if (abbrev.has_children && skip_children) {
+        // Jump over the whole subtree; the handler hears nothing of it
+        // but the end of this DIE.
+        dieptr = SkipDIETree(dieptr, abbrev, end);
+        handler_->EndDIE(absolute_offset);
+        continue;
+      }
       dieptr = SkipDIE(dieptr, abbrev);
     } else {
       dieptr = ProcessDIE(absolute_offset, dieptr, abbrev);
@@ -613,41 +803,19 @@ inline int GetElfWidth(const ElfReader& elf) {
 
 void CompilationUnit::ProcessSplitDwarf() {
   struct stat statbuf;
-  if (!have_checked_for_dwp_) {
-    // Look for a .dwp file in the same directory as the executable.
-    have_checked_for_dwp_ = true;
-    string dwp_suffix(".dwp");
-    dwp_path_ = path_ + dwp_suffix;
-    if (stat(dwp_path_.c_str(), &statbuf) != 0) {
-      // Fall back to a split .debug file in the same directory.
-      string debug_suffix(".debug");
-      dwp_path_ = path_;
-      size_t found = path_.rfind(debug_suffix);
-      if (found + debug_suffix.length() == path_.length())
-        dwp_path_ = dwp_path_.replace(found, debug_suffix.length(), dwp_suffix);
-    }
-    if (stat(dwp_path_.c_str(), &statbuf) == 0) {
-      ElfReader* elf = new ElfReader(dwp_path_);
-      int width = GetElfWidth(*elf);
-      if (width != 0) {
-        dwp_byte_reader_.reset(new ByteReader(reader_->GetEndianness()));
-        dwp_byte_reader_->SetAddressSize(width);
-        dwp_reader_.reset(new DwpReader(*dwp_byte_reader_, elf));
-        dwp_reader_->Initialize();
-      } else {
-        delete elf;
-      }
-    }
+  if (!dwp_cache_) {
+    own_dwp_cache_.reset(new DwpCache);
+    dwp_cache_ = own_dwp_cache_.get();
   }
   bool found_in_dwp = false;
-  if (dwp_reader_) {
+  DwpCache::Package* dwp = dwp_cache_->Find(path_, reader_->GetEndianness());
+  if (dwp) {
     // If we have a .dwp file, read the debug sections for the requested CU.
-    SectionMap sections;
-    dwp_reader_->ReadDebugSectionsForCU(dwo_id_, &sections);
-    if (!sections.empty()) {
+    const SectionMap* sections = dwp->reader->SectionsForCU(dwo_id_);
+    if (sections) {
       found_in_dwp = true;
-      CompilationUnit dwp_comp_unit(dwp_path_, sections, 0,
-                                    dwp_byte_reader_.get(), handler_);
+      CompilationUnit dwp_comp_unit(dwp->path, *sections, 0,
+                                    dwp->byte_reader.get(), handler_);
       dwp_comp_unit.SetSplitDwarf(addr_buffer_, addr_buffer_length_, addr_base_,
                                   ranges_base_, dwo_id_);
       dwp_comp_unit.Start();
@@ -703,7 +871,14 @@ DwpReader::DwpReader(const ByteReader& byte_reader, ElfReader* elf_reader)
       nslots_(0), phash_(NULL), pindex_(NULL), shndx_pool_(NULL),
       offset_table_(NULL), size_table_(NULL), abbrev_data_(NULL),
       abbrev_size_(0), info_data_(NULL), info_size_(0),
-      str_offsets_data_(NULL), str_offsets_size_(0) {}
+      str_offsets_data_(NULL), str_offsets_size_(0) {
+  const std::pair<const uint8_t *, uint64_t> empty(NULL, 0);
+  abbrev_entry_ = sections_.insert(std::make_pair(".debug_abbrev", empty))
+                      .first;
+  info_entry_ = sections_.insert(std::make_pair(".debug_info", empty)).first;
+  str_offsets_entry_ =
+      sections_.insert(std::make_pair(".debug_str_offsets", empty)).first;
+}
 
 DwpReader::~DwpReader() {
   if (elf_reader_) delete elf_reader_;
@@ -718,6 +893,8 @@ void DwpReader::Initialize() {
   // The .debug_str.dwo section is shared by all CUs in the file.
   string_buffer_ = elf_reader_->GetSectionByName(".debug_str.dwo",
                                                  &string_buffer_size_);
+  sections_[".debug_str"] = std::make_pair(
+      reinterpret_cast<const uint8_t *>(string_buffer_), string_buffer_size_);
 
   version_ = byte_reader_.ReadFourBytes(
       reinterpret_cast<const uint8_t *>(cu_index_));
@@ -752,27 +929,50 @@ void DwpReader::Initialize() {
       version_ = 0;
     }
   }
+  if (version_ == 0)
+    return;
+
+  // Decode the hash table once, rather than probing it for each CU.
+  // Empty slots have a zero hash in version 1, and a zero index in
+  // version 2.
+  units_.reserve(nslots_);
+  for (unsigned int slot = 0; slot < nslots_; ++slot) {
+    uint64_t dwo_id = byte_reader_.ReadEightBytes(
+        reinterpret_cast<const uint8_t *>(phash_) + slot * sizeof(uint64_t));
+    uint32_t index = byte_reader_.ReadFourBytes(
+        reinterpret_cast<const uint8_t *>(pindex_) + slot * sizeof(uint32_t));
+    if (version_ == 1 ? dwo_id == 0 : index == 0)
+      continue;
+    units_.insert(std::make_pair(dwo_id, index));
+  }
 }
 
-void DwpReader::ReadDebugSectionsForCU(uint64_t dwo_id,
-                                       SectionMap* sections) {
-  if (version_ == 1) {
-    int slot = LookupCU(dwo_id);
-    if (slot == -1) {
-      return;
-    }
+void DwpReader::SetSection(SectionMap::iterator entry, const char* data,
+                           size_t size) {
+  entry->second.first = reinterpret_cast<const uint8_t *>(data);
+  entry->second.second = size;
+}
 
+const SectionMap* DwpReader::SectionsForCU(uint64_t dwo_id) {
+  std::unordered_map<uint64_t, uint32_t>::const_iterator unit =
+      units_.find(dwo_id);
+  if (unit == units_.end())
+    return NULL;
+  uint32_t index = unit->second;
+
+  SetSection(abbrev_entry_, NULL, 0);
+  SetSection(info_entry_, NULL, 0);
+  SetSection(str_offsets_entry_, NULL, 0);
+
+  if (version_ == 1) {
     // The index table points to the section index pool, where we
     // can read a list of section indexes for the debug sections
     // for the CU whose dwo_id we are looking for.
-    int index = byte_reader_.ReadFourBytes(
-        reinterpret_cast<const uint8_t *>(pindex_)
-        + slot * sizeof(uint32_t));
     const char* shndx_list = shndx_pool_ + index * sizeof(uint32_t);
     for (;;) {
-      if (shndx_list >= cu_index_ + cu_index_size_) {
+      if (shndx_list + sizeof(uint32_t) > cu_index_ + cu_index_size_) {
         version_ = 0;
-        return;
+        return NULL;
       }
       unsigned int shndx = byte_reader_.ReadFourBytes(
           reinterpret_cast<const uint8_t *>(shndx_list));
@@ -780,6 +980,8 @@ void DwpReader::ReadDebugSectionsForCU(uint64_t dwo_id,
       if (shndx == 0)
         break;
       const char* section_name = elf_reader_->GetSectionName(shndx);
+      if (section_name == NULL)
+        continue;
       size_t section_size;
       const char* section_data;
       // We're only interested in these four debug sections.
@@ -787,35 +989,17 @@ void DwpReader::ReadDebugSectionsForCU(uint64_t dwo_id,
       // add them to the sections table with their normal names.
       if (!strncmp(section_name, ".debug_abbrev", strlen(".debug_abbrev"))) {
         section_data = elf_reader_->GetSectionByIndex(shndx, &section_size);
-        sections->insert(std::make_pair(
-            ".debug_abbrev",
-            std::make_pair(reinterpret_cast<const uint8_t *> (section_data),
-                                                              section_size)));
+        SetSection(abbrev_entry_, section_data, section_size);
       } else if (!strncmp(section_name, ".debug_info", strlen(".debug_info"))) {
         section_data = elf_reader_->GetSectionByIndex(shndx, &section_size);
-        sections->insert(std::make_pair(
-            ".debug_info",
-            std::make_pair(reinterpret_cast<const uint8_t *> (section_data),
-                           section_size)));
+        SetSection(info_entry_, section_data, section_size);
       } else if (!strncmp(section_name, ".debug_str_offsets",
                           strlen(".debug_str_offsets"))) {
         section_data = elf_reader_->GetSectionByIndex(shndx, &section_size);
-        sections->insert(std::make_pair(
-            ".debug_str_offsets",
-            std::make_pair(reinterpret_cast<const uint8_t *> (section_data),
-                           section_size)));
+        SetSection(str_offsets_entry_, section_data, section_size);
       }
     }
-    sections->insert(std::make_pair(
-        ".debug_str",
-        std::make_pair(reinterpret_cast<const uint8_t *> (string_buffer_),
-                       string_buffer_size_)));
   } else if (version_ == 2) {
-    uint32_t index = LookupCUv2(dwo_id);
-    if (index == 0) {
-      return;
-    }
-
     // The index points to a row in each of the section offsets table
     // and the section size table, where we can read the offsets and sizes
     // of the contributions to each debug section from the CU whose dwo_id
@@ -827,9 +1011,10 @@ void DwpReader::ReadDebugSectionsForCU(uint64_t dwo_id,
                              + index * ncolumns_ * sizeof(uint32_t);
     const char* size_row =
         size_table_ + (index - 1) * ncolumns_ * sizeof(uint32_t);
-    if (size_row + ncolumns_ * sizeof(uint32_t) > cu_index_ + cu_index_size_) {
+    if (index > nunits_ ||
+        size_row + ncolumns_ * sizeof(uint32_t) > cu_index_ + cu_index_size_) {
       version_ = 0;
-      return;
+      return NULL;
     }
     for (unsigned int col = 0u; col < ncolumns_; ++col) {
       uint32_t section_id =
@@ -841,65 +1026,64 @@ void DwpReader::ReadDebugSectionsForCU(uint64_t dwo_id,
       uint32_t size = byte_reader_.ReadFourBytes(
           reinterpret_cast<const uint8_t *>(size_row) + col * sizeof(uint32_t));
       if (section_id == DW_SECT_ABBREV) {
-        sections->insert(std::make_pair(
-            ".debug_abbrev",
-            std::make_pair(reinterpret_cast<const uint8_t *> (abbrev_data_)
-                           + offset, size)));
+        SetSection(abbrev_entry_, abbrev_data_ + offset, size);
       } else if (section_id == DW_SECT_INFO) {
-        sections->insert(std::make_pair(
-            ".debug_info",
-            std::make_pair(reinterpret_cast<const uint8_t *> (info_data_)
-                           + offset, size)));
+        SetSection(info_entry_, info_data_ + offset, size);
       } else if (section_id == DW_SECT_STR_OFFSETS) {
-        sections->insert(std::make_pair(
-            ".debug_str_offsets",
-            std::make_pair(reinterpret_cast<const uint8_t *> (str_offsets_data_)
-                           + offset, size)));
+        SetSection(str_offsets_entry_, str_offsets_data_ + offset, size);
       }
     }
-    sections->insert(std::make_pair(
-        ".debug_str",
-        std::make_pair(reinterpret_cast<const uint8_t *> (string_buffer_),
-                       string_buffer_size_)));
-  }
-}
-
-int DwpReader::LookupCU(uint64_t dwo_id) {
-  uint32_t slot = static_cast<uint32_t>(dwo_id) & (nslots_ - 1);
-  uint64_t probe = byte_reader_.ReadEightBytes(
-      reinterpret_cast<const uint8_t *>(phash_) + slot * sizeof(uint64_t));
-  if (probe != 0 && probe != dwo_id) {
-    uint32_t secondary_hash =
-        (static_cast<uint32_t>(dwo_id >> 32) & (nslots_ - 1)) | 1;
-    do {
-      slot = (slot + secondary_hash) & (nslots_ - 1);
-      probe = byte_reader_.ReadEightBytes(
-          reinterpret_cast<const uint8_t *>(phash_) + slot * sizeof(uint64_t));
-    } while (probe != 0 && probe != dwo_id);
-  }
-  if (probe == 0)
-    return -1;
-  return slot;
-}
-
-uint32_t DwpReader::LookupCUv2(uint64_t dwo_id) {
-  uint32_t slot = static_cast<uint32_t>(dwo_id) & (nslots_ - 1);
-  uint64_t probe = byte_reader_.ReadEightBytes(
-      reinterpret_cast<const uint8_t *>(phash_) + slot * sizeof(uint64_t));
-  uint32_t index = byte_reader_.ReadFourBytes(
-      reinterpret_cast<const uint8_t *>(pindex_) + slot * sizeof(uint32_t));
-  if (index != 0 && probe != dwo_id) {
-    uint32_t secondary_hash =
-        (static_cast<uint32_t>(dwo_id >> 32) & (nslots_ - 1)) | 1;
-    do {
-      slot = (slot + secondary_hash) & (nslots_ - 1);
-      probe = byte_reader_.ReadEightBytes(
-          reinterpret_cast<const uint8_t *>(phash_) + slot * sizeof(uint64_t));
-      index = byte_reader_.ReadFourBytes(
-          reinterpret_cast<const uint8_t *>(pindex_) + slot * sizeof(uint32_t));
-    } while (index != 0 && probe != dwo_id);
-  }
-  return index;
+  } else {
+    return NULL;
+  }
+
+  // A unit without these can't be read at all.
+  if (!abbrev_entry_->second.first || !info_entry_->second.first)
+    return NULL;
+  return &sections_;
+}
+
+DwpCache::Package* DwpCache::Find(const string& path,
+                                  enum Endianness endianness) {
+  PackageMap::iterator it = packages_.find(path);
+  if (it == packages_.end()) {
+    it = packages_.insert(std::make_pair(
+        path, std::unique_ptr<Package>(Open(path, endianness)))).first;
+  }
+  return it->second.get();
+}
+
+DwpCache::Package* DwpCache::Open(const string& path,
+                                  enum Endianness endianness) {
+  // Look for a .dwp file in the same directory as the executable.
+  struct stat statbuf;
+  string dwp_suffix(".dwp");
+  string dwp_path = path + dwp_suffix;
+  if (stat(dwp_path.c_str(), &statbuf) != 0) {
+    // Fall back to a split .debug file in the same directory.
+    string debug_suffix(".debug");
+    size_t found = path.rfind(debug_suffix);
+    if (found == string::npos ||
+        found + debug_suffix.length() != path.length())
+      return NULL;
+    dwp_path = path;
+    dwp_path.replace(found, debug_suffix.length(), dwp_suffix);
+    if (stat(dwp_path.c_str(), &statbuf) != 0)
+      return NULL;
+  }
+  ElfReader* elf = new ElfReader(dwp_path);
+  int width = GetElfWidth(*elf);
+  if (width == 0) {
+    delete elf;
+    return NULL;
+  }
+  Package* package = new Package;
+  package->path = dwp_path;
+  package->byte_reader.reset(new ByteReader(endianness));
+  package->byte_reader->SetAddressSize(width);
+  package->reader.reset(new DwpReader(*package->byte_reader, elf));
+  package->reader->Initialize();
+  return package;
 }
 
 LineInfo::LineInfo(const uint8_t *buffer, uint64_t buffer_length,
@@ -1210,40 +1394,85 @@ void LineInfo::ReadLines() {
     lengthstart += 4;
 
   const uint8_t *lineptr = after_header_;
+  const uint8_t *lineend = lengthstart + header_.total_length;
   lsm.Reset(header_.default_is_stmt);
 
+  // Most line programs consist mainly of special opcodes, each of which
+  // advances the address and line by amounts that depend only on the
+  // opcode. Decode them with a table, and leave the rest to
+  // ProcessOneOpcode.
+  int64_t address_advance[256];
+  int32_t line_advance[256];
+  const int special_base = header_.line_range ? header_.opcode_base : 256;
+  for (int opcode = special_base; opcode < 256; opcode++) {
+    const int adjusted = opcode - header_.opcode_base;
+    address_advance[opcode] = (adjusted / header_.line_range)
+                              * header_.min_insn_length;
+    line_advance[opcode] = (adjusted % header_.line_range)
+                           + header_.line_base;
+  }
+
   // The LineInfoHandler interface expects each line's length along
   // with its address, but DWARF only provides addresses (sans
   // length), and an end-of-sequence address; one infers the length
-  // from the next address. So we report a line only when we get the
-  // next line's address, or the end-of-sequence address.
+  // from the next address. So we complete a row only when we get the
+  // next row's address, or the end-of-sequence address. Completed rows
+  // are handed to the handler a sequence at a time.
+  std::vector<LineInfoRow> rows;
   bool have_pending_line = false;
-  uint64_t pending_address = 0;
-  uint32_t pending_file_num = 0, pending_line_num = 0, pending_column_num = 0;
+  LineInfoRow pending = LineInfoRow();
 
-  while (lineptr < lengthstart + header_.total_length) {
+  while (lineptr < lineend) {
+    const uint8_t opcode = *lineptr;
     size_t oplength;
-    bool add_row = ProcessOneOpcode(reader_, handler_, header_,
-                                    lineptr, &lsm, &oplength, (uintptr)-1,
-                                    NULL);
+    bool add_row;
+    if (opcode >= special_base) {
+      lsm.address += address_advance[opcode];
+      lsm.line_num += line_advance[opcode];
+      lsm.basic_block = true;
+      oplength = 1;
+      add_row = true;
+    } else {
+      // DW_LNE_define_file reports a file to the handler; report the
+      // rows we have so far first, so that the handler sees events in
+      // program order. Other extended opcodes don't call the handler.
+      if (opcode == DW_LNS_extended_op && !rows.empty()) {
+        size_t templen;
+        reader_->ReadUnsignedLEB128(lineptr + 1, &templen);
+        const uint8_t *subop = lineptr + 1 + templen;
+        if (subop < lineend && *subop == DW_LNE_define_file) {
+          handler_->AddLines(&rows[0], rows.size());
+          rows.clear();
+        }
+      }
+      add_row = ProcessOneOpcode(reader_, handler_, header_,
+                                 lineptr, &lsm, &oplength, (uintptr)-1,
+                                 NULL);
+    }
     if (add_row) {
-      if (have_pending_line)
-        handler_->AddLine(pending_address, lsm.address - pending_address,
-                          pending_file_num, pending_line_num,
-                          pending_column_num);
+      if (have_pending_line) {
+        pending.length = lsm.address - pending.address;
+        rows.push_back(pending);
+      }
       if (lsm.end_sequence) {
+        if (!rows.empty()) {
+          handler_->AddLines(&rows[0], rows.size());
+          rows.clear();
+        }
         lsm.Reset(header_.default_is_stmt);      
         have_pending_line = false;
       } else {
-        pending_address = lsm.address;
-        pending_file_num = lsm.file_num;
-        pending_line_num = lsm.line_num;
-        pending_column_num = lsm.column_num;
+        pending.address = lsm.address;
+        pending.file_num = lsm.file_num;
+        pending.line_num = lsm.line_num;
+        pending.column_num = lsm.column_num;
         have_pending_line = true;
       }
     }
     lineptr += oplength;
   }
+  if (!rows.empty())
+    handler_->AddLines(&rows[0], rows.size());
 
   after_header_ = lengthstart + header_.total_length;
 }
@@ -45,6 +45,7 @@
 #include <list>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <memory>
@@ -57,8 +58,10 @@
 
 namespace dwarf2reader {
 struct LineStateMachine;
+class AbbrevCache;
 class Dwarf2Handler;
 class LineInfoHandler;
+class DwpCache;
 class DwpReader;
 
 // This maps from a string naming a section to a pair containing a
@@ -83,6 +86,17 @@ struct LineInfoHeader {
   std::vector<unsigned char> *std_opcode_lengths;
 };
 
+// A single row of a line number table: LENGTH bytes of machine code
+// starting at ADDRESS, from line LINE_NUM of file FILE_NUM, starting at
+// column COLUMN_NUM (or 0 if unknown).
+struct LineInfoRow {
+  uint64_t address;
+  uint64_t length;
+  uint32_t file_num;
+  uint32_t line_num;
+  uint32_t column_num;
+};
+
 class LineInfo {
  public:
 
@@ -185,6 +199,17 @@ class LineInfoHandler {
   // if we know it (0 otherwise).
   virtual void AddLine(uint64_t address, uint64_t length,
                        uint32_t file_num, uint32_t line_num, uint32_t column_num) { }
+
+  // Called when the line info reader has decoded a run of COUNT rows
+  // starting at ROWS, in address order; usually these are a whole
+  // sequence. The default definition calls AddLine for each row in turn;
+  // handlers that can take a batch of lines at once can override this
+  // to do so.
+  virtual void AddLines(const LineInfoRow* rows, size_t count) {
+    for (size_t i = 0; i < count; i++)
+      AddLine(rows[i].address, rows[i].length, rows[i].file_num,
+              rows[i].line_num, rows[i].column_num);
+  }
 };
 
 class RangeListHandler {
@@ -251,6 +276,15 @@ class Dwarf2Handler {
   // section. Return false if you would like to skip this DIE.
   virtual bool StartDIE(uint64_t offset, enum DwarfTag tag) { return false; }
 
+  // Return true if, whenever StartDIE returns false, you would also like
+  // to skip all of that DIE's descendants. The reader then jumps over the
+  // whole subtree --- using the DIE's DW_AT_sibling attribute when it has
+  // one --- without calling StartDIE or EndDIE for any of the descendants,
+  // and calls EndDIE for the skipped DIE itself. The default definition
+  // visits the children of skipped DIEs, as handlers that look for DIEs
+  // nested inside ones they don't care about need.
+  virtual bool SkipChildrenOfSkippedDIEs() { return false; }
+
   // Called when we have an attribute with unsigned data to give to our
   // handler. The attribute is for the DIE at OFFSET from the beginning of the
   // .debug_info section. Its name is ATTR, its form is FORM, and its value is
@@ -360,9 +394,7 @@ class CompilationUnit {
   // ByteReader, and a Dwarf2Handler class to call callbacks in.
   CompilationUnit(const string& path, const SectionMap& sections,
                   uint64_t offset, ByteReader* reader, Dwarf2Handler* handler);
-  virtual ~CompilationUnit() {
-    if (abbrevs_) delete abbrevs_;
-  }
+  virtual ~CompilationUnit() { }
 
   // Initialize a compilation unit from a .dwo or .dwp file.
   // In this case, we need the .debug_addr section from the
@@ -373,6 +405,19 @@ class CompilationUnit {
   void SetSplitDwarf(const uint8_t* addr_buffer, uint64_t addr_buffer_length,
                      uint64_t addr_base, uint64_t ranges_base, uint64_t dwo_id);
 
+  // Look up this compilation unit's abbreviation table in CACHE, and
+  // add it there if we have to parse it, so that other compilation
+  // units using the same table can share it. CACHE must outlive this
+  // compilation unit.
+  void SetAbbrevCache(AbbrevCache* cache) { abbrev_cache_ = cache; }
+
+  // Look for the .dwp package holding this compilation unit's split
+  // DWARF in CACHE, opening it there if need be, so that all the
+  // skeleton compilation units of a file share one mapped and indexed
+  // package. CACHE must outlive this compilation unit. Without a cache,
+  // each skeleton compilation unit opens the package afresh.
+  void SetDwpCache(DwpCache* cache) { dwp_cache_ = cache; }
+
   // Begin reading a Dwarf2 compilation unit, and calling the
   // callbacks in the Dwarf2Handler
 
@@ -382,8 +427,6 @@ class CompilationUnit {
   // start of the next compilation unit, if there is one.
   uint64_t Start();
 
- private:
-
   // This struct represents a single DWARF2/3 abbreviation
   // The abbreviation tells how to read a DWARF2/3 DIE, and consist of a
   // tag and a list of attributes, as well as the data form of each attribute.
@@ -392,8 +435,33 @@ class CompilationUnit {
     enum DwarfTag tag;
     bool has_children;
     AttributeList attributes;
+
+    // A plan for skipping DIEs that use this abbreviation, computed once
+    // when the table is read. If FIXED_SIZE is true, every attribute's
+    // form has a size that depends only on the compilation unit header,
+    // and a DIE's attributes occupy FIXED_BYTES bytes, plus the size of
+    // an address for each of ADDRESS_FORMS attributes, plus the size of
+    // an offset for each of OFFSET_FORMS attributes, plus the size of a
+    // DW_FORM_ref_addr for each of REF_ADDR_FORMS attributes. (The
+    // tables are shared between compilation units, so these can't be
+    // folded together here.)
+    bool fixed_size;
+    uint64_t fixed_bytes;
+    uint32_t address_forms;
+    uint32_t offset_forms;
+    uint32_t ref_addr_forms;
+
+    // The position in ATTRIBUTES of the DW_AT_sibling attribute, if it
+    // has a CU-relative reference form, or -1 otherwise.
+    int sibling_index;
   };
 
+  // A set of DWARF2/3 abbreviations, indexed by abbreviation number,
+  // which means that element 0 is not valid.
+  typedef std::vector<Abbrev> AbbrevTable;
+
+ private:
+
   // A DWARF2/3 compilation unit header.  This is not the same size as
   // in the actual file, as the one in the file may have a 32 bit or
   // 64 bit length.
@@ -501,6 +569,20 @@ class CompilationUnit {
   // new place to position the stream to.
   const uint8_t *SkipAttribute(const uint8_t *start, enum DwarfForm form);
 
+  // Skips the children of the DIE with attributes specified in ABBREV
+  // starting at START, along with the DIE's own attributes, and return
+  // the position just past the null entry ending its list of children.
+  // END is the end of the compilation unit. Use DW_AT_sibling
+  // attributes to jump over subtrees where possible.
+  const uint8_t *SkipDIETree(const uint8_t *start, const Abbrev& abbrev,
+                             const uint8_t *end);
+
+  // If ABBREV has a DW_AT_sibling attribute, return the position of the
+  // sibling of the DIE whose attributes start at START, if it lies
+  // within (START, END]. Otherwise, return NULL.
+  const uint8_t *FindSibling(const uint8_t *start, const Abbrev& abbrev,
+                             const uint8_t *end);
+
   // Process the actual debug information in a split DWARF file.
   void ProcessSplitDwarf();
 
@@ -533,8 +615,13 @@ class CompilationUnit {
 
   // Set of DWARF2/3 abbreviations for this compilation unit.  Indexed
   // by abbreviation number, which means that abbrevs_[0] is not
-  // valid.
-  std::vector<Abbrev>* abbrevs_;
+  // valid. The table may be shared with other compilation units
+  // through abbrev_cache_.
+  std::shared_ptr<const AbbrevTable> abbrevs_;
+
+  // The cache of abbreviation tables shared with other compilation
+  // units, or NULL if we parse our table privately.
+  AbbrevCache* abbrev_cache_;
 
   // String section buffer and length, if we have a string section.
   // This is here to avoid doing a section lookup for strings in
@@ -577,17 +664,48 @@ class CompilationUnit {
   // The value of the DW_AT_GNU_addr_base attribute, if any.
   uint64_t addr_base_;
 
-  // True if we have already looked for a .dwp file.
-  bool have_checked_for_dwp_;
+  // Where to look for a .dwp package, and the cache we made ourselves
+  // if SetDwpCache wasn't called.
+  DwpCache* dwp_cache_;
+  std::unique_ptr<DwpCache> own_dwp_cache_;
+};
+
+// A cache of the abbreviation tables parsed by the CompilationUnits
+// reading a single file, keyed by where each table's data starts.
+// Linkers that merge abbreviations, and tools like dwz, leave thousands
+// of compilation units sharing a single table; with a cache, each table
+// is parsed once and shared, read-only, by all of them. The cache is
+// not thread-safe.
+class AbbrevCache {
+ public:
+  AbbrevCache() : hits_(0), misses_(0) { }
+
+  // Return the table whose data starts at START, or an empty pointer if
+  // no table has been added for START. Either way, count the lookup
+  // as a hit or a miss.
+  std::shared_ptr<const CompilationUnit::AbbrevTable> Find(
+      const uint8_t* start);
+
+  // Add TABLE, parsed from the data at START, to the cache.
+  void Add(const uint8_t* start,
+           std::shared_ptr<const CompilationUnit::AbbrevTable> table);
 
-  // Path to the .dwp file.
-  string dwp_path_;
+  // The number of lookups that found a table, and the number that
+  // didn't (and so led to a table being parsed).
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
 
-  // ByteReader for the DWP file.
-  std::unique_ptr<ByteReader> dwp_byte_reader_;
+  // The number of distinct tables in the cache.
+  size_t size() const { return tables_.size(); }
 
-  // DWP reader.
-   std::unique_ptr<DwpReader> dwp_reader_;
+ private:
+  typedef std::map<const uint8_t*,
+                   std::shared_ptr<const CompilationUnit::AbbrevTable> >
+      TableMap;
+
+  TableMap tables_;
+  uint64_t hits_;
+  uint64_t misses_;
 };
 
 // A Reader for a .dwp file.  Supports the fetching of DWARF debug
@@ -609,20 +727,19 @@ class DwpReader {
 
   ~DwpReader();
 
-  // Read the CU index and initialize data members.
+  // Read the CU index and initialize data members, decoding the index's
+  // hash table once so that each lookup is a single probe.
   void Initialize();
 
-  // Read the debug sections for the given dwo_id.
-  void ReadDebugSectionsForCU(uint64_t dwo_id, SectionMap* sections);
+  // Return the debug sections for the given dwo_id, as views into the
+  // mapped .dwp file, or NULL if the file has no usable compilation
+  // unit with that id. The map returned is this reader's own, and is
+  // overwritten by the next call.
+  const SectionMap* SectionsForCU(uint64_t dwo_id);
 
  private:
-  // Search a v1 hash table for "dwo_id".  Returns the slot index
-  // where the dwo_id was found, or -1 if it was not found.
-  int LookupCU(uint64_t dwo_id);
-
-  // Search a v2 hash table for "dwo_id".  Returns the row index
-  // in the offsets and sizes tables, or 0 if it was not found.
-  uint32_t LookupCUv2(uint64_t dwo_id);
+  // Point ENTRY, one of sections_'s, at DATA and SIZE.
+  void SetSection(SectionMap::iterator entry, const char* data, size_t size);
 
   // The ELF reader for the .dwp file.
   ElfReader* elf_reader_;
@@ -676,6 +793,49 @@ class DwpReader {
   size_t info_size_;
   const char* str_offsets_data_;
   size_t str_offsets_size_;
+
+  // The decoded hash table: a map from each dwo_id in the file to the
+  // value of its index table entry, which is a position in the section
+  // index pool (version 1) or a row of the section tables (version 2).
+  std::unordered_map<uint64_t, uint32_t> units_;
+
+  // The sections SectionsForCU returns, and their entries. The map's
+  // keys are made once; each call only repoints the entries.
+  SectionMap sections_;
+  SectionMap::iterator abbrev_entry_;
+  SectionMap::iterator info_entry_;
+  SectionMap::iterator str_offsets_entry_;
+};
+
+// The .dwp packages opened by the CompilationUnits reading a single
+// file, keyed by the path of the file they belong to. Without a cache,
+// each skeleton compilation unit finds, maps and indexes its package
+// afresh; with one, that happens once per file. The cache is not
+// thread-safe.
+class DwpCache {
+ public:
+  // An open .dwp package: its path, a ByteReader for its contents, and
+  // a DwpReader indexing it.
+  struct Package {
+    string path;
+    std::unique_ptr<ByteReader> byte_reader;
+    std::unique_ptr<DwpReader> reader;
+  };
+
+  // Return the package holding the split DWARF for the file at PATH,
+  // whose contents have ENDIANNESS: PATH with ".dwp" appended, or PATH
+  // with a ".debug" suffix replaced by ".dwp". Open the package the
+  // first time PATH is asked for. Return NULL if there is no usable
+  // package.
+  Package* Find(const string& path, enum Endianness endianness);
+
+ private:
+  typedef std::map<string, std::unique_ptr<Package> > PackageMap;
+
+  // Open the package for PATH, or return NULL if there isn't one.
+  static Package* Open(const string& path, enum Endianness endianness);
+
+  PackageMap packages_;
 };
 
 // This class is a reader for DWARF's Call Frame Information.  CFI
@@ -31,7 +31,9 @@
 
 // dwarf2reader_die_unittest.cc: Unit tests for dwarf2reader::CompilationUnit
 
+#include <elf.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #include <iostream>
@@ -42,6 +44,8 @@
 #include "common/dwarf/bytereader-inl.h"
 #include "common/dwarf/dwarf2reader_test_common.h"
 #include "common/dwarf/dwarf2reader.h"
+#include "common/linux/synth_elf.h"
+#include "common/tests/auto_tempdir.h"
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
 
@@ -78,6 +82,7 @@ class MockDwarf2Handler: public Dwarf2Handler {
                                           uint64_t cu_length,
                                           uint8_t dwarf_version));
   MOCK_METHOD2(StartDIE, bool(uint64_t offset, enum DwarfTag tag));
+  MOCK_METHOD0(SkipChildrenOfSkippedDIEs, bool());
   MOCK_METHOD4(ProcessAttributeUnsigned, void(uint64_t offset,
                                               DwarfAttribute attr,
                                               enum DwarfForm form,
@@ -116,6 +121,8 @@ struct DIEFixture {
     // Default expectations for the data handler.
     EXPECT_CALL(handler, StartCompilationUnit(_, _, _, _, _)).Times(0);
     EXPECT_CALL(handler, StartDIE(_, _)).Times(0);
+    EXPECT_CALL(handler, SkipChildrenOfSkippedDIEs())
+        .WillRepeatedly(Return(false));
     EXPECT_CALL(handler, ProcessAttributeUnsigned(_, _, _, _)).Times(0);
     EXPECT_CALL(handler, ProcessAttributeSigned(_, _, _, _)).Times(0);
     EXPECT_CALL(handler, ProcessAttributeReference(_, _, _, _)).Times(0);
@@ -231,6 +238,245 @@ INSTANTIATE_TEST_CASE_P(
                       DwarfHeaderParams(kBigEndian,    8, 4, 4),
                       DwarfHeaderParams(kBigEndian,    8, 4, 8)));
 
+// Compilation units sharing an AbbrevCache should parse each
+// abbreviation table once, and read their DIEs identically.
+TEST_P(DwarfHeader, SharedAbbrevCache) {
+  Label abbrev_table = abbrevs.Here();
+  abbrevs.Abbrev(1, dwarf2reader::DW_TAG_compile_unit,
+                 dwarf2reader::DW_children_no)
+      .Attribute(dwarf2reader::DW_AT_name, dwarf2reader::DW_FORM_string)
+      .EndAbbrev()
+      .EndTable();
+
+  info.set_format_size(GetParam().format_size);
+  info.set_endianness(GetParam().endianness);
+
+  info.Header(GetParam().version, abbrev_table, GetParam().address_size)
+      .ULEB128(1)                     // DW_TAG_compile_unit, no children
+      .AppendCString("sam");          // DW_AT_name, DW_FORM_string
+  info.Finish();
+
+  EXPECT_CALL(handler, StartCompilationUnit(0, _, _, _, _))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(handler, StartDIE(_, dwarf2reader::DW_TAG_compile_unit))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(handler, ProcessAttributeString(_, dwarf2reader::DW_AT_name,
+                                              dwarf2reader::DW_FORM_string,
+                                              "sam"))
+      .Times(2);
+  EXPECT_CALL(handler, EndDIE(_)).Times(2);
+
+  ByteReader byte_reader(GetParam().endianness == kLittleEndian ?
+                         ENDIANNESS_LITTLE : ENDIANNESS_BIG);
+  const SectionMap& section_map = MakeSectionMap();
+  dwarf2reader::AbbrevCache cache;
+  for (int i = 0; i < 2; i++) {
+    CompilationUnit parser("", section_map, 0, &byte_reader, &handler);
+    parser.SetAbbrevCache(&cache);
+    EXPECT_EQ(parser.Start(), info_contents.size());
+  }
+  EXPECT_EQ(1U, cache.size());
+  EXPECT_EQ(1U, cache.misses());
+  EXPECT_EQ(1U, cache.hits());
+}
+
+// A handler that skips a DIE's children along with the DIE itself
+// should hear nothing of the subtree but the DIE's end, whether the
+// reader jumps over it using DW_AT_sibling or walks it.
+TEST_P(DwarfHeader, SkipSubtrees) {
+  Label abbrev_table = abbrevs.Here();
+  abbrevs.Abbrev(1, dwarf2reader::DW_TAG_compile_unit,
+                 dwarf2reader::DW_children_yes)
+      .Attribute(dwarf2reader::DW_AT_name, dwarf2reader::DW_FORM_string)
+      .EndAbbrev()
+      .Abbrev(2, dwarf2reader::DW_TAG_structure_type,
+              dwarf2reader::DW_children_yes)
+      .Attribute(dwarf2reader::DW_AT_sibling, dwarf2reader::DW_FORM_ref4)
+      .Attribute(dwarf2reader::DW_AT_name, dwarf2reader::DW_FORM_string)
+      .EndAbbrev()
+      .Abbrev(3, dwarf2reader::DW_TAG_member, dwarf2reader::DW_children_no)
+      .Attribute(dwarf2reader::DW_AT_low_pc, dwarf2reader::DW_FORM_addr)
+      .Attribute(dwarf2reader::DW_AT_byte_size, dwarf2reader::DW_FORM_data4)
+      .Attribute(dwarf2reader::DW_AT_stmt_list,
+                 dwarf2reader::DW_FORM_sec_offset)
+      .EndAbbrev()
+      .Abbrev(4, dwarf2reader::DW_TAG_namespace, dwarf2reader::DW_children_yes)
+      .Attribute(dwarf2reader::DW_AT_decl_line, dwarf2reader::DW_FORM_data2)
+      .EndAbbrev()
+      .Abbrev(5, dwarf2reader::DW_TAG_class_type,
+              dwarf2reader::DW_children_yes)
+      .Attribute(dwarf2reader::DW_AT_name, dwarf2reader::DW_FORM_string)
+      .Attribute(dwarf2reader::DW_AT_sibling, dwarf2reader::DW_FORM_ref2)
+      .EndAbbrev()
+      .Abbrev(6, dwarf2reader::DW_TAG_base_type, dwarf2reader::DW_children_no)
+      .Attribute(dwarf2reader::DW_AT_name, dwarf2reader::DW_FORM_string)
+      .EndAbbrev()
+      .EndTable();
+
+  info.set_format_size(GetParam().format_size);
+  info.set_endianness(GetParam().endianness);
+
+  Label struct_sibling, class_sibling;
+  Label struct_die, namespace_die, base_die;
+  info.Header(GetParam().version, abbrev_table, GetParam().address_size)
+      .ULEB128(1)                     // DW_TAG_compile_unit, with children
+      .AppendCString("cu")            // DW_AT_name, DW_FORM_string
+      .Mark(&struct_die)
+      .ULEB128(2)                     // DW_TAG_structure_type, with children
+      .D32(struct_sibling)            // DW_AT_sibling, DW_FORM_ref4
+      .AppendCString("s")             // DW_AT_name, DW_FORM_string
+      .ULEB128(3)                     // DW_TAG_member, no children
+      .Append(GetParam().address_size, 0x5a)  // DW_AT_low_pc
+      .D32(0x12345678);               // DW_AT_byte_size
+  info.SectionOffset(0);              // DW_AT_stmt_list
+  info.D8(0)                          // end of structure_type's children
+      .Mark(&struct_sibling)
+      .Mark(&namespace_die)
+      .ULEB128(4)                     // DW_TAG_namespace, with children
+      .D16(0x1234)                    // DW_AT_decl_line, DW_FORM_data2
+      .ULEB128(5)                     // DW_TAG_class_type, with children
+      .AppendCString("c")             // DW_AT_name, DW_FORM_string
+      .D16(class_sibling)             // DW_AT_sibling, DW_FORM_ref2
+      .ULEB128(6)                     // DW_TAG_base_type, no children
+      .AppendCString("x")             // DW_AT_name, DW_FORM_string
+      .D8(0)                          // end of class_type's children
+      .Mark(&class_sibling)
+      .ULEB128(3)                     // DW_TAG_member, no children
+      .Append(GetParam().address_size, 0xa5)  // DW_AT_low_pc
+      .D32(0x87654321);               // DW_AT_byte_size
+  info.SectionOffset(0);              // DW_AT_stmt_list
+  info.D8(0)                          // end of namespace's children
+      .Mark(&base_die)
+      .ULEB128(6)                     // DW_TAG_base_type, no children
+      .AppendCString("int")           // DW_AT_name, DW_FORM_string
+      .D8(0);                         // end of compile_unit's children
+  info.Finish();
+
+  EXPECT_CALL(handler, SkipChildrenOfSkippedDIEs())
+      .WillRepeatedly(Return(true));
+  {
+    InSequence s;
+    EXPECT_CALL(handler, StartCompilationUnit(0, _, _, _, _))
+        .WillOnce(Return(true));
+    EXPECT_CALL(handler, StartDIE(_, dwarf2reader::DW_TAG_compile_unit))
+        .WillOnce(Return(true));
+    EXPECT_CALL(handler, ProcessAttributeString(_, dwarf2reader::DW_AT_name,
+                                                dwarf2reader::DW_FORM_string,
+                                                "cu"))
+        .WillOnce(Return());
+    EXPECT_CALL(handler, StartDIE(struct_die.Value(),
+                                  dwarf2reader::DW_TAG_structure_type))
+        .WillOnce(Return(false));
+    EXPECT_CALL(handler, EndDIE(struct_die.Value()))
+        .WillOnce(Return());
+    EXPECT_CALL(handler, StartDIE(namespace_die.Value(),
+                                  dwarf2reader::DW_TAG_namespace))
+        .WillOnce(Return(false));
+    EXPECT_CALL(handler, EndDIE(namespace_die.Value()))
+        .WillOnce(Return());
+    EXPECT_CALL(handler, StartDIE(base_die.Value(),
+                                  dwarf2reader::DW_TAG_base_type))
+        .WillOnce(Return(true));
+    EXPECT_CALL(handler, ProcessAttributeString(_, dwarf2reader::DW_AT_name,
+                                                dwarf2reader::DW_FORM_string,
+                                                "int"))
+        .WillOnce(Return());
+    EXPECT_CALL(handler, EndDIE(base_die.Value()))
+        .WillOnce(Return());
+    EXPECT_CALL(handler, EndDIE(_))
+        .WillOnce(Return());
+  }
+
+  ByteReader byte_reader(GetParam().endianness == kLittleEndian ?
+                         ENDIANNESS_LITTLE : ENDIANNESS_BIG);
+  CompilationUnit parser("", MakeSectionMap(), 0, &byte_reader, &handler);
+  EXPECT_EQ(parser.Start(), info_contents.size());
+}
+
+// A DwpCache should open a version 2 package once, and find each
+// unit's contributions to the package's sections.
+TEST(DwpCache, Version2) {
+  using google_breakpad::synth_elf::ELF;
+  Section cu_index(kLittleEndian);
+  cu_index.D32(2)                       // version
+      .D32(3)                           // columns
+      .D32(2)                           // units
+      .D32(4)                           // hash slots
+      .D64(0).D64(0x1111).D64(0x2222).D64(0)     // hashes
+      .D32(0).D32(1).D32(2).D32(0)               // unit rows
+      .D32(dwarf2reader::DW_SECT_INFO)           // column section ids
+      .D32(dwarf2reader::DW_SECT_ABBREV)
+      .D32(dwarf2reader::DW_SECT_STR_OFFSETS)
+      .D32(0).D32(0).D32(0)                      // unit 1 offsets
+      .D32(12).D32(4).D32(8)                     // unit 2 offsets
+      .D32(12).D32(4).D32(8)                     // unit 1 sizes
+      .D32(20).D32(6).D32(4);                    // unit 2 sizes
+  Section debug_info(kLittleEndian);
+  debug_info.Append(32, 0);
+  Section debug_abbrev(kLittleEndian);
+  debug_abbrev.Append(10, 0);
+  Section debug_str_offsets(kLittleEndian);
+  debug_str_offsets.Append(12, 0);
+  Section debug_str(kLittleEndian);
+  debug_str.AppendCString("dwo");
+
+  ELF elf(EM_X86_64, ELFCLASS64, kLittleEndian);
+  elf.AddSection(".debug_cu_index", cu_index, SHT_PROGBITS);
+  elf.AddSection(".debug_info.dwo", debug_info, SHT_PROGBITS);
+  elf.AddSection(".debug_abbrev.dwo", debug_abbrev, SHT_PROGBITS);
+  elf.AddSection(".debug_str_offsets.dwo", debug_str_offsets, SHT_PROGBITS);
+  elf.AddSection(".debug_str.dwo", debug_str, SHT_PROGBITS);
+  elf.Finish();
+  string contents;
+  ASSERT_TRUE(elf.GetContents(&contents));
+
+  google_breakpad::AutoTempDir temp_dir;
+  const string path = temp_dir.path() + "/binary";
+  FILE* file = fopen((path + ".dwp").c_str(), "wb");
+  ASSERT_TRUE(file);
+  ASSERT_EQ(contents.size(),
+            fwrite(contents.data(), 1, contents.size(), file));
+  fclose(file);
+
+  dwarf2reader::DwpCache cache;
+  dwarf2reader::DwpCache::Package* package =
+      cache.Find(path, ENDIANNESS_LITTLE);
+  ASSERT_TRUE(package);
+  EXPECT_EQ(path + ".dwp", package->path);
+  EXPECT_EQ(package, cache.Find(path, ENDIANNESS_LITTLE));
+  EXPECT_FALSE(cache.Find(temp_dir.path() + "/other", ENDIANNESS_LITTLE));
+
+  const SectionMap* sections = package->reader->SectionsForCU(0x2222);
+  ASSERT_TRUE(sections);
+  SectionMap::const_iterator info = sections->find(".debug_info");
+  SectionMap::const_iterator abbrev = sections->find(".debug_abbrev");
+  SectionMap::const_iterator str_offsets =
+      sections->find(".debug_str_offsets");
+  SectionMap::const_iterator str = sections->find(".debug_str");
+  ASSERT_TRUE(info != sections->end());
+  ASSERT_TRUE(abbrev != sections->end());
+  ASSERT_TRUE(str_offsets != sections->end());
+  ASSERT_TRUE(str != sections->end());
+  EXPECT_EQ(20U, info->second.second);
+  EXPECT_EQ(6U, abbrev->second.second);
+  EXPECT_EQ(4U, str_offsets->second.second);
+  EXPECT_EQ(4U, str->second.second);
+  EXPECT_STREQ("dwo", reinterpret_cast<const char*>(str->second.first));
+
+  // The other unit's contributions start where unit 2's offsets say.
+  const uint8_t* info_2 = info->second.first;
+  const uint8_t* abbrev_2 = abbrev->second.first;
+  sections = package->reader->SectionsForCU(0x1111);
+  ASSERT_TRUE(sections);
+  EXPECT_EQ(info_2 - 12, sections->find(".debug_info")->second.first);
+  EXPECT_EQ(12U, sections->find(".debug_info")->second.second);
+  EXPECT_EQ(abbrev_2 - 4, sections->find(".debug_abbrev")->second.first);
+
+  EXPECT_FALSE(package->reader->SectionsForCU(0x3333));
+}
+
 struct DwarfFormsFixture: public DIEFixture {
   // Start a compilation unit, as directed by |params|, containing one
   // childless DIE of the given tag, with one attribute of the given name
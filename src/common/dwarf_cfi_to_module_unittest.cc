@@ -80,7 +80,7 @@ struct DwarfCFIToModuleFixture {
   vector<string> register_names;
   MockCFIReporter reporter;
   DwarfCFIToModule handler;
-  vector<Module::StackFrameEntry *> entries;
+  vector<Module::StackFrameEntry> entries;
 };
 
 class Entry: public DwarfCFIToModuleFixture, public Test { };
@@ -91,10 +91,10 @@ TEST_F(Entry, Accept) {
   ASSERT_TRUE(handler.End());
   module.GetStackFrameEntries(&entries);
   EXPECT_EQ(1U, entries.size());
-  EXPECT_EQ(0xa21069698096fc98ULL, entries[0]->address);
-  EXPECT_EQ(0xb440ce248169c8d6ULL, entries[0]->size);
-  EXPECT_EQ(0U, entries[0]->initial_rules.size());
-  EXPECT_EQ(0U, entries[0]->rule_changes.size());
+  EXPECT_EQ(0xa21069698096fc98ULL, entries[0].address);
+  EXPECT_EQ(0xb440ce248169c8d6ULL, entries[0].size);
+  EXPECT_EQ(0U, entries[0].initial_rules.size());
+  EXPECT_EQ(0U, entries[0].rule_changes.size());
 }
 
 TEST_F(Entry, AcceptOldVersion) {
@@ -103,10 +103,10 @@ TEST_F(Entry, AcceptOldVersion) {
   ASSERT_TRUE(handler.End());
   module.GetStackFrameEntries(&entries);
   EXPECT_EQ(1U, entries.size());
-  EXPECT_EQ(0x75b8806bb09eab78ULL, entries[0]->address);
-  EXPECT_EQ(0xc771f44958d40bbcULL, entries[0]->size);
-  EXPECT_EQ(0U, entries[0]->initial_rules.size());
-  EXPECT_EQ(0U, entries[0]->rule_changes.size());
+  EXPECT_EQ(0x75b8806bb09eab78ULL, entries[0].address);
+  EXPECT_EQ(0xc771f44958d40bbcULL, entries[0].size);
+  EXPECT_EQ(0U, entries[0].initial_rules.size());
+  EXPECT_EQ(0U, entries[0].rule_changes.size());
 }
 
 struct RuleFixture: public DwarfCFIToModuleFixture {
@@ -122,8 +122,8 @@ struct RuleFixture: public DwarfCFIToModuleFixture {
   void CheckEntry() {
     module.GetStackFrameEntries(&entries);
     EXPECT_EQ(1U, entries.size());
-    EXPECT_EQ(entry_address, entries[0]->address);
-    EXPECT_EQ(entry_size, entries[0]->size);
+    EXPECT_EQ(entry_address, entries[0].address);
+    EXPECT_EQ(entry_size, entries[0].size);
   }
   uint64_t entry_address, entry_size;
   unsigned return_reg;
@@ -137,8 +137,8 @@ TEST_F(Rule, UndefinedRule) {
   ASSERT_TRUE(handler.UndefinedRule(entry_address, 7));
   ASSERT_TRUE(handler.End());
   CheckEntry();
-  EXPECT_EQ(0U, entries[0]->initial_rules.size());
-  EXPECT_EQ(0U, entries[0]->rule_changes.size());
+  EXPECT_EQ(0U, entries[0].initial_rules.size());
+  EXPECT_EQ(0U, entries[0].rule_changes.size());
 }
 
 TEST_F(Rule, RegisterWithEmptyName) {
@@ -148,8 +148,8 @@ TEST_F(Rule, RegisterWithEmptyName) {
   ASSERT_TRUE(handler.UndefinedRule(entry_address, 10));
   ASSERT_TRUE(handler.End());
   CheckEntry();
-  EXPECT_EQ(0U, entries[0]->initial_rules.size());
-  EXPECT_EQ(0U, entries[0]->rule_changes.size());
+  EXPECT_EQ(0U, entries[0].initial_rules.size());
+  EXPECT_EQ(0U, entries[0].rule_changes.size());
 }
 
 TEST_F(Rule, SameValueRule) {
@@ -159,8 +159,8 @@ TEST_F(Rule, SameValueRule) {
   CheckEntry();
   Module::RuleMap expected_initial;
   expected_initial["reg6"] = "reg6";
-  EXPECT_THAT(entries[0]->initial_rules, ContainerEq(expected_initial));
-  EXPECT_EQ(0U, entries[0]->rule_changes.size());
+  EXPECT_THAT(entries[0].initial_rules, ContainerEq(expected_initial));
+  EXPECT_EQ(0U, entries[0].rule_changes.size());
 }
 
 TEST_F(Rule, OffsetRule) {
@@ -170,10 +170,10 @@ TEST_F(Rule, OffsetRule) {
                                  16927065));
   ASSERT_TRUE(handler.End());
   CheckEntry();
-  EXPECT_EQ(0U, entries[0]->initial_rules.size());
+  EXPECT_EQ(0U, entries[0].initial_rules.size());
   Module::RuleChangeMap expected_changes;
   expected_changes[entry_address + 1][".ra"] = ".cfa 16927065 + ^";
-  EXPECT_THAT(entries[0]->rule_changes, ContainerEq(expected_changes));
+  EXPECT_THAT(entries[0].rule_changes, ContainerEq(expected_changes));
 }
 
 TEST_F(Rule, OffsetRuleNegative) {
@@ -182,10 +182,10 @@ TEST_F(Rule, OffsetRuleNegative) {
                                  DwarfCFIToModule::kCFARegister, 4, -34530721));
   ASSERT_TRUE(handler.End());
   CheckEntry();
-  EXPECT_EQ(0U, entries[0]->initial_rules.size());
+  EXPECT_EQ(0U, entries[0].initial_rules.size());
   Module::RuleChangeMap expected_changes;
   expected_changes[entry_address + 1][".cfa"] = "reg4 -34530721 + ^";
-  EXPECT_THAT(entries[0]->rule_changes, ContainerEq(expected_changes));
+  EXPECT_THAT(entries[0].rule_changes, ContainerEq(expected_changes));
 }
 
 TEST_F(Rule, ValOffsetRule) {
@@ -197,11 +197,11 @@ TEST_F(Rule, ValOffsetRule) {
                                     11, 61812979));
   ASSERT_TRUE(handler.End());
   CheckEntry();
-  EXPECT_EQ(0U, entries[0]->initial_rules.size());
+  EXPECT_EQ(0U, entries[0].initial_rules.size());
   Module::RuleChangeMap expected_changes;
   expected_changes[entry_address + 0x5ab7][".cfa"] =
       "unnamed_register11 61812979 +";
-  EXPECT_THAT(entries[0]->rule_changes, ContainerEq(expected_changes));
+  EXPECT_THAT(entries[0].rule_changes, ContainerEq(expected_changes));
 }
 
 TEST_F(Rule, RegisterRule) {
@@ -211,8 +211,8 @@ TEST_F(Rule, RegisterRule) {
   CheckEntry();
   Module::RuleMap expected_initial;
   expected_initial[".ra"] = "reg3";
-  EXPECT_THAT(entries[0]->initial_rules, ContainerEq(expected_initial));
-  EXPECT_EQ(0U, entries[0]->rule_changes.size());
+  EXPECT_THAT(entries[0].initial_rules, ContainerEq(expected_initial));
+  EXPECT_EQ(0U, entries[0].rule_changes.size());
 }
 
 TEST_F(Rule, ExpressionRule) {
@@ -222,8 +222,8 @@ TEST_F(Rule, ExpressionRule) {
                                      "it takes two to tango"));
   ASSERT_TRUE(handler.End());
   CheckEntry();
-  EXPECT_EQ(0U, entries[0]->initial_rules.size());
-  EXPECT_EQ(0U, entries[0]->rule_changes.size());
+  EXPECT_EQ(0U, entries[0].initial_rules.size());
+  EXPECT_EQ(0U, entries[0].rule_changes.size());
 }
 
 TEST_F(Rule, ValExpressionRule) {
@@ -233,8 +233,8 @@ TEST_F(Rule, ValExpressionRule) {
                                         "bit off more than he could chew"));
   ASSERT_TRUE(handler.End());
   CheckEntry();
-  EXPECT_EQ(0U, entries[0]->initial_rules.size());
-  EXPECT_EQ(0U, entries[0]->rule_changes.size());
+  EXPECT_EQ(0U, entries[0].initial_rules.size());
+  EXPECT_EQ(0U, entries[0].rule_changes.size());
 }
 
 TEST_F(Rule, DefaultReturnAddressRule) {
@@ -246,8 +246,8 @@ TEST_F(Rule, DefaultReturnAddressRule) {
   Module::RuleMap expected_initial;
   expected_initial[".ra"] = "reg2";
   expected_initial["reg0"] = "reg1";
-  EXPECT_THAT(entries[0]->initial_rules, ContainerEq(expected_initial));
-  EXPECT_EQ(0U, entries[0]->rule_changes.size());
+  EXPECT_THAT(entries[0].initial_rules, ContainerEq(expected_initial));
+  EXPECT_EQ(0U, entries[0].rule_changes.size());
 }
 
 TEST_F(Rule, DefaultReturnAddressRuleOverride) {
@@ -258,8 +258,8 @@ TEST_F(Rule, DefaultReturnAddressRuleOverride) {
   CheckEntry();
   Module::RuleMap expected_initial;
   expected_initial[".ra"] = "reg1";
-  EXPECT_THAT(entries[0]->initial_rules, ContainerEq(expected_initial));
-  EXPECT_EQ(0U, entries[0]->rule_changes.size());
+  EXPECT_THAT(entries[0].initial_rules, ContainerEq(expected_initial));
+  EXPECT_EQ(0U, entries[0].rule_changes.size());
 }
 
 TEST_F(Rule, DefaultReturnAddressRuleLater) {
@@ -270,10 +270,10 @@ TEST_F(Rule, DefaultReturnAddressRuleLater) {
   CheckEntry();
   Module::RuleMap expected_initial;
   expected_initial[".ra"] = "reg2";
-  EXPECT_THAT(entries[0]->initial_rules, ContainerEq(expected_initial));
+  EXPECT_THAT(entries[0].initial_rules, ContainerEq(expected_initial));
   Module::RuleChangeMap expected_changes;
   expected_changes[entry_address + 1][".ra"] = "reg1";
-  EXPECT_THAT(entries[0]->rule_changes, ContainerEq(expected_changes));
+  EXPECT_THAT(entries[0].rule_changes, ContainerEq(expected_changes));
 }
 
 TEST(RegisterNames, I386) {
@@ -0,0 +1,834 @@
+// Copyright (c) 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// dwarf_cu_cache.cc: Implementation of DwarfCUCache.
+// See dwarf_cu_cache.h for details.
+
+#include "common/dwarf_cu_cache.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "common/byte_cursor.h"
+#include "common/dwarf/bytereader-inl.h"
+#include "common/md5.h"
+
+namespace google_breakpad {
+
+namespace {
+
+using dwarf2reader::DwarfAttribute;
+using dwarf2reader::DwarfForm;
+using dwarf2reader::DwarfTag;
+
+// The first bytes of every cache entry. Change this whenever the
+// format of entries, or what DwarfCUToModule extracts from a given
+// compilation unit, changes; and make keys cover whatever new data it
+// reads.
+const char kEntryMagic[8] = "BPCUC03";
+
+// Append the SIZE low-order bytes of VALUE to OUT, little-endian.
+void AppendValue(string *out, uint64_t value, size_t size) {
+  for (size_t i = 0; i < size; i++)
+    out->push_back(static_cast<char>(value >> (8 * i)));
+}
+
+// Add the SIZE low-order bytes of VALUE to CONTEXT, little-endian.
+void AddValue(MD5Context *context, uint64_t value, size_t size) {
+  uint8_t bytes[8];
+  for (size_t i = 0; i < size; i++)
+    bytes[i] = static_cast<uint8_t>(value >> (8 * i));
+  MD5Update(context, bytes, size);
+}
+
+// Add SIZE bytes at DATA to CONTEXT, preceded by their count.
+void AddBytes(MD5Context *context, const uint8_t *data, uint64_t size) {
+  AddValue(context, size, 8);
+  MD5Update(context, data, size);
+}
+
+// Finish CONTEXT's digest, and store it in DIGEST.
+void FinishDigest(MD5Context *context, uint8_t digest[16]) {
+  // MD5Final stores the bit count over part of the last block it is
+  // given (and common/mac/macho_id.cc's identifiers depend on it doing
+  // so), so pad the data out to a whole block first.
+  static const uint8_t kZeros[64] = { 0 };
+  MD5Update(context, kZeros, 64 - ((context->bits[0] >> 3) & 0x3f));
+  MD5Final(digest, context);
+}
+
+// Find the section named NAME in SECTIONS, setting *START and *SIZE to
+// its contents. Return false if there is no such section.
+bool FindSection(const dwarf2reader::SectionMap &sections, const char *name,
+                 const uint8_t **start, uint64_t *size) {
+  dwarf2reader::SectionMap::const_iterator it = sections.find(name);
+  if (it == sections.end())
+    return false;
+  *start = it->second.first;
+  *size = it->second.second;
+  return true;
+}
+
+// Read an unsigned LEB128 number at *PTR into *VALUE, and advance *PTR
+// past it. Return false if it runs past END.
+bool ReadLEB128(dwarf2reader::ByteReader *reader, const uint8_t **ptr,
+                const uint8_t *end, uint64_t *value) {
+  const uint8_t *last = *ptr;
+  while (last < end && (*last & 0x80))
+    last++;
+  if (last >= end)
+    return false;
+  size_t len;
+  *value = reader->ReadUnsignedLEB128(*ptr, &len);
+  *ptr += len;
+  return true;
+}
+
+// Advance *PTR past an attribute value of form FORM in a unit of
+// version VERSION with ADDRESS_SIZE-byte addresses, reading with
+// READER. Return false if the value runs past END, or has a form the
+// root DIEs of DWARF 2 to 4 units don't use.
+bool SkipForm(dwarf2reader::ByteReader *reader, uint64_t form,
+              uint16_t version, uint8_t address_size,
+              const uint8_t **ptr, const uint8_t *end) {
+  uint64_t size = 0, value;
+  switch (form) {
+    case dwarf2reader::DW_FORM_flag_present:
+      return true;
+    case dwarf2reader::DW_FORM_data1:
+    case dwarf2reader::DW_FORM_flag:
+    case dwarf2reader::DW_FORM_ref1:
+      size = 1;
+      break;
+    case dwarf2reader::DW_FORM_data2:
+    case dwarf2reader::DW_FORM_ref2:
+      size = 2;
+      break;
+    case dwarf2reader::DW_FORM_data4:
+    case dwarf2reader::DW_FORM_ref4:
+      size = 4;
+      break;
+    case dwarf2reader::DW_FORM_data8:
+    case dwarf2reader::DW_FORM_ref8:
+    case dwarf2reader::DW_FORM_ref_sig8:
+      size = 8;
+      break;
+    case dwarf2reader::DW_FORM_addr:
+      size = address_size;
+      break;
+    case dwarf2reader::DW_FORM_ref_addr:
+      size = version <= 2 ? address_size : reader->OffsetSize();
+      break;
+    case dwarf2reader::DW_FORM_strp:
+    case dwarf2reader::DW_FORM_sec_offset:
+      size = reader->OffsetSize();
+      break;
+    case dwarf2reader::DW_FORM_string: {
+      const uint8_t *nul = *ptr;
+      while (nul < end && *nul)
+        nul++;
+      size = nul + 1 - *ptr;
+      break;
+    }
+    case dwarf2reader::DW_FORM_udata:
+    case dwarf2reader::DW_FORM_sdata:
+    case dwarf2reader::DW_FORM_ref_udata:
+    case dwarf2reader::DW_FORM_GNU_addr_index:
+    case dwarf2reader::DW_FORM_GNU_str_index:
+      return ReadLEB128(reader, ptr, end, &value);
+    case dwarf2reader::DW_FORM_block1:
+      if (*ptr + 1 > end)
+        return false;
+      size = 1 + reader->ReadOneByte(*ptr);
+      break;
+    case dwarf2reader::DW_FORM_block2:
+      if (*ptr + 2 > end)
+        return false;
+      size = 2 + reader->ReadTwoBytes(*ptr);
+      break;
+    case dwarf2reader::DW_FORM_block4:
+      if (*ptr + 4 > end)
+        return false;
+      size = 4 + reader->ReadFourBytes(*ptr);
+      break;
+    case dwarf2reader::DW_FORM_block:
+    case dwarf2reader::DW_FORM_exprloc:
+      if (!ReadLEB128(reader, ptr, end, &size))
+        return false;
+      break;
+    case dwarf2reader::DW_FORM_indirect:
+      return ReadLEB128(reader, ptr, end, &value) &&
+             value != dwarf2reader::DW_FORM_indirect &&
+             SkipForm(reader, value, version, address_size, ptr, end);
+    default:
+      return false;
+  }
+  if (size > static_cast<uint64_t>(end - *ptr))
+    return false;
+  *ptr += size;
+  return true;
+}
+
+// The data a compilation unit's key covers, gathered into one string.
+// Addresses are noted as they are added, and made relative to the
+// unit's base address --- the first nonzero one added --- when the key
+// is finished, so that a unit whose code merely moves keeps its key.
+class KeyData {
+ public:
+  KeyData() : base_(0), absolute_(false) { }
+
+  // Add the SIZE low-order bytes of VALUE.
+  void AddValue(uint64_t value, size_t size) {
+    AppendValue(&data_, value, size);
+  }
+
+  // Add SIZE bytes at DATA, preceded by their count.
+  void AddBytes(const uint8_t *data, uint64_t size) {
+    AppendValue(&data_, size, 8);
+    data_.append(reinterpret_cast<const char *>(data), size);
+  }
+
+  // Add ADDRESS, which is made relative to the base address later.
+  void AddAddress(uint64_t address) {
+    if (base_ == 0)
+      base_ = address;
+    addresses_.push_back(data_.size());
+    AppendValue(&data_, address, 8);
+  }
+
+  // Leave the addresses as they are: the unit has others, in sections
+  // all units share, that the key covers as they are.
+  void KeepAddressesAbsolute() { absolute_ = true; }
+
+  // The address the key's addresses are relative to.
+  uint64_t base() const { return absolute_ ? 0 : base_; }
+
+  // Compute the digest of the data, and store it in DIGEST.
+  void Finish(uint8_t digest[16]) {
+    const uint64_t base = this->base();
+    for (size_t i = 0; i < addresses_.size(); i++) {
+      uint64_t address = 0;
+      for (size_t j = 0; j < 8; j++)
+        address |= static_cast<uint64_t>(
+            static_cast<uint8_t>(data_[addresses_[i] + j])) << (8 * j);
+      address -= base;
+      for (size_t j = 0; j < 8; j++)
+        data_[addresses_[i] + j] = static_cast<char>(address >> (8 * j));
+    }
+    MD5Context context;
+    MD5Init(&context);
+    MD5Update(&context, reinterpret_cast<const uint8_t *>(data_.data()),
+              data_.size());
+    FinishDigest(&context, digest);
+  }
+
+ private:
+  string data_;
+  vector<size_t> addresses_;
+  uint64_t base_;
+  bool absolute_;
+};
+
+// Read a SIZE-byte value at PTR with READER. SIZE must be 4 or 8.
+uint64_t ReadValue(dwarf2reader::ByteReader *reader, const uint8_t *ptr,
+                   size_t size) {
+  return size == 4 ? reader->ReadFourBytes(ptr) : reader->ReadEightBytes(ptr);
+}
+
+// Add to DATA the line number program at OFFSET in .debug_line in
+// SECTIONS, reading with READER, with the operands of its
+// DW_LNE_set_address instructions as addresses. Return false if there
+// is no such program.
+bool AddLineProgram(const dwarf2reader::SectionMap &sections,
+                    dwarf2reader::ByteReader *reader, uint64_t offset,
+                    KeyData *data) {
+  const uint8_t *line;
+  uint64_t line_size;
+  if (!FindSection(sections, ".debug_line", &line, &line_size) ||
+      offset + 4 > line_size)
+    return false;
+  size_t offset_size = 4;
+  uint64_t program_length = reader->ReadFourBytes(line + offset);
+  if (program_length == 0xffffffff) {
+    offset_size = 8;
+    program_length = offset + 12 <= line_size ?
+        reader->ReadEightBytes(line + offset + 4) : 0;
+  }
+  const uint64_t header_size = offset_size == 4 ? 4 : 12;
+  program_length = std::min(program_length + header_size,
+                            line_size - offset);
+  const uint8_t *program = line + offset;
+  const uint8_t *end = program + program_length;
+
+  // Find the instructions, and the operand counts of the standard ones.
+  const uint8_t *ptr = program + header_size;
+  uint16_t version = 0;
+  if (ptr + 2 <= end)
+    version = reader->ReadTwoBytes(ptr);
+  const uint8_t *ops = end, *opcode_lengths = NULL;
+  uint8_t opcode_base = 0;
+  if (version >= 2 && version <= 4 &&
+      ptr + 2 + offset_size <= end) {
+    ptr += 2;
+    const uint64_t header_length = ReadValue(reader, ptr, offset_size);
+    ptr += offset_size;
+    const uint8_t *opcode_base_field = ptr + (version >= 4 ? 5 : 4);
+    if (header_length <= static_cast<uint64_t>(end - ptr) &&
+        opcode_base_field < ptr + header_length) {
+      ops = ptr + header_length;
+      opcode_base = *opcode_base_field;
+      opcode_lengths = opcode_base_field + 1;
+      if (opcode_base == 0 || opcode_lengths + opcode_base - 1 > ops)
+        ops = end;
+    }
+  }
+  if (ops == end) {
+    // Cover programs this can't read byte for byte, along with the
+    // strings version 5 programs may refer to.
+    const uint8_t *strings = NULL;
+    uint64_t strings_size = 0;
+    FindSection(sections, ".debug_line_str", &strings, &strings_size);
+    data->AddBytes(strings, strings_size);
+  }
+
+  const uint8_t *covered = program;
+  bool ok = true;
+  for (ptr = ops; ok && ptr < end;) {
+    const uint8_t opcode = *ptr++;
+    uint64_t length;
+    if (opcode >= opcode_base) {
+      // A special opcode.
+    } else if (opcode == 0) {
+      ok = ReadLEB128(reader, &ptr, end, &length) &&
+           length <= static_cast<uint64_t>(end - ptr);
+      if (ok && length > 0 &&
+          *ptr == dwarf2reader::DW_LNE_set_address &&
+          (length == 5 || length == 9)) {
+        data->AddBytes(covered, ptr + 1 - covered);
+        data->AddAddress(ReadValue(reader, ptr + 1, length - 1));
+        covered = ptr + length;
+      }
+      if (ok)
+        ptr += length;
+    } else if (opcode == dwarf2reader::DW_LNS_fixed_advance_pc) {
+      ok = ptr + 2 <= end;
+      ptr += 2;
+    } else {
+      for (uint8_t i = 0; ok && i < opcode_lengths[opcode - 1]; i++)
+        ok = ReadLEB128(reader, &ptr, end, &length);
+    }
+  }
+  data->AddBytes(covered, end - covered);
+  return true;
+}
+
+// Add to DATA the addresses of the range list at OFFSET in
+// .debug_ranges in SECTIONS, which hold ADDRESS_SIZE-byte addresses
+// relative to UNIT_BASE, reading with READER.
+void AddRangeList(const dwarf2reader::SectionMap &sections,
+                  dwarf2reader::ByteReader *reader, uint64_t offset,
+                  uint8_t address_size, uint64_t unit_base, KeyData *data) {
+  const uint8_t *section = NULL;
+  uint64_t size = 0;
+  FindSection(sections, ".debug_ranges", &section, &size);
+  const uint64_t max_address = address_size == 4 ? 0xffffffff : ~0ULL;
+  uint64_t base = unit_base;
+  for (uint64_t entry = offset;
+       entry < size && 2 * address_size <= size - entry;
+       entry += 2 * address_size) {
+    const uint64_t begin = ReadValue(reader, section + entry, address_size);
+    const uint64_t end =
+        ReadValue(reader, section + entry + address_size, address_size);
+    if (begin == 0 && end == 0)
+      break;
+    if (begin == max_address) {
+      // A base address selection entry.
+      base = end;
+      continue;
+    }
+    data->AddValue(1, 1);
+    data->AddAddress(base + begin);
+    data->AddAddress(base + end);
+  }
+  data->AddValue(0, 1);
+}
+
+// Gather into *DATA what the key of the compilation unit at OFFSET in
+// .debug_info in SECTIONS covers, reading with READER, and set *LENGTH
+// to the unit's length. Set *INDEXED if the unit has strings or
+// addresses given by index into the sections all units share, which
+// *DATA doesn't cover. Return false if the unit isn't a well-formed
+// DWARF 2 to 4 unit.
+bool GatherUnit(const dwarf2reader::SectionMap &sections,
+                dwarf2reader::ByteReader *reader, uint64_t offset,
+                KeyData *data, uint64_t *length, bool *indexed) {
+  const uint8_t *info, *abbrev_section;
+  uint64_t info_size, abbrev_size;
+  if (!FindSection(sections, ".debug_info", &info, &info_size) ||
+      !FindSection(sections, ".debug_abbrev", &abbrev_section,
+                   &abbrev_size) ||
+      offset + 4 > info_size)
+    return false;
+  const uint8_t *strings = NULL;
+  uint64_t strings_size = 0;
+  FindSection(sections, ".debug_str", &strings, &strings_size);
+
+  // The unit header.
+  const uint8_t *ptr = info + offset;
+  const uint8_t *info_end = info + info_size;
+  size_t initial_length_size;
+  const uint64_t unit_length =
+      reader->ReadInitialLength(ptr, &initial_length_size);
+  if (initial_length_size > static_cast<uint64_t>(info_end - ptr) ||
+      unit_length > static_cast<uint64_t>(info_end - ptr) -
+                    initial_length_size)
+    return false;
+  const uint8_t *end = ptr + initial_length_size + unit_length;
+  *length = end - ptr;
+  ptr += initial_length_size;
+  if (ptr + 2 + reader->OffsetSize() + 1 > end)
+    return false;
+  const uint16_t version = reader->ReadTwoBytes(ptr);
+  ptr += 2;
+  const uint64_t abbrev_offset = reader->ReadOffset(ptr);
+  ptr += reader->OffsetSize();
+  const uint8_t address_size = reader->ReadOneByte(ptr);
+  ptr++;
+  if (version < 2 || version > 4 ||
+      (address_size != 4 && address_size != 8) ||
+      abbrev_offset >= abbrev_size)
+    return false;
+  // The abbreviation table is covered by its contents, not its offset.
+  data->AddValue(version, 2);
+  data->AddValue(address_size, 1);
+
+  // The unit's abbreviation table, and the attributes of each entry.
+  const uint8_t *abbrev = abbrev_section + abbrev_offset;
+  const uint8_t *abbrev_end = abbrev_section + abbrev_size;
+  std::map<uint64_t, vector<std::pair<uint64_t, uint64_t> > > abbrevs;
+  for (;;) {
+    uint64_t code, tag, name, form;
+    if (!ReadLEB128(reader, &abbrev, abbrev_end, &code))
+      return false;
+    if (code == 0)
+      break;
+    if (!ReadLEB128(reader, &abbrev, abbrev_end, &tag) ||
+        abbrev >= abbrev_end)
+      return false;
+    abbrev++;  // DW_children_yes or DW_children_no.
+    vector<std::pair<uint64_t, uint64_t> > &attributes = abbrevs[code];
+    do {
+      if (!ReadLEB128(reader, &abbrev, abbrev_end, &name) ||
+          !ReadLEB128(reader, &abbrev, abbrev_end, &form))
+        return false;
+      if (name != 0)
+        attributes.push_back(std::make_pair(name, form));
+    } while (name != 0 || form != 0);
+  }
+  data->AddBytes(abbrev_section + abbrev_offset,
+                 abbrev - (abbrev_section + abbrev_offset));
+
+  // The DIEs. Values that lie elsewhere, or that give an address, are
+  // added in place of their bytes, and those DwarfCUToModule doesn't
+  // read are left out; the rest are added as they are.
+  const uint8_t *covered = ptr;
+  bool root = true;
+  uint64_t unit_base = 0;
+  vector<uint64_t> range_lists;
+  while (ptr < end) {
+    uint64_t code;
+    if (!ReadLEB128(reader, &ptr, end, &code))
+      return false;
+    if (code == 0)
+      continue;
+    std::map<uint64_t, vector<std::pair<uint64_t, uint64_t> > >::
+        const_iterator it = abbrevs.find(code);
+    if (it == abbrevs.end())
+      return false;
+    for (size_t i = 0; i < it->second.size(); i++) {
+      const uint64_t attr = it->second[i].first;
+      uint64_t form = it->second[i].second;
+      if (form == dwarf2reader::DW_FORM_indirect &&
+          !ReadLEB128(reader, &ptr, end, &form))
+        return false;
+      const uint8_t *value = ptr;
+      if (!SkipForm(reader, form, version, address_size, &ptr, end))
+        return false;
+      // Readers take these as offsets whatever the unit's version.
+      const bool section_offset =
+          form == dwarf2reader::DW_FORM_sec_offset ||
+          form == dwarf2reader::DW_FORM_data4 ||
+          form == dwarf2reader::DW_FORM_data8;
+      if (form == dwarf2reader::DW_FORM_GNU_str_index ||
+          form == dwarf2reader::DW_FORM_GNU_addr_index) {
+        *indexed = true;
+        continue;
+      }
+      const bool block =
+          form == dwarf2reader::DW_FORM_block1 ||
+          form == dwarf2reader::DW_FORM_block2 ||
+          form == dwarf2reader::DW_FORM_block4 ||
+          form == dwarf2reader::DW_FORM_block ||
+          form == dwarf2reader::DW_FORM_exprloc;
+      if (form != dwarf2reader::DW_FORM_addr &&
+          form != dwarf2reader::DW_FORM_strp &&
+          form != dwarf2reader::DW_FORM_sec_offset && !block &&
+          !(section_offset && (attr == dwarf2reader::DW_AT_stmt_list ||
+                               attr == dwarf2reader::DW_AT_ranges)))
+        continue;
+
+      data->AddBytes(covered, value - covered);
+      covered = ptr;
+      if (form == dwarf2reader::DW_FORM_addr) {
+        const uint64_t address = ReadValue(reader, value, address_size);
+        if (root && attr == dwarf2reader::DW_AT_low_pc)
+          unit_base = address;
+        data->AddAddress(address);
+      } else if (form == dwarf2reader::DW_FORM_strp) {
+        // The string, wherever in .debug_str it lies.
+        const uint64_t string_offset = reader->ReadOffset(value);
+        if (string_offset >= strings_size)
+          return false;
+        const uint8_t *string = strings + string_offset;
+        const uint8_t *nul = std::find(string, strings + strings_size, 0);
+        data->AddBytes(string, nul - string);
+      } else if (attr == dwarf2reader::DW_AT_stmt_list) {
+        if (!AddLineProgram(sections, reader,
+                            ReadValue(reader, value, ptr - value), data))
+          return false;
+      } else if (attr == dwarf2reader::DW_AT_ranges) {
+        // Added once the unit's base address is known.
+        range_lists.push_back(ReadValue(reader, value, ptr - value));
+      }
+      // DwarfCUToModule doesn't read blocks, such as location
+      // expressions, which give the addresses of data; nor the location
+      // lists and other data other section offsets refer to, which shift
+      // whenever other units change. Neither is covered.
+    }
+    root = false;
+  }
+  data->AddBytes(covered, end - covered);
+  for (size_t i = 0; i < range_lists.size(); i++) {
+    AddRangeList(sections, reader, range_lists[i], address_size, unit_base,
+                 data);
+  }
+  return true;
+}
+
+}  // namespace
+
+bool DwarfCUCache::Recorder::StartCompilationUnit(uint64_t offset,
+                                                  uint8_t address_size,
+                                                  uint8_t offset_size,
+                                                  uint64_t cu_length,
+                                                  uint8_t dwarf_version) {
+  cu_start_ = offset;
+  cu_end_ = offset + cu_length + (offset_size == 8 ? 12 : 4);
+  return handler_->StartCompilationUnit(offset, address_size, offset_size,
+                                        cu_length, dwarf_version);
+}
+
+bool DwarfCUCache::Recorder::NeedSplitDebugInfo() {
+  // The key of a skeleton unit can't cover its split DWARF object.
+  cacheable_ = false;
+  return handler_->NeedSplitDebugInfo();
+}
+
+bool DwarfCUCache::Recorder::StartSplitCompilationUnit(uint64_t offset,
+                                                       uint64_t cu_length) {
+  return handler_->StartSplitCompilationUnit(offset, cu_length);
+}
+
+bool DwarfCUCache::Recorder::StartDIE(uint64_t offset, enum DwarfTag tag) {
+  return handler_->StartDIE(offset, tag);
+}
+
+bool DwarfCUCache::Recorder::SkipChildrenOfSkippedDIEs() {
+  return handler_->SkipChildrenOfSkippedDIEs();
+}
+
+void DwarfCUCache::Recorder::ProcessAttributeUnsigned(uint64_t offset,
+                                                      enum DwarfAttribute attr,
+                                                      enum DwarfForm form,
+                                                      uint64_t data) {
+  handler_->ProcessAttributeUnsigned(offset, attr, form, data);
+}
+
+void DwarfCUCache::Recorder::ProcessAttributeSigned(uint64_t offset,
+                                                    enum DwarfAttribute attr,
+                                                    enum DwarfForm form,
+                                                    int64_t data) {
+  handler_->ProcessAttributeSigned(offset, attr, form, data);
+}
+
+void DwarfCUCache::Recorder::ProcessAttributeReference(
+    uint64_t offset, enum DwarfAttribute attr, enum DwarfForm form,
+    uint64_t data) {
+  if (form == dwarf2reader::DW_FORM_ref_addr ||
+      data < cu_start_ || data >= cu_end_)
+    cacheable_ = false;
+  handler_->ProcessAttributeReference(offset, attr, form, data);
+}
+
+void DwarfCUCache::Recorder::ProcessAttributeBuffer(uint64_t offset,
+                                                    enum DwarfAttribute attr,
+                                                    enum DwarfForm form,
+                                                    const uint8_t *data,
+                                                    uint64_t len) {
+  handler_->ProcessAttributeBuffer(offset, attr, form, data, len);
+}
+
+void DwarfCUCache::Recorder::ProcessAttributeString(uint64_t offset,
+                                                    enum DwarfAttribute attr,
+                                                    enum DwarfForm form,
+                                                    const string &data) {
+  handler_->ProcessAttributeString(offset, attr, form, data);
+}
+
+void DwarfCUCache::Recorder::ProcessAttributeSignature(
+    uint64_t offset, enum DwarfAttribute attr, enum DwarfForm form,
+    uint64_t signature) {
+  handler_->ProcessAttributeSignature(offset, attr, form, signature);
+}
+
+void DwarfCUCache::Recorder::EndDIE(uint64_t offset) {
+  handler_->EndDIE(offset);
+}
+
+void DwarfCUCache::Recorder::AddingFunctions(
+    const vector<Module::Function *> &functions) {
+  for (vector<Module::Function *>::const_iterator func_it = functions.begin();
+       func_it != functions.end(); ++func_it) {
+    const Module::Function *func = *func_it;
+    AppendValue(&functions_, func->address - base_, 8);
+    AppendValue(&functions_, func->parameter_size, 8);
+    functions_.append(func->name.c_str(), func->name.size() + 1);
+    AppendValue(&functions_, func->ranges.size(), 4);
+    for (size_t i = 0; i < func->ranges.size(); i++) {
+      AppendValue(&functions_, func->ranges[i].address - base_, 8);
+      AppendValue(&functions_, func->ranges[i].size, 8);
+    }
+    AppendValue(&functions_, func->lines.size(), 4);
+    for (size_t i = 0; i < func->lines.size(); i++) {
+      const Module::Line &line = func->lines[i];
+      std::pair<std::map<const Module::File *, uint32_t>::iterator, bool>
+          file = file_indices_.insert(
+              std::make_pair(line.file,
+                             static_cast<uint32_t>(file_names_.size())));
+      if (file.second)
+        file_names_.push_back(&line.file->name);
+      AppendValue(&functions_, line.address - base_, 8);
+      AppendValue(&functions_, line.size, 8);
+      AppendValue(&functions_, file.first->second, 4);
+      AppendValue(&functions_, static_cast<uint32_t>(line.number), 4);
+    }
+    function_count_++;
+  }
+}
+
+bool DwarfCUCache::ComputeKeys(vector<Key> *keys) const {
+  const uint8_t *info;
+  uint64_t info_size;
+  if (!FindSection(sections_, ".debug_info", &info, &info_size))
+    return false;
+
+  // A digest of the sections that strings and addresses given by index
+  // lie in, for the units that have any. Rather than find each unit's
+  // share, cover the sections in full.
+  bool have_shared_digest = false;
+  uint8_t shared_digest[16];
+
+  for (uint64_t offset = 0; offset < info_size;) {
+    KeyData data;
+    Key key;
+    bool indexed = false;
+    data.AddValue(handle_inter_cu_refs_, 1);
+    if (!GatherUnit(sections_, byte_reader_, offset, &data, &key.length,
+                    &indexed))
+      return false;
+    if (indexed) {
+      if (!have_shared_digest) {
+        MD5Context shared_context;
+        MD5Init(&shared_context);
+        static const char *const kSharedSections[] = {
+          ".debug_str", ".debug_str_offsets", ".debug_addr"
+        };
+        for (size_t i = 0;
+             i < sizeof(kSharedSections) / sizeof(kSharedSections[0]); i++) {
+          const uint8_t *contents = NULL;
+          uint64_t size = 0;
+          FindSection(sections_, kSharedSections[i], &contents, &size);
+          AddBytes(&shared_context, contents, size);
+        }
+        FinishDigest(&shared_context, shared_digest);
+        have_shared_digest = true;
+      }
+      data.AddBytes(shared_digest, sizeof(shared_digest));
+      data.KeepAddressesAbsolute();
+    }
+    data.Finish(key.digest);
+    key.base = data.base();
+    keys->push_back(key);
+    offset += key.length;
+  }
+  return true;
+}
+
+string DwarfCUCache::EntryPath(const Key &key) const {
+  char name[sizeof(key.digest) * 2 + 1];
+  for (size_t i = 0; i < sizeof(key.digest); i++)
+    snprintf(name + 2 * i, 3, "%02x", key.digest[i]);
+  return directory_ + "/" + name;
+}
+
+bool DwarfCUCache::Load(const Key &key, Module *module) {
+  const string path = EntryPath(key);
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) {
+    misses_++;
+    return false;
+  }
+  string data;
+  char buffer[16 * 1024];
+  size_t got;
+  while ((got = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    data.append(buffer, got);
+  bool read_error = ferror(file);
+  fclose(file);
+
+  ByteBuffer bytes(reinterpret_cast<const uint8_t *>(data.data()),
+                   data.size());
+  ByteCursor cursor(&bytes);
+  uint8_t magic[sizeof(kEntryMagic)];
+  cursor.Read(magic, sizeof(magic));
+  bool ok = !read_error && cursor &&
+      memcmp(magic, kEntryMagic, sizeof(magic)) == 0;
+
+  uint32_t file_count = 0;
+  ok = ok && (cursor >> file_count);
+
+  vector<Module::File *> files;
+  for (uint32_t i = 0; ok && i < file_count; i++) {
+    string name;
+    ok = cursor.CString(&name);
+    files.push_back(module->FindFile(name));
+  }
+
+  uint32_t function_count = 0;
+  ok = ok && (cursor >> function_count);
+  vector<Module::Function *> functions;
+  for (uint32_t i = 0; ok && i < function_count; i++) {
+    Module::Address address, parameter_size;
+    string name;
+    uint32_t range_count = 0, line_count = 0;
+    ok = cursor >> address >> parameter_size;
+    ok = ok && cursor.CString(&name);
+    ok = ok && (cursor >> range_count);
+    if (!ok)
+      break;
+    // Entries hold addresses relative to the unit's base address.
+    Module::Function *func = new Module::Function(name, address + key.base);
+    functions.push_back(func);
+    func->parameter_size = parameter_size;
+    for (uint32_t j = 0; ok && j < range_count; j++) {
+      Module::Range range(0, 0);
+      ok = cursor >> range.address >> range.size;
+      range.address += key.base;
+      func->ranges.push_back(range);
+    }
+    ok = ok && (cursor >> line_count);
+    for (uint32_t j = 0; ok && j < line_count; j++) {
+      Module::Line line;
+      uint32_t file_index = 0;
+      ok = cursor >> line.address >> line.size >> file_index >> line.number;
+      line.address += key.base;
+      ok = ok && file_index < files.size();
+      line.file = ok ? files[file_index] : NULL;
+      func->lines.push_back(line);
+    }
+  }
+  ok = ok && cursor.AtEnd();
+
+  if (!ok) {
+    fprintf(stderr, "%s: ignoring corrupt symbol cache entry\n",
+            path.c_str());
+    for (size_t i = 0; i < functions.size(); i++)
+      delete functions[i];
+    misses_++;
+    return false;
+  }
+  module->AddFunctions(functions.begin(), functions.end());
+  hits_++;
+  return true;
+}
+
+bool DwarfCUCache::Store(const Key &key, const Recorder &recorder) {
+  assert(recorder.cacheable() && recorder.base_ == key.base);
+  string entry(kEntryMagic, sizeof(kEntryMagic));
+  AppendValue(&entry, recorder.file_names_.size(), 4);
+  for (size_t i = 0; i < recorder.file_names_.size(); i++)
+    entry.append(recorder.file_names_[i]->c_str(),
+                 recorder.file_names_[i]->size() + 1);
+  AppendValue(&entry, recorder.function_count_, 4);
+  entry.append(recorder.functions_);
+
+  if (mkdir(directory_.c_str(), 0777) != 0 && errno != EEXIST) {
+    fprintf(stderr, "%s: couldn't create symbol cache directory: %s\n",
+            directory_.c_str(), strerror(errno));
+    return false;
+  }
+
+  // Write the entry under a name of its own, and then move it into
+  // place, so that concurrent runs never see a partial entry.
+  const string path = EntryPath(key);
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".%d.tmp", static_cast<int>(getpid()));
+  const string temp_path = path + suffix;
+  FILE *file = fopen(temp_path.c_str(), "wb");
+  bool ok = file &&
+      fwrite(entry.data(), 1, entry.size(), file) == entry.size();
+  if (file && fclose(file) != 0)
+    ok = false;
+  if (ok && rename(temp_path.c_str(), path.c_str()) != 0)
+    ok = false;
+  if (!ok) {
+    fprintf(stderr, "%s: couldn't write symbol cache entry: %s\n",
+            path.c_str(), strerror(errno));
+    unlink(temp_path.c_str());
+  }
+  return ok;
+}
+
+}  // namespace google_breakpad
@@ -0,0 +1,203 @@
+// -*- mode: c++ -*-
+
+// Copyright (c) 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// The DwarfCUCache class keeps the functions and source lines that
+// DwarfCUToModule extracts from each DWARF compilation unit in a
+// directory, keyed by a digest of the unit and of the data it refers
+// to, so that later runs can skip reading units that are unchanged.
+// The key takes strings by value and addresses relative to the unit's
+// own, so a unit keeps it when other units change and its code merely
+// moves: in an incremental build, most units hit, though those whose
+// code lies in sections that move by different amounts miss.
+//
+// Nothing is ever removed from the directory: it gains an entry for
+// every distinct compilation unit dumped, and grows without bound
+// unless whoever owns it prunes it. Entries may be deleted at any time,
+// even while dump_syms is running; a missing entry is just a miss.
+
+#ifndef COMMON_DWARF_CU_CACHE_H__
+#define COMMON_DWARF_CU_CACHE_H__
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "common/dwarf_cu_to_module.h"
+#include "common/dwarf/bytereader.h"
+#include "common/dwarf/dwarf2reader.h"
+#include "common/module.h"
+#include "common/using_std_string.h"
+
+namespace google_breakpad {
+
+class DwarfCUCache {
+ public:
+  // The key for a compilation unit: a digest of its DIEs, its
+  // abbreviation table, the strings in .debug_str its DIEs refer to,
+  // its line number program and its range lists, but not of where in
+  // their sections any of those lie, with the addresses they give made
+  // relative to BASE; and the unit's length in .debug_info. Blocks,
+  // such as location expressions, and offsets into sections dump_syms
+  // doesn't read, such as location lists, are left out.
+  struct Key {
+    uint8_t digest[16];
+    uint64_t length;
+
+    // The first nonzero address the unit gives, or zero if it has none,
+    // or has strings or addresses given by index, which the key covers
+    // by the whole of the sections they lie in. Entries hold addresses
+    // relative to this.
+    uint64_t base;
+  };
+
+  // A Dwarf2Handler that passes everything on to another handler,
+  // noting whether the unit refers to anything its key doesn't cover,
+  // and a DwarfCUToModule::FunctionsObserver that records the functions
+  // the unit contributes, for Store.
+  class Recorder : public dwarf2reader::Dwarf2Handler,
+                   public DwarfCUToModule::FunctionsObserver {
+   public:
+    // Pass everything on to HANDLER, and record addresses relative to
+    // BASE, the base address of the unit's key.
+    Recorder(dwarf2reader::Dwarf2Handler *handler, uint64_t base)
+        : handler_(handler), base_(base), cu_start_(0), cu_end_(0),
+          cacheable_(true), function_count_(0) { }
+
+    // True if nothing the unit refers to lies outside it and the data
+    // its key covers: no other compilation unit, and no split DWARF
+    // object.
+    bool cacheable() const { return cacheable_; }
+
+    // dwarf2reader::Dwarf2Handler.
+    bool StartCompilationUnit(uint64_t offset, uint8_t address_size,
+                              uint8_t offset_size, uint64_t cu_length,
+                              uint8_t dwarf_version);
+    bool NeedSplitDebugInfo();
+    bool StartSplitCompilationUnit(uint64_t offset, uint64_t cu_length);
+    bool StartDIE(uint64_t offset, enum dwarf2reader::DwarfTag tag);
+    bool SkipChildrenOfSkippedDIEs();
+    void ProcessAttributeUnsigned(uint64_t offset,
+                                  enum dwarf2reader::DwarfAttribute attr,
+                                  enum dwarf2reader::DwarfForm form,
+                                  uint64_t data);
+    void ProcessAttributeSigned(uint64_t offset,
+                                enum dwarf2reader::DwarfAttribute attr,
+                                enum dwarf2reader::DwarfForm form,
+                                int64_t data);
+    void ProcessAttributeReference(uint64_t offset,
+                                   enum dwarf2reader::DwarfAttribute attr,
+                                   enum dwarf2reader::DwarfForm form,
+                                   uint64_t data);
+    void ProcessAttributeBuffer(uint64_t offset,
+                                enum dwarf2reader::DwarfAttribute attr,
+                                enum dwarf2reader::DwarfForm form,
+                                const uint8_t *data, uint64_t len);
+    void ProcessAttributeString(uint64_t offset,
+                                enum dwarf2reader::DwarfAttribute attr,
+                                enum dwarf2reader::DwarfForm form,
+                                const string &data);
+    void ProcessAttributeSignature(uint64_t offset,
+                                   enum dwarf2reader::DwarfAttribute attr,
+                                   enum dwarf2reader::DwarfForm form,
+                                   uint64_t signature);
+    void EndDIE(uint64_t offset);
+
+    // DwarfCUToModule::FunctionsObserver.
+    void AddingFunctions(const vector<Module::Function *> &functions);
+
+   private:
+    friend class DwarfCUCache;
+
+    dwarf2reader::Dwarf2Handler *handler_;
+    uint64_t base_;
+
+    // The extent of the unit in .debug_info.
+    uint64_t cu_start_, cu_end_;
+    bool cacheable_;
+
+    // The index of each file the recorded lines cite, and their names.
+    std::map<const Module::File *, uint32_t> file_indices_;
+    vector<const string *> file_names_;
+
+    // The recorded functions, in the format Store writes.
+    uint32_t function_count_;
+    string functions_;
+  };
+
+  // Keep entries in DIRECTORY, creating it if need be, for compilation
+  // units in SECTIONS, which BYTE_READER reads. HANDLE_INTER_CU_REFS is
+  // the setting the units will be read with.
+  DwarfCUCache(const string &directory,
+               const dwarf2reader::SectionMap &sections,
+               dwarf2reader::ByteReader *byte_reader,
+               bool handle_inter_cu_refs)
+      : directory_(directory), sections_(sections),
+        byte_reader_(byte_reader),
+        handle_inter_cu_refs_(handle_inter_cu_refs),
+        hits_(0), misses_(0) { }
+
+  // Compute the keys of all the compilation units in the .debug_info
+  // section, in order, and place them in KEYS. This reads each unit's
+  // DIEs, but doesn't interpret them. Return false if some unit's key
+  // can't be computed; such files must be read afresh.
+  bool ComputeKeys(vector<Key> *keys) const;
+
+  // If the cache has an entry for KEY, add its functions to MODULE,
+  // placed at KEY's base address, and return true. Otherwise, return
+  // false.
+  bool Load(const Key &key, Module *module);
+
+  // Store the functions RECORDER has seen under KEY. RECORDER's unit
+  // must be cacheable, and its base address KEY's. Return false, having
+  // reported the problem to stderr, if the entry can't be written.
+  bool Store(const Key &key, const Recorder &recorder);
+
+  // The number of Load calls that found an entry, and that didn't.
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
+ private:
+  // Return the path of the entry for KEY.
+  string EntryPath(const Key &key) const;
+
+  string directory_;
+  const dwarf2reader::SectionMap &sections_;
+  dwarf2reader::ByteReader *byte_reader_;
+  bool handle_inter_cu_refs_;
+  uint64_t hits_;
+  uint64_t misses_;
+};
+
+}  // namespace google_breakpad
+
+#endif  // COMMON_DWARF_CU_CACHE_H__
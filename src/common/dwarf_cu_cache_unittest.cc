@@ -0,0 +1,536 @@
+// Copyright (c) 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// dwarf_cu_cache_unittest.cc: Unit tests for google_breakpad::DwarfCUCache.
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "breakpad_googletest_includes.h"
+#include "common/dwarf/dwarf2reader_test_common.h"
+#include "common/dwarf_cu_cache.h"
+#include "common/tests/auto_tempdir.h"
+#include "common/using_std_string.h"
+
+using google_breakpad::AutoTempDir;
+using google_breakpad::DwarfCUCache;
+using google_breakpad::Module;
+using google_breakpad::test_assembler::Label;
+using google_breakpad::test_assembler::kLittleEndian;
+using std::vector;
+
+namespace {
+
+// Add a function named NAME at ADDRESS to FUNCTIONS, with one line
+// from FILE for every four of its SIZE bytes.
+void AddFunction(vector<Module::Function *> *functions, const string &name,
+                 Module::Address address, Module::Address size,
+                 Module::File *file, int first_line) {
+  Module::Function *func = new Module::Function(name, address);
+  func->ranges.push_back(Module::Range(address, size));
+  func->parameter_size = 0x10;
+  for (Module::Address offset = 0; offset < size; offset += 4) {
+    Module::Line line = { address + offset, 4, file,
+                          first_line + static_cast<int>(offset / 4) };
+    func->lines.push_back(line);
+  }
+  functions->push_back(func);
+}
+
+DwarfCUCache::Key MakeKey(uint8_t seed, uint64_t base) {
+  DwarfCUCache::Key key;
+  for (size_t i = 0; i < sizeof(key.digest); i++)
+    key.digest[i] = seed + i;
+  key.length = 0x100;
+  key.base = base;
+  return key;
+}
+
+}  // namespace
+
+TEST(DwarfCUCache, StoreAndLoad) {
+  AutoTempDir temp_dir;
+  dwarf2reader::SectionMap sections;
+  dwarf2reader::ByteReader byte_reader(dwarf2reader::ENDIANNESS_LITTLE);
+  DwarfCUCache cache(temp_dir.path() + "/cache", sections, &byte_reader,
+                     true);
+
+  Module original("name", "os", "architecture", "id");
+  vector<Module::Function *> functions;
+  AddFunction(&functions, "f", 0x1000, 0x10,
+              original.FindFile("/src/a.cc"), 10);
+  AddFunction(&functions, "g(int)", 0x1010, 0x8,
+              original.FindFile("/src/a.h"), 30);
+  dwarf2reader::Dwarf2Handler handler;
+  DwarfCUCache::Recorder recorder(&handler, 0x1000);
+  recorder.AddingFunctions(functions);
+  ASSERT_TRUE(cache.Store(MakeKey(1, 0x1000), recorder));
+  original.AddFunctions(functions.begin(), functions.end());
+
+  Module loaded("name", "os", "architecture", "id");
+  EXPECT_FALSE(cache.Load(MakeKey(2, 0x1000), &loaded));
+  ASSERT_TRUE(cache.Load(MakeKey(1, 0x1000), &loaded));
+  EXPECT_EQ(1U, cache.hits());
+  EXPECT_EQ(1U, cache.misses());
+
+  vector<Module::Function *> expected, actual;
+  original.GetFunctions(&expected, expected.end());
+  loaded.GetFunctions(&actual, actual.end());
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_EQ(expected[i]->name, actual[i]->name);
+    EXPECT_EQ(expected[i]->address, actual[i]->address);
+    EXPECT_EQ(expected[i]->parameter_size, actual[i]->parameter_size);
+    ASSERT_EQ(expected[i]->ranges.size(), actual[i]->ranges.size());
+    EXPECT_EQ(expected[i]->ranges[0].size, actual[i]->ranges[0].size);
+    ASSERT_EQ(expected[i]->lines.size(), actual[i]->lines.size());
+    for (size_t j = 0; j < expected[i]->lines.size(); j++) {
+      EXPECT_EQ(expected[i]->lines[j].address, actual[i]->lines[j].address);
+      EXPECT_EQ(expected[i]->lines[j].size, actual[i]->lines[j].size);
+      EXPECT_EQ(expected[i]->lines[j].number, actual[i]->lines[j].number);
+      EXPECT_EQ(expected[i]->lines[j].file->name,
+                actual[i]->lines[j].file->name);
+    }
+  }
+}
+
+TEST(DwarfCUCache, CorruptEntry) {
+  AutoTempDir temp_dir;
+  dwarf2reader::SectionMap sections;
+  dwarf2reader::ByteReader byte_reader(dwarf2reader::ENDIANNESS_LITTLE);
+  DwarfCUCache cache(temp_dir.path(), sections, &byte_reader, true);
+
+  Module module("name", "os", "architecture", "id");
+  vector<Module::Function *> functions;
+  AddFunction(&functions, "f", 0x1000, 0x10, module.FindFile("a.cc"), 1);
+  dwarf2reader::Dwarf2Handler handler;
+  DwarfCUCache::Recorder recorder(&handler, 0x1000);
+  recorder.AddingFunctions(functions);
+  ASSERT_TRUE(cache.Store(MakeKey(1, 0x1000), recorder));
+  for (size_t i = 0; i < functions.size(); i++)
+    delete functions[i];
+
+  // Truncate the entry.
+  string path = temp_dir.path() + "/0102030405060708090a0b0c0d0e0f10";
+  FILE *file = fopen(path.c_str(), "r+");
+  ASSERT_TRUE(file != NULL);
+  ASSERT_EQ(0, ftruncate(fileno(file), 20));
+  fclose(file);
+
+  Module loaded("name", "os", "architecture", "id");
+  EXPECT_FALSE(cache.Load(MakeKey(1, 0x1000), &loaded));
+  vector<Module::Function *> loaded_functions;
+  loaded.GetFunctions(&loaded_functions, loaded_functions.end());
+  EXPECT_TRUE(loaded_functions.empty());
+}
+
+class ComputeKeys : public ::testing::Test {
+ public:
+  ComputeKeys() {
+    abbrevs.set_endianness(kLittleEndian);
+    abbrevs.Abbrev(1, dwarf2reader::DW_TAG_compile_unit,
+                   dwarf2reader::DW_children_yes)
+        .Attribute(dwarf2reader::DW_AT_name, dwarf2reader::DW_FORM_string)
+        .Attribute(dwarf2reader::DW_AT_stmt_list, dwarf2reader::DW_FORM_data4)
+        .EndAbbrev()
+        .Abbrev(2, dwarf2reader::DW_TAG_subprogram,
+                dwarf2reader::DW_children_no)
+        .Attribute(dwarf2reader::DW_AT_name, dwarf2reader::DW_FORM_string)
+        .Attribute(dwarf2reader::DW_AT_low_pc, dwarf2reader::DW_FORM_addr)
+        .Attribute(dwarf2reader::DW_AT_specification,
+                   dwarf2reader::DW_FORM_ref4)
+        .EndAbbrev()
+        .Abbrev(3, dwarf2reader::DW_TAG_subprogram,
+                dwarf2reader::DW_children_no)
+        .Attribute(dwarf2reader::DW_AT_specification,
+                   dwarf2reader::DW_FORM_ref_addr)
+        .EndAbbrev()
+        .Abbrev(4, dwarf2reader::DW_TAG_compile_unit,
+                dwarf2reader::DW_children_yes)
+        .Attribute(dwarf2reader::DW_AT_name, dwarf2reader::DW_FORM_strp)
+        .Attribute(dwarf2reader::DW_AT_low_pc, dwarf2reader::DW_FORM_addr)
+        .Attribute(dwarf2reader::DW_AT_stmt_list,
+                   dwarf2reader::DW_FORM_sec_offset)
+        .EndAbbrev()
+        .Abbrev(5, dwarf2reader::DW_TAG_subprogram,
+                dwarf2reader::DW_children_no)
+        .Attribute(dwarf2reader::DW_AT_name, dwarf2reader::DW_FORM_strp)
+        .Attribute(dwarf2reader::DW_AT_low_pc, dwarf2reader::DW_FORM_addr)
+        .Attribute(dwarf2reader::DW_AT_high_pc, dwarf2reader::DW_FORM_data4)
+        .EndAbbrev()
+        .Abbrev(6, dwarf2reader::DW_TAG_compile_unit,
+                dwarf2reader::DW_children_no)
+        .Attribute(dwarf2reader::DW_AT_name, dwarf2reader::DW_FORM_string)
+        .Attribute(dwarf2reader::DW_AT_ranges,
+                   dwarf2reader::DW_FORM_sec_offset)
+        .EndAbbrev()
+        .EndTable();
+  }
+
+  // Append a compilation unit named NAME whose line program lies at
+  // LINE_OFFSET, with a function named FUNCTION. If REF_ADDR is true,
+  // add a DIE with an inter-CU reference.
+  void AddUnit(const string &name, uint32_t line_offset,
+               const string &function, bool ref_addr) {
+    TestCompilationUnit unit;
+    unit.set_endianness(kLittleEndian);
+    unit.set_format_size(4);
+    unit.start() = 0;
+    Label abbrev_offset;
+    abbrev_offset = 0;
+    Label declaration;
+    unit.Header(4, abbrev_offset, 8)
+        .ULEB128(1)
+        .AppendCString(name)
+        .D32(line_offset)
+        .Mark(&declaration)
+        .ULEB128(2)
+        .AppendCString(function)
+        .D64(0x1000)
+        .D32(declaration);
+    if (ref_addr)
+      unit.ULEB128(3).D32(0);
+    unit.D8(0);
+    unit.Finish();
+    string contents;
+    ASSERT_TRUE(unit.GetContents(&contents));
+    info_contents += contents;
+  }
+
+  // Append a compilation unit named NAME, with a function named
+  // FUNCTION whose 0x10 bytes of code lie at LOW_PC, and whose line
+  // program lies at LINE_OFFSET. The names lie in .debug_str.
+  void AddStrpUnit(const string &name, const string &function,
+                   uint64_t low_pc, uint32_t line_offset) {
+    TestCompilationUnit unit;
+    unit.set_endianness(kLittleEndian);
+    unit.set_format_size(4);
+    unit.start() = 0;
+    Label abbrev_offset;
+    abbrev_offset = 0;
+    unit.Header(4, abbrev_offset, 8)
+        .ULEB128(4)
+        .D32(AddString(name))
+        .D64(low_pc)
+        .D32(line_offset)
+        .ULEB128(5)
+        .D32(AddString(function))
+        .D64(low_pc)
+        .D32(0x10)
+        .D8(0);
+    unit.Finish();
+    string contents;
+    ASSERT_TRUE(unit.GetContents(&contents));
+    info_contents += contents;
+  }
+
+  // Append a compilation unit named NAME whose range list lies at
+  // RANGES_OFFSET.
+  void AddRangesUnit(const string &name, uint32_t ranges_offset) {
+    TestCompilationUnit unit;
+    unit.set_endianness(kLittleEndian);
+    unit.set_format_size(4);
+    unit.start() = 0;
+    Label abbrev_offset;
+    abbrev_offset = 0;
+    unit.Header(4, abbrev_offset, 8)
+        .ULEB128(6)
+        .AppendCString(name)
+        .D32(ranges_offset);
+    unit.Finish();
+    string contents;
+    ASSERT_TRUE(unit.GetContents(&contents));
+    info_contents += contents;
+  }
+
+  // Append NAME to .debug_str, and return its offset.
+  uint32_t AddString(const string &name) {
+    uint32_t offset = str_contents.size();
+    str_contents.append(name.c_str(), name.size() + 1);
+    return offset;
+  }
+
+  // Append a range list holding the RANGES to .debug_ranges, and
+  // return its offset.
+  uint32_t AddRangeList(const vector<std::pair<uint64_t, uint64_t> > &ranges) {
+    uint32_t offset = ranges_contents.size();
+    for (size_t i = 0; i <= ranges.size(); i++) {
+      uint64_t entry[2] = { 0, 0 };
+      if (i < ranges.size()) {
+        entry[0] = ranges[i].first;
+        entry[1] = ranges[i].second;
+      }
+      ranges_contents.append(reinterpret_cast<const char *>(entry),
+                             sizeof(entry));
+    }
+    return offset;
+  }
+
+  // Return the body of a version 2 line number program for FILE,
+  // whose one sequence covers 0x10 bytes at ADDRESS.
+  static string LineProgram(const string &file, uint64_t address) {
+    static const uint8_t kOpcodeLengths[] = {
+      0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1
+    };
+    string header;
+    header.push_back(1);  // minimum_instruction_length
+    header.push_back(1);  // default_is_stmt
+    header.push_back(-5);  // line_base
+    header.push_back(14);  // line_range
+    header.push_back(sizeof(kOpcodeLengths) + 1);  // opcode_base
+    header.append(reinterpret_cast<const char *>(kOpcodeLengths),
+                  sizeof(kOpcodeLengths));
+    header.push_back(0);  // No include directories.
+    header.append(file.c_str(), file.size() + 1);
+    header.append(3, 0);  // Directory, time and size.
+    header.push_back(0);  // No more files.
+
+    string body("\x02\x00", 2);  // version
+    uint32_t header_length = header.size();
+    body.append(reinterpret_cast<const char *>(&header_length), 4);
+    body += header;
+    body.append("\x00\x09\x02", 3);  // DW_LNE_set_address
+    body.append(reinterpret_cast<const char *>(&address), 8);
+    body.push_back(dwarf2reader::DW_LNS_copy);
+    body.push_back(dwarf2reader::DW_LNS_advance_pc);
+    body.push_back(0x10);
+    body.append("\x00\x01\x01", 3);  // DW_LNE_end_sequence
+    return body;
+  }
+
+  // Append a line number program holding BODY to .debug_line, and
+  // return its offset.
+  uint32_t AddLineProgram(const string &body) {
+    uint32_t offset = line_contents.size();
+    uint32_t length = body.size();
+    line_contents.append(reinterpret_cast<const char *>(&length), 4);
+    line_contents += body;
+    return offset;
+  }
+
+  void SetSections() {
+    if (abbrevs_contents.empty())
+      EXPECT_TRUE(abbrevs.GetContents(&abbrevs_contents));
+    sections[".debug_info"] = std::make_pair(
+        reinterpret_cast<const uint8_t *>(info_contents.data()),
+        info_contents.size());
+    sections[".debug_abbrev"] = std::make_pair(
+        reinterpret_cast<const uint8_t *>(abbrevs_contents.data()),
+        abbrevs_contents.size());
+    sections[".debug_line"] = std::make_pair(
+        reinterpret_cast<const uint8_t *>(line_contents.data()),
+        line_contents.size());
+    sections[".debug_str"] = std::make_pair(
+        reinterpret_cast<const uint8_t *>(str_contents.data()),
+        str_contents.size());
+    sections[".debug_ranges"] = std::make_pair(
+        reinterpret_cast<const uint8_t *>(ranges_contents.data()),
+        ranges_contents.size());
+  }
+
+  bool Compute(vector<DwarfCUCache::Key> *keys) {
+    SetSections();
+    dwarf2reader::ByteReader byte_reader(dwarf2reader::ENDIANNESS_LITTLE);
+    DwarfCUCache cache("", sections, &byte_reader, true);
+    return cache.ComputeKeys(keys);
+  }
+
+  TestAbbrevTable abbrevs;
+  string abbrevs_contents, info_contents, line_contents, str_contents;
+  string ranges_contents;
+  dwarf2reader::SectionMap sections;
+};
+
+// Identical units get identical keys wherever their line programs lie;
+// a change to either changes the key.
+TEST_F(ComputeKeys, RelocationIndependent) {
+  uint32_t line1 = AddLineProgram("program one");
+  uint32_t line2 = AddLineProgram("program one");
+  uint32_t line3 = AddLineProgram("program two");
+  AddUnit("a.cc", line1, "f", false);
+  AddUnit("a.cc", line2, "f", false);
+  AddUnit("a.cc", line3, "f", false);
+  AddUnit("a.cc", line1, "g", false);
+
+  vector<DwarfCUCache::Key> keys;
+  ASSERT_TRUE(Compute(&keys));
+  ASSERT_EQ(4U, keys.size());
+  EXPECT_EQ(info_contents.size(), keys[0].length + keys[1].length +
+            keys[2].length + keys[3].length);
+  EXPECT_EQ(0, memcmp(keys[0].digest, keys[1].digest, 16));
+  EXPECT_NE(0, memcmp(keys[0].digest, keys[2].digest, 16));
+  EXPECT_NE(0, memcmp(keys[0].digest, keys[3].digest, 16));
+}
+
+// A change to the strings a unit refers to changes its key; where they
+// lie in .debug_str doesn't.
+TEST_F(ComputeKeys, StringsCovered) {
+  str_contents = "padding";
+  uint32_t line = AddLineProgram(LineProgram("a.cc", 0x1000));
+  AddStrpUnit("a.cc", "f", 0x1000, line);
+  AddStrpUnit("a.cc", "g", 0x1000, line);
+  str_contents.push_back(0);
+  AddStrpUnit("a.cc", "f", 0x1000, line);
+
+  vector<DwarfCUCache::Key> before, after;
+  ASSERT_TRUE(Compute(&before));
+  str_contents[0] = 'P';
+  ASSERT_TRUE(Compute(&after));
+  ASSERT_EQ(3U, before.size());
+  ASSERT_EQ(3U, after.size());
+  EXPECT_NE(0, memcmp(before[0].digest, before[1].digest, 16));
+  EXPECT_EQ(0, memcmp(before[0].digest, before[2].digest, 16));
+  EXPECT_EQ(0, memcmp(before[0].digest, after[0].digest, 16));
+
+  str_contents[str_contents.find("a.cc")] = 'b';
+  after.clear();
+  ASSERT_TRUE(Compute(&after));
+  EXPECT_NE(0, memcmp(before[0].digest, after[0].digest, 16));
+}
+
+// A unit keeps its key when another unit's strings and code change,
+// moving its own, and its entry is then loaded at its new address.
+TEST_F(ComputeKeys, OtherUnitsChange) {
+  AddStrpUnit("b.cc", "g", 0x1000,
+              AddLineProgram(LineProgram("b.cc", 0x1000)));
+  AddStrpUnit("a.cc", "f", 0x2000,
+              AddLineProgram(LineProgram("a.cc", 0x2000)));
+  vector<DwarfCUCache::Key> before;
+  ASSERT_TRUE(Compute(&before));
+
+  info_contents.clear();
+  line_contents.clear();
+  str_contents.clear();
+  AddStrpUnit("b_renamed.cc", "g_renamed", 0x1000,
+              AddLineProgram(LineProgram("b_renamed.cc", 0x1000)));
+  AddStrpUnit("a.cc", "f", 0x2400,
+              AddLineProgram(LineProgram("a.cc", 0x2400)));
+  vector<DwarfCUCache::Key> after;
+  ASSERT_TRUE(Compute(&after));
+
+  ASSERT_EQ(2U, before.size());
+  ASSERT_EQ(2U, after.size());
+  EXPECT_NE(0, memcmp(before[0].digest, after[0].digest, 16));
+  EXPECT_EQ(0, memcmp(before[1].digest, after[1].digest, 16));
+  EXPECT_EQ(0x2000U, before[1].base);
+  EXPECT_EQ(0x2400U, after[1].base);
+
+  AutoTempDir temp_dir;
+  dwarf2reader::ByteReader byte_reader(dwarf2reader::ENDIANNESS_LITTLE);
+  DwarfCUCache cache(temp_dir.path(), sections, &byte_reader, true);
+  Module original("name", "os", "architecture", "id");
+  vector<Module::Function *> functions;
+  AddFunction(&functions, "f", 0x2000, 0x10, original.FindFile("a.cc"), 1);
+  dwarf2reader::Dwarf2Handler handler;
+  DwarfCUCache::Recorder recorder(&handler, before[1].base);
+  recorder.AddingFunctions(functions);
+  ASSERT_TRUE(cache.Store(before[1], recorder));
+  for (size_t i = 0; i < functions.size(); i++)
+    delete functions[i];
+
+  Module loaded("name", "os", "architecture", "id");
+  ASSERT_TRUE(cache.Load(after[1], &loaded));
+  vector<Module::Function *> loaded_functions;
+  loaded.GetFunctions(&loaded_functions, loaded_functions.end());
+  ASSERT_EQ(1U, loaded_functions.size());
+  EXPECT_EQ(0x2400U, loaded_functions[0]->address);
+  ASSERT_EQ(1U, loaded_functions[0]->ranges.size());
+  EXPECT_EQ(0x2400U, loaded_functions[0]->ranges[0].address);
+  ASSERT_EQ(4U, loaded_functions[0]->lines.size());
+  EXPECT_EQ(0x240cU, loaded_functions[0]->lines[3].address);
+}
+
+// A unit's range lists are covered by their contents, with their
+// addresses relative to the unit's base, wherever they lie.
+TEST_F(ComputeKeys, RangeListsCovered) {
+  vector<std::pair<uint64_t, uint64_t> > ranges;
+  ranges.push_back(std::make_pair(0x1000, 0x1010));
+  ranges.push_back(std::make_pair(0x1020, 0x1030));
+  uint32_t original = AddRangeList(ranges);
+  for (size_t i = 0; i < ranges.size(); i++) {
+    ranges[i].first += 0x4000;
+    ranges[i].second += 0x4000;
+  }
+  uint32_t moved = AddRangeList(ranges);
+  ranges[1].second += 0x10;
+  uint32_t changed = AddRangeList(ranges);
+  AddRangesUnit("a.cc", original);
+  AddRangesUnit("a.cc", moved);
+  AddRangesUnit("a.cc", changed);
+
+  vector<DwarfCUCache::Key> keys;
+  ASSERT_TRUE(Compute(&keys));
+  ASSERT_EQ(3U, keys.size());
+  EXPECT_EQ(0, memcmp(keys[0].digest, keys[1].digest, 16));
+  EXPECT_EQ(0x1000U, keys[0].base);
+  EXPECT_EQ(0x5000U, keys[1].base);
+  EXPECT_NE(0, memcmp(keys[0].digest, keys[2].digest, 16));
+}
+
+// A Dwarf2Handler that accepts every unit and DIE.
+class AcceptingHandler : public dwarf2reader::Dwarf2Handler {
+ public:
+  bool StartCompilationUnit(uint64_t offset, uint8_t address_size,
+                            uint8_t offset_size, uint64_t cu_length,
+                            uint8_t dwarf_version) {
+    return true;
+  }
+  bool StartDIE(uint64_t offset, enum dwarf2reader::DwarfTag tag) {
+    return true;
+  }
+};
+
+// Units that refer to other units can't be cached; the Recorder that
+// reads them says so.
+TEST_F(ComputeKeys, InterCUReference) {
+  uint32_t line = AddLineProgram("program");
+  AddUnit("a.cc", line, "f", false);
+  AddUnit("b.cc", line, "g", true);
+
+  vector<DwarfCUCache::Key> keys;
+  ASSERT_TRUE(Compute(&keys));
+  ASSERT_EQ(2U, keys.size());
+
+  dwarf2reader::ByteReader byte_reader(dwarf2reader::ENDIANNESS_LITTLE);
+  AcceptingHandler handler;
+  DwarfCUCache::Recorder recorder_a(&handler, keys[0].base);
+  DwarfCUCache::Recorder recorder_b(&handler, keys[1].base);
+  dwarf2reader::CompilationUnit reader_a("", sections, 0, &byte_reader,
+                                         &recorder_a);
+  EXPECT_EQ(keys[0].length, reader_a.Start());
+  dwarf2reader::CompilationUnit reader_b("", sections, keys[0].length,
+                                         &byte_reader, &recorder_b);
+  EXPECT_EQ(keys[1].length, reader_b.Start());
+  EXPECT_TRUE(recorder_a.cacheable());
+  EXPECT_FALSE(recorder_b.cacheable());
+}
@@ -76,16 +76,19 @@ using std::vector;
 //
 // A Specification holds information gathered from a declaration DIE that
 // we may need if we find a DW_AT_specification link pointing to it.
+//
+// The names are interned in the module, as the same declarations appear
+// in every compilation unit that includes them; none of them is NULL.
 struct DwarfCUToModule::Specification {
   // The qualified name that can be found by demangling DW_AT_MIPS_linkage_name.
-  string qualified_name;
+  const string *qualified_name;
 
   // The name of the enclosing scope, or the empty string if there is none.
-  string enclosing_name;
+  const string *enclosing_name;
 
   // The name for the specification DIE itself, without any enclosing
   // name components.
-  string unqualified_name;
+  const string *unqualified_name;
 };
 
 // An abstract origin -- base definition of an inline function.
@@ -98,27 +101,23 @@ struct AbstractOrigin {
 
 typedef map<uint64_t, AbstractOrigin> AbstractOriginByOffset;
 
+// The outcome of demangling a linkage name: the demangler's result
+// and, on success, the interned demangled name.
+struct DemangledName {
+  Language::DemangleResult result;
+  const string *name;
+};
+
+// A map from linkage names to the results of demangling them.
+typedef unordered_map<string, DemangledName> DemangleCache;
+
 // Data global to the DWARF-bearing file that is private to the
 // DWARF-to-Module process.
 struct DwarfCUToModule::FilePrivate {
-  // A set of strings used in this CU. Before storing a string in one of
-  // our data structures, insert it into this set, and then use the string
-  // from the set.
-  //
-  // In some STL implementations, strings are reference-counted internally,
-  // meaning that simply using strings from this set, even if passed by
-  // value, assigned, or held directly in structures and containers
-  // (map<string, ...>, for example), causes those strings to share a
-  // single instance of each distinct piece of text. GNU's libstdc++ uses
-  // reference counts, and I believe MSVC did as well, at some point.
-  // However, C++ '11 implementations are moving away from reference
-  // counting.
-  //
-  // In other implementations, string assignments copy the string's text,
-  // so this set will actually hold yet another copy of the string (although
-  // everything will still work). To improve memory consumption portably,
-  // we will probably need to use pointers to strings held in this set.
-  unordered_set<string> common_strings;
+  // The results of demangling the linkage names seen so far, for each
+  // language that has demangled any. The same linkage names recur in
+  // every compilation unit that declares or instantiates them.
+  map<const Language *, DemangleCache> demangle_caches;
 
   // A map from offsets of DIEs within the .debug_info section to
   // Specifications describing those DIEs. Specification references can
@@ -248,7 +247,10 @@ class DwarfCUToModule::GenericDIEHandler: public dwarf2reader::DIEHandler {
         offset_(offset),
         declaration_(false),
         specification_(NULL),
-        forward_ref_die_offset_(0) { }
+        forward_ref_die_offset_(0),
+        name_attribute_(NULL),
+        demangled_name_(NULL),
+        raw_name_(NULL) { }
 
   // Derived classes' ProcessAttributeUnsigned can defer to this to
   // handle DW_AT_declaration, or simply not override it.
@@ -283,13 +285,15 @@ class DwarfCUToModule::GenericDIEHandler: public dwarf2reader::DIEHandler {
   DIEContext *parent_context_;
   uint64_t offset_;
 
-  // Place the name in the global set of strings. Even though this looks
-  // like a copy, all the major string implementations use reference
-  // counting internally, so the effect is to have all the data structures
-  // share copies of strings whenever possible.
-  // FIXME: Should this return something like a string_ref to avoid the
-  // assumption about how strings are implemented?
-  string AddStringToPool(const string &str);
+  // Return the module's interned copy of STR, so that all the data
+  // structures share a single copy of each distinct name.
+  const string *AddStringToPool(const string &str);
+
+  // Demangle the linkage name MANGLED in this CU's language, reusing
+  // the result from an earlier DIE if there is one. Set *DEMANGLED to
+  // the interned demangled name on success.
+  Language::DemangleResult Demangle(const string &mangled,
+                                    const string **demangled);
 
   // If this DIE has a DW_AT_declaration attribute, this is its value.
   // It is false on DIEs with no DW_AT_declaration attribute.
@@ -305,18 +309,18 @@ class DwarfCUToModule::GenericDIEHandler: public dwarf2reader::DIEHandler {
   // to be fixed up when the DIE is parsed.
   uint64_t forward_ref_die_offset_;
 
-  // The value of the DW_AT_name attribute, or the empty string if the
+  // The interned value of the DW_AT_name attribute, or NULL if the
   // DIE has no such attribute.
-  string name_attribute_;
+  const string *name_attribute_;
 
-  // The demangled value of the DW_AT_MIPS_linkage_name attribute, or the empty
-  // string if the DIE has no such attribute or its content could not be
+  // The interned demangled value of the DW_AT_MIPS_linkage_name attribute,
+  // or NULL if the DIE has no such attribute or its content could not be
   // demangled.
-  string demangled_name_;
+  const string *demangled_name_;
 
-  // The non-demangled value of the DW_AT_MIPS_linkage_name attribute,
-  // it its content count not be demangled.
-  string raw_name_;
+  // The interned non-demangled value of the DW_AT_MIPS_linkage_name
+  // attribute, it its content count not be demangled, or NULL.
+  const string *raw_name_;
 };
 
 void DwarfCUToModule::GenericDIEHandler::ProcessAttributeUnsigned(
@@ -362,10 +366,27 @@ void DwarfCUToModule::GenericDIEHandler::ProcessAttributeReference(
   }
 }
 
-string DwarfCUToModule::GenericDIEHandler::AddStringToPool(const string &str) {
-  pair<unordered_set<string>::iterator, bool> result =
-    cu_context_->file_context->file_private_->common_strings.insert(str);
-  return *result.first;
+const string *DwarfCUToModule::GenericDIEHandler::AddStringToPool(
+    const string &str) {
+  return cu_context_->file_context->module_->InternString(str);
+}
+
+Language::DemangleResult DwarfCUToModule::GenericDIEHandler::Demangle(
+    const string &mangled, const string **demangled) {
+  DemangleCache &cache = cu_context_->file_context->file_private_->
+      demangle_caches[cu_context_->language];
+  DemangleCache::iterator it = cache.find(mangled);
+  if (it == cache.end()) {
+    DemangledName entry;
+    string demangled_text;
+    entry.result =
+        cu_context_->language->DemangleName(mangled, &demangled_text);
+    entry.name = entry.result == Language::kDemangleSuccess ?
+        AddStringToPool(demangled_text) : NULL;
+    it = cache.insert(std::make_pair(mangled, entry)).first;
+  }
+  *demangled = it->second.name;
+  return it->second.result;
 }
 
 void DwarfCUToModule::GenericDIEHandler::ProcessAttributeString(
@@ -378,19 +399,18 @@ void DwarfCUToModule::GenericDIEHandler::ProcessAttributeString(
       break;
     case dwarf2reader::DW_AT_MIPS_linkage_name:
     case dwarf2reader::DW_AT_linkage_name: {
-      string demangled;
-      Language::DemangleResult result =
-          cu_context_->language->DemangleName(data, &demangled);
+      const string *demangled;
+      Language::DemangleResult result = Demangle(data, &demangled);
       switch (result) {
         case Language::kDemangleSuccess:
-          demangled_name_ = AddStringToPool(demangled);
+          demangled_name_ = demangled;
           break;
 
         case Language::kDemangleFailure:
           cu_context_->reporter->DemangleError(data);
           // fallthrough
         case Language::kDontDemangle:
-          demangled_name_.clear();
+          demangled_name_ = NULL;
           raw_name_ = AddStringToPool(data);
           break;
       }
@@ -405,12 +425,12 @@ string DwarfCUToModule::GenericDIEHandler::ComputeQualifiedName() {
   // preferable to those inferred from the DWARF structure because they
   // include argument types.
   const string *qualified_name = NULL;
-  if (!demangled_name_.empty()) {
+  if (demangled_name_ && !demangled_name_->empty()) {
     // Found it is this DIE.
-    qualified_name = &demangled_name_;
-  } else if (specification_ && !specification_->qualified_name.empty()) {
+    qualified_name = demangled_name_;
+  } else if (specification_ && !specification_->qualified_name->empty()) {
     // Found it on the specification.
-    qualified_name = &specification_->qualified_name;
+    qualified_name = specification_->qualified_name;
   }
 
   const string *unqualified_name = NULL;
@@ -418,18 +438,18 @@ string DwarfCUToModule::GenericDIEHandler::ComputeQualifiedName() {
   if (!qualified_name) {
     // Find the unqualified name. If the DIE has its own DW_AT_name
     // attribute, then use that; otherwise, check the specification.
-    if (!name_attribute_.empty())
-      unqualified_name = &name_attribute_;
+    if (name_attribute_ && !name_attribute_->empty())
+      unqualified_name = name_attribute_;
     else if (specification_)
-      unqualified_name = &specification_->unqualified_name;
-    else if (!raw_name_.empty())
-      unqualified_name = &raw_name_;
+      unqualified_name = specification_->unqualified_name;
+    else if (raw_name_ && !raw_name_->empty())
+      unqualified_name = raw_name_;
 
     // Find the name of the enclosing context. If this DIE has a
     // specification, it's the specification's enclosing context that
     // counts; otherwise, use this DIE's context.
     if (specification_)
-      enclosing_name = &specification_->enclosing_name;
+      enclosing_name = specification_->enclosing_name;
     else
       enclosing_name = &parent_context_->name;
   }
@@ -450,12 +470,13 @@ string DwarfCUToModule::GenericDIEHandler::ComputeQualifiedName() {
   // specification table.
   if ((declaration_ && qualified_name) ||
       (unqualified_name && enclosing_name)) {
-    Specification spec;
+    const string *empty = AddStringToPool(string());
+    Specification spec = { empty, empty, empty };
     if (qualified_name) {
-      spec.qualified_name = *qualified_name;
+      spec.qualified_name = qualified_name;
     } else {
-      spec.enclosing_name = *enclosing_name;
-      spec.unqualified_name = *unqualified_name;
+      spec.enclosing_name = AddStringToPool(*enclosing_name);
+      spec.unqualified_name = unqualified_name;
     }
     cu_context_->file_context->file_private_->specifications[offset_] = spec;
   }
@@ -800,6 +821,7 @@ DwarfCUToModule::DwarfCUToModule(FileContext *file_context,
                                  RangesHandler *ranges_handler,
                                  WarningReporter *reporter)
     : line_reader_(line_reader),
+      functions_observer_(NULL),
       cu_context_(new CUContext(file_context, reporter, ranges_handler)),
       child_context_(new DIEContext()),
       has_source_line_info_(false) {
@@ -1215,6 +1237,9 @@ void DwarfCUToModule::Finish() {
   // Dole out lines to the appropriate functions.
   AssignLinesToFunctions();
 
+  if (functions_observer_ && !functions->empty())
+    functions_observer_->AddingFunctions(*functions);
+
   // Add our functions, which now have source lines assigned to them,
   // to module_.
   cu_context_->file_context->module_->AddFunctions(functions->begin(),
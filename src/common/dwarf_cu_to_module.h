@@ -162,6 +162,20 @@ class DwarfCUToModule: public dwarf2reader::RootDIEHandler {
                              Module *module, vector<Module::Line> *lines) = 0;
   };
 
+  // An abstract base class for observers that want to see the
+  // functions each compilation unit contributes to the module.
+  class FunctionsObserver {
+   public:
+    FunctionsObserver() { }
+    virtual ~FunctionsObserver() { }
+
+    // Called with the compilation unit's FUNCTIONS, their source lines
+    // assigned, just before the module takes ownership of them. Not
+    // called for compilation units that contribute no functions.
+    virtual void AddingFunctions(
+        const vector<Module::Function *> &functions) = 0;
+  };
+
   // The interface DwarfCUToModule uses to report warnings. The member
   // function definitions for this class write messages to stderr, but
   // you can override them if you'd like to detect or report these
@@ -284,6 +298,12 @@ class DwarfCUToModule: public dwarf2reader::RootDIEHandler {
                             uint8_t dwarf_version);
   bool StartRootDIE(uint64_t offset, enum DwarfTag tag);
 
+  // Show OBSERVER the functions this compilation unit adds to the
+  // module. OBSERVER is owned by the caller.
+  void SetFunctionsObserver(FunctionsObserver *observer) {
+    functions_observer_ = observer;
+  }
+
  private:
   // Used internally by the handler. Full definitions are in
   // dwarf_cu_to_module.cc.
@@ -321,6 +341,9 @@ class DwarfCUToModule: public dwarf2reader::RootDIEHandler {
   // The handler to use to handle line number data.
   LineToModuleHandler *line_reader_;
 
+  // The observer to show our functions to, or NULL.
+  FunctionsObserver *functions_observer_;
+
   // This compilation unit's context.
   scoped_ptr<CUContext> cu_context_;
 
@@ -101,11 +101,24 @@ void DwarfLineToModule::DefineFile(const string &name, int32_t file_num,
   // Find a Module::File object of the given name, and add it to the
   // file table.
   files_[file_num] = module_->FindFile(full_name);
+  last_file_ = NULL;
 }
 
 void DwarfLineToModule::AddLine(uint64_t address, uint64_t length,
                                 uint32_t file_num, uint32_t line_num,
                                 uint32_t column_num) {
+  AddOneLine(address, length, file_num, line_num);
+}
+
+void DwarfLineToModule::AddLines(const dwarf2reader::LineInfoRow* rows,
+                                 size_t count) {
+  for (size_t i = 0; i < count; i++)
+    AddOneLine(rows[i].address, rows[i].length, rows[i].file_num,
+               rows[i].line_num);
+}
+
+void DwarfLineToModule::AddOneLine(uint64_t address, uint64_t length,
+                                   uint32_t file_num, uint32_t line_num) {
   if (length == 0)
     return;
 
@@ -122,7 +135,15 @@ void DwarfLineToModule::AddLine(uint64_t address, uint64_t length,
   }
 
   // Find the source file being referred to.
-  Module::File *file = files_[file_num];
+  Module::File *file;
+  if (last_file_ && file_num == last_file_number_) {
+    file = last_file_;
+  } else {
+    FileTable::const_iterator it = files_.find(file_num);
+    file = it != files_.end() ? it->second : NULL;
+    last_file_number_ = file_num;
+    last_file_ = file;
+  }
   if (!file) {
     if (!warned_bad_file_number_) {
       fprintf(stderr, "warning: DWARF line number data refers to "
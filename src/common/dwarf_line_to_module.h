@@ -126,6 +126,8 @@ class DwarfLineToModule: public dwarf2reader::LineInfoHandler {
         compilation_dir_(compilation_dir),
         lines_(lines),
         highest_file_number_(-1),
+        last_file_number_(0),
+        last_file_(NULL),
         omitted_line_end_(0),
         warned_bad_file_number_(false),
         warned_bad_directory_number_(false) { }
@@ -138,12 +140,18 @@ class DwarfLineToModule: public dwarf2reader::LineInfoHandler {
                   uint64_t length);
   void AddLine(uint64_t address, uint64_t length,
                uint32_t file_num, uint32_t line_num, uint32_t column_num);
+  void AddLines(const dwarf2reader::LineInfoRow* rows, size_t count);
 
  private:
 
   typedef std::map<uint32_t, string> DirectoryTable;
   typedef std::map<uint32_t, Module::File *> FileTable;
 
+  // Add a line, as for AddLine. This is the non-virtual part of AddLine
+  // and AddLines.
+  void AddOneLine(uint64_t address, uint64_t length,
+                  uint32_t file_num, uint32_t line_num);
+
   // The module we're contributing debugging info to. Owned by our
   // client.
   Module *module_;
@@ -172,6 +180,13 @@ class DwarfLineToModule: public dwarf2reader::LineInfoHandler {
   // The highest file number we've seen so far, or -1 if we've seen
   // none.  Used for dynamically defined file numbers.
   int32_t highest_file_number_;
+
+  // The file number of the last line we added, and its file. Runs of
+  // lines from the same file are the rule, so this saves most lookups
+  // in files_. LAST_FILE_ is NULL if there is no such line, or if
+  // files_ has changed since.
+  uint32_t last_file_number_;
+  Module::File *last_file_;
   
   // This is the ending address of the last line we omitted, or zero if we
   // didn't omit the previous line. It is zero before we have received any
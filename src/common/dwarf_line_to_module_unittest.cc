@@ -123,6 +123,50 @@ TEST(SimpleModule, Many) {
   EXPECT_EQ(0x75047044, lines[4].number);
 }
 
+TEST(SimpleModule, Batch) {
+  Module m("name", "os", "architecture", "id");
+  vector<Module::Line> lines;
+  DwarfLineToModule h(&m, "/", &lines);
+
+  h.DefineFile("file1", 1, 0, 0, 0);
+  h.DefineFile("file2", 2, 0, 0, 0);
+  const dwarf2reader::LineInfoRow rows[] = {
+    { 0x1000, 0x10, 1, 10, 0 },
+    { 0x1010, 0x08, 1, 11, 0 },
+    { 0x1018, 0x00, 1, 12, 0 },         // empty; should be omitted
+    { 0x1018, 0x04, 2, 20, 0 },
+    { 0x101c, 0x04, 3, 30, 0 },         // bad file number
+    { 0x1020, 0x0c, 1, 13, 0 },
+  };
+  h.AddLines(rows, sizeof(rows) / sizeof(rows[0]));
+
+  // Defining a file after a batch must not confuse later lookups.
+  h.DefineFile("file3", 1, 0, 0, 0);
+  h.AddLine(0x2000, 0x10, 1, 40, 0);
+
+  vector<Module::File *> files;
+  m.GetFiles(&files);
+  ASSERT_EQ(3U, files.size());
+
+  ASSERT_EQ(5U, lines.size());
+  EXPECT_EQ(0x1000U, lines[0].address);
+  EXPECT_EQ(0x10U, lines[0].size);
+  EXPECT_STREQ("/file1", lines[0].file->name.c_str());
+  EXPECT_EQ(10, lines[0].number);
+  EXPECT_EQ(0x1010U, lines[1].address);
+  EXPECT_STREQ("/file1", lines[1].file->name.c_str());
+  EXPECT_EQ(11, lines[1].number);
+  EXPECT_EQ(0x1018U, lines[2].address);
+  EXPECT_STREQ("/file2", lines[2].file->name.c_str());
+  EXPECT_EQ(20, lines[2].number);
+  EXPECT_EQ(0x1020U, lines[3].address);
+  EXPECT_STREQ("/file1", lines[3].file->name.c_str());
+  EXPECT_EQ(13, lines[3].number);
+  EXPECT_EQ(0x2000U, lines[4].address);
+  EXPECT_STREQ("/file3", lines[4].file->name.c_str());
+  EXPECT_EQ(40, lines[4].number);
+}
+
 TEST(Filenames, Absolute) {
   Module m("name", "os", "architecture", "id");
   vector<Module::Line> lines;
@@ -32,6 +32,10 @@
 // dump_symbols.cc: implement google_breakpad::WriteSymbolFile:
 // Find all the debugging info in a file and dump it as a Breakpad symbol file.
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include "common/linux/dump_symbols.h"
 
 #include <assert.h>
@@ -40,6 +44,7 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <link.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -47,8 +52,15 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <set>
 #include <string>
 #include <utility>
@@ -57,6 +69,7 @@
 #include "common/dwarf/bytereader-inl.h"
 #include "common/dwarf/dwarf2diehandler.h"
 #include "common/dwarf_cfi_to_module.h"
+#include "common/dwarf_cu_cache.h"
 #include "common/dwarf_cu_to_module.h"
 #include "common/dwarf_line_to_module.h"
 #include "common/dwarf_range_list_handler.h"
@@ -81,6 +94,7 @@ namespace {
 
 using google_breakpad::DumpOptions;
 using google_breakpad::DwarfCFIToModule;
+using google_breakpad::DwarfCUCache;
 using google_breakpad::DwarfCUToModule;
 using google_breakpad::DwarfLineToModule;
 using google_breakpad::DwarfRangeListHandler;
@@ -105,6 +119,15 @@ using google_breakpad::wasteful_vector;
 #define EM_AARCH64      183
 #endif
 
+// Define the compressed section flag and compression type if the host's
+// <elf.h> predates them.
+#ifndef SHF_COMPRESSED
+#define SHF_COMPRESSED  (1 << 11)
+#endif
+#ifndef ELFCOMPRESS_ZLIB
+#define ELFCOMPRESS_ZLIB 1
+#endif
+
 //
 // FDWrapper
 //
@@ -162,6 +185,251 @@ class MmapWrapper {
   size_t size_;
 };
 
+// The compression header at the start of SHF_COMPRESSED sections, by
+// ELF class.
+template<typename ElfClass>
+struct ElfCompressionHeader;
+
+template<>
+struct ElfCompressionHeader<ElfClass32> {
+  typedef Elf32_Chdr Chdr;
+};
+
+template<>
+struct ElfCompressionHeader<ElfClass64> {
+  typedef Elf64_Chdr Chdr;
+};
+
+// Inflate the zlib stream of COMPRESSED_SIZE bytes at COMPRESSED into
+// the UNCOMPRESSED_SIZE bytes at UNCOMPRESSED. zlib reads straight from
+// the mapped file and writes straight into the destination, so no
+// intermediate copies are made. Return true if the stream decoded to
+// exactly UNCOMPRESSED_SIZE bytes.
+#ifdef HAVE_LIBZ
+bool InflateSectionContents(const uint8_t* compressed,
+                            uint64_t compressed_size,
+                            uint8_t* uncompressed,
+                            uint64_t uncompressed_size) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit(&stream) != Z_OK)
+    return false;
+
+  // zlib counts bytes in uInts, so hand it sections larger than that
+  // a piece at a time.
+  const uint64_t kMaxChunk = std::numeric_limits<uInt>::max();
+  uint64_t in_remaining = compressed_size;
+  uint64_t out_remaining = uncompressed_size;
+  stream.next_in = const_cast<Bytef*>(compressed);
+  stream.next_out = uncompressed;
+  int status = Z_OK;
+  while (status == Z_OK) {
+    if (stream.avail_in == 0) {
+      stream.avail_in = static_cast<uInt>(std::min(in_remaining, kMaxChunk));
+      in_remaining -= stream.avail_in;
+    }
+    if (stream.avail_out == 0) {
+      stream.avail_out = static_cast<uInt>(std::min(out_remaining, kMaxChunk));
+      out_remaining -= stream.avail_out;
+    }
+    status = inflate(&stream, Z_NO_FLUSH);
+  }
+  inflateEnd(&stream);
+
+  return status == Z_STREAM_END &&
+         static_cast<uint64_t>(stream.next_out - uncompressed) ==
+             uncompressed_size;
+}
+#endif  // HAVE_LIBZ
+
+//
+// DwarfSectionCache
+//
+// Provides the contents of an ELF file's debugging sections, inflating
+// sections compressed with SHF_COMPRESSED (as produced by -gz) or stored
+// in the legacy ".zdebug_" form. A compressed section is only inflated
+// the first time it is asked for; the uncompressed contents live as long
+// as the cache does.
+//
+template<typename ElfClass>
+class DwarfSectionCache {
+ public:
+  typedef typename ElfClass::Ehdr Ehdr;
+  typedef typename ElfClass::Shdr Shdr;
+  typedef typename ElfCompressionHeader<ElfClass>::Chdr Chdr;
+
+  DwarfSectionCache(const string& filename, const Ehdr* elf_header)
+      : filename_(filename), elf_header_(elf_header) {
+    const Shdr* sections =
+        GetOffset<ElfClass, Shdr>(elf_header, elf_header->e_shoff);
+    section_names_ = GetOffset<ElfClass, char>(
+        elf_header, sections[elf_header->e_shstrndx].sh_offset);
+  }
+
+  // Return true if SECTION must be inflated before its contents can be
+  // used.
+  bool IsCompressed(const Shdr* section) const {
+    return (section->sh_flags & SHF_COMPRESSED) != 0 ||
+           IsZdebugName(section_names_ + section->sh_name);
+  }
+
+  // Return the name the DWARF readers know SECTION by: legacy
+  // ".zdebug_foo" sections hold the contents of ".debug_foo".
+  string CanonicalName(const Shdr* section) const {
+    const char* name = section_names_ + section->sh_name;
+    if (IsZdebugName(name))
+      return string(".") + (name + strlen(".z"));
+    return name;
+  }
+
+  // Set *CONTENTS and *SIZE to the usable contents of SECTION, inflating
+  // it if necessary. Return false if the section is compressed in a form
+  // we can't decode.
+  bool GetContents(const Shdr* section,
+                   const uint8_t** contents, uint64_t* size) {
+    const uint8_t* raw =
+        GetOffset<ElfClass, uint8_t>(elf_header_, section->sh_offset);
+    if (!IsCompressed(section)) {
+      *contents = raw;
+      *size = section->sh_size;
+      return true;
+    }
+
+    if (failed_.count(section))
+      return false;
+    typename UncompressedMap::iterator it = uncompressed_.find(section);
+    if (it == uncompressed_.end()) {
+      vector<uint8_t> buffer;
+      if (!Inflate(section, raw, &buffer)) {
+        failed_.insert(section);
+        return false;
+      }
+      it = uncompressed_.insert(std::make_pair(section, vector<uint8_t>()))
+               .first;
+      it->second.swap(buffer);
+    }
+    *contents = it->second.empty() ? NULL : &it->second[0];
+    *size = it->second.size();
+    return true;
+  }
+
+ private:
+  typedef std::map<const Shdr*, vector<uint8_t> > UncompressedMap;
+
+  static bool IsZdebugName(const char* name) {
+    return strncmp(name, ".zdebug_", strlen(".zdebug_")) == 0;
+  }
+
+  // Inflate the compressed SECTION, whose raw contents are at RAW, into
+  // BUFFER. Return true on success; report the problem and return false
+  // otherwise.
+  bool Inflate(const Shdr* section, const uint8_t* raw,
+               vector<uint8_t>* buffer) {
+    const char* name = section_names_ + section->sh_name;
+#ifndef HAVE_LIBZ
+    fprintf(stderr, "%s: section '%s' is compressed, but dump_syms was"
+            " built without zlib\n", filename_.c_str(), name);
+    return false;
+#else
+    uint64_t uncompressed_size;
+    const uint8_t* stream;
+    uint64_t stream_size;
+    if (section->sh_flags & SHF_COMPRESSED) {
+      // An ELF compression header, followed by the compressed stream.
+      if (section->sh_size < sizeof(Chdr)) {
+        fprintf(stderr, "%s: section '%s' is too short to be compressed\n",
+                filename_.c_str(), name);
+        return false;
+      }
+      const Chdr* header = reinterpret_cast<const Chdr*>(raw);
+      if (header->ch_type != ELFCOMPRESS_ZLIB) {
+        fprintf(stderr, "%s: section '%s' uses unsupported compression"
+                " type %u\n", filename_.c_str(), name,
+                static_cast<unsigned>(header->ch_type));
+        return false;
+      }
+      uncompressed_size = header->ch_size;
+      stream = raw + sizeof(Chdr);
+      stream_size = section->sh_size - sizeof(Chdr);
+    } else {
+      // The legacy ".zdebug_" format: the magic "ZLIB", then the
+      // uncompressed size as a 64-bit big-endian number, then the
+      // compressed stream.
+      const size_t kZdebugHeaderSize = 12;
+      if (section->sh_size < kZdebugHeaderSize ||
+          memcmp(raw, "ZLIB", 4) != 0) {
+        fprintf(stderr, "%s: section '%s' has no ZLIB header\n",
+                filename_.c_str(), name);
+        return false;
+      }
+      uncompressed_size = 0;
+      for (size_t i = 4; i < kZdebugHeaderSize; i++)
+        uncompressed_size = (uncompressed_size << 8) | raw[i];
+      stream = raw + kZdebugHeaderSize;
+      stream_size = section->sh_size - kZdebugHeaderSize;
+    }
+
+    // Deflate cannot compress by more than a factor of 1032, so a larger
+    // claimed size means the header is corrupt. Check before allocating.
+    const uint64_t kMaxDeflateRatio = 1032;
+    if (uncompressed_size / kMaxDeflateRatio > stream_size) {
+      fprintf(stderr, "%s: section '%s' claims an uncompressed size of"
+              " %" PRIu64 " bytes, too large for its %" PRIu64
+              " compressed bytes\n", filename_.c_str(), name,
+              uncompressed_size, stream_size);
+      return false;
+    }
+
+    buffer->resize(uncompressed_size);
+    if (uncompressed_size > 0 &&
+        !InflateSectionContents(stream, stream_size, &(*buffer)[0],
+                                uncompressed_size)) {
+      fprintf(stderr, "%s: failed to decompress section '%s'\n",
+              filename_.c_str(), name);
+      return false;
+    }
+    return true;
+#endif  // HAVE_LIBZ
+  }
+
+  // The name of the file, for use in error messages.
+  const string filename_;
+
+  // The mapped ELF file whose sections we're providing.
+  const Ehdr* elf_header_;
+
+  // The file's section name string table.
+  const char* section_names_;
+
+  // The contents of the compressed sections inflated so far.
+  UncompressedMap uncompressed_;
+
+  // Compressed sections we were unable to inflate, so that we report
+  // each problem only once.
+  std::set<const Shdr*> failed_;
+};
+
+// Return true if the DWARF readers driven by LoadDwarf look up the
+// section named NAME. Compressed sections that nothing reads are never
+// inflated.
+bool IsDwarfSectionRead(const string& name) {
+  static const char* const kSectionsRead[] = {
+    ".debug_abbrev",
+    ".debug_addr",
+    ".debug_info",
+    ".debug_line",
+    ".debug_ranges",
+    ".debug_str",
+    ".debug_str_offsets",
+  };
+  for (size_t i = 0; i < sizeof(kSectionsRead) / sizeof(kSectionsRead[0]);
+       i++) {
+    if (name == kSectionsRead[i])
+      return true;
+  }
+  return false;
+}
+
 // Find the preferred loading address of the binary.
 template<typename ElfClass>
 typename ElfClass::Addr GetLoadingAddress(
@@ -278,6 +546,8 @@ bool LoadDwarf(const string& dwarf_filename,
                const typename ElfClass::Ehdr* elf_header,
                const bool big_endian,
                bool handle_inter_cu_refs,
+               const string& cu_cache_dir,
+               DwarfSectionCache<ElfClass>* section_cache,
                Module* module) {
   typedef typename ElfClass::Shdr Shdr;
 
@@ -300,9 +570,16 @@ bool LoadDwarf(const string& dwarf_filename,
     string name = GetOffset<ElfClass, char>(elf_header,
                                             section_names->sh_offset) +
                   section->sh_name;
-    const uint8_t *contents = GetOffset<ElfClass, uint8_t>(elf_header,
-                                                           section->sh_offset);
-    file_context.AddSectionToSectionMap(name, contents, section->sh_size);
+    if (section_cache->IsCompressed(section)) {
+      // Only pay for inflating the sections the readers will look at.
+      name = section_cache->CanonicalName(section);
+      if (!IsDwarfSectionRead(name))
+        continue;
+    }
+    const uint8_t *contents;
+    uint64_t size;
+    if (section_cache->GetContents(section, &contents, &size))
+      file_context.AddSectionToSectionMap(name, contents, size);
   }
 
   // Optional .debug_ranges reader
@@ -328,7 +605,31 @@ bool LoadDwarf(const string& dwarf_filename,
   // .debug_info section.
   assert(debug_info_section.first);
   uint64_t debug_info_length = debug_info_section.second;
-  for (uint64_t offset = 0; offset < debug_info_length;) {
+  // Compilation units that share an abbreviation table parse it once,
+  // and split DWARF skeleton units share one open .dwp package.
+  dwarf2reader::AbbrevCache abbrev_cache;
+  dwarf2reader::DwpCache dwp_cache;
+
+  // If we have a cache of compilation units' functions, work out which
+  // entries we want.
+  scoped_ptr<DwarfCUCache> cu_cache;
+  std::vector<DwarfCUCache::Key> cu_keys;
+  if (!cu_cache_dir.empty()) {
+    cu_cache.reset(new DwarfCUCache(cu_cache_dir, file_context.section_map(),
+                                    &byte_reader, handle_inter_cu_refs));
+    if (!cu_cache->ComputeKeys(&cu_keys)) {
+      fprintf(stderr, "%s: can't compute compilation unit keys;"
+              " not using the symbol cache\n", dwarf_filename.c_str());
+      cu_cache.reset();
+    }
+  }
+
+  size_t cu_index = 0;
+  for (uint64_t offset = 0; offset < debug_info_length; cu_index++) {
+    if (cu_cache.get() && cu_cache->Load(cu_keys[cu_index], module)) {
+      offset += cu_keys[cu_index].length;
+      continue;
+    }
     // Make a handler for the root DIE that populates MODULE with the
     // data that was found.
     DwarfCUToModule::WarningReporter reporter(dwarf_filename, offset);
@@ -336,14 +637,33 @@ bool LoadDwarf(const string& dwarf_filename,
                                  ranges_handler.get(), &reporter);
     // Make a Dwarf2Handler that drives the DIEHandler.
     dwarf2reader::DIEDispatcher die_dispatcher(&root_handler);
+    // If we have a cache, record the unit's functions for it, and note
+    // whether they depend on anything the unit's key doesn't cover.
+    DwarfCUCache::Recorder recorder(
+        &die_dispatcher, cu_cache.get() ? cu_keys[cu_index].base : 0);
+    dwarf2reader::Dwarf2Handler* handler = &die_dispatcher;
+    if (cu_cache.get()) {
+      root_handler.SetFunctionsObserver(&recorder);
+      handler = &recorder;
+    }
     // Make a DWARF parser for the compilation unit at OFFSET.
     dwarf2reader::CompilationUnit reader(dwarf_filename,
                                          file_context.section_map(),
                                          offset,
                                          &byte_reader,
-                                         &die_dispatcher);
+                                         handler);
+    reader.SetAbbrevCache(&abbrev_cache);
+    reader.SetDwpCache(&dwp_cache);
     // Process the entire compilation unit; get the offset of the next.
     offset += reader.Start();
+    if (cu_cache.get() && recorder.cacheable())
+      cu_cache->Store(cu_keys[cu_index], recorder);
+  }
+  if (cu_cache.get()) {
+    fprintf(stderr, "%s: read %llu of %llu compilation units from the"
+            " symbol cache\n", dwarf_filename.c_str(),
+            static_cast<unsigned long long>(cu_cache->hits()),
+            static_cast<unsigned long long>(cu_keys.size()));
   }
   return true;
 }
@@ -386,6 +706,7 @@ bool LoadDwarfCFI(const string& dwarf_filename,
                   const typename ElfClass::Shdr* got_section,
                   const typename ElfClass::Shdr* text_section,
                   const bool big_endian,
+                  DwarfSectionCache<ElfClass>* section_cache,
                   Module* module) {
   // Find the appropriate set of register names for this file's
   // architecture.
@@ -400,10 +721,12 @@ bool LoadDwarfCFI(const string& dwarf_filename,
   const dwarf2reader::Endianness endianness = big_endian ?
       dwarf2reader::ENDIANNESS_BIG : dwarf2reader::ENDIANNESS_LITTLE;
 
-  // Find the call frame information and its size.
-  const uint8_t *cfi =
-      GetOffset<ElfClass, uint8_t>(elf_header, section->sh_offset);
-  size_t cfi_size = section->sh_size;
+  // Find the call frame information and its size, inflating it if the
+  // section is compressed.
+  const uint8_t *cfi;
+  uint64_t cfi_size;
+  if (!section_cache->GetContents(section, &cfi, &cfi_size))
+    return false;
 
   // Plug together the parser, handler, and their entourages.
   DwarfCFIToModule::Reporter module_reporter(dwarf_filename, section_name);
@@ -573,6 +896,66 @@ string ReadDebugLink(const uint8_t *debuglink,
   return string();
 }
 
+// Runs one phase of LoadSymbols on a thread of its own, reading into a
+// Module of its own. The phases read disjoint sections of the mapped
+// file and share nothing else, so they can run alongside each other
+// and be merged into the real Module once they finish. If no thread
+// can be created, the phase runs right away instead.
+class SymbolLoadThread {
+ public:
+  typedef std::function<bool(Module*)> Loader;
+
+  // Start running LOAD on MODULE, which this object takes ownership of.
+  SymbolLoadThread(Module* module, const Loader& load)
+      : module_(module), load_(load), result_(false), running_(false) {
+    running_ = pthread_create(&thread_, NULL, Run, this) == 0;
+    if (!running_)
+      Run(this);
+  }
+
+  ~SymbolLoadThread() { Join(); }
+
+  // Wait for the phase to finish, merge what it read into MODULE, and
+  // return its result.
+  bool Finish(Module* module) {
+    Join();
+    module->MergeFrom(module_.get());
+    return result_;
+  }
+
+ private:
+  static void* Run(void* arg) {
+    SymbolLoadThread* self = static_cast<SymbolLoadThread*>(arg);
+    self->result_ = self->load_(self->module_.get());
+    return NULL;
+  }
+
+  void Join() {
+    if (running_) {
+      pthread_join(thread_, NULL);
+      running_ = false;
+    }
+  }
+
+  scoped_ptr<Module> module_;
+  Loader load_;
+  bool result_;
+  bool running_;
+  pthread_t thread_;
+};
+
+// Return a new, empty Module with MODULE's header, LOAD_ADDRESS and
+// ADDRESS_RANGES, for a SymbolLoadThread to fill.
+Module* NewPartialModule(const Module& module, Module::Address load_address,
+                         const vector<Module::Range>& address_ranges) {
+  Module* partial = new Module(module.name(), module.os(),
+                               module.architecture(), module.identifier(),
+                               module.code_identifier());
+  partial->SetLoadAddress(load_address);
+  partial->SetAddressRanges(address_ranges);
+  return partial;
+}
+
 //
 // LoadSymbolsInfo
 //
@@ -683,110 +1066,63 @@ bool LoadSymbols(const string& obj_file,
   bool found_debug_info_section = false;
   bool found_usable_info = false;
 
-  if (options.symbol_data != ONLY_CFI) {
-#ifndef NO_STABS_SUPPORT
-    // Look for STABS debugging information, and load it if present.
-    const Shdr* stab_section =
-      FindElfSectionByName<ElfClass>(".stab", SHT_PROGBITS,
-                                     sections, names, names_end,
-                                     elf_header->e_shnum);
-    if (stab_section) {
-      const Shdr* stabstr_section = stab_section->sh_link + sections;
-      if (stabstr_section) {
-        found_debug_info_section = true;
-        found_usable_info = true;
-        info->LoadedSection(".stab");
-        if (!LoadStabs<ElfClass>(elf_header, stab_section, stabstr_section,
-                                 big_endian, module)) {
-          fprintf(stderr, "%s: \".stab\" section found, but failed to load"
-                  " STABS debugging information\n", obj_file.c_str());
-        }
-      }
-    }
-#endif  // NO_STABS_SUPPORT
-
-    // Look for DWARF debugging information, and load it if present.
-    const Shdr* dwarf_section =
-      FindElfSectionByName<ElfClass>(".debug_info", SHT_PROGBITS,
-                                     sections, names, names_end,
-                                     elf_header->e_shnum);
-
-    // .debug_info section type is SHT_PROGBITS for mips on pnacl toolchains,
-    // but MIPS_DWARF for regular gnu toolchains, so both need to be checked
-    if (elf_header->e_machine == EM_MIPS && !dwarf_section) {
-      dwarf_section =
-        FindElfSectionByName<ElfClass>(".debug_info", SHT_MIPS_DWARF,
-                                       sections, names, names_end,
-                                       elf_header->e_shnum);
-    }
+  // Compressed debugging sections are inflated on first use, and kept
+  // until we're done with this file.
+  DwarfSectionCache<ElfClass> section_cache(obj_file, elf_header);
 
-    if (dwarf_section) {
-      found_debug_info_section = true;
-      found_usable_info = true;
-      info->LoadedSection(".debug_info");
-      if (!LoadDwarf<ElfClass>(obj_file, elf_header, big_endian,
-                               options.handle_inter_cu_refs, module)) {
-        fprintf(stderr, "%s: \".debug_info\" section found, but failed to load "
-                "DWARF debugging information\n", obj_file.c_str());
-      }
-    }
+  // The ELF symbol table and the two kinds of call frame information
+  // live in sections of their own, and only meet the STABS and DWARF
+  // data in MODULE. Read each into a Module of its own on a thread of
+  // its own while this thread reads the debugging information, and
+  // merge them in afterwards.
+  scoped_ptr<SymbolLoadThread> symbols_thread;
+  scoped_ptr<SymbolLoadThread> debug_frame_thread;
+  scoped_ptr<SymbolLoadThread> eh_frame_thread;
 
+  if (options.symbol_data != ONLY_CFI) {
     // See if there are export symbols available.
-    const Shdr* symtab_section =
+    const Shdr* symbols_section =
         FindElfSectionByName<ElfClass>(".symtab", SHT_SYMTAB,
                                        sections, names, names_end,
                                        elf_header->e_shnum);
-    const Shdr* strtab_section =
+    const Shdr* strings_section =
         FindElfSectionByName<ElfClass>(".strtab", SHT_STRTAB,
                                        sections, names, names_end,
                                        elf_header->e_shnum);
-    if (symtab_section && strtab_section) {
+    if (symbols_section && strings_section) {
       info->LoadedSection(".symtab");
-
-      const uint8_t* symtab =
-          GetOffset<ElfClass, uint8_t>(elf_header,
-                                       symtab_section->sh_offset);
-      const uint8_t* strtab =
-          GetOffset<ElfClass, uint8_t>(elf_header,
-                                       strtab_section->sh_offset);
-      bool result =
-          ELFSymbolsToModule(symtab,
-                             symtab_section->sh_size,
-                             strtab,
-                             strtab_section->sh_size,
-                             big_endian,
-                             ElfClass::kAddrSize,
-                             module);
-      found_usable_info = found_usable_info || result;
     } else {
       // Look in dynsym only if full symbol table was not available.
-      const Shdr* dynsym_section =
+      symbols_section =
           FindElfSectionByName<ElfClass>(".dynsym", SHT_DYNSYM,
                                          sections, names, names_end,
                                          elf_header->e_shnum);
-      const Shdr* dynstr_section =
+      strings_section =
           FindElfSectionByName<ElfClass>(".dynstr", SHT_STRTAB,
                                          sections, names, names_end,
                                          elf_header->e_shnum);
-      if (dynsym_section && dynstr_section) {
+      if (symbols_section && strings_section)
         info->LoadedSection(".dynsym");
+    }
 
-        const uint8_t* dynsyms =
-            GetOffset<ElfClass, uint8_t>(elf_header,
-                                         dynsym_section->sh_offset);
-        const uint8_t* dynstrs =
-            GetOffset<ElfClass, uint8_t>(elf_header,
-                                         dynstr_section->sh_offset);
-        bool result =
-            ELFSymbolsToModule(dynsyms,
-                               dynsym_section->sh_size,
-                               dynstrs,
-                               dynstr_section->sh_size,
-                               big_endian,
-                               ElfClass::kAddrSize,
-                               module);
-        found_usable_info = found_usable_info || result;
-      }
+    if (symbols_section && strings_section) {
+      const uint8_t* symbols =
+          GetOffset<ElfClass, uint8_t>(elf_header,
+                                       symbols_section->sh_offset);
+      const uint8_t* strings =
+          GetOffset<ElfClass, uint8_t>(elf_header,
+                                       strings_section->sh_offset);
+      symbols_thread.reset(new SymbolLoadThread(
+          NewPartialModule(*module, loading_addr, address_ranges),
+          [=](Module* partial) {
+            return ELFSymbolsToModule(symbols,
+                                      symbols_section->sh_size,
+                                      strings,
+                                      strings_section->sh_size,
+                                      big_endian,
+                                      ElfClass::kAddrSize,
+                                      partial);
+          }));
     }
   }
 
@@ -807,16 +1143,26 @@ bool LoadSymbols(const string& obj_file,
                                         elf_header->e_shnum);
     }
 
+    if (!dwarf_cfi_section) {
+      dwarf_cfi_section =
+          FindElfSectionByName<ElfClass>(".zdebug_frame", SHT_PROGBITS,
+                                         sections, names, names_end,
+                                         elf_header->e_shnum);
+    }
+
     if (dwarf_cfi_section) {
-      // Ignore the return value of this function; even without call frame
-      // information, the other debugging information could be perfectly
-      // useful.
       info->LoadedSection(".debug_frame");
-      bool result =
-          LoadDwarfCFI<ElfClass>(obj_file, elf_header, ".debug_frame",
-                                 dwarf_cfi_section, false, 0, 0, big_endian,
-                                 module);
-      found_usable_info = found_usable_info || result;
+      debug_frame_thread.reset(new SymbolLoadThread(
+          NewPartialModule(*module, loading_addr, address_ranges),
+          [=](Module* partial) {
+            // Each thread inflates the sections it reads itself.
+            DwarfSectionCache<ElfClass> cfi_section_cache(obj_file,
+                                                          elf_header);
+            return LoadDwarfCFI<ElfClass>(obj_file, elf_header,
+                                          ".debug_frame", dwarf_cfi_section,
+                                          false, 0, 0, big_endian,
+                                          &cfi_section_cache, partial);
+          }));
     }
 
     // Linux C++ exception handling information can also provide
@@ -837,15 +1183,97 @@ bool LoadSymbols(const string& obj_file,
                                          sections, names, names_end,
                                          elf_header->e_shnum);
       info->LoadedSection(".eh_frame");
-      // As above, ignore the return value of this function.
-      bool result =
-          LoadDwarfCFI<ElfClass>(obj_file, elf_header, ".eh_frame",
-                                 eh_frame_section, true,
-                                 got_section, text_section, big_endian, module);
-      found_usable_info = found_usable_info || result;
+      eh_frame_thread.reset(new SymbolLoadThread(
+          NewPartialModule(*module, loading_addr, address_ranges),
+          [=](Module* partial) {
+            DwarfSectionCache<ElfClass> cfi_section_cache(obj_file,
+                                                          elf_header);
+            return LoadDwarfCFI<ElfClass>(obj_file, elf_header, ".eh_frame",
+                                          eh_frame_section, true,
+                                          got_section, text_section,
+                                          big_endian, &cfi_section_cache,
+                                          partial);
+          }));
     }
   }
 
+  if (options.symbol_data != ONLY_CFI) {
+#ifndef NO_STABS_SUPPORT
+    // Look for STABS debugging information, and load it if present.
+    const Shdr* stab_section =
+      FindElfSectionByName<ElfClass>(".stab", SHT_PROGBITS,
+                                     sections, names, names_end,
+                                     elf_header->e_shnum);
+    if (stab_section) {
+      const Shdr* stabstr_section = stab_section->sh_link + sections;
+      if (stabstr_section) {
+        found_debug_info_section = true;
+        found_usable_info = true;
+        info->LoadedSection(".stab");
+        if (!LoadStabs<ElfClass>(elf_header, stab_section, stabstr_section,
+                                 big_endian, module)) {
+          fprintf(stderr, "%s: \".stab\" section found, but failed to load"
+                  " STABS debugging information\n", obj_file.c_str());
+        }
+      }
+    }
+#endif  // NO_STABS_SUPPORT
+
+    // Look for DWARF debugging information, and load it if present.
+    const Shdr* dwarf_section =
+      FindElfSectionByName<ElfClass>(".debug_info", SHT_PROGBITS,
+                                     sections, names, names_end,
+                                     elf_header->e_shnum);
+
+    // .debug_info section type is SHT_PROGBITS for mips on pnacl toolchains,
+    // but MIPS_DWARF for regular gnu toolchains, so both need to be checked
+    if (elf_header->e_machine == EM_MIPS && !dwarf_section) {
+      dwarf_section =
+        FindElfSectionByName<ElfClass>(".debug_info", SHT_MIPS_DWARF,
+                                       sections, names, names_end,
+                                       elf_header->e_shnum);
+    }
+
+    // Older toolchains compress debugging information into ".zdebug_"
+    // sections instead of marking them SHF_COMPRESSED.
+    if (!dwarf_section) {
+      dwarf_section =
+        FindElfSectionByName<ElfClass>(".zdebug_info", SHT_PROGBITS,
+                                       sections, names, names_end,
+                                       elf_header->e_shnum);
+    }
+
+    if (dwarf_section) {
+      found_debug_info_section = true;
+      found_usable_info = true;
+      info->LoadedSection(".debug_info");
+      if (!LoadDwarf<ElfClass>(obj_file, elf_header, big_endian,
+                               options.handle_inter_cu_refs,
+                               options.cu_cache_dir, &section_cache,
+                               module)) {
+        fprintf(stderr, "%s: \".debug_info\" section found, but failed to load "
+                "DWARF debugging information\n", obj_file.c_str());
+      }
+    }
+  }
+
+  // Merge the other threads' results in, in the order they were read
+  // before they had threads of their own. A CFI loader failing only
+  // means it found nothing usable; even without call frame information,
+  // the other debugging information could be perfectly useful.
+  if (symbols_thread.get()) {
+    bool result = symbols_thread->Finish(module);
+    found_usable_info = found_usable_info || result;
+  }
+  if (debug_frame_thread.get()) {
+    bool result = debug_frame_thread->Finish(module);
+    found_usable_info = found_usable_info || result;
+  }
+  if (eh_frame_thread.get()) {
+    bool result = eh_frame_thread->Finish(module);
+    found_usable_info = found_usable_info || result;
+  }
+
   if (!found_debug_info_section) {
     fprintf(stderr, "%s: file contains no debugging information"
             " (no \".stab\" or \".debug_info\" sections)\n",
@@ -997,6 +1425,7 @@ bool ReadSymbolDataElfClass(const typename ElfClass::Ehdr* elf_header,
                                        module)) {
     return false;
   }
+  module->SetFunctionMemoryLimit(options.function_memory_limit);
 
   // Figure out what endianness this file is.
   bool big_endian;
@@ -1089,6 +1518,21 @@ bool WriteSymbolFileHeader(const string& load_path,
                            const string& obj_file,
                            const string& obj_os,
                            std::ostream &sym_stream) {
+  Module* module;
+  if (!ReadSymbolDataHeader(load_path, obj_file, obj_os, &module))
+    return false;
+
+  bool result = module->Write(sym_stream, ALL_SYMBOL_DATA);
+  delete module;
+  return result;
+}
+
+bool ReadSymbolDataHeader(const string& load_path,
+                          const string& obj_file,
+                          const string& obj_os,
+                          Module** out_module) {
+  *out_module = NULL;
+
   MmapWrapper map_wrapper;
   void* elf_header = NULL;
   if (!LoadELF(load_path, &map_wrapper, &elf_header)) {
@@ -1122,7 +1566,8 @@ bool WriteSymbolFileHeader(const string& load_path,
     return false;
   }
 
-  return module->Write(sym_stream, ALL_SYMBOL_DATA);
+  *out_module = module.release();
+  return true;
 }
 
 bool ReadSymbolData(const string& load_path,
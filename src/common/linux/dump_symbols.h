@@ -49,11 +49,22 @@ class Module;
 struct DumpOptions {
   DumpOptions(SymbolData symbol_data, bool handle_inter_cu_refs)
       : symbol_data(symbol_data),
-        handle_inter_cu_refs(handle_inter_cu_refs) {
+        handle_inter_cu_refs(handle_inter_cu_refs),
+        function_memory_limit(0) {
   }
 
   SymbolData symbol_data;
   bool handle_inter_cu_refs;
+
+  // If non-zero, spill functions and their line data to a temporary
+  // file once they take up more than this many bytes; see
+  // Module::SetFunctionMemoryLimit.
+  size_t function_memory_limit;
+
+  // If non-empty, a directory in which to keep the functions read from
+  // each DWARF compilation unit, to be reused by later runs over
+  // identical units; see DwarfCUCache.
+  string cu_cache_dir;
 };
 
 // Find all the debugging information in OBJ_FILE, an ELF executable
@@ -78,6 +89,16 @@ bool WriteSymbolFileHeader(const string& load_path,
                            const string& obj_os,
                            std::ostream &sym_stream);
 
+// Read only the identifying information --- name, operating system,
+// architecture and identifier --- of the selected object file, and
+// return it in an otherwise empty MODULE. This is much cheaper than
+// reading the debugging information. The caller owns the resulting
+// Module object and must delete it when finished.
+bool ReadSymbolDataHeader(const string& load_path,
+                          const string& obj_file,
+                          const string& obj_os,
+                          Module** module);
+
 // As above, but simply return the debugging information in MODULE
 // instead of writing it to a stream. The caller owns the resulting
 // Module object and must delete it when finished.
@@ -32,14 +32,22 @@
 // dump_symbols_unittest.cc:
 // Unittests for google_breakpad::DumpSymbols
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include <elf.h>
 #include <link.h>
 #include <stdio.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
 
 #include <sstream>
 #include <vector>
 
 #include "breakpad_googletest_includes.h"
+#include "common/dwarf/cfi_assembler.h"
 #include "common/linux/elf_gnu_compat.h"
 #include "common/linux/elfutils.h"
 #include "common/linux/dump_symbols.h"
@@ -56,11 +64,14 @@ bool ReadSymbolDataInternal(const uint8_t* obj_file,
                             const DumpOptions& options,
                             Module** module);
 
+using google_breakpad::CFISection;
 using google_breakpad::synth_elf::ELF;
 using google_breakpad::synth_elf::Notes;
 using google_breakpad::synth_elf::StringTable;
 using google_breakpad::synth_elf::SymbolTable;
+using google_breakpad::test_assembler::kBigEndian;
 using google_breakpad::test_assembler::kLittleEndian;
+using google_breakpad::test_assembler::Label;
 using google_breakpad::test_assembler::Section;
 using std::stringstream;
 using std::vector;
@@ -80,6 +91,70 @@ class DumpSymbols : public Test {
     elfdata = &elfdata_v[0];
   }
 
+  // Return the contents of a .debug_frame section holding a single FDE
+  // for [0x1000, 0x1010): the CFA is the stack pointer plus one word,
+  // and the return address is saved just below it.
+  string DebugFrameContents() {
+    // DWARF register numbers for the stack pointer and return address.
+    const bool is_64 = ElfClass::kAddrSize == 8;
+    const unsigned kStackPointer = is_64 ? 7 : 4;
+    const unsigned kReturnAddress = is_64 ? 16 : 8;
+    CFISection cfi(kLittleEndian, ElfClass::kAddrSize);
+    Label cie;
+    cfi
+        .Mark(&cie)
+        .CIEHeader(1, -static_cast<int>(ElfClass::kAddrSize), kReturnAddress)
+        .D8(dwarf2reader::DW_CFA_def_cfa).ULEB128(kStackPointer)
+        .ULEB128(ElfClass::kAddrSize)
+        .D8(dwarf2reader::DW_CFA_offset | kReturnAddress).ULEB128(1)
+        .FinishEntry()
+        .FDEHeader(cie, 0x1000, 0x10)
+        .FinishEntry();
+    string contents;
+    EXPECT_TRUE(cfi.GetContents(&contents));
+    return contents;
+  }
+
+#ifdef HAVE_LIBZ
+  // Return CONTENTS compressed with zlib.
+  string Deflate(const string& contents) {
+    uLongf size = compressBound(contents.size());
+    vector<Bytef> buffer(size);
+    EXPECT_EQ(Z_OK, compress(&buffer[0], &size,
+                             reinterpret_cast<const Bytef*>(contents.data()),
+                             contents.size()));
+    return string(reinterpret_cast<const char*>(&buffer[0]), size);
+  }
+#endif  // HAVE_LIBZ
+
+  // Dump the contents of ELF's symbols, and check the CFI matches what
+  // DebugFrameContents produces.
+  void CheckDebugFrame(ELF& elf) {
+    elf.Finish();
+    this->GetElfContents(elf);
+
+    Module* module;
+    DumpOptions options(ONLY_CFI, true);
+    ASSERT_TRUE(ReadSymbolDataInternal(this->elfdata,
+                                       "foo",
+                                       "Linux",
+                                       vector<string>(),
+                                       options,
+                                       &module));
+
+    stringstream s;
+    module->Write(s, ONLY_CFI);
+    const bool is_64 = ElfClass::kAddrSize == 8;
+    const string expected =
+      string("MODULE Linux ") + ElfClass::kMachineName
+      + " 000000000000000000000000000000000 foo\n"
+      "INFO CODE_ID 00000000000000000000000000000000\n"
+      + (is_64 ? "STACK CFI INIT 1000 10 .cfa: $rsp 8 + .ra: .cfa -8 + ^\n"
+               : "STACK CFI INIT 1000 10 .cfa: $esp 4 + .ra: .cfa -4 + ^\n");
+    EXPECT_EQ(expected, s.str());
+    delete module;
+  }
+
   vector<uint8_t> elfdata_v;
   uint8_t* elfdata;
 };
@@ -205,4 +280,75 @@ TYPED_TEST(DumpSymbols, SimpleBuildID) {
   delete module;
 }
 
+#ifdef HAVE_LIBZ
+TYPED_TEST(DumpSymbols, CompressedDebugFrame) {
+  ELF elf(TypeParam::kMachine, TypeParam::kClass, kLittleEndian);
+  Section text(kLittleEndian);
+  text.Append(4096, 0);
+  elf.AddSection(".text", text, SHT_PROGBITS);
+
+  // An SHF_COMPRESSED section starts with an ELF compression header.
+  const string debug_frame = this->DebugFrameContents();
+  Section compressed(kLittleEndian);
+  if (TypeParam::kClass == ELFCLASS64) {
+    compressed.D32(ELFCOMPRESS_ZLIB).D32(0)
+              .D64(debug_frame.size()).D64(1);
+  } else {
+    compressed.D32(ELFCOMPRESS_ZLIB).D32(debug_frame.size()).D32(1);
+  }
+  compressed.Append(this->Deflate(debug_frame));
+  elf.AddSection(".debug_frame", compressed, SHT_PROGBITS, SHF_COMPRESSED);
+
+  this->CheckDebugFrame(elf);
+}
+
+TYPED_TEST(DumpSymbols, ZdebugFrame) {
+  ELF elf(TypeParam::kMachine, TypeParam::kClass, kLittleEndian);
+  Section text(kLittleEndian);
+  text.Append(4096, 0);
+  elf.AddSection(".text", text, SHT_PROGBITS);
+
+  // A legacy .zdebug_ section starts with "ZLIB" and the big-endian
+  // uncompressed size.
+  const string debug_frame = this->DebugFrameContents();
+  Section compressed(kBigEndian);
+  compressed.Append("ZLIB").D64(debug_frame.size());
+  compressed.Append(this->Deflate(debug_frame));
+  elf.AddSection(".zdebug_frame", compressed, SHT_PROGBITS);
+
+  this->CheckDebugFrame(elf);
+}
+
+TYPED_TEST(DumpSymbols, CompressedSizeTooLarge) {
+  ELF elf(TypeParam::kMachine, TypeParam::kClass, kLittleEndian);
+  Section text(kLittleEndian);
+  text.Append(4096, 0);
+  elf.AddSection(".text", text, SHT_PROGBITS);
+
+  // Claim far more uncompressed data than the stream could hold. The
+  // section should be rejected without trying to allocate that much.
+  const string debug_frame = this->DebugFrameContents();
+  Section compressed(kBigEndian);
+  compressed.Append("ZLIB").D64(0x100000000000ULL);
+  compressed.Append(this->Deflate(debug_frame));
+  elf.AddSection(".zdebug_frame", compressed, SHT_PROGBITS);
+  elf.Finish();
+  this->GetElfContents(elf);
+
+  Module* module;
+  DumpOptions options(ONLY_CFI, true);
+  if (ReadSymbolDataInternal(this->elfdata,
+                             "foo",
+                             "Linux",
+                             vector<string>(),
+                             options,
+                             &module)) {
+    stringstream s;
+    module->Write(s, ONLY_CFI);
+    EXPECT_EQ(string::npos, s.str().find("STACK CFI"));
+    delete module;
+  }
+}
+#endif  // HAVE_LIBZ
+
 }  // namespace google_breakpad
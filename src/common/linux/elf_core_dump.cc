@@ -35,6 +35,8 @@
 #include <stddef.h>
 #include <string.h>
 
+#include <algorithm>
+
 namespace google_breakpad {
 
 // Implementation of ElfCoreDump::Note.
@@ -99,10 +101,12 @@ ElfCoreDump::ElfCoreDump() {}
 
 ElfCoreDump::ElfCoreDump(const MemoryRange& content)
     : content_(content) {
+  IndexSegments();
 }
 
 void ElfCoreDump::SetContent(const MemoryRange& content) {
   content_ = content;
+  IndexSegments();
 }
 
 bool ElfCoreDump::IsValid() const {
@@ -147,23 +151,55 @@ unsigned ElfCoreDump::GetProgramHeaderCount() const {
 }
 
 bool ElfCoreDump::CopyData(void* buffer, Addr virtual_address, size_t length) {
+  uint8_t* dest = static_cast<uint8_t*>(buffer);
+  while (length > 0) {
+    const Segment* segment = FindSegment(virtual_address);
+    if (!segment)
+      return false;
+
+    size_t offset_in_segment = virtual_address - segment->start;
+    size_t chunk = std::min<size_t>(length, segment->end - virtual_address);
+    const void* data = content_.GetData(segment->offset + offset_in_segment,
+                                        chunk);
+    if (!data)
+      return false;
+    memcpy(dest, data, chunk);
+    dest += chunk;
+    virtual_address += chunk;
+    length -= chunk;
+  }
+  return true;
+}
+
+void ElfCoreDump::IndexSegments() {
+  segments_.clear();
   for (unsigned i = 0, n = GetProgramHeaderCount(); i < n; ++i) {
     const Phdr* program = GetProgramHeader(i);
-    if (program->p_type != PT_LOAD)
+    if (!program || program->p_type != PT_LOAD || program->p_filesz == 0)
       continue;
 
-    size_t offset_in_segment = virtual_address - program->p_vaddr;
-    if (virtual_address >= program->p_vaddr &&
-        offset_in_segment < program->p_filesz) {
-      const void* data =
-          content_.GetData(program->p_offset + offset_in_segment, length);
-      if (data) {
-        memcpy(buffer, data, length);
-        return true;
-      }
-    }
+    Segment segment;
+    segment.start = program->p_vaddr;
+    segment.end = program->p_vaddr + program->p_filesz;
+    segment.offset = program->p_offset;
+    if (segment.end > segment.start)
+      segments_.push_back(segment);
   }
-  return false;
+  // Cores are normally written in address order; only sort if needed.
+  if (!std::is_sorted(segments_.begin(), segments_.end()))
+    std::stable_sort(segments_.begin(), segments_.end());
+}
+
+const ElfCoreDump::Segment* ElfCoreDump::FindSegment(
+    Addr virtual_address) const {
+  Segment key;
+  key.start = virtual_address;
+  std::vector<Segment>::const_iterator next =
+      std::upper_bound(segments_.begin(), segments_.end(), key);
+  if (next == segments_.begin())
+    return NULL;
+  const Segment* segment = &*(next - 1);
+  return virtual_address < segment->end ? segment : NULL;
 }
 
 ElfCoreDump::Note ElfCoreDump::GetFirstNote() const {
@@ -38,6 +38,8 @@
 #include <link.h>
 #include <stddef.h>
 
+#include <vector>
+
 #include "common/memory_range.h"
 
 namespace google_breakpad {
@@ -106,7 +108,8 @@ class ElfCoreDump {
   // Constructor that takes the core dump content from |content|.
   explicit ElfCoreDump(const MemoryRange& content);
 
-  // Sets the core dump content to |content|.
+  // Sets the core dump content to |content|, and indexes its PT_LOAD
+  // segments for CopyData().
   void SetContent(const MemoryRange& content);
 
   // Returns true if a valid ELF header in the core dump, or false otherwise.
@@ -131,8 +134,9 @@ class ElfCoreDump {
 
   // Copies |length| bytes of data starting at |virtual_address| in the core
   // dump to |buffer|. |buffer| should be a valid pointer to a buffer of at
-  // least |length| bytes. Returns true if the data to be copied is found in
-  // the core dump, or false otherwise.
+  // least |length| bytes. The data may span several PT_LOAD segments as long
+  // as they cover it without a gap. Returns true if the data to be copied is
+  // found in the core dump, or false otherwise.
   bool CopyData(void* buffer, Addr virtual_address, size_t length);
 
   // Returns the first note found in the note section of the core dump, or
@@ -140,8 +144,27 @@ class ElfCoreDump {
   Note GetFirstNote() const;
 
  private:
+  // The part of a PT_LOAD segment that is present in the core dump file.
+  struct Segment {
+    Addr start;
+    Addr end;
+    size_t offset;
+
+    bool operator<(const Segment& other) const { return start < other.start; }
+  };
+
+  // Rebuilds |segments_| from the program headers in |content_|.
+  void IndexSegments();
+
+  // Returns the segment containing |virtual_address|, or NULL if no segment
+  // contains it.
+  const Segment* FindSegment(Addr virtual_address) const;
+
   // Core dump content.
   MemoryRange content_;
+
+  // PT_LOAD segments with file content, sorted by start address.
+  std::vector<Segment> segments_;
 };
 
 }  // namespace google_breakpad
@@ -33,6 +33,7 @@
 
 #include <set>
 #include <string>
+#include <vector>
 
 #include "breakpad_googletest_includes.h"
 #include "common/linux/elf_core_dump.h"
@@ -48,6 +49,43 @@ using google_breakpad::MemoryMappedFile;
 using google_breakpad::MemoryRange;
 using google_breakpad::WriteFile;
 using std::set;
+using std::vector;
+
+namespace {
+
+// Builds a core dump in |core| with one PT_LOAD segment of |segment_size|
+// bytes for each address in |addresses|, in that order. Each byte of a
+// segment holds the low bits of its virtual address.
+void BuildCoreWithSegments(const vector<ElfCoreDump::Addr>& addresses,
+                           size_t segment_size, vector<uint8_t>* core) {
+  const size_t data_offset = sizeof(ElfCoreDump::Ehdr) +
+      addresses.size() * sizeof(ElfCoreDump::Phdr);
+  core->assign(data_offset + addresses.size() * segment_size, 0);
+
+  ElfCoreDump::Ehdr* header =
+      reinterpret_cast<ElfCoreDump::Ehdr*>(&(*core)[0]);
+  memcpy(header->e_ident, ELFMAG, SELFMAG);
+  header->e_ident[EI_CLASS] = ElfCoreDump::kClass;
+  header->e_version = EV_CURRENT;
+  header->e_type = ET_CORE;
+  header->e_phoff = sizeof(ElfCoreDump::Ehdr);
+  header->e_phentsize = sizeof(ElfCoreDump::Phdr);
+  header->e_phnum = addresses.size();
+
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    ElfCoreDump::Phdr* program = reinterpret_cast<ElfCoreDump::Phdr*>(
+        &(*core)[header->e_phoff + i * sizeof(ElfCoreDump::Phdr)]);
+    program->p_type = PT_LOAD;
+    program->p_vaddr = addresses[i];
+    program->p_offset = data_offset + i * segment_size;
+    program->p_filesz = segment_size;
+    program->p_memsz = segment_size;
+    for (size_t j = 0; j < segment_size; ++j)
+      (*core)[program->p_offset + j] = static_cast<uint8_t>(addresses[i] + j);
+  }
+}
+
+}  // namespace
 
 TEST(ElfCoreDumpTest, DefaultConstructor) {
   ElfCoreDump core;
@@ -263,3 +301,58 @@ TEST(ElfCoreDumpTest, ValidCoreFile) {
   EXPECT_EQ(num_pr_fpvalid, num_nt_prxfpreg);
 #endif
 }
+
+TEST(ElfCoreDumpTest, CopyDataAcrossSegments) {
+  const size_t kSegmentSize = 0x100;
+  vector<ElfCoreDump::Addr> addresses;
+  // Out of order, with a gap between 0x2100 and 0x3000.
+  addresses.push_back(0x2000);
+  addresses.push_back(0x1000);
+  addresses.push_back(0x3000);
+  addresses.push_back(0x1100);
+  vector<uint8_t> content;
+  BuildCoreWithSegments(addresses, kSegmentSize, &content);
+
+  ElfCoreDump core(MemoryRange(&content[0], content.size()));
+  ASSERT_TRUE(core.IsValid());
+
+  uint8_t buffer[0x180];
+  ASSERT_TRUE(core.CopyData(buffer, 0x1010, 0x10));
+  EXPECT_EQ(0x10, buffer[0]);
+  EXPECT_EQ(0x1F, buffer[0xF]);
+
+  // 0x1000-0x1100 and 0x1100-0x1200 are contiguous.
+  ASSERT_TRUE(core.CopyData(buffer, 0x1080, sizeof(buffer)));
+  for (size_t i = 0; i < sizeof(buffer); ++i)
+    ASSERT_EQ(static_cast<uint8_t>(0x80 + i), buffer[i]) << i;
+
+  EXPECT_FALSE(core.CopyData(buffer, 0x2080, sizeof(buffer)));
+  EXPECT_FALSE(core.CopyData(buffer, 0x1180, sizeof(buffer)));
+  EXPECT_FALSE(core.CopyData(buffer, 0xF00, 0x10));
+  EXPECT_FALSE(core.CopyData(buffer, 0x4000, 0x10));
+  EXPECT_TRUE(core.CopyData(buffer, 0x30F0, 0x10));
+}
+
+// Reads every segment of a core with many segments. With a linear scan of
+// the program headers per read this takes quadratic time.
+TEST(ElfCoreDumpTest, CopyDataWithManySegments) {
+  const size_t kSegmentCount = 60000;
+  const size_t kSegmentSize = 0x40;
+  vector<ElfCoreDump::Addr> addresses;
+  for (size_t i = 0; i < kSegmentCount; ++i)
+    addresses.push_back(0x10000 + i * 2 * kSegmentSize);
+  vector<uint8_t> content;
+  BuildCoreWithSegments(addresses, kSegmentSize, &content);
+
+  ElfCoreDump core;
+  core.SetContent(MemoryRange(&content[0], content.size()));
+  ASSERT_TRUE(core.IsValid());
+
+  for (size_t i = kSegmentCount; i-- > 0;) {
+    uint8_t value;
+    ASSERT_TRUE(core.CopyData(&value, addresses[i] + 1, sizeof(value)));
+    ASSERT_EQ(static_cast<uint8_t>(addresses[i] + 1), value);
+    ASSERT_FALSE(core.CopyData(&value, addresses[i] + kSegmentSize,
+                               sizeof(value)));
+  }
+}
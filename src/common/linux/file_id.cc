@@ -67,9 +67,9 @@ static bool ElfClassBuildIDNoteIdentifier(const void *section, size_t length,
                 "Elf32_Nhdr and Elf64_Nhdr should be the same");
   typedef typename ElfClass32::Nhdr Nhdr;
 
-  const void* section_end = reinterpret_cast<const char*>(section) + length;
+  const char* section_end = reinterpret_cast<const char*>(section) + length;
   const Nhdr* note_header = reinterpret_cast<const Nhdr*>(section);
-  while (reinterpret_cast<const void *>(note_header) < section_end) {
+  while (reinterpret_cast<const char*>(note_header + 1) <= section_end) {
     if (note_header->n_type == NT_GNU_BUILD_ID)
       break;
     note_header = reinterpret_cast<const Nhdr*>(
@@ -77,13 +77,17 @@ static bool ElfClassBuildIDNoteIdentifier(const void *section, size_t length,
                   NOTE_PADDING(note_header->n_namesz) +
                   NOTE_PADDING(note_header->n_descsz));
   }
-  if (reinterpret_cast<const void *>(note_header) >= section_end ||
+  if (reinterpret_cast<const char*>(note_header + 1) > section_end ||
       note_header->n_descsz == 0) {
     return false;
   }
 
   const uint8_t* build_id = reinterpret_cast<const uint8_t*>(note_header) +
     sizeof(Nhdr) + NOTE_PADDING(note_header->n_namesz);
+  if (reinterpret_cast<const char*>(build_id) + note_header->n_descsz >
+      section_end) {
+    return false;
+  }
   identifier.insert(identifier.end(),
                     build_id,
                     build_id + note_header->n_descsz);
@@ -154,6 +158,13 @@ bool FileID::ElfFileIdentifierFromMappedFile(const void* base,
   return HashElfTextSection(base, identifier);
 }
 
+// static
+bool FileID::ElfFileIdentifierFromNotes(const void* notes,
+                                        size_t length,
+                                        wasteful_vector<uint8_t>& identifier) {
+  return ElfClassBuildIDNoteIdentifier(notes, length, identifier);
+}
+
 bool FileID::ElfFileIdentifier(wasteful_vector<uint8_t>& identifier) {
   MemoryMappedFile mapped_file(path_.c_str(), 0);
   if (!mapped_file.data())  // Should probably check if size >= ElfW(Ehdr)?
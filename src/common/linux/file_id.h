@@ -68,6 +68,13 @@ class FileID {
       const void* base,
       wasteful_vector<uint8_t>& identifier);
 
+  // Load the build ID from the |length| bytes of ELF notes at |notes|, such
+  // as the contents of a PT_NOTE segment, into |identifier|. Return false if
+  // there is no NT_GNU_BUILD_ID note among them.
+  static bool ElfFileIdentifierFromNotes(const void* notes,
+                                         size_t length,
+                                         wasteful_vector<uint8_t>& identifier);
+
   // Convert the |identifier| data to a string.  The string will
   // be formatted as a UUID in all uppercase without dashes.
   // (e.g., 22F065BBFC9C49F780FE26A7CEBD7BCE).
@@ -465,6 +465,8 @@ void DumpSymbols::ReadDwarf(google_breakpad::Module *module,
 
   // Walk the __debug_info section, one compilation unit at a time.
   uint64_t debug_info_length = debug_info_section.second;
+  // Compilation units that share an abbreviation table parse it once.
+  dwarf2reader::AbbrevCache abbrev_cache;
   for (uint64_t offset = 0; offset < debug_info_length;) {
     // Make a handler for the root DIE that populates MODULE with the
     // debug info.
@@ -480,6 +482,7 @@ void DumpSymbols::ReadDwarf(google_breakpad::Module *module,
                                                offset,
                                                &byte_reader,
                                                &die_dispatcher);
+    dwarf_reader.SetAbbrevCache(&abbrev_cache);
     // Process the entire compilation unit; get the offset of the next.
     offset += dwarf_reader.Start();
   }
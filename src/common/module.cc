@@ -37,15 +37,234 @@
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
+#include <queue>
+#include <sstream>
 #include <utility>
 
+#include "processor/fast_source_line_resolver_types.h"
+
 namespace google_breakpad {
 
 using std::dec;
 using std::hex;
 
+namespace {
+
+// Append the bytes of VALUE to FILE.
+template<typename T>
+bool WriteSpillValue(FILE *file, const T &value) {
+  return fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+// Reads the Function records of one spilled run back in order. Each
+// record holds the function's address, parameter size, name, ranges and
+// lines, in the host's byte order; lines refer to their files by
+// pointer, which stays valid since the Module owns its files for its
+// whole lifetime.
+class SpillRunReader {
+ public:
+  SpillRunReader(int fd, uint64_t offset, uint64_t size)
+      : fd_(fd), offset_(offset), end_(offset + size), buffer_(kBufferSize),
+        buffer_start_(0), buffer_end_(0), error_(false) { }
+
+  // Return the next function in the run, which the caller owns, or NULL
+  // at the end of the run or if an error occurs.
+  Module::Function *Next() {
+    Module::Address address, parameter_size;
+    uint32_t name_size;
+    if (offset_ == end_ ||
+        !Read(&address) || !Read(&parameter_size) || !Read(&name_size))
+      return NULL;
+    string name(name_size, '\0');
+    if (name_size && !ReadBytes(&name[0], name_size))
+      return NULL;
+    Module::Function *function = new Module::Function(name, address);
+    function->parameter_size = parameter_size;
+    uint32_t range_count, line_count;
+    bool ok = Read(&range_count);
+    for (uint32_t i = 0; ok && i < range_count; i++) {
+      Module::Range range(0, 0);
+      ok = Read(&range.address) && Read(&range.size);
+      function->ranges.push_back(range);
+    }
+    ok = ok && Read(&line_count);
+    for (uint32_t i = 0; ok && i < line_count; i++) {
+      Module::Line line;
+      uintptr_t file;
+      ok = Read(&line.address) && Read(&line.size) && Read(&file) &&
+          Read(&line.number);
+      line.file = reinterpret_cast<Module::File *>(file);
+      function->lines.push_back(line);
+    }
+    if (!ok) {
+      delete function;
+      return NULL;
+    }
+    return function;
+  }
+
+  // True if reading the run failed.
+  bool error() const { return error_; }
+
+ private:
+  static const size_t kBufferSize = 16 * 1024;
+
+  template<typename T>
+  bool Read(T *value) { return ReadBytes(value, sizeof(*value)); }
+
+  bool ReadBytes(void *out, size_t size) {
+    char *dest = static_cast<char *>(out);
+    while (size > 0) {
+      if (buffer_start_ == buffer_end_) {
+        uint64_t want = std::min<uint64_t>(buffer_.size(), end_ - offset_);
+        ssize_t got = want ? pread(fd_, &buffer_[0], want, offset_) : 0;
+        if (got <= 0) {
+          error_ = true;
+          return false;
+        }
+        offset_ += got;
+        buffer_start_ = 0;
+        buffer_end_ = got;
+      }
+      size_t chunk = std::min(size, buffer_end_ - buffer_start_);
+      memcpy(dest, &buffer_[buffer_start_], chunk);
+      buffer_start_ += chunk;
+      dest += chunk;
+      size -= chunk;
+    }
+    return true;
+  }
+
+  int fd_;
+  uint64_t offset_, end_;
+  vector<char> buffer_;
+  size_t buffer_start_, buffer_end_;
+  bool error_;
+};
+
+// The head of a run during the merge: the smallest function not yet
+// written, and the run it came from.
+struct SpillRunHead {
+  Module::Function *function;
+  size_t run;
+};
+
+// Orders SpillRunHeads so that a priority queue yields the smallest
+// function first, and of equal functions the one from the earliest run,
+// as FunctionSet keeps the first of a pair of duplicates.
+struct SpillRunHeadGreater {
+  bool operator()(const SpillRunHead &lhs, const SpillRunHead &rhs) const {
+    Module::FunctionCompare less;
+    if (less(rhs.function, lhs.function))
+      return true;
+    if (less(lhs.function, rhs.function))
+      return false;
+    return lhs.run > rhs.run;
+  }
+};
+
+// The pieces of the format ModuleSerializer produces, which
+// WriteSerialized writes directly. See processor/module_serializer.cc,
+// processor/map_serializers-inl.h and processor/simple_serializer-inl.h.
+
+// The number of WindowsFrameInfo::StackInfoTypes, each of which gets a
+// table of its own, and the total number of tables in the format. These
+// come from the processor, so that a change to the format there fails to
+// compile here until WriteSerialized is updated to match.
+const int kSerializedWindowsFrameInfoTables = WindowsFrameInfo::STACK_INFO_LAST;
+const int kSerializedTables = kSerializedModuleMaps;
+
+// WriteSerialized writes the files, functions and public symbols tables,
+// then the WindowsFrameInfo tables, then the two CFI tables.
+static_assert(kSerializedTables == 5 + kSerializedWindowsFrameInfoTables,
+              "WriteSerialized no longer matches ModuleSerializer's layout");
+
+// Append the bytes of VALUE to OUT, as SimpleSerializer does.
+template<typename T>
+void AppendSerialized(string *out, const T &value) {
+  out->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+// Append STR to OUT as a null-terminated string.
+void AppendSerializedString(string *out, const string &str) {
+  out->append(str.c_str(), str.size() + 1);
+}
+
+// A map serialized as StdMapSerializer does: the number of entries,
+// each entry's offset from the start of the map, all the keys, and then
+// all the values. Entries must be added in increasing key order.
+template<typename Key>
+class SerializedMap {
+ public:
+  void Add(const Key &key, const string &value) {
+    keys_.push_back(key);
+    values_.push_back(value);
+  }
+
+  void AppendTo(string *out) const {
+    uint32_t offset = sizeof(uint32_t) +
+        keys_.size() * (sizeof(uint32_t) + sizeof(Key));
+    AppendSerialized(out, static_cast<uint32_t>(keys_.size()));
+    for (size_t i = 0; i < values_.size(); i++) {
+      AppendSerialized(out, offset);
+      offset += values_[i].size();
+    }
+    for (size_t i = 0; i < keys_.size(); i++)
+      AppendSerialized(out, keys_[i]);
+    for (size_t i = 0; i < values_.size(); i++)
+      out->append(values_[i]);
+  }
+
+ private:
+  vector<Key> keys_;
+  vector<string> values_;
+};
+
+// The ranges a RangeMap using its default exclusive merge strategy
+// would accept, serialized as RangeMapSerializer does: as a map from
+// each range's highest address to its base address and value.
+class SerializedRangeMap {
+ public:
+  // Store VALUE for the SIZE bytes starting at BASE, unless the range is
+  // empty, wraps around, or overlaps a range already stored, in which
+  // case RangeMap::StoreRange would refuse it too.
+  void StoreRange(Module::Address base, Module::Address size,
+                  const string &value) {
+    Module::Address high = base + (size - 1);
+    if (size == 0 || high < base)
+      return;
+    RangeMap::const_iterator base_it = ranges_.lower_bound(base);
+    RangeMap::const_iterator high_it = ranges_.lower_bound(high);
+    if (base_it != high_it ||
+        (high_it != ranges_.end() && high_it->second.first <= high))
+      return;
+    ranges_.insert(high_it, std::make_pair(high, std::make_pair(base, value)));
+  }
+
+  void AppendTo(string *out) const {
+    SerializedMap<Module::Address> map;
+    for (RangeMap::const_iterator it = ranges_.begin();
+         it != ranges_.end(); ++it) {
+      string value;
+      AppendSerialized(&value, it->second.first);
+      value.append(it->second.second);
+      map.Add(it->first, value);
+    }
+    map.AppendTo(out);
+  }
+
+ private:
+  typedef map<Module::Address, std::pair<Module::Address, string> > RangeMap;
+  RangeMap ranges_;
+};
+
+}  // namespace
+
 
 Module::Module(const string &name, const string &os,
                const string &architecture, const string &id,
@@ -55,7 +274,10 @@ Module::Module(const string &name, const string &os,
     architecture_(architecture),
     id_(id),
     code_id_(code_id),
-    load_address_(0) { }
+    load_address_(0),
+    function_memory_limit_(0),
+    function_memory_(0),
+    spill_file_(NULL) { }
 
 Module::~Module() {
   for (FileByNameMap::iterator it = files_.begin(); it != files_.end(); ++it)
@@ -64,12 +286,10 @@ Module::~Module() {
        it != functions_.end(); ++it) {
     delete *it;
   }
-  for (vector<StackFrameEntry *>::iterator it = stack_frame_entries_.begin();
-       it != stack_frame_entries_.end(); ++it) {
-    delete *it;
-  }
   for (ExternSet::iterator it = externs_.begin(); it != externs_.end(); ++it)
     delete *it;
+  if (spill_file_)
+    fclose(spill_file_);
 }
 
 void Module::SetLoadAddress(Address address) {
@@ -80,6 +300,10 @@ void Module::SetAddressRanges(const vector<Range>& ranges) {
   address_ranges_ = ranges;
 }
 
+void Module::SetFunctionMemoryLimit(size_t limit) {
+  function_memory_limit_ = limit;
+}
+
 void Module::AddFunction(Function *function) {
   // FUNC lines must not hold an empty name, so catch the problem early if
   // callers try to add one.
@@ -121,6 +345,12 @@ void Module::AddFunction(Function *function) {
     // Free the duplicate that was not inserted because this Module
     // now owns it.
     delete function;
+  } else if (ret.second && function_memory_limit_) {
+    function_memory_ += FunctionMemory(function);
+    if (function_memory_ > function_memory_limit_ && !SpillFunctions()) {
+      // Keep going in memory rather than failing the whole dump.
+      function_memory_limit_ = 0;
+    }
   }
 }
 
@@ -131,11 +361,47 @@ void Module::AddFunctions(vector<Function *>::iterator begin,
 }
 
 void Module::AddStackFrameEntry(StackFrameEntry *stack_frame_entry) {
-  if (!AddressIsInModule(stack_frame_entry->address)) {
-    return;
+  if (AddressIsInModule(stack_frame_entry->address)) {
+    CFIEntry entry = { stack_frame_entry->address, stack_frame_entry->size,
+                       static_cast<uint32_t>(cfi_rows_.size()) };
+    cfi_entries_.push_back(entry);
+    AddCFIRow(stack_frame_entry->address, stack_frame_entry->initial_rules);
+    for (RuleChangeMap::const_iterator it =
+             stack_frame_entry->rule_changes.begin();
+         it != stack_frame_entry->rule_changes.end(); ++it) {
+      AddCFIRow(it->first, it->second);
+    }
   }
+  delete stack_frame_entry;
+}
 
-  stack_frame_entries_.push_back(stack_frame_entry);
+void Module::AddCFIRow(Address address, const RuleMap &rule_map) {
+  CFIRow row = { address, static_cast<uint32_t>(cfi_rules_.size()) };
+  cfi_rows_.push_back(row);
+  for (RuleMap::const_iterator it = rule_map.begin();
+       it != rule_map.end(); ++it) {
+    CFIRule rule = { InternCFIString(it->first),
+                     InternCFIString(it->second) };
+    cfi_rules_.push_back(rule);
+  }
+}
+
+uint32_t Module::InternCFIString(const string &str) {
+  std::pair<unordered_map<string, uint32_t>::iterator, bool> ret =
+      cfi_string_ids_.insert(std::make_pair(str, cfi_strings_.size()));
+  if (ret.second)
+    cfi_strings_.push_back(&ret.first->first);
+  return ret.first->second;
+}
+
+size_t Module::CFIEntryRowsEnd(size_t entry) const {
+  return entry + 1 < cfi_entries_.size() ?
+      cfi_entries_[entry + 1].first_row : cfi_rows_.size();
+}
+
+size_t Module::CFIRowRulesEnd(size_t row) const {
+  return row + 1 < cfi_rows_.size() ?
+      cfi_rows_[row + 1].first_rule : cfi_rules_.size();
 }
 
 void Module::AddExtern(Extern *ext) {
@@ -151,6 +417,64 @@ void Module::AddExtern(Extern *ext) {
   }
 }
 
+void Module::MergeFrom(Module *other) {
+  assert(!other->spill_file_);
+
+  // Point OTHER's lines at this module's files before adopting them.
+  map<File *, File *> files;
+  for (FileByNameMap::iterator it = other->files_.begin();
+       it != other->files_.end(); ++it) {
+    files[it->second] = FindFile(*it->first);
+  }
+  for (FunctionSet::iterator it = other->functions_.begin();
+       it != other->functions_.end(); ++it) {
+    vector<Line> &lines = (*it)->lines;
+    for (vector<Line>::iterator line = lines.begin(); line != lines.end();
+         ++line) {
+      line->file = files[line->file];
+    }
+    AddFunction(*it);
+  }
+  other->functions_.clear();
+  other->function_memory_ = 0;
+
+  for (ExternSet::iterator it = other->externs_.begin();
+       it != other->externs_.end(); ++it) {
+    AddExtern(*it);
+  }
+  other->externs_.clear();
+
+  // Copy OTHER's CFI tables, renumbering its interned strings.
+  vector<uint32_t> strings(other->cfi_strings_.size());
+  for (size_t i = 0; i < strings.size(); ++i)
+    strings[i] = InternCFIString(*other->cfi_strings_[i]);
+  for (size_t entry = 0; entry < other->cfi_entries_.size(); ++entry) {
+    const CFIEntry &other_entry = other->cfi_entries_[entry];
+    if (!AddressIsInModule(other_entry.address))
+      continue;
+    CFIEntry new_entry = { other_entry.address, other_entry.size,
+                           static_cast<uint32_t>(cfi_rows_.size()) };
+    cfi_entries_.push_back(new_entry);
+    size_t rows_end = other->CFIEntryRowsEnd(entry);
+    for (size_t row = other_entry.first_row; row < rows_end; ++row) {
+      CFIRow new_row = { other->cfi_rows_[row].address,
+                         static_cast<uint32_t>(cfi_rules_.size()) };
+      cfi_rows_.push_back(new_row);
+      size_t rules_end = other->CFIRowRulesEnd(row);
+      for (size_t rule = other->cfi_rows_[row].first_rule; rule < rules_end;
+           ++rule) {
+        const CFIRule &other_rule = other->cfi_rules_[rule];
+        CFIRule new_rule = { strings[other_rule.name],
+                             strings[other_rule.expression] };
+        cfi_rules_.push_back(new_rule);
+      }
+    }
+  }
+  other->cfi_entries_.clear();
+  other->cfi_rows_.clear();
+  other->cfi_rules_.clear();
+}
+
 void Module::GetFunctions(vector<Function *> *vec,
                           vector<Function *>::iterator i) {
   vec->insert(i, functions_.begin(), functions_.end());
@@ -193,14 +517,35 @@ Module::File *Module::FindExistingFile(const string &name) {
   return (it == files_.end()) ? NULL : it->second;
 }
 
+const string *Module::InternString(const string &str) {
+  return &*interned_strings_.insert(str).first;
+}
+
 void Module::GetFiles(vector<File *> *vec) {
   vec->clear();
   for (FileByNameMap::iterator it = files_.begin(); it != files_.end(); ++it)
     vec->push_back(it->second);
 }
 
-void Module::GetStackFrameEntries(vector<StackFrameEntry *> *vec) const {
-  *vec = stack_frame_entries_;
+void Module::GetStackFrameEntries(vector<StackFrameEntry> *vec) const {
+  vec->clear();
+  vec->reserve(cfi_entries_.size());
+  for (size_t i = 0; i < cfi_entries_.size(); i++) {
+    vec->push_back(StackFrameEntry());
+    StackFrameEntry &entry = vec->back();
+    entry.address = cfi_entries_[i].address;
+    entry.size = cfi_entries_[i].size;
+    for (size_t row = cfi_entries_[i].first_row; row < CFIEntryRowsEnd(i);
+         row++) {
+      RuleMap &rule_map = row == cfi_entries_[i].first_row ?
+          entry.initial_rules : entry.rule_changes[cfi_rows_[row].address];
+      for (size_t rule = cfi_rows_[row].first_rule;
+           rule < CFIRowRulesEnd(row); rule++) {
+        rule_map[*cfi_strings_[cfi_rules_[rule].name]] =
+            *cfi_strings_[cfi_rules_[rule].expression];
+      }
+    }
+  }
 }
 
 void Module::AssignSourceIds() {
@@ -212,6 +557,9 @@ void Module::AssignSourceIds() {
 
   // Next, mark all files actually cited by our functions' line number
   // info, by setting each one's source id to zero.
+  for (set<File *>::iterator file_it = spilled_files_.begin();
+       file_it != spilled_files_.end(); ++file_it)
+    (*file_it)->source_id = 0;
   for (FunctionSet::const_iterator func_it = functions_.begin();
        func_it != functions_.end(); ++func_it) {
     Function *func = *func_it;
@@ -238,16 +586,144 @@ bool Module::ReportError() {
   return false;
 }
 
-bool Module::WriteRuleMap(const RuleMap &rule_map, std::ostream &stream) {
-  for (RuleMap::const_iterator it = rule_map.begin();
-       it != rule_map.end(); ++it) {
-    if (it != rule_map.begin())
+bool Module::WriteCFIRow(size_t row, std::ostream &stream) const {
+  size_t begin = cfi_rows_[row].first_rule, end = CFIRowRulesEnd(row);
+  for (size_t rule = begin; rule < end; rule++) {
+    if (rule != begin)
       stream << ' ';
-    stream << it->first << ": " << it->second;
+    stream << *cfi_strings_[cfi_rules_[rule].name] << ": "
+           << *cfi_strings_[cfi_rules_[rule].expression];
   }
   return stream.good();
 }
 
+size_t Module::FunctionMemory(const Function *function) {
+  // Count the set node holding the function as roughly four pointers.
+  return sizeof(Function) + 4 * sizeof(void *) + function->name.capacity() +
+      function->ranges.capacity() * sizeof(Range) +
+      function->lines.capacity() * sizeof(Line);
+}
+
+bool Module::SpillFunctions() {
+  if (!spill_file_) {
+    spill_file_ = tmpfile();
+    if (!spill_file_) {
+      fprintf(stderr, "couldn't create a temporary file to spill"
+              " functions to: %s\n", strerror(errno));
+      return false;
+    }
+  }
+
+  if (fseeko(spill_file_, 0, SEEK_END) != 0)
+    return false;
+  off_t start = ftello(spill_file_);
+  bool ok = start >= 0;
+  for (FunctionSet::const_iterator func_it = functions_.begin();
+       ok && func_it != functions_.end(); ++func_it) {
+    const Function *func = *func_it;
+    uint32_t name_size = func->name.size();
+    uint32_t range_count = func->ranges.size();
+    ok = WriteSpillValue(spill_file_, func->address) &&
+        WriteSpillValue(spill_file_, func->parameter_size) &&
+        WriteSpillValue(spill_file_, name_size) &&
+        fwrite(func->name.data(), 1, name_size, spill_file_) == name_size &&
+        WriteSpillValue(spill_file_, range_count);
+    for (size_t i = 0; ok && i < func->ranges.size(); i++) {
+      ok = WriteSpillValue(spill_file_, func->ranges[i].address) &&
+          WriteSpillValue(spill_file_, func->ranges[i].size);
+    }
+    uint32_t line_count = func->lines.size();
+    ok = ok && WriteSpillValue(spill_file_, line_count);
+    for (size_t i = 0; ok && i < func->lines.size(); i++) {
+      const Line &line = func->lines[i];
+      uintptr_t file = reinterpret_cast<uintptr_t>(line.file);
+      ok = WriteSpillValue(spill_file_, line.address) &&
+          WriteSpillValue(spill_file_, line.size) &&
+          WriteSpillValue(spill_file_, file) &&
+          WriteSpillValue(spill_file_, line.number);
+    }
+  }
+  off_t end = ok && fflush(spill_file_) == 0 ? ftello(spill_file_) : -1;
+  if (end < 0) {
+    fprintf(stderr, "error spilling functions to a temporary file: %s\n",
+            strerror(errno));
+    return false;
+  }
+
+  SpillRun run = { static_cast<uint64_t>(start),
+                   static_cast<uint64_t>(end - start) };
+  spill_runs_.push_back(run);
+  for (FunctionSet::iterator func_it = functions_.begin();
+       func_it != functions_.end(); ++func_it) {
+    Function *func = *func_it;
+    for (vector<Line>::iterator line_it = func->lines.begin();
+         line_it != func->lines.end(); ++line_it)
+      spilled_files_.insert(line_it->file);
+    delete func;
+  }
+  functions_.clear();
+  function_memory_ = 0;
+  return true;
+}
+
+bool Module::VisitFunctions(const FunctionVisitor &visit) {
+  if (spill_runs_.empty()) {
+    for (FunctionSet::const_iterator func_it = functions_.begin();
+         func_it != functions_.end(); ++func_it) {
+      if (!visit(**func_it))
+        return false;
+    }
+    return true;
+  }
+
+  if (!functions_.empty() && !SpillFunctions())
+    return false;
+
+  vector<SpillRunReader> readers;
+  readers.reserve(spill_runs_.size());
+  std::priority_queue<SpillRunHead, vector<SpillRunHead>,
+                      SpillRunHeadGreater> heads;
+  for (size_t i = 0; i < spill_runs_.size(); i++) {
+    readers.push_back(SpillRunReader(fileno(spill_file_),
+                                     spill_runs_[i].offset,
+                                     spill_runs_[i].size));
+    SpillRunHead head = { readers[i].Next(), i };
+    if (head.function)
+      heads.push(head);
+  }
+
+  // Visit each function in order, dropping any that duplicates the one
+  // before it.
+  Function *previous = NULL;
+  bool ok = true;
+  while (!heads.empty()) {
+    SpillRunHead head = heads.top();
+    heads.pop();
+    if (ok && (!previous || FunctionCompare()(previous, head.function)))
+      ok = visit(*head.function);
+    delete previous;
+    previous = head.function;
+    // After a failure, just drain the remaining heads to free them.
+    if (!ok)
+      continue;
+    head.function = readers[head.run].Next();
+    if (head.function)
+      heads.push(head);
+  }
+  delete previous;
+  if (!ok)
+    return false;
+
+  for (size_t i = 0; i < readers.size(); i++) {
+    if (readers[i].error()) {
+      fprintf(stderr, "error reading spilled functions back: %s\n",
+              strerror(errno));
+      return false;
+    }
+  }
+  return true;
+}
+
 bool Module::AddressIsInModule(Address address) const {
   if (address_ranges_.empty()) {
     return true;
@@ -261,6 +737,38 @@ bool Module::AddressIsInModule(Address address) const {
   return false;
 }
 
+bool Module::WriteFunction(const Function &func, std::ostream &stream) {
+  vector<Line>::const_iterator line_it = func.lines.begin();
+  for (auto range_it = func.ranges.cbegin();
+       range_it != func.ranges.cend(); ++range_it) {
+    stream << "FUNC " << hex
+           << (range_it->address - load_address_) << " "
+           << range_it->size << " "
+           << func.parameter_size << " "
+           << func.name << dec << "\n";
+
+    if (!stream.good())
+      return false;
+
+    while ((line_it != func.lines.end()) &&
+           (line_it->address >= range_it->address) &&
+           (line_it->address < (range_it->address + range_it->size))) {
+      stream << hex
+             << (line_it->address - load_address_) << " "
+             << line_it->size << " "
+             << dec
+             << line_it->number << " "
+             << line_it->file->source_id << "\n";
+
+      if (!stream.good())
+        return false;
+
+      ++line_it;
+    }
+  }
+  return true;
+}
+
 bool Module::Write(std::ostream &stream, SymbolData symbol_data) {
   stream << "MODULE " << os_ << " " << architecture_ << " "
          << id_ << " " << name_ << "\n";
@@ -286,37 +794,12 @@ bool Module::Write(std::ostream &stream, SymbolData symbol_data) {
     }
 
     // Write out functions and their lines.
-    for (FunctionSet::const_iterator func_it = functions_.begin();
-         func_it != functions_.end(); ++func_it) {
-      Function *func = *func_it;
-      vector<Line>::iterator line_it = func->lines.begin();
-      for (auto range_it = func->ranges.cbegin();
-           range_it != func->ranges.cend(); ++range_it) {
-        stream << "FUNC " << hex
-               << (range_it->address - load_address_) << " "
-               << range_it->size << " "
-               << func->parameter_size << " "
-               << func->name << dec << "\n";
-
-        if (!stream.good())
-          return ReportError();
-
-        while ((line_it != func->lines.end()) &&
-               (line_it->address >= range_it->address) &&
-               (line_it->address < (range_it->address + range_it->size))) {
-          stream << hex
-                 << (line_it->address - load_address_) << " "
-                 << line_it->size << " "
-                 << dec
-                 << line_it->number << " "
-                 << line_it->file->source_id << "\n";
-
-          if (!stream.good())
-            return ReportError();
-
-          ++line_it;
-        }
-      }
+    bool write_failed = false;
+    if (!VisitFunctions([&](const Function &func) {
+          write_failed = !WriteFunction(func, stream);
+          return !write_failed;
+        })) {
+      return write_failed ? ReportError() : false;
     }
 
     // Write out 'PUBLIC' records.
@@ -331,26 +814,24 @@ bool Module::Write(std::ostream &stream, SymbolData symbol_data) {
 
   if (symbol_data != NO_CFI) {
     // Write out 'STACK CFI INIT' and 'STACK CFI' records.
-    vector<StackFrameEntry *>::const_iterator frame_it;
-    for (frame_it = stack_frame_entries_.begin();
-         frame_it != stack_frame_entries_.end(); ++frame_it) {
-      StackFrameEntry *entry = *frame_it;
+    for (size_t i = 0; i < cfi_entries_.size(); i++) {
+      const CFIEntry &entry = cfi_entries_[i];
       stream << "STACK CFI INIT " << hex
-             << (entry->address - load_address_) << " "
-             << entry->size << " " << dec;
+             << (entry.address - load_address_) << " "
+             << entry.size << " " << dec;
       if (!stream.good()
-          || !WriteRuleMap(entry->initial_rules, stream))
+          || !WriteCFIRow(entry.first_row, stream))
         return ReportError();
 
       stream << "\n";
 
       // Write out this entry's delta rules as 'STACK CFI' records.
-      for (RuleChangeMap::const_iterator delta_it = entry->rule_changes.begin();
-           delta_it != entry->rule_changes.end(); ++delta_it) {
+      for (size_t row = entry.first_row + 1; row < CFIEntryRowsEnd(i);
+           row++) {
         stream << "STACK CFI " << hex
-               << (delta_it->first - load_address_) << " " << dec;
+               << (cfi_rows_[row].address - load_address_) << " " << dec;
         if (!stream.good()
-            || !WriteRuleMap(delta_it->second, stream))
+            || !WriteCFIRow(row, stream))
           return ReportError();
 
         stream << "\n";
@@ -361,4 +842,156 @@ bool Module::Write(std::ostream &stream, SymbolData symbol_data) {
   return true;
 }
 
+bool Module::WriteSerialized(std::ostream &stream, SymbolData symbol_data) {
+  // Where the text form would make BasicSourceLineResolver report a parse
+  // error, mark the module corrupt and drop the record, as it would.
+  bool is_corrupt = false;
+  SerializedMap<int> files;
+  SerializedRangeMap functions;
+  SerializedMap<Address> public_symbols;
+
+  if (symbol_data != ONLY_CFI) {
+    AssignSourceIds();
+
+    // AssignSourceIds numbers files in name order, so this adds them in
+    // increasing source id order.
+    for (FileByNameMap::iterator file_it = files_.begin();
+         file_it != files_.end(); ++file_it) {
+      File *file = file_it->second;
+      if (file->source_id < 0)
+        continue;
+      if (file->name.empty()) {
+        is_corrupt = true;
+        continue;
+      }
+      string value;
+      AppendSerializedString(&value, file->name);
+      files.Add(file->source_id, value);
+    }
+    // Each of a function's ranges becomes a function of its own, holding
+    // the lines Write would list under that range's FUNC record.
+    if (!VisitFunctions([&](const Function &func) {
+          vector<Line>::const_iterator line_it = func.lines.begin();
+          for (auto range_it = func.ranges.cbegin();
+               range_it != func.ranges.cend(); ++range_it) {
+            SerializedRangeMap lines;
+            while ((line_it != func.lines.end()) &&
+                   (line_it->address >= range_it->address) &&
+                   (line_it->address <
+                    (range_it->address + range_it->size))) {
+              if (line_it->number < 0) {
+                is_corrupt = true;
+              } else {
+                int32_t source_id = line_it->file->source_id;
+                string value;
+                AppendSerialized(&value, line_it->address - load_address_);
+                AppendSerialized(&value, line_it->size);
+                AppendSerialized(&value, source_id);
+                AppendSerialized(&value, static_cast<int32_t>(line_it->number));
+                lines.StoreRange(line_it->address - load_address_,
+                                 line_it->size, value);
+              }
+              ++line_it;
+            }
+
+            if (func.parameter_size >=
+                static_cast<Address>(std::numeric_limits<long>::max())) {
+              is_corrupt = true;
+              continue;
+            }
+            string value;
+            AppendSerializedString(&value, func.name);
+            AppendSerialized(&value, range_it->address - load_address_);
+            AppendSerialized(&value, range_it->size);
+            AppendSerialized(&value,
+                             static_cast<int32_t>(func.parameter_size));
+            lines.AppendTo(&value);
+            functions.StoreRange(range_it->address - load_address_,
+                                 range_it->size, value);
+          }
+          return true;
+        })) {
+      return false;
+    }
+
+    for (ExternSet::const_iterator extern_it = externs_.begin();
+         extern_it != externs_.end(); ++extern_it) {
+      Extern *ext = *extern_it;
+      Address address = ext->address - load_address_;
+      // BasicSourceLineResolver ignores public symbols at address zero.
+      if (address == 0)
+        continue;
+      if (ext->name.empty()) {
+        is_corrupt = true;
+        continue;
+      }
+      string value;
+      AppendSerializedString(&value, ext->name);
+      AppendSerialized(&value, address);
+      AppendSerialized(&value, static_cast<int32_t>(0));
+      public_symbols.Add(address, value);
+    }
+  }
+
+  SerializedRangeMap cfi_initial_rules;
+  map<Address, string> cfi_delta_rules;
+  if (symbol_data != NO_CFI) {
+    for (size_t i = 0; i < cfi_entries_.size(); i++) {
+      const CFIEntry &entry = cfi_entries_[i];
+      for (size_t row = entry.first_row; row < CFIEntryRowsEnd(i); row++) {
+        std::ostringstream rules;
+        WriteCFIRow(row, rules);
+        if (rules.str().empty()) {
+          is_corrupt = true;
+        } else if (row == entry.first_row) {
+          string value;
+          AppendSerializedString(&value, rules.str());
+          cfi_initial_rules.StoreRange(entry.address - load_address_,
+                                       entry.size, value);
+        } else {
+          cfi_delta_rules[cfi_rows_[row].address - load_address_] =
+              rules.str();
+        }
+      }
+    }
+  }
+
+  // Serialize each table, in the order FastSourceLineResolver expects.
+  string tables[kSerializedTables];
+  int table = 0;
+  files.AppendTo(&tables[table++]);
+  functions.AppendTo(&tables[table++]);
+  public_symbols.AppendTo(&tables[table++]);
+  for (int i = 0; i < kSerializedWindowsFrameInfoTables; i++) {
+    // An empty ContainedRangeMap: its base, the size of its (absent)
+    // entry, and its number of children.
+    AppendSerialized(&tables[table], static_cast<Address>(0));
+    AppendSerialized(&tables[table], static_cast<uint32_t>(0));
+    AppendSerialized(&tables[table++], static_cast<uint32_t>(0));
+  }
+  cfi_initial_rules.AppendTo(&tables[table++]);
+  SerializedMap<Address> delta_rules;
+  for (map<Address, string>::const_iterator it = cfi_delta_rules.begin();
+       it != cfi_delta_rules.end(); ++it) {
+    string value;
+    AppendSerializedString(&value, it->second);
+    delta_rules.Add(it->first, value);
+  }
+  delta_rules.AppendTo(&tables[table++]);
+  assert(table == kSerializedTables);
+
+  string header;
+  header.push_back(static_cast<char>(is_corrupt ? 255 : 0));
+  for (int i = 0; i < kSerializedTables; i++)
+    AppendSerialized(&header, static_cast<uint32_t>(tables[i].size()));
+  stream.write(header.data(), header.size());
+  for (int i = 0; i < kSerializedTables; i++)
+    stream.write(tables[i].data(), tables[i].size());
+  // A final null terminator, for the benefit of C-string readers.
+  stream.put('\0');
+  if (!stream.good())
+    return ReportError();
+  return true;
+}
+
 }  // namespace google_breakpad
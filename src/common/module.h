@@ -38,6 +38,9 @@
 #ifndef COMMON_LINUX_MODULE_H__
 #define COMMON_LINUX_MODULE_H__
 
+#include <stdio.h>
+
+#include <functional>
 #include <iostream>
 #include <map>
 #include <set>
@@ -45,6 +48,7 @@
 #include <vector>
 
 #include "common/symbol_data.h"
+#include "common/unordered.h"
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
 
@@ -213,6 +217,15 @@ class Module {
   // this method is called.
   void SetAddressRanges(const vector<Range>& ranges);
 
+  // Limit the memory used to hold functions and their line data to
+  // roughly LIMIT bytes. Whenever the functions added to this module
+  // exceed the limit, they are written in address order to a temporary
+  // file and freed; Write merges these sorted runs back together. A
+  // LIMIT of zero, the default, keeps every function in memory. Once
+  // functions have been spilled, GetFunctions returns only those still
+  // held in memory.
+  void SetFunctionMemoryLimit(size_t limit);
+
   // Add FUNCTION to the module. FUNCTION's name must not be empty.
   // This module owns all Function objects added with this function:
   // destroying the module destroys them as well.
@@ -225,8 +238,8 @@ class Module {
                     vector<Function *>::iterator end);
 
   // Add STACK_FRAME_ENTRY to the module.
-  // This module owns all StackFrameEntry objects added with this
-  // function: destroying the module destroys them as well.
+  // This module takes ownership of STACK_FRAME_ENTRY: it copies the
+  // entry's rules into its own compact CFI tables and deletes it.
   void AddStackFrameEntry(StackFrameEntry *stack_frame_entry);
 
   // Add PUBLIC to the module.
@@ -234,6 +247,14 @@ class Module {
   // destroying the module destroys them as well.
   void AddExtern(Extern *ext);
 
+  // Move the functions, externs and stack frame entries added to OTHER
+  // into this module, as if they had been added here directly in that
+  // order, and leave OTHER without them. OTHER's source files are
+  // matched to this module's by name. OTHER must not have spilled any
+  // functions. This lets separate Modules be filled concurrently and
+  // combined afterwards.
+  void MergeFrom(Module *other);
+
   // If this module has a file named NAME, return a pointer to it. If
   // it has none, then create one and return a pointer to the new
   // file. This module owns all File objects created using these
@@ -245,6 +266,13 @@ class Module {
   // Otherwise, return NULL.
   File *FindExistingFile(const string &name);
 
+  // Return a pointer to this module's copy of STR, creating it if
+  // necessary. Every call with equal text returns the same pointer, so
+  // readers can use this to store names that recur across compilation
+  // units only once. This module owns the strings: they live as long as
+  // it does.
+  const string *InternString(const string &str);
+
   // Insert pointers to the functions added to this module at I in
   // VEC. The pointed-to Functions are still owned by this module.
   // (Since this is effectively a copy of the function list, this is
@@ -266,12 +294,12 @@ class Module {
   // a more appropriate interface.)
   void GetFiles(vector<File *> *vec);
 
-  // Clear VEC and fill it with pointers to the StackFrameEntry
-  // objects that have been added to this module. (Since this is
-  // effectively a copy of the stack frame entry list, this is mostly
-  // useful for testing; other uses should probably get
-  // a more appropriate interface.)
-  void GetStackFrameEntries(vector<StackFrameEntry *> *vec) const;
+  // Clear VEC and fill it with copies of the StackFrameEntry objects
+  // that have been added to this module, rebuilt from the compact CFI
+  // tables. (Since this is effectively a copy of the stack frame entry
+  // list, this is mostly useful for testing; other uses should
+  // probably get a more appropriate interface.)
+  void GetStackFrameEntries(vector<StackFrameEntry> *vec) const;
 
   // Find those files in this module that are actually referred to by
   // functions' line number data, and assign them source id numbers.
@@ -294,6 +322,16 @@ class Module {
   // established by SetLoadAddress.
   bool Write(std::ostream &stream, SymbolData symbol_data);
 
+  // Call AssignSourceIds, and write this module to STREAM in the
+  // serialized format that FastSourceLineResolver loads without parsing
+  // (see processor/module_serializer.h). The result is the same as
+  // running ModuleSerializer::SerializeSymbolFileData on the symbol file
+  // that Write would produce for SYMBOL_DATA, without the text round
+  // trip. Since each table starts with the offsets of its contents, the
+  // data is assembled in memory before being written. Return true if
+  // all goes well, or false if an error occurs.
+  bool WriteSerialized(std::ostream &stream, SymbolData symbol_data);
+
   string name() const { return name_; }
   string os() const { return os_; }
   string architecture() const { return architecture_; }
@@ -305,10 +343,43 @@ class Module {
   // errno to find the appropriate cause.  Return false.
   static bool ReportError();
 
-  // Write RULE_MAP to STREAM, in the form appropriate for 'STACK CFI'
-  // records, without a final newline. Return true if all goes well;
-  // if an error occurs, return false, and leave errno set.
-  static bool WriteRuleMap(const RuleMap &rule_map, std::ostream &stream);
+  // Write the rules of cfi_rows_[ROW] to STREAM, in the form
+  // appropriate for 'STACK CFI' records, without a final newline.
+  // Return true if all goes well; if an error occurs, return false,
+  // and leave errno set.
+  bool WriteCFIRow(size_t row, std::ostream &stream) const;
+
+  // Append a row of CFI rules taking effect at ADDRESS, holding the
+  // rules in RULE_MAP, to cfi_rows_.
+  void AddCFIRow(Address address, const RuleMap &rule_map);
+
+  // Return the index of STR in cfi_strings_, adding it if necessary.
+  uint32_t InternCFIString(const string &str);
+
+  // Return the bounds of the rows of cfi_entries_[ENTRY] and of the
+  // rules of cfi_rows_[ROW], as one-past-the-end indices.
+  size_t CFIEntryRowsEnd(size_t entry) const;
+  size_t CFIRowRulesEnd(size_t row) const;
+
+  // Write FUNC's 'FUNC' records and their lines to STREAM. Return true
+  // if all goes well, or false if an error occurs.
+  bool WriteFunction(const Function &func, std::ostream &stream);
+
+  // Write the functions in functions_ to the spill file as a single
+  // sorted run, and free them. Return false if the run could not be
+  // written; the functions are kept in memory in that case.
+  bool SpillFunctions();
+
+  // Call VISIT on each of this module's functions in FunctionCompare
+  // order, merging any spilled runs back together and dropping
+  // duplicates as FunctionSet would. Functions read back from the spill
+  // file only live for the duration of the call. Stop and return false
+  // if VISIT returns false or the spilled runs can't be read.
+  typedef std::function<bool(const Function &)> FunctionVisitor;
+  bool VisitFunctions(const FunctionVisitor &visit);
+
+  // Return an estimate of the memory FUNCTION occupies.
+  static size_t FunctionMemory(const Function *function);
 
   // Returns true of the specified address resides with an specified address
   // range, or if no ranges have been specified.
@@ -348,9 +419,53 @@ class Module {
   FileByNameMap files_;    // This module's source files.
   FunctionSet functions_;  // This module's functions.
 
-  // The module owns all the call frame info entries that have been
-  // added to it.
-  vector<StackFrameEntry *> stack_frame_entries_;
+  // The spill limit given to SetFunctionMemoryLimit, and the estimated
+  // memory used by the functions currently in functions_.
+  size_t function_memory_limit_;
+  size_t function_memory_;
+
+  // A byte range of spill_file_ holding one run of functions, sorted
+  // by FunctionCompare.
+  struct SpillRun {
+    uint64_t offset, size;
+  };
+
+  // The temporary file holding spilled functions, or NULL if nothing
+  // has been spilled; its runs; and the files their lines cite.
+  FILE *spill_file_;
+  vector<SpillRun> spill_runs_;
+  set<File *> spilled_files_;
+
+  // Call frame info is held in flat tables rather than as
+  // StackFrameEntry objects, since it can dominate the module's memory.
+  // Each CFIEntry owns a run of consecutive CFIRows, the first of which
+  // holds its initial rules and the rest its rule changes; each CFIRow
+  // owns a run of consecutive CFIRules, sorted by register name. A run
+  // ends where the next entry's or row's run begins. Register names and
+  // rule expressions are interned in cfi_strings_ and referred to by
+  // index.
+  struct CFIEntry {
+    Address address, size;
+    uint32_t first_row;
+  };
+  struct CFIRow {
+    Address address;
+    uint32_t first_rule;
+  };
+  struct CFIRule {
+    uint32_t name, expression;
+  };
+  vector<CFIEntry> cfi_entries_;
+  vector<CFIRow> cfi_rows_;
+  vector<CFIRule> cfi_rules_;
+
+  // The strings returned by InternString.
+  unordered_set<string> interned_strings_;
+
+  // The interned CFI strings, and a map from each string to its index.
+  // The entries of cfi_strings_ point at the keys of cfi_string_ids_.
+  vector<const string *> cfi_strings_;
+  unordered_map<string, uint32_t> cfi_string_ids_;
 
   // The module owns all the externs that have been added to it;
   // destroying the module frees the Externs these point to.
@@ -360,37 +360,37 @@ TEST(Construct, AddFrames) {
                contents.c_str());
 
   // Check that GetStackFrameEntries works.
-  vector<Module::StackFrameEntry*> entries;
+  vector<Module::StackFrameEntry> entries;
   m.GetStackFrameEntries(&entries);
   ASSERT_EQ(3U, entries.size());
   // Check first entry.
-  EXPECT_EQ(0xddb5f41285aa7757ULL, entries[0]->address);
-  EXPECT_EQ(0x1486493370dc5073ULL, entries[0]->size);
-  ASSERT_EQ(0U, entries[0]->initial_rules.size());
-  ASSERT_EQ(0U, entries[0]->rule_changes.size());
+  EXPECT_EQ(0xddb5f41285aa7757ULL, entries[0].address);
+  EXPECT_EQ(0x1486493370dc5073ULL, entries[0].size);
+  ASSERT_EQ(0U, entries[0].initial_rules.size());
+  ASSERT_EQ(0U, entries[0].rule_changes.size());
   // Check second entry.
-  EXPECT_EQ(0x8064f3af5e067e38ULL, entries[1]->address);
-  EXPECT_EQ(0x0de2a5ee55509407ULL, entries[1]->size);
-  ASSERT_EQ(3U, entries[1]->initial_rules.size());
+  EXPECT_EQ(0x8064f3af5e067e38ULL, entries[1].address);
+  EXPECT_EQ(0x0de2a5ee55509407ULL, entries[1].size);
+  ASSERT_EQ(3U, entries[1].initial_rules.size());
   Module::RuleMap entry2_initial;
   entry2_initial[".cfa"] = "I think that I shall never see";
   entry2_initial["stromboli"] = "a poem lovely as a tree";
   entry2_initial["cannoli"] = "a tree whose hungry mouth is prest";
-  EXPECT_THAT(entries[1]->initial_rules, ContainerEq(entry2_initial));
-  ASSERT_EQ(0U, entries[1]->rule_changes.size());
+  EXPECT_THAT(entries[1].initial_rules, ContainerEq(entry2_initial));
+  ASSERT_EQ(0U, entries[1].rule_changes.size());
   // Check third entry.
-  EXPECT_EQ(0x5e8d0db0a7075c6cULL, entries[2]->address);
-  EXPECT_EQ(0x1c7edb12a7aea229ULL, entries[2]->size);
+  EXPECT_EQ(0x5e8d0db0a7075c6cULL, entries[2].address);
+  EXPECT_EQ(0x1c7edb12a7aea229ULL, entries[2].size);
   Module::RuleMap entry3_initial;
   entry3_initial[".cfa"] = "Whose woods are these";
-  EXPECT_THAT(entries[2]->initial_rules, ContainerEq(entry3_initial));
+  EXPECT_THAT(entries[2].initial_rules, ContainerEq(entry3_initial));
   Module::RuleChangeMap entry3_changes;
   entry3_changes[0x36682fad3763ffffULL][".cfa"] = "I think I know";
   entry3_changes[0x36682fad3763ffffULL]["stromboli"] = "his house is in";
   entry3_changes[0x47ceb0f63c269d7fULL]["calzone"] = "the village though";
   entry3_changes[0x47ceb0f63c269d7fULL]["cannoli"] =
     "he will not see me stopping here";
-  EXPECT_THAT(entries[2]->rule_changes, ContainerEq(entry3_changes));
+  EXPECT_THAT(entries[2].rule_changes, ContainerEq(entry3_changes));
 }
 
 TEST(Construct, UniqueFiles) {
@@ -406,6 +406,87 @@ TEST(Construct, UniqueFiles) {
   EXPECT_TRUE(m.FindExistingFile("baz") == NULL);
 }
 
+TEST(Construct, InternedStrings) {
+  Module m(MODULE_NAME, MODULE_OS, MODULE_ARCH, MODULE_ID);
+  const string* name1 = m.InternString("ns::Class");
+  const string* name2 = m.InternString(string("ns::") + "Class");
+  const string* name3 = m.InternString("ns::Other");
+  EXPECT_EQ(name1, name2);
+  EXPECT_NE(name1, name3);
+  EXPECT_EQ("ns::Class", *name1);
+  EXPECT_EQ("ns::Other", *name3);
+}
+
+TEST(Construct, MergeFrom) {
+  Module m(MODULE_NAME, MODULE_OS, MODULE_ARCH, MODULE_ID);
+  Module::File* file1 = m.FindFile("file1.cc");
+  Module::Function* function1 = new Module::Function("function1", 0x1000);
+  function1->ranges.push_back(Module::Range(0x1000, 0x100));
+  Module::Line line1 = { 0x1000, 0x100, file1, 10 };
+  function1->lines.push_back(line1);
+  m.AddFunction(function1);
+  Module::StackFrameEntry* entry1 = new Module::StackFrameEntry();
+  entry1->address = 0x1000;
+  entry1->size = 0x100;
+  entry1->initial_rules[".cfa"] = "$esp 4 +";
+  m.AddStackFrameEntry(entry1);
+
+  // Another module with its own copy of file1.cc, a new file, an extern
+  // at function1's address, and more CFI.
+  Module other(MODULE_NAME, MODULE_OS, MODULE_ARCH, MODULE_ID);
+  Module::File* other_file1 = other.FindFile("file1.cc");
+  Module::File* file2 = other.FindFile("file2.cc");
+  Module::Function* function2 = new Module::Function("function2", 0x2000);
+  function2->ranges.push_back(Module::Range(0x2000, 0x100));
+  Module::Line line2 = { 0x2000, 0x80, other_file1, 20 };
+  Module::Line line3 = { 0x2080, 0x80, file2, 30 };
+  function2->lines.push_back(line2);
+  function2->lines.push_back(line3);
+  other.AddFunction(function2);
+  Module::Extern* extern1 = new Module::Extern(0x1000);
+  extern1->name = "extern1";
+  other.AddExtern(extern1);
+  Module::Extern* extern2 = new Module::Extern(0x3000);
+  extern2->name = "extern2";
+  other.AddExtern(extern2);
+  Module::StackFrameEntry* entry2 = new Module::StackFrameEntry();
+  entry2->address = 0x2000;
+  entry2->size = 0x100;
+  entry2->initial_rules[".cfa"] = "$esp 8 +";
+  entry2->rule_changes[0x2001][".cfa"] = "$esp 4 +";
+  other.AddStackFrameEntry(entry2);
+
+  m.MergeFrom(&other);
+
+  stringstream s;
+  m.Write(s, ALL_SYMBOL_DATA);
+  EXPECT_STREQ("MODULE os-name architecture id-string name with spaces\n"
+               "FILE 0 file1.cc\n"
+               "FILE 1 file2.cc\n"
+               "FUNC 1000 100 0 function1\n"
+               "1000 100 10 0\n"
+               "FUNC 2000 100 0 function2\n"
+               "2000 80 20 0\n"
+               "2080 80 30 1\n"
+               "PUBLIC 1000 0 extern1\n"
+               "PUBLIC 3000 0 extern2\n"
+               "STACK CFI INIT 1000 100 .cfa: $esp 4 +\n"
+               "STACK CFI INIT 2000 100 .cfa: $esp 8 +\n"
+               "STACK CFI 2001 .cfa: $esp 4 +\n",
+               s.str().c_str());
+
+  // OTHER is left without the records it handed over.
+  vector<Module::Function*> functions;
+  other.GetFunctions(&functions, functions.end());
+  EXPECT_TRUE(functions.empty());
+  vector<Module::Extern*> externs;
+  other.GetExterns(&externs, externs.end());
+  EXPECT_TRUE(externs.empty());
+  vector<Module::StackFrameEntry> entries;
+  other.GetStackFrameEntries(&entries);
+  EXPECT_TRUE(entries.empty());
+}
+
 TEST(Construct, DuplicateFunctions) {
   stringstream s;
   Module m(MODULE_NAME, MODULE_OS, MODULE_ARCH, MODULE_ID);
@@ -446,6 +527,50 @@ TEST(Construct, FunctionsWithSameAddress) {
                contents.c_str());
 }
 
+// Add the same functions, lines and files to M in an unsorted order,
+// with duplicates, for the spilling tests.
+static void add_spill_test_functions(Module* m) {
+  Module::File* file1 = m->FindFile("spill-b.cc");
+  Module::File* file2 = m->FindFile("spill-a.cc");
+  m->FindFile("spill-unused.cc");
+  const Module::Address addresses[] = { 0x3000, 0x1000, 0x2000, 0x1000 };
+  for (size_t i = 0; i < sizeof(addresses) / sizeof(addresses[0]); i++) {
+    Module::Address address = addresses[i];
+    Module::Function* function = new Module::Function(
+        i == 2 ? "spill_same_name" : "spill_function", address);
+    function->parameter_size = i;
+    function->ranges.push_back(Module::Range(address, 0x80));
+    function->ranges.push_back(Module::Range(address + 0x100, 0x40));
+    Module::Line line1 = { address, 0x40, file1, static_cast<int>(i + 10) };
+    Module::Line line2 = { address + 0x100, 0x20, i == 2 ? file2 : file1,
+                           static_cast<int>(i + 20) };
+    function->lines.push_back(line1);
+    function->lines.push_back(line2);
+    m->AddFunction(function);
+  }
+  m->AddFunction(generate_duplicate_function("spill_dup"));
+}
+
+TEST(Construct, SpilledFunctions) {
+  stringstream expected, s;
+  Module in_memory(MODULE_NAME, MODULE_OS, MODULE_ARCH, MODULE_ID);
+  add_spill_test_functions(&in_memory);
+  in_memory.SetLoadAddress(0x800);
+  ASSERT_TRUE(in_memory.Write(expected, ALL_SYMBOL_DATA));
+
+  // A one-byte limit spills every function as soon as it is added.
+  Module spilled(MODULE_NAME, MODULE_OS, MODULE_ARCH, MODULE_ID);
+  spilled.SetFunctionMemoryLimit(1);
+  add_spill_test_functions(&spilled);
+  spilled.SetLoadAddress(0x800);
+  ASSERT_TRUE(spilled.Write(s, ALL_SYMBOL_DATA));
+  EXPECT_EQ(expected.str(), s.str());
+
+  vector<Module::Function*> functions;
+  spilled.GetFunctions(&functions, functions.end());
+  EXPECT_TRUE(functions.empty());
+}
+
 // Externs should be written out as PUBLIC records, sorted by
 // address.
 TEST(Construct, Externs) {
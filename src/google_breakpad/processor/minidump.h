@@ -1294,6 +1294,11 @@ class Minidump {
   // Opens the minidump file, or if already open, seeks to the beginning.
   bool Open();
 
+  // If the minidump is gzip-compressed, as the Linux client writes it when
+  // asked to, replaces stream_ with a stream of its decompressed contents.
+  // Expects stream_ to be at the beginning, and leaves it there.
+  bool Decompress();
+
   // The largest number of top-level streams that will be read from a minidump.
   // Note that streams are only read (and only consume memory) as needed,
   // when directed by the caller.  The default is 128.
@@ -1321,6 +1326,10 @@ class Minidump {
   // Set based on the path in Open, or directly in the constructor.
   std::istream*             stream_;
 
+  // The decompressed contents of a compressed minidump, which stream_
+  // refers to in place of the stream they were read from.  Owned.
+  std::istream*             decompressed_stream_;
+
   // swap_ is true if the minidump file should be byte-swapped.  If the
   // minidump was produced by a CPU that is other-endian than the CPU
   // processing the minidump, this will be true.  If the two CPUs are
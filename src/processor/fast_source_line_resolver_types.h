@@ -53,6 +53,12 @@
 
 namespace google_breakpad {
 
+// The number of maps in a serialized FastSourceLineResolver::Module: files,
+// functions, public symbols, one per WindowsFrameInfo::StackInfoTypes, and
+// the CFI initial and delta rules. ModuleSerializer writes this format, and
+// so does Module::WriteSerialized in common/module.cc.
+const int kSerializedModuleMaps = 5 + WindowsFrameInfo::STACK_INFO_LAST;
+
 struct FastSourceLineResolver::Line : public SourceLineResolverBase::Line {
   void CopyFrom(const Line *line_ptr) {
     const char *raw = reinterpret_cast<const char*>(line_ptr);
@@ -141,7 +147,7 @@ class FastSourceLineResolver::Module: public SourceLineResolverBase::Module {
   virtual CFIFrameInfo *FindCFIFrameInfo(const StackFrame *frame) const;
 
   // Number of serialized map components of Module.
-  static const int kNumberMaps_ = 5 + WindowsFrameInfo::STACK_INFO_LAST;
+  static const int kNumberMaps_ = kSerializedModuleMaps;
 
  private:
   friend class FastSourceLineResolver;
@@ -44,6 +44,7 @@
 #include <string>
 
 #include "breakpad_googletest_includes.h"
+#include "common/module.h"
 #include "common/using_std_string.h"
 #include "google_breakpad/processor/code_module.h"
 #include "google_breakpad/processor/stack_frame.h"
@@ -65,6 +66,7 @@ using google_breakpad::MemoryRegion;
 using google_breakpad::StackFrame;
 using google_breakpad::WindowsFrameInfo;
 using google_breakpad::linked_ptr;
+using google_breakpad::scoped_array;
 using google_breakpad::scoped_ptr;
 
 class TestCodeModule : public CodeModule {
@@ -484,6 +486,117 @@ TEST_F(TestFastSourceLineResolver, CompareModule) {
   }
 }
 
+// Fill MODULE with functions, lines, externs and CFI, including records
+// that BasicSourceLineResolver drops or reports as errors.
+static void PopulateModule(google_breakpad::Module* module) {
+  typedef google_breakpad::Module Module;
+  module->SetLoadAddress(0x10000);
+  Module::File* file_a = module->FindFile("a.cc");
+  Module::File* file_b = module->FindFile("b.cc");
+  module->FindFile("unused.cc");
+
+  // A function with two ranges, a line outside both, a zero-size line
+  // and two overlapping lines.
+  Module::Function* function = new Module::Function("Split()", 0x11000);
+  function->parameter_size = 8;
+  function->ranges.push_back(Module::Range(0x11000, 0x100));
+  function->ranges.push_back(Module::Range(0x14000, 0x40));
+  Module::Line lines[] = {
+    { 0x11000, 0x10, file_a, 10 },
+    { 0x11010, 0x0, file_a, 11 },
+    { 0x11020, 0x20, file_b, 12 },
+    { 0x11030, 0x20, file_b, 13 },
+    { 0x14000, 0x40, file_a, 14 },
+    { 0x15000, 0x10, file_a, 15 },
+  };
+  function->lines.assign(lines, lines + sizeof(lines) / sizeof(lines[0]));
+  module->AddFunction(function);
+
+  // A function overlapping the first, and one with no lines.
+  function = new Module::Function("Overlap()", 0x11080);
+  function->ranges.push_back(Module::Range(0x11080, 0x100));
+  module->AddFunction(function);
+  function = new Module::Function("NoLines(int)", 0x12000);
+  function->ranges.push_back(Module::Range(0x12000, 0x30));
+  module->AddFunction(function);
+
+  // Externs, including one at the load address and one with no name.
+  const char* extern_names[] = { "zero", "public_a", "" };
+  const Module::Address extern_addresses[] = { 0x10000, 0x13000, 0x13100 };
+  for (int i = 0; i < 3; i++) {
+    Module::Extern* ext = new Module::Extern(extern_addresses[i]);
+    ext->name = extern_names[i];
+    module->AddExtern(ext);
+  }
+
+  // CFI, including an entry with no initial rules, an empty entry, and
+  // two entries with rule changes at the same address.
+  Module::StackFrameEntry* entry = new Module::StackFrameEntry;
+  entry->address = 0x11000;
+  entry->size = 0x100;
+  entry->initial_rules[".cfa"] = "$esp 4 +";
+  entry->initial_rules[".ra"] = ".cfa 4 - ^";
+  entry->rule_changes[0x11001][".cfa"] = "$esp 8 +";
+  module->AddStackFrameEntry(entry);
+  entry = new Module::StackFrameEntry;
+  entry->address = 0x12000;
+  entry->size = 0x30;
+  entry->rule_changes[0x11001][".cfa"] = "$esp 12 +";
+  module->AddStackFrameEntry(entry);
+  entry = new Module::StackFrameEntry;
+  entry->address = 0x12100;
+  entry->size = 0;
+  entry->initial_rules[".cfa"] = "$esp 4 +";
+  module->AddStackFrameEntry(entry);
+}
+
+// Check that Module::WriteSerialized produces exactly what ModuleSerializer
+// makes of the text symbol file Module::Write produces, and that the
+// result loads into a FastSourceLineResolver.
+static void CheckWriteSerialized(google_breakpad::Module* module,
+                                 SymbolData symbol_data) {
+  std::stringstream text;
+  ASSERT_TRUE(module->Write(text, symbol_data));
+  ModuleSerializer serializer;
+  unsigned int expected_size = 0;
+  scoped_array<char> expected(
+      serializer.SerializeSymbolFileData(text.str(), &expected_size));
+  ASSERT_TRUE(expected.get());
+
+  std::stringstream serialized;
+  ASSERT_TRUE(module->WriteSerialized(serialized, symbol_data));
+  EXPECT_EQ(string(expected.get(), expected_size), serialized.str());
+
+  FastSourceLineResolver fast_resolver;
+  TestCodeModule code_module("serialized");
+  ASSERT_TRUE(fast_resolver.LoadModuleUsingMapBuffer(&code_module,
+                                                     serialized.str()));
+  if (symbol_data != ONLY_CFI) {
+    StackFrame frame;
+    frame.instruction = 0x1020;
+    frame.module = &code_module;
+    fast_resolver.FillSourceLineInfo(&frame);
+    EXPECT_EQ("Split()", frame.function_name);
+    EXPECT_EQ("b.cc", frame.source_file_name);
+    EXPECT_EQ(12, frame.source_line);
+  }
+}
+
+TEST(ModuleWriteSerialized, MatchesModuleSerializer) {
+  google_breakpad::Module module("name", "os", "x86", "id");
+  PopulateModule(&module);
+  CheckWriteSerialized(&module, ALL_SYMBOL_DATA);
+  CheckWriteSerialized(&module, NO_CFI);
+  CheckWriteSerialized(&module, ONLY_CFI);
+}
+
+TEST(ModuleWriteSerialized, SpilledFunctions) {
+  google_breakpad::Module module("name", "os", "x86", "id");
+  module.SetFunctionMemoryLimit(1);
+  PopulateModule(&module);
+  CheckWriteSerialized(&module, ALL_SYMBOL_DATA);
+}
+
 }  // namespace
 
 int main(int argc, char *argv[]) {
@@ -55,11 +55,13 @@ static const char kMicrodumpBegin[] = "-----BEGIN BREAKPAD MICRODUMP-----";
 static const char kMicrodumpEnd[] = "-----END BREAKPAD MICRODUMP-----";
 static const char kOsKey[] = ": O ";
 static const char kCpuKey[] = ": C ";
+static const char kCpuBase64Key[] = ": c ";
 static const char kCrashReasonKey[] = ": R ";
 static const char kGpuKey[] = ": G ";
 static const char kMmapKey[] = ": M ";
 static const char kStackKey[] = ": S ";
 static const char kStackFirstLineKey[] = ": S 0 ";
+static const char kStackBase64Key[] = ": s ";
 static const char kArmArchitecture[] = "arm";
 static const char kArm64Architecture[] = "arm64";
 static const char kX86Architecture[] = "x86";
@@ -83,6 +85,38 @@ std::vector<uint8_t> ParseHexBuf(const string& str) {
   return buf;
 }
 
+// Decodes RFC 4648 base64, as emitted on the "s" and "c" lines. Decoding
+// stops at the first padding or non-alphabet character.
+std::vector<uint8_t> ParseBase64Buf(const string& str) {
+  std::vector<uint8_t> buf;
+  buf.reserve(str.length() / 4 * 3);
+  uint32_t bits = 0;
+  int nbits = 0;
+  for (size_t i = 0; i < str.length(); ++i) {
+    const char c = str[i];
+    int value;
+    if (c >= 'A' && c <= 'Z')
+      value = c - 'A';
+    else if (c >= 'a' && c <= 'z')
+      value = c - 'a' + 26;
+    else if (c >= '0' && c <= '9')
+      value = c - '0' + 52;
+    else if (c == '+')
+      value = 62;
+    else if (c == '/')
+      value = 63;
+    else
+      break;
+    bits = (bits << 6) | value;
+    nbits += 6;
+    if (nbits >= 8) {
+      nbits -= 8;
+      buf.push_back(static_cast<uint8_t>(bits >> nbits));
+    }
+  }
+  return buf;
+}
+
 bool GetLine(std::istringstream* istream, string* str) {
   if (std::getline(*istream, *str)) {
     // Trim any trailing newline from the end of the line. Allows us
@@ -274,7 +308,8 @@ Microdump::Microdump(const string& contents)
       }
 
       // OS line also contains release and version for future use.
-    } else if ((pos = line.find(kStackKey)) != string::npos) {
+    } else if ((pos = line.find(kStackKey)) != string::npos ||
+               (pos = line.find(kStackBase64Key)) != string::npos) {
       if (line.find(kStackFirstLineKey) != string::npos) {
         // The first line of the stack (S 0 stack header) provides the value of
         // the stack pointer, the start address of the stack being dumped and
@@ -296,12 +331,16 @@ Microdump::Microdump(const string& contents)
       } else {
         stack_start = start_addr;
       }
-      std::vector<uint8_t> chunk = ParseHexBuf(raw_content);
+      const bool base64 = line[pos + 2] == 's';
+      std::vector<uint8_t> chunk =
+          base64 ? ParseBase64Buf(raw_content) : ParseHexBuf(raw_content);
       stack_content.insert(stack_content.end(), chunk.begin(), chunk.end());
 
-    } else if ((pos = line.find(kCpuKey)) != string::npos) {
+    } else if ((pos = line.find(kCpuKey)) != string::npos ||
+               (pos = line.find(kCpuBase64Key)) != string::npos) {
       string cpu_state_str(line, pos + strlen(kCpuKey));
-      std::vector<uint8_t> cpu_state_raw = ParseHexBuf(cpu_state_str);
+      std::vector<uint8_t> cpu_state_raw = line[pos + 2] == 'c' ?
+          ParseBase64Buf(cpu_state_str) : ParseHexBuf(cpu_state_str);
       if (strcmp(arch.c_str(), kArmArchitecture) == 0) {
         if (cpu_state_raw.size() != sizeof(MDRawContextARM)) {
           std::cerr << "Malformed CPU context. Got " << cpu_state_raw.size()
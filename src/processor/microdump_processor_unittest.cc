@@ -224,6 +224,20 @@ TEST_F(MicrodumpProcessorTest, TestProcessX86) {
   // names.
 }
 
+TEST_F(MicrodumpProcessorTest, TestProcessX86Base64) {
+  // Same dump as microdump-x86.dmp, with the stack and CPU state
+  // base64-encoded on "s" and "c" lines.
+  ProcessState state;
+  AnalyzeDump("microdump-x86-base64.dmp", false /* omit_symbols */,
+              4 /* expected_cpu_count */, &state);
+
+  ASSERT_EQ(124U, state.modules()->module_count());
+  ASSERT_EQ("x86", state.system_info()->cpu);
+  ASSERT_EQ(17U, state.threads()->at(0)->frames()->size());
+  ASSERT_EQ("libc.so",
+            state.threads()->at(0)->frames()->at(0)->module->debug_file());
+}
+
 TEST_F(MicrodumpProcessorTest, TestProcessMultiple) {
   ProcessState state;
   AnalyzeDump("microdump-multiple.dmp", false /* omit_symbols */,
@@ -33,6 +33,10 @@
 //
 // Author: Mark Mentovai
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include "google_breakpad/processor/minidump.h"
 
 #include <assert.h>
@@ -47,9 +51,15 @@
 #include <unistd.h>
 #endif  // _WIN32
 
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
 #include <algorithm>
 #include <fstream>
+#include <iterator>
 #include <limits>
+#include <sstream>
 #include <utility>
 
 #include "processor/range_map-inl.h"
@@ -5036,6 +5046,7 @@ Minidump::Minidump(const string& path, bool hexdump, unsigned int hexdump_width)
       stream_map_(new MinidumpStreamMap()),
       path_(path),
       stream_(NULL),
+      decompressed_stream_(NULL),
       swap_(false),
       is_big_endian_(false),
       valid_(false),
@@ -5049,6 +5060,7 @@ Minidump::Minidump(istream& stream)
       stream_map_(new MinidumpStreamMap()),
       path_(),
       stream_(&stream),
+      decompressed_stream_(NULL),
       swap_(false),
       is_big_endian_(false),
       valid_(false),
@@ -5060,9 +5072,10 @@ Minidump::~Minidump() {
   if (stream_) {
     BPLOG(INFO) << "Minidump closing minidump";
   }
-  if (!path_.empty()) {
+  if (!path_.empty() && stream_ != decompressed_stream_) {
     delete stream_;
   }
+  delete decompressed_stream_;
   delete directory_;
   delete stream_map_;
 }
@@ -5090,6 +5103,67 @@ bool Minidump::Open() {
   return true;
 }
 
+bool Minidump::Decompress() {
+  // gzip data starts with these two bytes, which no minidump signature does.
+  uint8_t magic[2];
+  if (!ReadBytes(magic, sizeof(magic)) || !SeekSet(0)) {
+    BPLOG(ERROR) << "Minidump cannot read header";
+    return false;
+  }
+  if (magic[0] != 0x1f || magic[1] != 0x8b) {
+    return true;
+  }
+
+#ifndef HAVE_LIBZ
+  BPLOG(ERROR) << "Minidump is compressed, but this was built without zlib";
+  return false;
+#else
+  string compressed((std::istreambuf_iterator<char>(*stream_)),
+                    std::istreambuf_iterator<char>());
+
+  z_stream zstream;
+  memset(&zstream, 0, sizeof(zstream));
+  // Adding 16 to the window bits accepts a gzip header and trailer.
+  if (inflateInit2(&zstream, 15 + 16) != Z_OK) {
+    BPLOG(ERROR) << "Minidump cannot initialize decompression";
+    return false;
+  }
+  zstream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+  zstream.avail_in = static_cast<uInt>(compressed.size());
+
+  // RVAs are 32 bits wide, so a minidump can't be any larger than that.
+  const size_t kMaxSize = std::numeric_limits<uint32_t>::max();
+  string contents;
+  char buffer[64 * 1024];
+  int result;
+  do {
+    zstream.next_out = reinterpret_cast<Bytef*>(buffer);
+    zstream.avail_out = sizeof(buffer);
+    result = inflate(&zstream, Z_NO_FLUSH);
+    contents.append(buffer, sizeof(buffer) - zstream.avail_out);
+  } while (result == Z_OK && contents.size() <= kMaxSize);
+  inflateEnd(&zstream);
+  if (result != Z_STREAM_END) {
+    BPLOG(ERROR) << "Minidump cannot decompress minidump: " <<
+                    (contents.size() > kMaxSize ? "too large" :
+                     zstream.msg ? zstream.msg : "truncated");
+    return false;
+  }
+
+  BPLOG(INFO) << "Minidump decompressed " << compressed.size() <<
+                 " bytes to " << contents.size();
+  std::istream* decompressed = new std::istringstream(contents);
+  if (!path_.empty() && stream_ != decompressed_stream_) {
+    // Open() created the file stream.
+    delete stream_;
+  }
+  delete decompressed_stream_;
+  stream_ = decompressed_stream_ = decompressed;
+  return true;
+#endif  // HAVE_LIBZ
+}
+
 bool Minidump::GetContextCPUFlagsFromSystemInfo(uint32_t *context_cpu_flags) {
   // Initialize output parameters
   *context_cpu_flags = 0;
@@ -5182,6 +5256,11 @@ bool Minidump::Read() {
     return false;
   }
 
+  if (!Decompress()) {
+    BPLOG(ERROR) << "Minidump cannot decompress minidump";
+    return false;
+  }
+
   if (!ReadBytes(&header_, sizeof(MDRawHeader))) {
     BPLOG(ERROR) << "Minidump cannot read header";
     return false;
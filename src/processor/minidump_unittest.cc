@@ -30,12 +30,20 @@
 // Unit test for Minidump.  Uses a pre-generated minidump and
 // verifies that certain streams are correct.
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <vector>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
 
 #include "breakpad_googletest_includes.h"
 #include "common/using_std_string.h"
@@ -131,6 +139,57 @@ TEST_F(MinidumpTest, TestMinidumpFromStream) {
   //TODO: add more checks here
 }
 
+#ifdef HAVE_LIBZ
+
+// Return a gzip-compressed copy of |contents|, as the Linux client writes
+// minidumps when asked to.
+static string Gzip(const string& contents) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  EXPECT_EQ(Z_OK, deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8,
+                               Z_DEFAULT_STRATEGY));
+  string compressed(deflateBound(&stream, contents.size()), '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(contents.data()));
+  stream.avail_in = contents.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+  stream.avail_out = compressed.size();
+  EXPECT_EQ(Z_STREAM_END, deflate(&stream, Z_FINISH));
+  compressed.resize(stream.total_out);
+  deflateEnd(&stream);
+  return compressed;
+}
+
+TEST_F(MinidumpTest, TestCompressedMinidumpFromStream) {
+  ifstream file_stream(minidump_file_.c_str(), std::ios::in | std::ios::binary);
+  ASSERT_TRUE(file_stream.good());
+  std::stringstream contents;
+  contents << file_stream.rdbuf();
+  const string compressed = Gzip(contents.str());
+  ASSERT_LT(compressed.size(), contents.str().size());
+
+  istringstream stream(compressed);
+  Minidump minidump(stream);
+  ASSERT_TRUE(minidump.Read());
+  const MDRawHeader* header = minidump.header();
+  ASSERT_NE(header, (MDRawHeader*)NULL);
+  ASSERT_EQ(header->signature, uint32_t(MD_HEADER_SIGNATURE));
+  MinidumpModuleList *md_module_list = minidump.GetModuleList();
+  ASSERT_TRUE(md_module_list != NULL);
+  const MinidumpModule *md_module = md_module_list->GetModuleAtIndex(0);
+  ASSERT_TRUE(md_module != NULL);
+  ASSERT_EQ("c:\\test_app.exe", md_module->code_file());
+
+  // Reading again starts from the decompressed contents.
+  ASSERT_TRUE(minidump.Read());
+  ASSERT_EQ(header->signature, uint32_t(MD_HEADER_SIGNATURE));
+
+  istringstream truncated(compressed.substr(0, compressed.size() / 2));
+  Minidump truncated_minidump(truncated);
+  ASSERT_FALSE(truncated_minidump.Read());
+}
+
+#endif  // HAVE_LIBZ
+
 TEST(Dump, ReadBackEmpty) {
   Dump dump(0);
   dump.Finish();
@@ -138,6 +138,13 @@
         '../common/common.gyp:common',
         '../third_party/libdisasm/libdisasm.gyp:libdisasm',
       ],
+      'conditions': [
+        ['OS!="win"', {
+          'link_settings': {
+            'libraries': ['-lz'],
+          },
+        }],
+      ],
     },
     {
       'target_name': 'processor_unittests',
@@ -27,23 +27,42 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <dirent.h>
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <paths.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <cstring>
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
 
 #include "common/linux/dump_symbols.h"
+#include "common/linux/eintr_wrapper.h"
+#include "common/module.h"
+#include "common/scoped_ptr.h"
 
+using google_breakpad::Module;
+using google_breakpad::ReadSymbolData;
+using google_breakpad::ReadSymbolDataHeader;
+using google_breakpad::scoped_ptr;
 using google_breakpad::WriteSymbolFile;
 using google_breakpad::WriteSymbolFileHeader;
 
 int usage(const char* self) {
   fprintf(stderr, "Usage: %s [OPTION] <binary-with-debugging-info> "
-          "[directories-for-debug-file]\n\n", self);
+          "[directories-for-debug-file]\n", self);
+  fprintf(stderr, "       %s -b <dir> [OPTION] [binaries-or-directories]"
+          "\n\n", self);
   fprintf(stderr, "Options:\n");
   fprintf(stderr, "  -i:         Output module header information only.\n");
   fprintf(stderr, "  -c          Do not generate CFI section\n");
@@ -53,9 +72,295 @@ int usage(const char* self) {
   fprintf(stderr, "  -n <name>   Use specified name for name of the object\n");
   fprintf(stderr, "  -o <os>     Use specified name for the "
                                  "operating system\n");
+  fprintf(stderr, "  -m <MB>     Keep at most about <MB> megabytes of "
+                                 "functions and line\n"
+                  "              data in memory, spilling the rest to a "
+                                 "temporary file\n");
+  fprintf(stderr, "  -s <file>   Also write the symbols to <file> in the "
+                                 "serialized format\n"
+                  "              loaded by FastSourceLineResolver\n");
+  fprintf(stderr, "  -C <dir>    Keep the functions and lines read from each "
+                                 "compilation unit\n"
+                  "              in <dir>, and reuse them for identical "
+                                 "units in later runs;\n"
+                  "              nothing is ever removed from <dir>\n");
+  fprintf(stderr, "\nBatch mode:\n");
+  fprintf(stderr, "  -b <dir>    Dump every ELF file given, or found under a "
+                                 "directory given,\n"
+                  "              to <dir>/<debug file>/<debug id>/"
+                                 "<debug file>.sym, skipping\n"
+                  "              files whose output already exists\n");
+  fprintf(stderr, "  -l <file>   Also dump the files and directories listed "
+                                 "in <file>, one per\n"
+                  "              line; - reads the list from standard "
+                                 "input\n");
+  fprintf(stderr, "  -j <jobs>   Dump <jobs> files at a time (default: one "
+                                 "per processor)\n");
+  fprintf(stderr, "  -d <dir>    Look for debug files in <dir>; may be "
+                                 "repeated\n");
   return 1;
 }
 
+namespace {
+
+// Dumps many binaries into a symbol store on a pool of worker threads,
+// reporting the outcome and time taken for each on REPORT. Each binary
+// is dumped by a dump_syms child process running DUMP_COMMAND, with the
+// binary's path and DEBUG_DIRS appended, so that a file that trips up
+// the debugging information readers only fails itself rather than the
+// whole batch.
+class BatchDumper {
+ public:
+  BatchDumper(const string& output_dir, const char* obj_os,
+              const std::vector<string>& dump_command,
+              const std::vector<string>& debug_dirs, FILE* report)
+      : output_dir_(output_dir), obj_os_(obj_os),
+        dump_command_(dump_command), debug_dirs_(debug_dirs),
+        report_(report), next_input_(0), dumped_(0), skipped_(0),
+        failed_(0) {
+    pthread_mutex_init(&mutex_, NULL);
+  }
+
+  ~BatchDumper() { pthread_mutex_destroy(&mutex_); }
+
+  // Add PATH to the files to dump: an ELF file, or a directory to
+  // search for ELF files. Symbolic links found while searching are not
+  // followed, since sysroots are full of links to the same libraries.
+  // Return false if PATH can't be read.
+  bool AddInput(const string& path);
+
+  // Add each file or directory listed in LIST_PATH, one per line.
+  // Return false if the list can't be read.
+  bool AddInputList(const char* list_path);
+
+  // Dump all the inputs using JOBS threads. Return true if all of them
+  // were dumped or skipped.
+  bool Run(int jobs);
+
+ private:
+  enum Outcome { DUMPED, SKIPPED, FAILED };
+
+  // Add the ELF files under directory PATH.
+  void AddDirectory(const string& path);
+
+  static void* Worker(void* arg);
+
+  // Dump PATH to the symbol store, setting *SYM_PATH to its symbol
+  // file's name if it gets that far.
+  Outcome Dump(const string& path, string* sym_path);
+
+  // Run a child dump_syms on PATH with its output going to FD. Return
+  // true if it succeeded.
+  bool RunDumpCommand(const string& path, int fd);
+
+  const string output_dir_;
+  const char* obj_os_;
+  const std::vector<string>& dump_command_;
+  const std::vector<string>& debug_dirs_;
+  FILE* report_;
+
+  // The files to dump, and the index of the next one to hand out. These
+  // and the counts of outcomes are protected by mutex_ once Run starts.
+  std::vector<string> inputs_;
+  size_t next_input_;
+  int dumped_, skipped_, failed_;
+  pthread_mutex_t mutex_;
+};
+
+// Return true if PATH starts with the ELF magic number.
+bool IsElfFile(const string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  char magic[SELFMAG];
+  bool is_elf = read(fd, magic, SELFMAG) == SELFMAG &&
+                memcmp(magic, ELFMAG, SELFMAG) == 0;
+  close(fd);
+  return is_elf;
+}
+
+// Create directory PATH and any missing parents. Return false if that
+// fails.
+bool MakeDirectories(const string& path) {
+  for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+    string prefix = path.substr(0, slash);
+    if (mkdir(prefix.c_str(), 0777) != 0 && errno != EEXIST)
+      return false;
+    if (slash == string::npos)
+      return true;
+  }
+}
+
+double Now() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+bool BatchDumper::AddInput(const string& path) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    fprintf(report_, "FAILED %s: %s\n", path.c_str(), strerror(errno));
+    failed_++;
+    return false;
+  }
+  if (S_ISDIR(st.st_mode))
+    AddDirectory(path);
+  else
+    inputs_.push_back(path);
+  return true;
+}
+
+bool BatchDumper::AddInputList(const char* list_path) {
+  std::ifstream file;
+  std::istream* list = &std::cin;
+  if (strcmp(list_path, "-") != 0) {
+    file.open(list_path);
+    if (!file) {
+      fprintf(report_, "FAILED %s: %s\n", list_path, strerror(errno));
+      failed_++;
+      return false;
+    }
+    list = &file;
+  }
+  string line;
+  while (std::getline(*list, line)) {
+    if (!line.empty())
+      AddInput(line);
+  }
+  return true;
+}
+
+void BatchDumper::AddDirectory(const string& path) {
+  DIR* dir = opendir(path.c_str());
+  if (!dir) {
+    fprintf(report_, "FAILED %s: %s\n", path.c_str(), strerror(errno));
+    failed_++;
+    return;
+  }
+  while (struct dirent* entry = readdir(dir)) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+      continue;
+    string entry_path = path + "/" + entry->d_name;
+    struct stat st;
+    if (lstat(entry_path.c_str(), &st) != 0)
+      continue;
+    if (S_ISDIR(st.st_mode))
+      AddDirectory(entry_path);
+    else if (S_ISREG(st.st_mode) && IsElfFile(entry_path))
+      inputs_.push_back(entry_path);
+  }
+  closedir(dir);
+}
+
+bool BatchDumper::Run(int jobs) {
+  double start = Now();
+  std::vector<pthread_t> threads;
+  for (int i = 0; i < jobs && static_cast<size_t>(i) < inputs_.size(); ++i) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, Worker, this) != 0)
+      break;
+    threads.push_back(thread);
+  }
+  // If no threads could be started, do the work on this one.
+  if (threads.empty())
+    Worker(this);
+  for (size_t i = 0; i < threads.size(); ++i)
+    pthread_join(threads[i], NULL);
+
+  fprintf(report_, "%d dumped, %d skipped, %d failed in %.3fs\n",
+          dumped_, skipped_, failed_, Now() - start);
+  return failed_ == 0;
+}
+
+void* BatchDumper::Worker(void* arg) {
+  BatchDumper* self = static_cast<BatchDumper*>(arg);
+  pthread_mutex_lock(&self->mutex_);
+  while (self->next_input_ < self->inputs_.size()) {
+    const string path = self->inputs_[self->next_input_++];
+    pthread_mutex_unlock(&self->mutex_);
+
+    double start = Now();
+    string sym_path;
+    Outcome outcome = self->Dump(path, &sym_path);
+    double elapsed = Now() - start;
+
+    pthread_mutex_lock(&self->mutex_);
+    const char* status;
+    switch (outcome) {
+      case DUMPED:  status = "DUMPED";  self->dumped_++;  break;
+      case SKIPPED: status = "SKIPPED"; self->skipped_++; break;
+      default:      status = "FAILED";  self->failed_++;  break;
+    }
+    fprintf(self->report_, "%s %.3fs %s", status, elapsed, path.c_str());
+    if (outcome != FAILED)
+      fprintf(self->report_, " -> %s", sym_path.c_str());
+    fprintf(self->report_, "\n");
+    fflush(self->report_);
+  }
+  pthread_mutex_unlock(&self->mutex_);
+  return NULL;
+}
+
+BatchDumper::Outcome BatchDumper::Dump(const string& path, string* sym_path) {
+  // The build id is cheap to find, so check for existing output before
+  // reading any debugging information.
+  Module* header;
+  if (!ReadSymbolDataHeader(path, path, obj_os_, &header))
+    return FAILED;
+  const string name = header->name();
+  const string dir = output_dir_ + "/" + name + "/" + header->identifier();
+  delete header;
+  *sym_path = dir + "/" + name + ".sym";
+  if (access(sym_path->c_str(), F_OK) == 0)
+    return SKIPPED;
+
+  // Write to a temporary file and rename it into place, so that an
+  // interrupted run or two copies of one binary never leave a partial
+  // symbol file behind for the next run to skip.
+  if (!MakeDirectories(dir))
+    return FAILED;
+  string temp_path = *sym_path + ".XXXXXX";
+  int fd = mkostemp(&temp_path[0], O_CLOEXEC);
+  if (fd < 0)
+    return FAILED;
+  bool dumped = RunDumpCommand(path, fd);
+  close(fd);
+  if (!dumped || rename(temp_path.c_str(), sym_path->c_str()) != 0) {
+    unlink(temp_path.c_str());
+    return FAILED;
+  }
+  return DUMPED;
+}
+
+bool BatchDumper::RunDumpCommand(const string& path, int fd) {
+  // Build the argument vector before forking; the child of a threaded
+  // process may only make async-signal-safe calls before exec.
+  std::vector<string> args(dump_command_);
+  args.push_back(path);
+  args.insert(args.end(), debug_dirs_.begin(), debug_dirs_.end());
+  std::vector<char*> argv;
+  for (size_t i = 0; i < args.size(); ++i)
+    argv.push_back(&args[i][0]);
+  argv.push_back(NULL);
+
+  pid_t child = fork();
+  if (child < 0)
+    return false;
+  if (child == 0) {
+    if (dup2(fd, STDOUT_FILENO) < 0)
+      _exit(1);
+    execv(argv[0], &argv[0]);
+    _exit(1);
+  }
+  int status;
+  if (HANDLE_EINTR(waitpid(child, &status, 0)) < 0)
+    return false;
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+}  // namespace
+
 int main(int argc, char **argv) {
   if (argc < 2)
     return usage(argv[0]);
@@ -63,7 +368,14 @@ int main(int argc, char **argv) {
   bool cfi = true;
   bool handle_inter_cu_refs = true;
   bool log_to_stderr = false;
+  size_t function_memory_limit = 0;
   std::string obj_name;
+  const char* serialized_path = NULL;
+  const char* cu_cache_dir = NULL;
+  const char* batch_dir = NULL;
+  const char* batch_list = NULL;
+  long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  std::vector<string> batch_debug_dirs;
   const char* obj_os = "Linux";
   int arg_index = 1;
   while (arg_index < argc && strlen(argv[arg_index]) > 0 &&
@@ -90,14 +402,85 @@ int main(int argc, char **argv) {
       }
       obj_os = argv[arg_index + 1];
       ++arg_index;
+    } else if (strcmp("-m", argv[arg_index]) == 0) {
+      if (arg_index + 1 >= argc) {
+        fprintf(stderr, "Missing argument to -m\n");
+        return usage(argv[0]);
+      }
+      char* end;
+      unsigned long megabytes = strtoul(argv[arg_index + 1], &end, 10);
+      if (*end != '\0' || megabytes == 0) {
+        fprintf(stderr, "Invalid argument to -m\n");
+        return usage(argv[0]);
+      }
+      function_memory_limit = static_cast<size_t>(megabytes) << 20;
+      ++arg_index;
+    } else if (strcmp("-s", argv[arg_index]) == 0) {
+      if (arg_index + 1 >= argc) {
+        fprintf(stderr, "Missing argument to -s\n");
+        return usage(argv[0]);
+      }
+      serialized_path = argv[arg_index + 1];
+      ++arg_index;
+    } else if (strcmp("-C", argv[arg_index]) == 0) {
+      if (arg_index + 1 >= argc) {
+        fprintf(stderr, "Missing argument to -C\n");
+        return usage(argv[0]);
+      }
+      cu_cache_dir = argv[arg_index + 1];
+      ++arg_index;
+    } else if (strcmp("-b", argv[arg_index]) == 0) {
+      if (arg_index + 1 >= argc) {
+        fprintf(stderr, "Missing argument to -b\n");
+        return usage(argv[0]);
+      }
+      batch_dir = argv[arg_index + 1];
+      ++arg_index;
+    } else if (strcmp("-l", argv[arg_index]) == 0) {
+      if (arg_index + 1 >= argc) {
+        fprintf(stderr, "Missing argument to -l\n");
+        return usage(argv[0]);
+      }
+      batch_list = argv[arg_index + 1];
+      ++arg_index;
+    } else if (strcmp("-j", argv[arg_index]) == 0) {
+      if (arg_index + 1 >= argc) {
+        fprintf(stderr, "Missing argument to -j\n");
+        return usage(argv[0]);
+      }
+      char* end;
+      jobs = strtol(argv[arg_index + 1], &end, 10);
+      if (*end != '\0' || jobs <= 0) {
+        fprintf(stderr, "Invalid argument to -j\n");
+        return usage(argv[0]);
+      }
+      ++arg_index;
+    } else if (strcmp("-d", argv[arg_index]) == 0) {
+      if (arg_index + 1 >= argc) {
+        fprintf(stderr, "Missing argument to -d\n");
+        return usage(argv[0]);
+      }
+      batch_debug_dirs.push_back(argv[arg_index + 1]);
+      ++arg_index;
     } else {
       printf("2.4 %s\n", argv[arg_index]);
       return usage(argv[0]);
     }
     ++arg_index;
   }
-  if (arg_index == argc)
+  if (batch_dir) {
+    if (header_only || serialized_path || !obj_name.empty()) {
+      fprintf(stderr, "-i, -n and -s can't be used in batch mode\n");
+      return usage(argv[0]);
+    }
+    if (arg_index == argc && !batch_list)
+      return usage(argv[0]);
+  } else if (batch_list || !batch_debug_dirs.empty()) {
+    fprintf(stderr, "-l and -d can only be used in batch mode\n");
     return usage(argv[0]);
+  } else if (arg_index == argc) {
+    return usage(argv[0]);
+  }
   // Save stderr so it can be used below.
   FILE* saved_stderr = fdopen(dup(fileno(stderr)), "w");
   if (!log_to_stderr) {
@@ -106,6 +489,35 @@ int main(int argc, char **argv) {
       // Add this brace section to silence gcc warnings.
     }
   }
+  if (batch_dir) {
+    // Each binary is dumped by running this program again on it alone.
+    std::vector<string> dump_command;
+    dump_command.push_back("/proc/self/exe");
+    if (!cfi)
+      dump_command.push_back("-c");
+    if (!handle_inter_cu_refs)
+      dump_command.push_back("-r");
+    if (log_to_stderr)
+      dump_command.push_back("-v");
+    if (function_memory_limit) {
+      dump_command.push_back("-m");
+      dump_command.push_back(std::to_string(function_memory_limit >> 20));
+    }
+    if (cu_cache_dir) {
+      dump_command.push_back("-C");
+      dump_command.push_back(cu_cache_dir);
+    }
+    dump_command.push_back("-o");
+    dump_command.push_back(obj_os);
+    BatchDumper dumper(batch_dir, obj_os, dump_command, batch_debug_dirs,
+                       stdout);
+    for (; arg_index < argc; ++arg_index)
+      dumper.AddInput(argv[arg_index]);
+    if (batch_list)
+      dumper.AddInputList(batch_list);
+    return dumper.Run(jobs > 0 ? jobs : 1) ? 0 : 1;
+  }
+
   const char* binary;
   std::vector<string> debug_dirs;
   binary = argv[arg_index];
@@ -126,8 +538,30 @@ int main(int argc, char **argv) {
   } else {
     SymbolData symbol_data = cfi ? ALL_SYMBOL_DATA : NO_CFI;
     google_breakpad::DumpOptions options(symbol_data, handle_inter_cu_refs);
-    if (!WriteSymbolFile(binary, obj_name, obj_os, debug_dirs, options,
-                         std::cout)) {
+    options.function_memory_limit = function_memory_limit;
+    if (cu_cache_dir)
+      options.cu_cache_dir = cu_cache_dir;
+    if (serialized_path) {
+      Module* module;
+      if (!ReadSymbolData(binary, obj_name, obj_os, debug_dirs, options,
+                          &module)) {
+        fprintf(saved_stderr, "Failed to read symbol data.\n");
+        return 1;
+      }
+      scoped_ptr<Module> module_owner(module);
+      if (!module->Write(std::cout, symbol_data)) {
+        fprintf(saved_stderr, "Failed to write symbol file.\n");
+        return 1;
+      }
+      std::ofstream serialized(serialized_path,
+                               std::ios::out | std::ios::binary);
+      if (!serialized || !module->WriteSerialized(serialized, symbol_data)) {
+        fprintf(saved_stderr, "Failed to write serialized symbol file: %s\n",
+                serialized_path);
+        return 1;
+      }
+    } else if (!WriteSymbolFile(binary, obj_name, obj_os, debug_dirs, options,
+                                std::cout)) {
       fprintf(saved_stderr, "Failed to write symbol file.\n");
       return 1;
     }
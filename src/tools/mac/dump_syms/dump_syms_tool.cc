@@ -62,46 +62,46 @@ struct Options {
   bool handle_inter_cu_refs;
 };
 
-static bool StackFrameEntryComparator(const Module::StackFrameEntry* a,
-                                      const Module::StackFrameEntry* b) {
-  return a->address < b->address;
+static bool StackFrameEntryComparator(const Module::StackFrameEntry& a,
+                                      const Module::StackFrameEntry& b) {
+  return a.address < b.address;
 }
 
 // Copy the CFI data from |from_module| into |to_module|, for any non-
 // overlapping ranges.
 static void CopyCFIDataBetweenModules(Module* to_module,
                                       const Module* from_module) {
-  typedef vector<Module::StackFrameEntry*>::const_iterator Iterator;
+  typedef vector<Module::StackFrameEntry>::const_iterator Iterator;
 
   // Get the CFI data from both the source and destination modules and ensure
   // it is sorted by start address.
-  vector<Module::StackFrameEntry*> from_data;
+  vector<Module::StackFrameEntry> from_data;
   from_module->GetStackFrameEntries(&from_data);
   std::sort(from_data.begin(), from_data.end(), &StackFrameEntryComparator);
 
-  vector<Module::StackFrameEntry*> to_data;
+  vector<Module::StackFrameEntry> to_data;
   to_module->GetStackFrameEntries(&to_data);
   std::sort(to_data.begin(), to_data.end(), &StackFrameEntryComparator);
 
   Iterator to_it = to_data.begin();
 
   for (Iterator it = from_data.begin(); it != from_data.end(); ++it) {
-    Module::StackFrameEntry* from_entry = *it;
-    Module::Address from_entry_end = from_entry->address + from_entry->size;
+    const Module::StackFrameEntry& from_entry = *it;
+    Module::Address from_entry_end = from_entry.address + from_entry.size;
 
     // Find the first CFI record in the |to_module| that does not have an
     // address less than the entry to be copied.
     while (to_it != to_data.end()) {
-      if (from_entry->address > (*to_it)->address)
+      if (from_entry.address > to_it->address)
         ++to_it;
       else
         break;
     }
 
     // If the entry does not overlap, then it is safe to copy to |to_module|.
-    if (to_it == to_data.end() || (from_entry->address < (*to_it)->address &&
-            from_entry_end < (*to_it)->address)) {
-      to_module->AddStackFrameEntry(new Module::StackFrameEntry(*from_entry));
+    if (to_it == to_data.end() || (from_entry.address < to_it->address &&
+            from_entry_end < to_it->address)) {
+      to_module->AddStackFrameEntry(new Module::StackFrameEntry(from_entry));
     }
   }
 }